@@ -42,7 +42,7 @@ extern "C"
 #define GASPI_TEST        (0x0)
 #define GASPI_MAX_NODES   (65536)
 #define GASPI_MAX_GROUPS  (32)
-#define GASPI_MAX_MSEGS   (32)
+#define GASPI_MAX_MSEGS   (32) /* default segment_max */
 #define GASPI_GROUP_ALL   (0)
 #define GASPI_MAX_QP      (16)
 #define GASPI_COLL_QP     (GASPI_MAX_QP)
@@ -74,6 +74,7 @@ extern "C"
   typedef unsigned char gaspi_queue_id_t;
   typedef unsigned long gaspi_size_t;
   typedef unsigned long gaspi_alloc_t;
+  typedef unsigned int gaspi_memory_description_t;
   typedef unsigned char gaspi_segment_id_t;
   typedef unsigned long gaspi_offset_t;
   typedef unsigned long gaspi_atomic_value_t;
@@ -134,7 +135,9 @@ extern "C"
     GASPI_TYPE_FLOAT = 2,
     GASPI_TYPE_DOUBLE = 3,
     GASPI_TYPE_LONG = 4,
-    GASPI_TYPE_ULONG = 5
+    GASPI_TYPE_ULONG = 5,
+    GASPI_TYPE_HALF = 6,      /**< IEEE 754 binary16 (reduced in float) */
+    GASPI_TYPE_BFLOAT16 = 7   /**< bfloat16 (reduced in float) */
   } gaspi_datatype_t;
 
   /**
@@ -147,6 +150,16 @@ extern "C"
     GASPI_STATE_CORRUPT = 1
   } gaspi_qp_state_t;
 
+  /**
+   * Write-back of file backed segments.
+   * 
+   */
+  typedef enum
+  {
+    GASPI_SYNC_WAIT = 0,  /**< Return when the data is written */
+    GASPI_SYNC_ASYNC = 1  /**< Only start the write-back */
+  } gaspi_sync_mode_t;
+
   /**
    * Memory allocation policy.
    * 
@@ -155,10 +168,20 @@ extern "C"
   {
     GASPI_MEM_UNINITIALIZED = 0, /**< Memory will not be initialized */
     GASPI_MEM_INITIALIZED = 1,	 /**< Memory will be initialized (zero-ed) */
-    GASPI_MEM_GPU = 2
+    GASPI_MEM_GPU = 2,
+    GASPI_MEM_HUGEPAGE = 4,	 /**< Back with huge pages of the default size */
+    GASPI_MEM_HUGEPAGE_2M = 8,	 /**< Back with 2 MB huge pages */
+    GASPI_MEM_HUGEPAGE_1G = 16,	 /**< Back with 1 GB huge pages */
+    GASPI_MEM_NUMA_LOCAL = 32,	 /**< Place on the NUMA node of the calling thread */
+    GASPI_MEM_NUMA_INTERLEAVE = 64, /**< Interleave over all allowed NUMA nodes */
+    GASPI_MEM_NUMA_BIND = 128,	 /**< Bind to a node, see GASPI_MEM_NUMA_NODE */
+    GASPI_MEM_PARALLEL_TOUCH = 256 /**< First-touch pages in parallel from all CPUs of the process */
   };
 
 #define GASPI_ALLOC_DEFAULT GASPI_MEM_UNINITIALIZED 
+
+  /** Allocation policy binding a segment to NUMA node (node) */
+#define GASPI_MEM_NUMA_NODE(node) (GASPI_MEM_NUMA_BIND | ((gaspi_alloc_t) (node) << 16))
   
   /**
    * A structure with configuration.
@@ -177,14 +200,18 @@ extern "C"
     gaspi_uint queue_depth;  /* the queue depth (size) to use */
     gaspi_uint queue_num;    /* the number of queues to use */
     gaspi_number_t group_max;
-    gaspi_number_t segment_max;
+    gaspi_number_t segment_max; /* max. number of segments (up to 256) */
     gaspi_size_t transfer_size_max;
-    gaspi_number_t notification_num;
+    gaspi_number_t notification_num; /* notifications per segment */
     gaspi_number_t passive_queue_size_max;
     gaspi_number_t passive_transfer_size_max;
     gaspi_size_t allreduce_buf_size;
     gaspi_number_t allreduce_elem_max;
     gaspi_number_t build_infrastructure;
+    gaspi_number_t allreduce_reproducible; /* bitwise reproducible float/double sums */
+    gaspi_number_t segment_lazy; /* exchange segment info on first access */
+    gaspi_number_t connect_lazy; /* connect to a rank on first access */
+    gaspi_number_t queue_lazy_tnc; /* above this many ranks, queues > 0 are set up on first use */
 
   } gaspi_config_t;
 
@@ -335,6 +362,32 @@ extern "C"
   gaspi_return_t gaspi_connect (const gaspi_rank_t rank,
 				const gaspi_timeout_t timeout_ms);
 
+  /** Connect to a list of ranks at once. The requests to all ranks
+   * are sent before any reply is awaited and the queue pairs are
+   * brought up in parallel, so the time is bounded by the round
+   * trips rather than by the number of ranks. Ranks already
+   * connected are skipped.
+   * 
+   * @param rank_list The ranks to connect to.
+   * @param num The number of ranks in the list.
+   * @param timeout_ms Timeout in milliseconds (or GASPI_BLOCK/GASPI_TEST).
+   * 
+   * @return GASPI_SUCCESS in case of success, GASPI_ERROR in case of
+   * error, GASPI_TIMEOUT in case of timeout.
+   */
+  gaspi_return_t gaspi_connect_list (const gaspi_rank_t * const rank_list,
+				     const gaspi_number_t num,
+				     const gaspi_timeout_t timeout_ms);
+
+  /** Connect to all ranks (see gaspi_connect_list).
+   * 
+   * @param timeout_ms Timeout in milliseconds (or GASPI_BLOCK/GASPI_TEST).
+   * 
+   * @return GASPI_SUCCESS in case of success, GASPI_ERROR in case of
+   * error, GASPI_TIMEOUT in case of timeout.
+   */
+  gaspi_return_t gaspi_connect_all (const gaspi_timeout_t timeout_ms);
+
   /** Disconnect from a particular rank. 
    * 
    * 
@@ -388,6 +441,28 @@ extern "C"
   gaspi_return_t gaspi_group_commit (const gaspi_group_t group,
 				     const gaspi_timeout_t timeout_ms);
 
+  /** Split a group into sub-groups (collective over the parent).
+   *
+   * Members with the same color end up in the same new group, ranked
+   * by key (ties by their rank in the parent). The new groups are
+   * committed on return. After a timeout, the call must be repeated
+   * with the same arguments to complete the split.
+   *
+   * @param parent The group to split.
+   * @param color The sub-group selector.
+   * @param key The ordering of the ranks in the sub-group.
+   * @param group Output parameter with the new group.
+   * @param timeout_ms Timeout in milliseconds (or GASPI_BLOCK/GASPI_TEST).
+   *
+   * @return GASPI_SUCCESS in case of success, GASPI_ERROR in case of
+   * error, GASPI_TIMEOUT in case of timeout.
+   */
+  gaspi_return_t gaspi_group_split (const gaspi_group_t parent,
+				    const int color,
+				    const int key,
+				    gaspi_group_t * const group,
+				    const gaspi_timeout_t timeout_ms);
+
   /** Get the current number of created groups. 
    * 
    * 
@@ -465,9 +540,32 @@ extern "C"
 					 const gaspi_rank_t rank,
 					 const gaspi_timeout_t timeout_ms);
 
+  /** Fetch the segment information (address, key, size) of a list of
+   * ranks, e.g. the neighbours of a rank. The information of a
+   * segment that was not registered with us is otherwise fetched on
+   * its first access, which is the only exchange taking place when
+   * segment_lazy is set in the configuration.
+   * 
+   * 
+   * @param segment_id The segment id.
+   * @param rank_list The ranks to fetch the segment information from.
+   * @param num The number of ranks in rank_list.
+   * @param timeout_ms Timeout in milliseconds (or GASPI_BLOCK/GASPI_TEST).
+   * 
+   * @return GASPI_SUCCESS in case of success, GASPI_ERROR in case of
+   * error (e.g. the segment does not exist on a rank), GASPI_TIMEOUT in
+   * case of timeout.
+   */
+  gaspi_return_t gaspi_segment_prefetch (const gaspi_segment_id_t segment_id,
+					 const gaspi_rank_t * const rank_list,
+					 const gaspi_number_t num,
+					 const gaspi_timeout_t timeout_ms);
+
   /** Create a segment. It is semantically equivalent to a collective
    * aggregation of gaspi_segment_ alloc, gaspi_segment_register and
    * gaspi_barrier involving all of the mem- bers of a given group.
+   * With segment_lazy set in the configuration the registration is
+   * skipped and done on first access (see gaspi_segment_prefetch).
    * 
    * 
    * @param segment_id The segment id to identify the segment.
@@ -485,6 +583,81 @@ extern "C"
 				       const gaspi_timeout_t timeout_ms,
 				       const gaspi_alloc_t alloc_policy);
 
+  /** Bind memory provided by the application to a segment. The
+   * memory is registered in place (no copy) and must stay valid
+   * until the segment is deleted. The notification area of the
+   * segment is allocated separately.
+   * 
+   * 
+   * @param segment_id The segment identifier to be bound.
+   * @param pointer The start of the memory.
+   * @param size The size of the memory (in bytes).
+   * @param memory_description Description of the memory (reserved, use 0).
+   * 
+   * @return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+   */
+  gaspi_return_t gaspi_segment_bind (const gaspi_segment_id_t segment_id,
+				     const gaspi_pointer_t pointer,
+				     const gaspi_size_t size,
+				     const gaspi_memory_description_t memory_description);
+
+  /** Use memory provided by the application as a segment. It is
+   * semantically equivalent to a collective aggregation of
+   * gaspi_segment_bind, gaspi_segment_register and gaspi_barrier
+   * involving all of the members of a given group.
+   * 
+   * 
+   * @param segment_id The segment id to identify the segment.
+   * @param pointer The start of the memory.
+   * @param size The size of the memory (in bytes).
+   * @param group The group of ranks with which the segment should be registered.
+   * @param timeout_ms Timeout in milliseconds (or GASPI_BLOCK/GASPI_TEST).
+   * @param memory_description Description of the memory (reserved, use 0).
+   * 
+   * @return GASPI_SUCCESS in case of success, GASPI_ERROR in case of
+   * error, GASPI_TIMEOUT in case of timeout.
+   */
+  gaspi_return_t gaspi_segment_use (const gaspi_segment_id_t segment_id,
+				    const gaspi_pointer_t pointer,
+				    const gaspi_size_t size,
+				    const gaspi_group_t group,
+				    const gaspi_timeout_t timeout_ms,
+				    const gaspi_memory_description_t memory_description);
+
+  /** Allocate a segment backed by a file, mapped shared. The file
+   * must be on tmpfs (e.g. /dev/shm) or hugetlbfs: the pages of a
+   * disk file cannot stay pinned for the network, and data written
+   * by remote ranks would not reach the disk. The file is created or
+   * grown to size; existing content is kept, so a restarted process
+   * gets its data back without copying. Other processes can map the
+   * file to inspect the segment. The segment is registered as with
+   * gaspi_segment_alloc.
+   *
+   * @param segment_id The segment identifier to be created.
+   * @param path The path of the file.
+   * @param size The size of the segment (in bytes).
+   *
+   * @return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+   */
+  gaspi_return_t gaspi_segment_alloc_file (const gaspi_segment_id_t segment_id,
+					   const char * const path,
+					   const gaspi_size_t size);
+
+  /** Write back a range of a file backed segment to its file.
+   *
+   * @param segment_id The segment (see gaspi_segment_alloc_file).
+   * @param offset The start of the range.
+   * @param size The size of the range (in bytes).
+   * @param mode GASPI_SYNC_ASYNC to only start the write-back,
+   * GASPI_SYNC_WAIT to return when the data is written.
+   *
+   * @return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+   */
+  gaspi_return_t gaspi_segment_sync (const gaspi_segment_id_t segment_id,
+				     const gaspi_offset_t offset,
+				     const gaspi_size_t size,
+				     const gaspi_sync_mode_t mode);
+
   /** Get the number of allocated segments. 
    * 
    * 
@@ -539,6 +712,67 @@ extern "C"
    */
   gaspi_return_t gaspi_segment_max (gaspi_number_t * const segment_max);
 
+  /** Allocate a block of a local segment. Blocks up to 32 KB come
+   * from size classes (a power of two, aligned to their size), larger
+   * ones are aligned to 64 KB. Thread safe; the common case takes no
+   * lock.
+   *
+   * @param segment_id The segment to allocate from.
+   * @param size The size of the block (in bytes).
+   * @param offset Output parameter with the offset of the block in
+   * the segment.
+   *
+   * @return GASPI_SUCCESS in case of success, GASPI_ERROR in case of
+   * error (e.g. the segment is full).
+   */
+  gaspi_return_t gaspi_segment_malloc (const gaspi_segment_id_t segment_id,
+				       const gaspi_size_t size,
+				       gaspi_offset_t * const offset);
+
+  /** Free a block allocated with gaspi_segment_malloc.
+   *
+   * @param segment_id The segment of the block.
+   * @param offset The offset of the block.
+   *
+   * @return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+   */
+  gaspi_return_t gaspi_segment_free (const gaspi_segment_id_t segment_id,
+				     const gaspi_offset_t offset);
+
+  /** Reserve the start of a local segment for allocations by other
+   * ranks (gaspi_segment_remote_malloc). Must be called once, before
+   * the first gaspi_segment_malloc on the segment, and before the
+   * other ranks allocate (e.g. followed by a barrier).
+   *
+   * @param segment_id The segment.
+   * @param size The size of the remote heap (in bytes).
+   *
+   * @return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+   */
+  gaspi_return_t gaspi_segment_remote_heap (const gaspi_segment_id_t segment_id,
+					    const gaspi_size_t size);
+
+  /** Allocate a block of the remote heap of a segment of another
+   * rank, with a remote atomic (no involvement of the remote
+   * process). Blocks are 8 byte aligned and cannot be freed.
+   *
+   * @param segment_id The remote segment.
+   * @param rank The rank owning the segment.
+   * @param size The size of the block (in bytes).
+   * @param offset Output parameter with the offset of the block in
+   * the remote segment.
+   * @param timeout_ms Timeout in milliseconds (or GASPI_BLOCK/GASPI_TEST).
+   *
+   * @return GASPI_SUCCESS in case of success, GASPI_ERROR in case of
+   * error (e.g. the remote heap is exhausted), GASPI_TIMEOUT in case
+   * of timeout.
+   */
+  gaspi_return_t gaspi_segment_remote_malloc (const gaspi_segment_id_t segment_id,
+					      const gaspi_rank_t rank,
+					      const gaspi_size_t size,
+					      gaspi_offset_t * const offset,
+					      const gaspi_timeout_t timeout_ms);
+
   /// \name One-sided communication.
   //@{  
   /** One-sided write.
@@ -670,6 +904,35 @@ extern "C"
   gaspi_return_t gaspi_barrier (const gaspi_group_t group,
 				const gaspi_timeout_t timeout_ms);
 
+  /** Start a split-phase barrier.
+   *
+   * Signals arrival to the first peer and returns. Local work can be
+   * done before completing the barrier with gaspi_barrier_end. No
+   * other collective can be started on the group in between.
+   *
+   * @param group The group involved in the barrier.
+   *
+   * @return GASPI_SUCCESS in case of success, GASPI_ERROR in case of
+   * error.
+   */
+  gaspi_return_t gaspi_barrier_begin (const gaspi_group_t group);
+
+  /** Complete a split-phase barrier.
+   *
+   * Drives the remaining rounds of a barrier started with
+   * gaspi_barrier_begin. With GASPI_TEST it can be used to test for
+   * completion and be called again after GASPI_TIMEOUT.
+   *
+   * @param group The group involved in the barrier.
+   * @param timeout_ms Timeout in milliseconds (or GASPI_BLOCK/GASPI_TEST).
+   *
+   * @return GASPI_SUCCESS in case of success, GASPI_ERROR in case of
+   * error (also if no barrier was begun), GASPI_TIMEOUT in case of
+   * timeout.
+   */
+  gaspi_return_t gaspi_barrier_end (const gaspi_group_t group,
+				    const gaspi_timeout_t timeout_ms);
+
   /** All Reduce collective operation. 
    * 
    * 
@@ -1085,6 +1348,21 @@ extern "C"
    */
   gaspi_return_t gaspi_state_vec_get (gaspi_state_vector_t state_vector);
 
+  /** Memory used by the library for its own state: per rank tables,
+   * per peer state, group buffers and segment descriptor tables (not
+   * the segments themselves nor the QPs kept by the driver).
+   * 
+   * 
+   * @param peers Output parameter with the number of peers with an endpoint.
+   * @param peer_bytes Output parameter with the bytes of per peer state.
+   * @param total_bytes Output parameter with the bytes of all library state.
+   * 
+   * @return GASPI_SUCCESS in case of success, GASPI_ERROR in case of error.
+   */
+  gaspi_return_t gaspi_memory_report (gaspi_number_t * const peers,
+				      gaspi_size_t * const peer_bytes,
+				      gaspi_size_t * const total_bytes);
+
   /** GASPI printf to print the gaspi_logger. 
    * 
    * 
@@ -53,6 +53,12 @@ extern "C"
   gaspi_return_t pgaspi_connect (const gaspi_rank_t rank,
 				const gaspi_timeout_t timeout_ms);
 
+  gaspi_return_t pgaspi_connect_list (const gaspi_rank_t * const rank_list,
+				     const gaspi_number_t num,
+				     const gaspi_timeout_t timeout_ms);
+
+  gaspi_return_t pgaspi_connect_all (const gaspi_timeout_t timeout_ms);
+
   gaspi_return_t pgaspi_disconnect (const gaspi_rank_t rank,
 				   const gaspi_timeout_t timeout_ms);
 
@@ -67,6 +73,12 @@ extern "C"
   gaspi_return_t pgaspi_group_commit (const gaspi_group_t group,
 				     const gaspi_timeout_t timeout_ms);
 
+  gaspi_return_t pgaspi_group_split (const gaspi_group_t parent,
+				     const int color,
+				     const int key,
+				     gaspi_group_t * const group,
+				     const gaspi_timeout_t timeout_ms);
+
   gaspi_return_t pgaspi_group_num (gaspi_number_t * const group_num);
 
   gaspi_return_t pgaspi_group_size (const gaspi_group_t group,
@@ -88,6 +100,11 @@ extern "C"
 					 const gaspi_rank_t rank,
 					 const gaspi_timeout_t timeout_ms);
 
+  gaspi_return_t pgaspi_segment_prefetch (const gaspi_segment_id_t segment_id,
+					  const gaspi_rank_t * const rank_list,
+					  const gaspi_number_t num,
+					  const gaspi_timeout_t timeout_ms);
+
 
   gaspi_return_t pgaspi_segment_create (const gaspi_segment_id_t segment_id,
 				       const gaspi_size_t size,
@@ -95,6 +112,27 @@ extern "C"
 				       const gaspi_timeout_t timeout_ms,
 				       const gaspi_alloc_t alloc_policy);
 
+  gaspi_return_t pgaspi_segment_bind (const gaspi_segment_id_t segment_id,
+				      const gaspi_pointer_t pointer,
+				      const gaspi_size_t size,
+				      const gaspi_memory_description_t memory_description);
+
+  gaspi_return_t pgaspi_segment_use (const gaspi_segment_id_t segment_id,
+				     const gaspi_pointer_t pointer,
+				     const gaspi_size_t size,
+				     const gaspi_group_t group,
+				     const gaspi_timeout_t timeout_ms,
+				     const gaspi_memory_description_t memory_description);
+
+  gaspi_return_t pgaspi_segment_alloc_file (const gaspi_segment_id_t segment_id,
+					    const char * const path,
+					    const gaspi_size_t size);
+
+  gaspi_return_t pgaspi_segment_sync (const gaspi_segment_id_t segment_id,
+				      const gaspi_offset_t offset,
+				      const gaspi_size_t size,
+				      const gaspi_sync_mode_t mode);
+
   gaspi_return_t pgaspi_segment_num (gaspi_number_t * const segment_num);
 
   gaspi_return_t pgaspi_segment_list (const gaspi_number_t num,
@@ -111,6 +149,22 @@ extern "C"
 
   gaspi_return_t pgaspi_segment_max (gaspi_number_t * const segment_max);
 
+  gaspi_return_t pgaspi_segment_malloc (const gaspi_segment_id_t segment_id,
+					const gaspi_size_t size,
+					gaspi_offset_t * const offset);
+
+  gaspi_return_t pgaspi_segment_free (const gaspi_segment_id_t segment_id,
+				      const gaspi_offset_t offset);
+
+  gaspi_return_t pgaspi_segment_remote_heap (const gaspi_segment_id_t segment_id,
+					     const gaspi_size_t size);
+
+  gaspi_return_t pgaspi_segment_remote_malloc (const gaspi_segment_id_t segment_id,
+					       const gaspi_rank_t rank,
+					       const gaspi_size_t size,
+					       gaspi_offset_t * const offset,
+					       const gaspi_timeout_t timeout_ms);
+
   gaspi_return_t pgaspi_write (const gaspi_segment_id_t segment_id_local,
 			      const gaspi_offset_t offset_local,
 			      const gaspi_rank_t rank,
@@ -156,6 +210,11 @@ extern "C"
   gaspi_return_t pgaspi_barrier (const gaspi_group_t group,
 				const gaspi_timeout_t timeout_ms);
 
+  gaspi_return_t pgaspi_barrier_begin (const gaspi_group_t group);
+
+  gaspi_return_t pgaspi_barrier_end (const gaspi_group_t group,
+				     const gaspi_timeout_t timeout_ms);
+
   gaspi_return_t pgaspi_allreduce (const gaspi_pointer_t buffer_send,
 				  gaspi_pointer_t const buffer_receive,
 				  const gaspi_number_t num,
@@ -299,6 +358,10 @@ extern "C"
 
   gaspi_return_t pgaspi_state_vec_get (gaspi_state_vector_t state_vector);
 
+  gaspi_return_t pgaspi_memory_report (gaspi_number_t * const peers,
+				       gaspi_size_t * const peer_bytes,
+				       gaspi_size_t * const total_bytes);
+
   void pgaspi_printf (const char *fmt, ...);
 
   void pgaspi_print_affinity_mask ();
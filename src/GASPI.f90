@@ -38,6 +38,7 @@ module GASPI_types
   integer, parameter   :: gaspi_queue_id_t = c_signed_char
   integer, parameter   :: gaspi_size_t = c_long
   integer, parameter   :: gaspi_alloc_t = c_long
+  integer, parameter   :: gaspi_memory_description_t = c_int
   integer, parameter   :: gaspi_segment_id_t = c_signed_char
   integer, parameter   :: gaspi_offset_t = c_long
   integer, parameter   :: gaspi_atomic_value_t = c_long
@@ -90,6 +91,8 @@ module GASPI
       enumerator :: GASPI_TYPE_DOUBLE=3
       enumerator :: GASPI_TYPE_LONG=4
       enumerator :: GASPI_TYPE_ULONG=5
+      enumerator :: GASPI_TYPE_HALF=6
+      enumerator :: GASPI_TYPE_BFLOAT16=7
     end enum 
 
     enum, bind(C) !:: gaspi_qp_state_t
@@ -97,9 +100,22 @@ module GASPI
       enumerator :: GASPI_STATE_CORRUPT=1
     end enum 
 
+    enum, bind(C) !:: gaspi_sync_mode_t
+      enumerator :: GASPI_SYNC_WAIT=0
+      enumerator :: GASPI_SYNC_ASYNC=1
+    end enum 
+
     enum, bind(C) !:: gaspi_alloc_policy_flags
       enumerator :: GASPI_MEM_UNINITIALIZED=0
       enumerator :: GASPI_MEM_INITIALIZED=1
+      enumerator :: GASPI_MEM_GPU=2
+      enumerator :: GASPI_MEM_HUGEPAGE=4
+      enumerator :: GASPI_MEM_HUGEPAGE_2M=8
+      enumerator :: GASPI_MEM_HUGEPAGE_1G=16
+      enumerator :: GASPI_MEM_NUMA_LOCAL=32
+      enumerator :: GASPI_MEM_NUMA_INTERLEAVE=64
+      enumerator :: GASPI_MEM_NUMA_BIND=128
+      enumerator :: GASPI_MEM_PARALLEL_TOUCH=256
     end enum 
 
     enum, bind(C) !:: gaspi_statistic_argument_t
@@ -126,6 +142,10 @@ module GASPI
       integer (gaspi_size_t)   :: allreduce_buf_size
       integer (gaspi_number_t) :: allreduce_elem_max
       integer (gaspi_number_t) :: build_infrastructure
+      integer (gaspi_number_t) :: allreduce_reproducible
+      integer (gaspi_number_t) :: segment_lazy
+      integer (gaspi_number_t) :: connect_lazy
+      integer (gaspi_number_t) :: queue_lazy_tnc
     end type gaspi_config_t
 
     interface ! gaspi_config_get
@@ -220,6 +240,26 @@ module GASPI
       end function gaspi_connect
     end interface
 
+    interface ! gaspi_connect_list
+      function gaspi_connect_list(rank_list,num,timeout_ms) &
+&         result( res ) bind(C, name="gaspi_connect_list")
+        import
+        type(c_ptr), value :: rank_list
+        integer(gaspi_number_t), value :: num
+        integer(gaspi_timeout_t), value :: timeout_ms
+        integer(gaspi_return_t) :: res
+      end function gaspi_connect_list
+    end interface
+
+    interface ! gaspi_connect_all
+      function gaspi_connect_all(timeout_ms) &
+&         result( res ) bind(C, name="gaspi_connect_all")
+        import
+        integer(gaspi_timeout_t), value :: timeout_ms
+        integer(gaspi_return_t) :: res
+      end function gaspi_connect_all
+    end interface
+
     interface ! gaspi_disconnect
       function gaspi_disconnect(rank,timeout_ms) &
 &         result( res ) bind(C, name="gaspi_disconnect")
@@ -268,6 +308,19 @@ module GASPI
       end function gaspi_group_commit
     end interface
 
+    interface ! gaspi_group_split
+      function gaspi_group_split(parent,color,key,group,timeout_ms) &
+&         result( res ) bind(C, name="gaspi_group_split")
+        import
+        integer(gaspi_group_t), value :: parent
+        integer(gaspi_int), value :: color
+        integer(gaspi_int), value :: key
+        integer(gaspi_group_t) :: group
+        integer(gaspi_timeout_t), value :: timeout_ms
+        integer(gaspi_return_t) :: res
+      end function gaspi_group_split
+    end interface
+
     interface ! gaspi_group_num
       function gaspi_group_num(group_num) &
 &         result( res ) bind(C, name="gaspi_group_num")
@@ -337,6 +390,19 @@ module GASPI
       end function gaspi_segment_register
     end interface
 
+    interface ! gaspi_segment_prefetch
+      function gaspi_segment_prefetch(segment_id,rank_list,num, &
+&         timeout_ms) &
+&         result( res ) bind(C, name="gaspi_segment_prefetch")
+        import
+        integer(gaspi_segment_id_t), value :: segment_id
+        type(c_ptr), value :: rank_list
+        integer(gaspi_number_t), value :: num
+        integer(gaspi_timeout_t), value :: timeout_ms
+        integer(gaspi_return_t) :: res
+      end function gaspi_segment_prefetch
+    end interface
+
     interface ! gaspi_segment_create
       function gaspi_segment_create(segment_id,size,group, &
 &         timeout_ms,alloc_policy) &
@@ -351,6 +417,58 @@ module GASPI
       end function gaspi_segment_create
     end interface
 
+    interface ! gaspi_segment_bind
+      function gaspi_segment_bind(segment_id,pointer,size, &
+&         memory_description) &
+&         result( res ) bind(C, name="gaspi_segment_bind")
+        import
+        integer(gaspi_segment_id_t), value :: segment_id
+        type(c_ptr), value :: pointer
+        integer(gaspi_size_t), value :: size
+        integer(gaspi_memory_description_t), value :: memory_description
+        integer(gaspi_return_t) :: res
+      end function gaspi_segment_bind
+    end interface
+
+    interface ! gaspi_segment_use
+      function gaspi_segment_use(segment_id,pointer,size,group, &
+&         timeout_ms,memory_description) &
+&         result( res ) bind(C, name="gaspi_segment_use")
+        import
+        integer(gaspi_segment_id_t), value :: segment_id
+        type(c_ptr), value :: pointer
+        integer(gaspi_size_t), value :: size
+        integer(gaspi_group_t), value :: group
+        integer(gaspi_timeout_t), value :: timeout_ms
+        integer(gaspi_memory_description_t), value :: memory_description
+        integer(gaspi_return_t) :: res
+      end function gaspi_segment_use
+    end interface
+
+    interface ! gaspi_segment_alloc_file
+      function gaspi_segment_alloc_file(segment_id,path,size) &
+&         result( res ) bind(C, name="gaspi_segment_alloc_file")
+        import
+        integer(gaspi_segment_id_t), value :: segment_id
+        character(c_char), dimension(*) :: path
+        integer(gaspi_size_t), value :: size
+        integer(gaspi_return_t) :: res
+      end function gaspi_segment_alloc_file
+    end interface
+
+    interface ! gaspi_segment_sync
+      function gaspi_segment_sync(segment_id,offset,size, &
+&         mode) &
+&         result( res ) bind(C, name="gaspi_segment_sync")
+        import
+        integer(gaspi_segment_id_t), value :: segment_id
+        integer(gaspi_offset_t), value :: offset
+        integer(gaspi_size_t), value :: size
+        integer(gaspi_int), value :: mode
+        integer(gaspi_return_t) :: res
+      end function gaspi_segment_sync
+    end interface
+
     interface ! gaspi_segment_num
       function gaspi_segment_num(segment_num) &
 &         result( res ) bind(C, name="gaspi_segment_num")
@@ -400,6 +518,51 @@ module GASPI
       end function gaspi_segment_max
     end interface
 
+    interface ! gaspi_segment_malloc
+      function gaspi_segment_malloc(segment_id,size,offset) &
+&         result( res ) bind(C, name="gaspi_segment_malloc")
+        import
+        integer(gaspi_segment_id_t), value :: segment_id
+        integer(gaspi_size_t), value :: size
+        integer(gaspi_offset_t) :: offset
+        integer(gaspi_return_t) :: res
+      end function gaspi_segment_malloc
+    end interface
+
+    interface ! gaspi_segment_free
+      function gaspi_segment_free(segment_id,offset) &
+&         result( res ) bind(C, name="gaspi_segment_free")
+        import
+        integer(gaspi_segment_id_t), value :: segment_id
+        integer(gaspi_offset_t), value :: offset
+        integer(gaspi_return_t) :: res
+      end function gaspi_segment_free
+    end interface
+
+    interface ! gaspi_segment_remote_heap
+      function gaspi_segment_remote_heap(segment_id,size) &
+&         result( res ) bind(C, name="gaspi_segment_remote_heap")
+        import
+        integer(gaspi_segment_id_t), value :: segment_id
+        integer(gaspi_size_t), value :: size
+        integer(gaspi_return_t) :: res
+      end function gaspi_segment_remote_heap
+    end interface
+
+    interface ! gaspi_segment_remote_malloc
+      function gaspi_segment_remote_malloc(segment_id,rank,size, &
+&         offset,timeout_ms) &
+&         result( res ) bind(C, name="gaspi_segment_remote_malloc")
+        import
+        integer(gaspi_segment_id_t), value :: segment_id
+        integer(gaspi_rank_t), value :: rank
+        integer(gaspi_size_t), value :: size
+        integer(gaspi_offset_t) :: offset
+        integer(gaspi_timeout_t), value :: timeout_ms
+        integer(gaspi_return_t) :: res
+      end function gaspi_segment_remote_malloc
+    end interface
+
     interface ! gaspi_write
       function gaspi_write(segment_id_local,offset_local,rank, &
 &         segment_id_remote,offset_remote,size,queue,timeout_ms) &
@@ -490,6 +653,25 @@ module GASPI
       end function gaspi_barrier
     end interface
 
+    interface ! gaspi_barrier_begin
+      function gaspi_barrier_begin(group) &
+&         result( res ) bind(C, name="gaspi_barrier_begin")
+        import
+        integer(gaspi_group_t), value :: group
+        integer(gaspi_return_t) :: res
+      end function gaspi_barrier_begin
+    end interface
+
+    interface ! gaspi_barrier_end
+      function gaspi_barrier_end(group,timeout_ms) &
+&         result( res ) bind(C, name="gaspi_barrier_end")
+        import
+        integer(gaspi_group_t), value :: group
+        integer(gaspi_timeout_t), value :: timeout_ms
+        integer(gaspi_return_t) :: res
+      end function gaspi_barrier_end
+    end interface
+
     interface ! gaspi_allreduce
       function gaspi_allreduce(buffer_send,buffer_receive,num, &
 &         operation,datatyp,group,timeout_ms) &
@@ -801,6 +983,17 @@ module GASPI
       end function gaspi_state_vec_get
     end interface
 
+    interface ! gaspi_memory_report
+      function gaspi_memory_report(peers,peer_bytes,total_bytes) &
+&         result( res ) bind(C, name="gaspi_memory_report")
+        import
+        integer(gaspi_number_t) :: peers
+        integer(gaspi_size_t) :: peer_bytes
+        integer(gaspi_size_t) :: total_bytes
+        integer(gaspi_return_t) :: res
+      end function gaspi_memory_report
+    end interface
+
     interface ! gaspi_printf
       subroutine gaspi_printf(fmt) &
 &         bind(C, name="gaspi_printf")
@@ -16,16 +16,22 @@ You should have received a copy of the GNU General Public License
 along with GPI-2. If not, see <http://www.gnu.org/licenses/>.
 */
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
 #include <pthread.h>
 #include <signal.h>
+#include <sys/mman.h>
 #include <sys/resource.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/timeb.h>
 #include <sys/utsname.h>
 #include <unistd.h>
 
 #include "GASPI.h"
 #include "GPI2.h"
+#include "GPI2_Coll.h"
 #include "GPI2_Env.h"
 #include "GPI2_IB.h"
 #include "GPI2_Mem.h"
@@ -54,7 +60,11 @@ gaspi_config_t glb_gaspi_cfg = {
   GASPI_MAX_TSIZE_P,		//passive_transfer_size_max;
   NEXT_OFFSET,			//allreduce_buf_size;
   255,				//allreduce_elem_max;
-  1				//build_infrastructure;  
+  1,				//build_infrastructure;  
+  0,				//allreduce_reproducible;
+  0,				//segment_lazy;
+  0,				//connect_lazy;
+  GASPI_QUEUE_LAZY_TNC		//queue_lazy_tnc;
 };
 
 
@@ -86,6 +96,10 @@ pgaspi_config_set (const gaspi_config_t nconf)
 
   glb_gaspi_cfg.net_info = nconf.net_info;
   glb_gaspi_cfg.build_infrastructure = nconf.build_infrastructure;
+  glb_gaspi_cfg.allreduce_reproducible = nconf.allreduce_reproducible;
+  glb_gaspi_cfg.segment_lazy = nconf.segment_lazy;
+  glb_gaspi_cfg.connect_lazy = nconf.connect_lazy;
+  glb_gaspi_cfg.queue_lazy_tnc = nconf.queue_lazy_tnc;
   glb_gaspi_cfg.logger = nconf.logger;
   glb_gaspi_cfg.port_check = nconf.port_check;
 
@@ -124,6 +138,30 @@ pgaspi_config_set (const gaspi_config_t nconf)
   else
     glb_gaspi_cfg.queue_depth = nconf.queue_depth;
 
+  if (nconf.group_max < 1 || nconf.group_max > GASPI_GROUPS_LIMIT)
+    {
+      gaspi_print_error("Invalid value for parameter group_max (min=1 and max=%d)", GASPI_GROUPS_LIMIT);
+      return GASPI_ERR_CONFIG;
+    }
+  else
+    glb_gaspi_cfg.group_max = nconf.group_max;
+
+  if (nconf.segment_max < 1 || nconf.segment_max > GASPI_SEGMENTS_LIMIT)
+    {
+      gaspi_print_error("Invalid value for parameter segment_max (min=1 and max=%d)", GASPI_SEGMENTS_LIMIT);
+      return GASPI_ERR_CONFIG;
+    }
+  else
+    glb_gaspi_cfg.segment_max = nconf.segment_max;
+
+  if (nconf.notification_num < 1 || nconf.notification_num > GASPI_MAX_NOTIFICATION)
+    {
+      gaspi_print_error("Invalid value for parameter notification_num (min=1 and max=%d)", GASPI_MAX_NOTIFICATION);
+      return GASPI_ERR_CONFIG;
+    }
+  else
+    glb_gaspi_cfg.notification_num = nconf.notification_num;
+
   if (nconf.mtu == 0 || nconf.mtu == 1024 || nconf.mtu == 2048 || nconf.mtu == 4096)
     glb_gaspi_cfg.mtu = nconf.mtu;
   else
@@ -212,6 +250,417 @@ pgaspi_numa_socket(gaspi_uchar * const socket)
 }
 
 
+/* Bootstrap tree over the first rank of each node (poff 0): the
+   i-th of them gets the topology from the ((i - 1) / k)-th and
+   forwards it to the (k * i + 1)-th ... (k * i + k)-th. The other
+   ranks of a node take it from shared memory (gaspi_node_join). The
+   other SN connections are opened on first use */
+#define GASPI_SN_TREE_ARITY (8)
+#define GASPI_SN_TREE_CHILD(idx, c) (GASPI_SN_TREE_ARITY * (idx) + 1 + (c))
+
+static unsigned long
+gaspi_elapsed_ms (const struct timeb *t0)
+{
+  struct timeb t1;
+  ftime(&t1);
+
+  return (t1.time - t0->time) * 1000 + (t1.millitm - t0->millitm);
+}
+
+/* Rank of child c of ours in the bootstrap tree, -1 if none */
+static int
+gaspi_sn_tree_child (const int c)
+{
+  int i, idx = 0, n = 0;
+
+  for(i = 0; i < glb_gaspi_ctx.rank; i++)
+    {
+      if(glb_gaspi_ctx.poff[i] == 0)
+	idx++;
+    }
+
+  const int cidx = GASPI_SN_TREE_CHILD (idx, c);
+
+  for(i = 0; i < glb_gaspi_ctx.tnc; i++)
+    {
+      if(glb_gaspi_ctx.poff[i] != 0)
+	continue;
+
+      if(n == cidx)
+	return i;
+      n++;
+    }
+
+  return -1;
+}
+
+/* Node-local bootstrap region in /dev/shm, created by the first rank
+   of a node: the topology for the other ranks of the node (after the
+   header), their readiness and the go-ahead passed on to them */
+#define GASPI_NODE_BOOT_PUBLISHED (0x47504932)
+
+typedef struct
+{
+  volatile int state;
+  pid_t leader;
+  int leader_rank, tnc;
+  volatile int nready;
+  volatile int go;
+} gaspi_node_boot;
+
+static gaspi_node_boot *node_boot = NULL;
+static size_t node_boot_size = 0;
+
+static void
+gaspi_node_boot_path (char *path, const size_t len)
+{
+  snprintf (path, len, "/dev/shm/gpi2_boot.%u.%u",
+	    (unsigned) getuid (), (unsigned) glb_gaspi_cfg.sn_port);
+}
+
+/* Number of ranks on our node, ourselves included */
+static int
+gaspi_node_nlocal (void)
+{
+  int i, n = 0;
+
+  for(i = 0; i < glb_gaspi_ctx.tnc; i++)
+    {
+      if(strncmp (gaspi_get_hn (i), gaspi_get_hn (glb_gaspi_ctx.rank), 64) == 0)
+	n++;
+    }
+
+  return n;
+}
+
+/* First rank of a node: publish the topology to the others */
+static int
+gaspi_node_publish (void)
+{
+  char path[64];
+
+  if(node_boot != NULL || gaspi_node_nlocal () < 2)
+    return 0;
+
+  gaspi_node_boot_path (path, sizeof (path));
+
+  //left over by an earlier job
+  unlink (path);
+
+  const size_t size = sizeof (gaspi_node_boot) + glb_gaspi_ctx.tnc * 65;
+
+  const int fd = open (path, O_RDWR | O_CREAT | O_EXCL | O_NOFOLLOW, 0600);
+  if(fd < 0)
+    {
+      gaspi_print_error ("Failed to create %s", path);
+      return -1;
+    }
+
+  void *ptr = MAP_FAILED;
+  if(ftruncate (fd, size) == 0)
+    ptr = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  close (fd);
+
+  if(ptr == MAP_FAILED)
+    {
+      gaspi_print_error ("Failed to map %s", path);
+      unlink (path);
+      return -1;
+    }
+
+  node_boot = (gaspi_node_boot *) ptr;
+  node_boot_size = size;
+
+  node_boot->leader = getpid ();
+  node_boot->leader_rank = glb_gaspi_ctx.rank;
+  node_boot->tnc = glb_gaspi_ctx.tnc;
+  memcpy (node_boot + 1, glb_gaspi_ctx.hn_poff, glb_gaspi_ctx.tnc * 65);
+
+  __sync_synchronize ();
+  node_boot->state = GASPI_NODE_BOOT_PUBLISHED;
+
+  return 0;
+}
+
+/* Other ranks of a node: wait for the region of the first rank and
+   take the topology (and our rank) from it */
+static gaspi_return_t
+gaspi_node_join (const gaspi_timeout_t timeout_ms, const struct timeb *t0)
+{
+  int i;
+  char path[64];
+
+  gaspi_node_boot_path (path, sizeof (path));
+
+  while(node_boot == NULL)
+    {
+      const int fd = open (path, O_RDWR | O_NOFOLLOW);
+      if(fd >= 0)
+	{
+	  struct stat st;
+
+	  ///dev/shm is shared: only a file of ours can be the first rank's
+	  if(fstat (fd, &st) == 0 && S_ISREG (st.st_mode) && st.st_uid == getuid ()
+	     && st.st_size >= (off_t) sizeof (gaspi_node_boot))
+	    {
+	      void *ptr = mmap (NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	      if(ptr != MAP_FAILED)
+		{
+		  gaspi_node_boot *nb = (gaspi_node_boot *) ptr;
+
+		  //complete and of a first rank still alive (not an earlier job's)
+		  if(nb->state == GASPI_NODE_BOOT_PUBLISHED
+		     && st.st_size == (off_t) (sizeof (gaspi_node_boot) + nb->tnc * 65)
+		     && (kill (nb->leader, 0) == 0 || errno != ESRCH))
+		    {
+		      node_boot = nb;
+		      node_boot_size = st.st_size;
+		    }
+		  else
+		    munmap (ptr, st.st_size);
+		}
+	    }
+
+	  close (fd);
+	}
+
+      if(node_boot != NULL)
+	break;
+
+      if(gaspi_elapsed_ms (t0) > timeout_ms)
+	return GASPI_TIMEOUT;
+
+      struct timespec sleep_time, rem;
+      sleep_time.tv_sec = 0;
+      sleep_time.tv_nsec = 1000000;
+      nanosleep (&sleep_time, &rem);
+    }
+
+  __sync_synchronize ();
+
+  //resumed after a timeout
+  if(glb_gaspi_ctx.sockfd != NULL)
+    return GASPI_SUCCESS;
+
+  const int tnc = node_boot->tnc;
+  const char *hn_poff = (const char *) (node_boot + 1);
+
+  glb_gaspi_ctx.rank = -1;
+  for(i = 0; i < tnc; i++)
+    {
+      if(hn_poff[tnc * 64 + i] == glb_gaspi_ctx.localSocket
+	 && strncmp (hn_poff + i * 64, hn_poff + node_boot->leader_rank * 64, 64) == 0)
+	{
+	  glb_gaspi_ctx.rank = i;
+	  break;
+	}
+    }
+
+  if(glb_gaspi_ctx.rank < 0)
+    {
+      gaspi_print_error ("Rank with socket %d not found in topology", glb_gaspi_ctx.localSocket);
+      return GASPI_ERROR;
+    }
+
+  glb_gaspi_ctx.tnc = tnc;
+
+  free (glb_gaspi_ctx.hn_poff);
+  glb_gaspi_ctx.hn_poff = (char *) malloc (tnc * 65);
+  glb_gaspi_ctx.sockfd = (int *) malloc (tnc * sizeof (int));
+  if(glb_gaspi_ctx.hn_poff == NULL || glb_gaspi_ctx.sockfd == NULL)
+    {
+      gaspi_print_error ("Memory allocation failed");
+      free (glb_gaspi_ctx.sockfd);
+      glb_gaspi_ctx.sockfd = NULL;
+      return GASPI_ERROR;
+    }
+
+  memcpy (glb_gaspi_ctx.hn_poff, hn_poff, tnc * 65);
+  glb_gaspi_ctx.poff = glb_gaspi_ctx.hn_poff + tnc * 64;
+
+  for(i = 0; i < tnc; i++)
+    glb_gaspi_ctx.sockfd[i] = -1;
+
+  return GASPI_SUCCESS;
+}
+
+/* Forward the topology to our children in the bootstrap tree and
+   to the other ranks of our node */
+static gaspi_return_t
+gaspi_sn_topo_fanout (const gaspi_timeout_t timeout_ms)
+{
+  int c;
+
+  if(gaspi_node_publish () != 0)
+    return GASPI_ERROR;
+
+  for(c = 0; c < GASPI_SN_TREE_ARITY; c++)
+    {
+      const int child = gaspi_sn_tree_child (c);
+      if(child < 0)
+	break;
+
+      //sent before a timeout
+      if(glb_gaspi_ctx.sockfd[child] != -1)
+	continue;
+
+      const int fd = gaspi_connect2port(gaspi_get_hn(child),
+					glb_gaspi_cfg.sn_port + glb_gaspi_ctx.poff[child],
+					timeout_ms);
+      //-2 is problem with system limits -> nothing you can do
+      if(fd == -2)
+	return GASPI_ERR_EMFILE;
+      if(fd < 0)
+	return GASPI_TIMEOUT;
+
+      //TODO: 65 is magic
+      gaspi_cd_header cdh;
+      memset(&cdh, 0, sizeof(gaspi_cd_header));
+      cdh.op_len = glb_gaspi_ctx.tnc * 65;
+      cdh.op = GASPI_SN_TOPOLOGY;
+      cdh.rank = child;
+      cdh.tnc = glb_gaspi_ctx.tnc;
+
+      if(write(fd, &cdh, sizeof(gaspi_cd_header)) != sizeof(gaspi_cd_header)
+	 || write(fd, glb_gaspi_ctx.hn_poff, cdh.op_len) != cdh.op_len)
+	{
+	  gaspi_print_error("Failed to send topology to rank %d", child);
+	  close(fd);
+	  return GASPI_ERROR;
+	}
+
+      glb_gaspi_ctx.sockfd[child] = fd;
+    }
+
+  return GASPI_SUCCESS;
+}
+
+/* Wait until all ranks are up: readiness goes up the bootstrap tree
+   (the other ranks of a node count themselves in the node region)
+   and the go-ahead comes back down from rank 0 */
+static gaspi_return_t
+gaspi_sn_tree_sync (const gaspi_timeout_t timeout_ms, const struct timeb *t0)
+{
+  static int nready = 0, ready_sent = 0;
+  int c, ready = 1;
+
+  if(glb_gaspi_ctx.localSocket > 0)
+    {
+      if(!ready_sent)
+	{
+	  __sync_fetch_and_add (&node_boot->nready, 1);
+	  ready_sent = 1;
+	}
+
+      while(!node_boot->go)
+	{
+	  if(gaspi_elapsed_ms(t0) > timeout_ms)
+	    return GASPI_TIMEOUT;
+
+	  gaspi_delay();
+	}
+
+      return GASPI_SUCCESS;
+    }
+
+  for(c = nready; c < GASPI_SN_TREE_ARITY; c++)
+    {
+      const int child = gaspi_sn_tree_child (c);
+      if(child < 0)
+	break;
+
+      const unsigned long elapsed = gaspi_elapsed_ms(t0);
+      struct pollfd pfd;
+      pfd.fd = glb_gaspi_ctx.sockfd[child];
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+
+      const int wait_ms = (timeout_ms == GASPI_BLOCK) ? -1
+	: (int) MIN (timeout_ms - MIN (elapsed, timeout_ms), INT_MAX);
+
+      const int n = poll(&pfd, 1, wait_ms);
+      if(n == 0)
+	return GASPI_TIMEOUT;
+
+      if(n < 0 || read(pfd.fd, &ready, sizeof(int)) != sizeof(int))
+	{
+	  gaspi_print_error("Failed to get readiness of rank %d", child);
+	  return GASPI_ERROR;
+	}
+
+      nready = c + 1;
+    }
+
+  if(node_boot != NULL)
+    {
+      const int nlocal = gaspi_node_nlocal ();
+
+      while(node_boot->nready < nlocal - 1)
+	{
+	  if(gaspi_elapsed_ms(t0) > timeout_ms)
+	    return GASPI_TIMEOUT;
+
+	  gaspi_delay();
+	}
+
+      //all have attached, the region is not needed in /dev/shm anymore
+      char path[64];
+      gaspi_node_boot_path (path, sizeof (path));
+      unlink (path);
+    }
+
+  if(glb_gaspi_ctx.rank != 0)
+    {
+      while(!ready_sent)
+	{
+	  const int ret = write(gaspi_sn_parent_fd, &ready, sizeof(int));
+	  if(ret == sizeof(int))
+	    ready_sent = 1;
+	  else if(ret >= 0 || errno != EAGAIN)
+	    {
+	      gaspi_print_error("Failed to signal readiness");
+	      return GASPI_ERROR;
+	    }
+	}
+
+      while(!gaspi_sn_go)
+	{
+	  if(gaspi_sn_status != GASPI_SN_STATE_OK)
+	    {
+	      gaspi_print_error("Error in SN initialization");
+	      return gaspi_sn_err;
+	    }
+
+	  if(gaspi_elapsed_ms(t0) > timeout_ms)
+	    return GASPI_TIMEOUT;
+
+	  gaspi_delay();
+	}
+    }
+
+  if(node_boot != NULL)
+    node_boot->go = 1;
+
+  for(c = 0; c < nready; c++)
+    {
+      const int child = gaspi_sn_tree_child (c);
+
+      gaspi_cd_header cdh;
+      memset(&cdh, 0, sizeof(gaspi_cd_header));
+      cdh.op = GASPI_SN_INIT_GO;
+      cdh.rank = glb_gaspi_ctx.rank;
+
+      if(write(glb_gaspi_ctx.sockfd[child], &cdh, sizeof(gaspi_cd_header)) != sizeof(gaspi_cd_header))
+	{
+	  gaspi_print_error("Failed to release rank %d", child);
+	  return GASPI_ERROR;
+	}
+    }
+
+  return GASPI_SUCCESS;
+}
+
 #pragma weak gaspi_proc_init = pgaspi_proc_init
 gaspi_return_t
 pgaspi_proc_init (const gaspi_timeout_t timeout_ms)
@@ -259,6 +708,16 @@ pgaspi_proc_init (const gaspi_timeout_t timeout_ms)
 	  eret = GASPI_ERR_ENV;
 	  goto errL;
 	}
+
+      //collectives decision table
+      if(glb_gaspi_ctx.cfile[0] != '\0')
+	{
+	  if(gaspi_coll_load(glb_gaspi_ctx.cfile) < 0 && !glb_gaspi_ctx.coll_tune)
+	    {
+	      gaspi_printf("Warning: failed to load collectives decision file %s (using defaults)\n",
+			   glb_gaspi_ctx.cfile);
+	    }
+	}
   
       //start sn_backend
       if(pthread_create(&glb_gaspi_ctx.snt, NULL, gaspi_sn_backend, NULL) != 0)
@@ -395,70 +854,10 @@ pgaspi_proc_init (const gaspi_timeout_t timeout_ms)
 	  
 	}//glb_gaspi_ib_init
       
-      struct timeb t0,t1;
-      ftime(&t0);
-      
-      for(i = 0; i < glb_gaspi_ctx.tnc; i++)
-	{
-	  if(glb_gaspi_ctx.sockfd[i] != -1)
-	    continue;
-	  
-	  while(glb_gaspi_ctx.sockfd[i] == -1)
-	    {
-	      glb_gaspi_ctx.sockfd[i] = gaspi_connect2port(gaspi_get_hn(i),glb_gaspi_cfg.sn_port+glb_gaspi_ctx.poff[i], timeout_ms);
+      eret = gaspi_sn_topo_fanout(timeout_ms);
+      if(eret != GASPI_SUCCESS)
+	goto errL;
 
-	      if(glb_gaspi_ctx.sockfd[i] == -2)
-		{
-		  eret = GASPI_ERROR;
-		  goto errL;
-		}
-	      
-	      if(glb_gaspi_ctx.sockfd[i] == -1)
-		{
-		  ftime(&t1);
-		  const unsigned int delta_ms = (t1.time - t0.time) * 1000 + (t1.millitm - t0.millitm);
-		  
-		  if(delta_ms > timeout_ms)
-		    {
-		      eret = GASPI_TIMEOUT;
-		      goto errL;
-		    }
-		}
-	      else
-		{
-		  //TODO: 65 is magic
-		  if(i > 0)
-		    {//we already have everything
-		      gaspi_cd_header cdh;
-		      cdh.op_len=glb_gaspi_ctx.tnc*65;
-		      cdh.op=GASPI_SN_TOPOLOGY;
-		      cdh.rank=i;
-		      cdh.tnc=glb_gaspi_ctx.tnc;
-		      int ret;
-		      if( (ret = write(glb_gaspi_ctx.sockfd[i],&cdh,sizeof(gaspi_cd_header)))!=sizeof(gaspi_cd_header))
-			{
-			  //			  int errsv = errno;
-			  //			  gaspi_print_error("Failed to write. Error %d: (%s)\n", errsv, (char*)strerror(errsv));
-			  gaspi_print_error("Failed to write.");
-			  
-			  eret = GASPI_ERROR;
-			  goto errL;
-			}
-		      
-		      if( (ret=write(glb_gaspi_ctx.sockfd[i],glb_gaspi_ctx.hn_poff,glb_gaspi_ctx.tnc*65))!=glb_gaspi_ctx.tnc*65)
-			{
-			  //int errsv = errno;
-			  //			  gaspi_print_error("Failed to write\nError %d: (%s)\n", errsv, (char*)strerror(errsv));
-			  gaspi_print_error("Failed to write");
-			  
-
-			  eret = GASPI_ERROR;
-			  goto errL;
-			}
-		    }
-		}
-	    }
-	}
       if(gaspi_init_ib_core() != GASPI_SUCCESS)
 	{
 	  eret = GASPI_ERROR;
@@ -467,6 +866,23 @@ pgaspi_proc_init (const gaspi_timeout_t timeout_ms)
       
     }//MASTER_PROC
 
+  else if(glb_gaspi_ctx.procType == WORKER_PROC && glb_gaspi_ctx.localSocket > 0)
+    {
+      //topology from the first rank of our node
+      eret = gaspi_node_join(timeout_ms, &tinit0);
+      if(eret != GASPI_SUCCESS)
+	goto errL;
+
+      if(glb_gaspi_ib_init == 0)
+	{
+	  if(gaspi_init_ib_core() != GASPI_SUCCESS)
+	    {
+	      gaspi_print_error("Failed to initialized IB core");
+	      eret = GASPI_ERROR;
+	      goto errL;
+	    }
+	}
+    }
   else if(glb_gaspi_ctx.procType == WORKER_PROC)
     {
       //wait for topo data
@@ -501,36 +917,9 @@ pgaspi_proc_init (const gaspi_timeout_t timeout_ms)
 	  goto errL;
 	}
 
-      //do connections
-      for(i=0;i<glb_gaspi_ctx.tnc;i++)
-	{
-	  if(glb_gaspi_ctx.sockfd[i] != -1)
-	    continue;
-  
-	  while(glb_gaspi_ctx.sockfd[i] == -1)
-	    {
-	      glb_gaspi_ctx.sockfd[i] = gaspi_connect2port(gaspi_get_hn(i),glb_gaspi_cfg.sn_port+glb_gaspi_ctx.poff[i], timeout_ms);
-
-	      //-2 is problem with system limits -> nothing you can do
-	      if(glb_gaspi_ctx.sockfd[i] == -2)
-		{
-		  eret = GASPI_ERR_EMFILE;
-		  goto errL;
-		}
-
-	      if(glb_gaspi_ctx.sockfd[i] == -1)
-		{
-		  ftime(&t1);
-		  const unsigned int delta_ms = (t1.time-t0.time)*1000+(t1.millitm-t0.millitm);
-		
-		  if(delta_ms > timeout_ms)
-		    {
-		      eret=GASPI_TIMEOUT;
-		      goto errL;
-		    }
-		}
-	    }
-	}
+      eret = gaspi_sn_topo_fanout(timeout_ms);
+      if(eret != GASPI_SUCCESS)
+	goto errL;
     }
   else
     {
@@ -539,22 +928,13 @@ pgaspi_proc_init (const gaspi_timeout_t timeout_ms)
       goto errL;
     }
   
-  /*   glb_gaspi_init = 1; */
-  /*   need to wait to make sure everyone is connected */
-  /*   avoid problem of connecting to a node which is not yet ready (sn side) */
-  /*   TODO: should only be done when building infrastructure? */
-  while(glb_gaspi_init < glb_gaspi_ctx.tnc )
-    {
-      gaspi_delay();
-      if(gaspi_sn_status != GASPI_SN_STATE_OK)
-	{
-	  gaspi_print_error("Error in SN initialization");
+  //make sure everyone is up before anyone talks to a rank
+  eret = gaspi_sn_tree_sync(timeout_ms, &tinit0);
+  if(eret != GASPI_SUCCESS)
+    goto errL;
+
+  glb_gaspi_init = 1;
 
-	  eret = gaspi_sn_err;
-	  goto errL;
-	}
-    }
-  
   unlock_gaspi (&glb_gaspi_ctx_lock);
 
 #ifdef GPI2_DEV_DEBUG
@@ -570,13 +950,24 @@ pgaspi_proc_init (const gaspi_timeout_t timeout_ms)
   
   if(glb_gaspi_cfg.build_infrastructure)
     {
-      //connect all ranks
-      for(i = glb_gaspi_ctx.rank; i < glb_gaspi_ctx.tnc; i++)
+      //connect to the ranks above (or on first access with connect_lazy)
+      if(!glb_gaspi_cfg.connect_lazy)
 	{
-	  if(gaspi_connect(i, timeout_ms) != GASPI_SUCCESS)
+	  const gaspi_number_t nup = glb_gaspi_ctx.tnc - glb_gaspi_ctx.rank;
+	  gaspi_rank_t *up = (gaspi_rank_t *) malloc (nup * sizeof (gaspi_rank_t));
+	  if(up == NULL)
+	    return GASPI_ERROR;
+
+	  for(i = 0; i < nup; i++)
+	    up[i] = glb_gaspi_ctx.rank + i;
+
+	  eret = gaspi_connect_list(up, nup, timeout_ms);
+	  free (up);
+
+	  if(eret != GASPI_SUCCESS)
 	    {
-	      gaspi_print_error("Failed to connnect to %d\n", i);
-	      return GASPI_ERROR;
+	      gaspi_print_error("Failed to connect to the ranks");
+	      return eret;
 	    }
 	}
       
@@ -614,6 +1005,16 @@ pgaspi_proc_init (const gaspi_timeout_t timeout_ms)
 	  gaspi_print_error("Group commit has failed (GASPI_GROUP_ALL)\n");
 	  return GASPI_ERROR;
 	}
+
+      //tuning mode: benchmark collectives and write decision file
+      if(eret == GASPI_SUCCESS && glb_gaspi_ctx.coll_tune)
+	{
+	  if(gaspi_coll_tune(glb_gaspi_ctx.cfile, timeout_ms) != 0)
+	    {
+	      gaspi_print_error("Failed to tune collectives");
+	      return GASPI_ERROR;
+	    }
+	}
     }
   else //dont build_infrastructure
     {
@@ -649,7 +1050,7 @@ pgaspi_initialized (gaspi_number_t *initialized)
 {
   gaspi_verify_null_ptr(initialized);
   
-  *initialized = ( glb_gaspi_init != 0 && glb_gaspi_init == glb_gaspi_ctx.tnc );
+  *initialized = ( glb_gaspi_init != 0 );
   
   return GASPI_SUCCESS;
 }
@@ -682,6 +1083,14 @@ pgaspi_proc_term (const gaspi_timeout_t timeout)
     free(glb_gaspi_ctx.sockfd);
   }
 
+  gaspi_sn_requests_free();
+
+  if(node_boot != NULL)
+    {
+      munmap(node_boot, node_boot_size);
+      node_boot = NULL;
+    }
+
 #ifdef GPI2_WITH_MPI
   if(glb_gaspi_ctx.rank == 0)
     {
@@ -724,13 +1133,13 @@ pgaspi_proc_kill (const gaspi_rank_t rank,const gaspi_timeout_t timeout_ms)
 
 
   gaspi_cd_header cdh;
+  memset(&cdh, 0, sizeof(gaspi_cd_header));
   cdh.op_len = 0;
   cdh.op = GASPI_SN_PROC_KILL;
   cdh.rank = glb_gaspi_ctx.rank;
-           
-  int ret;
-  ret = write(glb_gaspi_ctx.sockfd[rank], &cdh, sizeof(gaspi_cd_header));
-  if(ret != sizeof(gaspi_cd_header))
+
+  //no reply
+  if(gaspi_sn_post(rank, &cdh, NULL, 0, NULL, NULL, 0, timeout_ms) != 0)
     {
       //      int errsv = errno;
       //      gaspi_print_error("Failed to send kill command to SN thread. Error %d: %s\n", errsv, (char*) strerror(errsv));
@@ -882,7 +1291,8 @@ pgaspi_notification_num (gaspi_number_t * const notification_num)
 {
   gaspi_verify_null_ptr(notification_num);
 
-  *notification_num = ((1 << 16) - 1);
+  //ids are gaspi_notification_id_t
+  *notification_num = MIN (glb_gaspi_cfg.notification_num, (1 << 16) - 1);
   return GASPI_SUCCESS;
 }
 
@@ -28,6 +28,10 @@ along with GPI-2. If not, see <http://www.gnu.org/licenses/>.
 #define NEXT_OFFSET       (COLL_MEM_RECV + 73728)
 #define NOTIFY_OFFSET     (65536*4)
 
+#define GASPI_GROUPS_LIMIT   (256) /* range of gaspi_group_t */
+#define GASPI_SEGMENTS_LIMIT (256) /* range of gaspi_segment_id_t */
+#define GASPI_MR_POOL_CHUNK (1 << 20)
+
 gaspi_context glb_gaspi_ctx;
 
 volatile int glb_gaspi_init;
@@ -39,7 +43,6 @@ volatile int gaspi_rrcd_data;
 //locks
 gaspi_lock_t glb_gaspi_ctx_lock;
 gaspi_lock_t gaspi_create_lock;
-gaspi_lock_t gaspi_ccontext_lock;
 gaspi_lock_t gaspi_mseg_lock;
 
 static inline gaspi_cycles_t
@@ -0,0 +1,526 @@
+/*
+Copyright (c) Fraunhofer ITWM - Carsten Lojewski <lojewski@itwm.fhg.de>, 2013-2014
+
+This file is part of GPI-2.
+
+GPI-2 is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+GPI-2 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with GPI-2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Sub-allocation of segment memory.
+
+   The segment is cut into pages of GASPI_ARENA_PAGE bytes, taken in
+   order from a break offset. A page serves one size class (64 bytes
+   to half a page) or is part of a large block (a run of pages). The
+   page map keeps for each page its class or, for the first page of a
+   large block, the run length.
+
+   Each class has a free list of blocks, linked through the first 8
+   bytes of the free blocks. The list head holds the block index and
+   a tag that changes on every update, so that pop and push are a
+   single compare-and-swap without ABA problem. Only refilling a class
+   with a new page and large blocks take the arena lock.
+
+   The remote heap is the start of the segment, reserved by the owner
+   before any local allocation. Its counter (bytes left) lives in the
+   notification area; peers reserve space with a remote fetch-and-add
+   of the negated size, which never involves the owner's CPU. */
+
+#include <stdint.h>
+
+#include "GPI2.h"
+#include "GASPI.h"
+#include "GPI2_IB.h"
+
+extern gaspi_config_t glb_gaspi_cfg;
+
+#define GASPI_ARENA_PAGE_SHIFT (16)
+#define GASPI_ARENA_PAGE (1UL << GASPI_ARENA_PAGE_SHIFT)
+#define GASPI_ARENA_MIN_SHIFT (6)
+#define GASPI_ARENA_CLASSES (GASPI_ARENA_PAGE_SHIFT - GASPI_ARENA_MIN_SHIFT)
+#define GASPI_ARENA_LARGE (0x80000000U)
+
+/* Free list head: block index + 1 (offset / 64) in the low bits, the
+   tag in the high bits. Limits a segment to 64 TB */
+#define GASPI_ARENA_IDX_BITS (40)
+#define GASPI_ARENA_IDX_MASK ((1UL << GASPI_ARENA_IDX_BITS) - 1)
+#define GASPI_ARENA_TAG_INC (1UL << GASPI_ARENA_IDX_BITS)
+
+typedef struct gaspi_arena_extent
+{
+  unsigned long off;
+  unsigned long len;
+  struct gaspi_arena_extent *next;
+} gaspi_arena_extent;
+
+struct gaspi_arena
+{
+  volatile unsigned long head[GASPI_ARENA_CLASSES];
+  gaspi_lock_t lock;
+  unsigned char *base;
+  unsigned long brk;
+  unsigned long end;
+  unsigned long remote; /* size of the remote heap */
+  unsigned int *pages;
+  gaspi_arena_extent *extents; /* free large blocks, by offset */
+};
+
+static inline int
+gaspi_arena_class (const gaspi_size_t size)
+{
+  int c = 0;
+
+  while ((1UL << (c + GASPI_ARENA_MIN_SHIFT)) < size)
+    c++;
+
+  return c;
+}
+
+static inline unsigned long
+gaspi_arena_pop (struct gaspi_arena *a, const int c)
+{
+  unsigned long h, n, idx;
+
+  do
+    {
+      h = a->head[c];
+      idx = h & GASPI_ARENA_IDX_MASK;
+      if (idx == 0)
+	return 0;
+
+      /* the block may be taken meanwhile: the tag makes the CAS fail */
+      n = *(volatile unsigned long *) (a->base + ((idx - 1) << GASPI_ARENA_MIN_SHIFT));
+    }
+  while (!__sync_bool_compare_and_swap (&a->head[c], h,
+					((h + GASPI_ARENA_TAG_INC) & ~GASPI_ARENA_IDX_MASK)
+					| (n & GASPI_ARENA_IDX_MASK)));
+
+  return idx;
+}
+
+static inline void
+gaspi_arena_push (struct gaspi_arena *a, const int c, const unsigned long off)
+{
+  unsigned long h;
+  const unsigned long idx = (off >> GASPI_ARENA_MIN_SHIFT) + 1;
+
+  do
+    {
+      h = a->head[c];
+      *(volatile unsigned long *) (a->base + off) = h & GASPI_ARENA_IDX_MASK;
+    }
+  while (!__sync_bool_compare_and_swap (&a->head[c], h,
+					((h + GASPI_ARENA_TAG_INC) & ~GASPI_ARENA_IDX_MASK) | idx));
+}
+
+/* Take len bytes (a multiple of the page size) from the free large
+   blocks or the break (arena lock held). Returns the offset or -1 */
+static long
+gaspi_arena_pages (struct gaspi_arena *a, const unsigned long len)
+{
+  gaspi_arena_extent **e;
+
+  for (e = &a->extents; *e != NULL; e = &(*e)->next)
+    {
+      if ((*e)->len >= len)
+	{
+	  gaspi_arena_extent *x = *e;
+	  const unsigned long off = x->off;
+
+	  x->off += len;
+	  x->len -= len;
+	  if (x->len == 0)
+	    {
+	      *e = x->next;
+	      free (x);
+	    }
+
+	  return (long) off;
+	}
+    }
+
+  if (a->brk + len > a->end)
+    return -1;
+
+  a->brk += len;
+  return (long) (a->brk - len);
+}
+
+/* Take the rest of the segment, shorter than len, from the break
+   (arena lock held). Free large blocks are whole pages and never
+   serve it. Returns the offset or -1 */
+static long
+gaspi_arena_tail (struct gaspi_arena *a, const unsigned long min)
+{
+  if (a->brk >= a->end || a->end - a->brk < min)
+    return -1;
+
+  const unsigned long off = a->brk;
+  a->brk = a->end;
+
+  return (long) off;
+}
+
+/* Give back a large block (arena lock held) */
+static void
+gaspi_arena_pages_free (struct gaspi_arena *a, const unsigned long off,
+			const unsigned long len)
+{
+  gaspi_arena_extent **e, *prev = NULL;
+
+  for (e = &a->extents; *e != NULL && (*e)->off < off; e = &(*e)->next)
+    prev = *e;
+
+  if (prev != NULL && prev->off + prev->len == off)
+    prev->len += len;
+  else
+    {
+      gaspi_arena_extent *x = (gaspi_arena_extent *) malloc (sizeof (gaspi_arena_extent));
+
+      /* out of memory: the block is lost, not the arena */
+      if (x == NULL)
+	return;
+
+      x->off = off;
+      x->len = len;
+      x->next = *e;
+      *e = x;
+      prev = x;
+    }
+
+  if (prev->next != NULL && prev->off + prev->len == prev->next->off)
+    {
+      gaspi_arena_extent *x = prev->next;
+
+      prev->len += x->len;
+      prev->next = x->next;
+      free (x);
+    }
+
+  /* the last block goes back to the break */
+  if (prev->next == NULL && prev->off + prev->len == a->brk)
+    {
+      a->brk = prev->off;
+      for (e = &a->extents; *e != prev; e = &(*e)->next);
+      *e = NULL;
+      free (prev);
+    }
+}
+
+/* Refill a size class with a new page (arena lock held). Returns
+   the index of a block, the others of the page go to the free list */
+static unsigned long
+gaspi_arena_refill (struct gaspi_arena *a, const int c)
+{
+  const unsigned long csize = 1UL << (c + GASPI_ARENA_MIN_SHIFT);
+  unsigned long len, b;
+  long off;
+
+  /* a class empty meanwhile refilled by another thread */
+  const unsigned long idx = gaspi_arena_pop (a, c);
+  if (idx != 0)
+    return idx;
+
+  len = GASPI_ARENA_PAGE;
+  off = gaspi_arena_pages (a, GASPI_ARENA_PAGE);
+  if (off < 0)
+    {
+      /* last (partial) page of the segment */
+      off = gaspi_arena_tail (a, csize);
+      if (off < 0)
+	return 0;
+      len = a->end - off;
+    }
+
+  a->pages[off >> GASPI_ARENA_PAGE_SHIFT] = c + 1;
+
+  for (b = csize; b + csize <= len; b += csize)
+    gaspi_arena_push (a, c, off + b);
+
+  return (off >> GASPI_ARENA_MIN_SHIFT) + 1;
+}
+
+/* Create the arena of a segment (segment lock held) */
+static struct gaspi_arena *
+gaspi_arena_create (const gaspi_segment_id_t segment_id)
+{
+  struct gaspi_arena *a;
+
+  if (glb_gaspi_ctx_ib.rrmd[segment_id] == NULL)
+    return NULL;
+
+  const unsigned long size = glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].size;
+  if (size == 0 || (size >> GASPI_ARENA_MIN_SHIFT) >= GASPI_ARENA_IDX_MASK)
+    return NULL;
+
+  if (posix_memalign ((void **) &a, sizeof (gaspi_lock_t), sizeof (struct gaspi_arena)) != 0)
+    return NULL;
+
+  memset (a, 0, sizeof (struct gaspi_arena));
+
+  a->pages = (unsigned int *) calloc ((size + GASPI_ARENA_PAGE - 1) >> GASPI_ARENA_PAGE_SHIFT,
+				      sizeof (unsigned int));
+  if (a->pages == NULL)
+    {
+      free (a);
+      return NULL;
+    }
+
+  a->base = glb_gaspi_ctx_ib.lmsd[segment_id].buf;
+  a->end = size;
+
+  return a;
+}
+
+void
+gaspi_arena_destroy (struct gaspi_arena *a)
+{
+  if (a == NULL)
+    return;
+
+  while (a->extents != NULL)
+    {
+      gaspi_arena_extent *x = a->extents;
+      a->extents = x->next;
+      free (x);
+    }
+
+  free (a->pages);
+  free (a);
+}
+
+static struct gaspi_arena *
+gaspi_arena_get (const gaspi_segment_id_t segment_id)
+{
+  gaspi_lc_mseg *lseg = &glb_gaspi_ctx_ib.lmsd[segment_id];
+
+  if (lseg->arena != NULL)
+    return lseg->arena;
+
+  lock_gaspi_tout (&gaspi_mseg_lock, GASPI_BLOCK);
+
+  if (lseg->arena == NULL)
+    {
+      struct gaspi_arena *a = gaspi_arena_create (segment_id);
+      __sync_synchronize ();
+      lseg->arena = a;
+    }
+
+  unlock_gaspi (&gaspi_mseg_lock);
+
+  return lseg->arena;
+}
+
+#pragma weak gaspi_segment_malloc = pgaspi_segment_malloc
+gaspi_return_t
+pgaspi_segment_malloc (const gaspi_segment_id_t segment_id,
+		       const gaspi_size_t size,
+		       gaspi_offset_t * const offset)
+{
+  unsigned long idx;
+
+  gaspi_verify_null_ptr(offset);
+
+  if (!glb_gaspi_init || size == 0)
+    return GASPI_ERROR;
+
+  struct gaspi_arena *a = gaspi_arena_get (segment_id);
+  if (a == NULL)
+    {
+      gaspi_print_error ("Invalid segment %d (gaspi_segment_malloc)", segment_id);
+      return GASPI_ERROR;
+    }
+
+  if (size <= GASPI_ARENA_PAGE / 2)
+    {
+      const int c = gaspi_arena_class (size);
+
+      idx = gaspi_arena_pop (a, c);
+      if (idx == 0)
+	{
+	  lock_gaspi_tout (&a->lock, GASPI_BLOCK);
+	  idx = gaspi_arena_refill (a, c);
+	  unlock_gaspi (&a->lock);
+
+	  if (idx == 0)
+	    return GASPI_ERROR;
+	}
+
+      *offset = (idx - 1) << GASPI_ARENA_MIN_SHIFT;
+      return GASPI_SUCCESS;
+    }
+
+  unsigned long npages = (size + GASPI_ARENA_PAGE - 1) >> GASPI_ARENA_PAGE_SHIFT;
+  if (npages >= GASPI_ARENA_LARGE)
+    return GASPI_ERROR;
+
+  lock_gaspi_tout (&a->lock, GASPI_BLOCK);
+
+  long off = gaspi_arena_pages (a, npages << GASPI_ARENA_PAGE_SHIFT);
+
+  /* a block ending in the last (partial) page: record the pages it
+     really spans, free gives back up to the end of the segment */
+  if (off < 0)
+    {
+      off = gaspi_arena_tail (a, size);
+      if (off >= 0)
+	npages = (a->end - off + GASPI_ARENA_PAGE - 1) >> GASPI_ARENA_PAGE_SHIFT;
+    }
+
+  if (off >= 0)
+    a->pages[off >> GASPI_ARENA_PAGE_SHIFT] = GASPI_ARENA_LARGE | npages;
+
+  unlock_gaspi (&a->lock);
+
+  if (off < 0)
+    return GASPI_ERROR;
+
+  *offset = (gaspi_offset_t) off;
+  return GASPI_SUCCESS;
+}
+
+#pragma weak gaspi_segment_free = pgaspi_segment_free
+gaspi_return_t
+pgaspi_segment_free (const gaspi_segment_id_t segment_id,
+		     const gaspi_offset_t offset)
+{
+  if (!glb_gaspi_init)
+    return GASPI_ERROR;
+
+  if (glb_gaspi_ctx_ib.rrmd[segment_id] == NULL
+      || glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].size == 0)
+    {
+      gaspi_print_error ("Invalid segment %d (gaspi_segment_free)", segment_id);
+      return GASPI_ERROR;
+    }
+
+  struct gaspi_arena *a = glb_gaspi_ctx_ib.lmsd[segment_id].arena;
+
+  if (a == NULL || offset < a->remote || offset >= a->brk)
+    {
+      gaspi_print_error ("Invalid offset %lu (gaspi_segment_free)", offset);
+      return GASPI_ERROR;
+    }
+
+  const unsigned long p = offset >> GASPI_ARENA_PAGE_SHIFT;
+  const unsigned int kind = a->pages[p];
+
+  if (kind & GASPI_ARENA_LARGE)
+    {
+      if (offset & (GASPI_ARENA_PAGE - 1))
+	return GASPI_ERROR;
+
+      lock_gaspi_tout (&a->lock, GASPI_BLOCK);
+
+      a->pages[p] = 0;
+      gaspi_arena_pages_free (a, offset,
+			      MIN ((unsigned long) (kind & ~GASPI_ARENA_LARGE) << GASPI_ARENA_PAGE_SHIFT,
+				   a->end - offset));
+      unlock_gaspi (&a->lock);
+
+      return GASPI_SUCCESS;
+    }
+
+  if (kind == 0 || (offset & ((1UL << (kind - 1 + GASPI_ARENA_MIN_SHIFT)) - 1)))
+    {
+      gaspi_print_error ("Invalid offset %lu (gaspi_segment_free)", offset);
+      return GASPI_ERROR;
+    }
+
+  gaspi_arena_push (a, kind - 1, offset);
+
+  return GASPI_SUCCESS;
+}
+
+#pragma weak gaspi_segment_remote_heap = pgaspi_segment_remote_heap
+gaspi_return_t
+pgaspi_segment_remote_heap (const gaspi_segment_id_t segment_id,
+			    const gaspi_size_t size)
+{
+  gaspi_return_t eret = GASPI_ERROR;
+
+  if (!glb_gaspi_init)
+    return GASPI_ERROR;
+
+  struct gaspi_arena *a = gaspi_arena_get (segment_id);
+  gaspi_lc_mseg *lseg = &glb_gaspi_ctx_ib.lmsd[segment_id];
+
+  /* GPU segments keep their notifications apart from the pool */
+  if (a == NULL || lseg->notif_mr == NULL)
+    return GASPI_ERROR;
+
+  const unsigned long len = (size + 7) & ~7UL;
+
+  lock_gaspi_tout (&a->lock, GASPI_BLOCK);
+
+  if (a->brk != 0 || a->remote != 0 || len == 0 || len > a->end)
+    {
+      gaspi_print_error ("Remote heap must be set once, before gaspi_segment_malloc");
+      goto endL;
+    }
+
+  a->remote = len;
+  a->brk = MIN ((len + GASPI_ARENA_PAGE - 1) & ~(GASPI_ARENA_PAGE - 1), a->end);
+
+  *(volatile gaspi_atomic_value_t *) (lseg->notif_buf + GASPI_NOTIF_HEAP_OFFSET) = len;
+  eret = GASPI_SUCCESS;
+
+ endL:
+  unlock_gaspi (&a->lock);
+  return eret;
+}
+
+#pragma weak gaspi_segment_remote_malloc = pgaspi_segment_remote_malloc
+gaspi_return_t
+pgaspi_segment_remote_malloc (const gaspi_segment_id_t segment_id,
+			      const gaspi_rank_t rank,
+			      const gaspi_size_t size,
+			      gaspi_offset_t * const offset,
+			      const gaspi_timeout_t timeout_ms)
+{
+  gaspi_atomic_value_t left = 0, old;
+
+  gaspi_verify_null_ptr(offset);
+
+  if (!glb_gaspi_init || size == 0)
+    return GASPI_ERROR;
+
+  gaspi_return_t eret = gaspi_segment_remote (segment_id, rank, timeout_ms);
+  if (eret != GASPI_SUCCESS)
+    return eret;
+
+  const unsigned long len = (size + 7) & ~7UL;
+  const gaspi_rc_mseg *seg = &glb_gaspi_ctx_ib.rrmd[segment_id][rank];
+
+  /* compare and swap, so that a request that does not fit leaves the
+     counter alone (the first one only reads it) */
+  for (;;)
+    {
+      eret = gaspi_atomic_post (rank, seg->notif_addr + GASPI_NOTIF_HEAP_OFFSET,
+				seg->notif_rkey, IBV_WR_ATOMIC_CMP_AND_SWP,
+				left, (left >= len) ? left - len : left, &old, timeout_ms);
+      if (eret != GASPI_SUCCESS)
+	return eret;
+
+      if (old == left && left >= len)
+	break;
+
+      //heap exhausted (or never set)
+      if (old < len)
+	return GASPI_ERROR;
+
+      left = old;
+    }
+
+  *offset = left - len;
+  return GASPI_SUCCESS;
+}
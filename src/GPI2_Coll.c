@@ -0,0 +1,398 @@
+/*
+Copyright (c) Fraunhofer ITWM - Carsten Lojewski <lojewski@itwm.fhg.de>, 2013-2014
+
+This file is part of GPI-2.
+
+GPI-2 is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+GPI-2 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with GPI-2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "GPI2.h"
+#include "GPI2_Coll.h"
+#include "GPI2_IB.h"
+
+extern gaspi_config_t glb_gaspi_cfg;
+
+/* Decision table: for a collective, the algorithm to use for groups
+   of at least group_size ranks and messages of up to bytes bytes */
+typedef struct
+{
+  gaspi_coll_t coll;
+  int group_size;
+  int bytes;
+  int alg;
+} gaspi_coll_rule;
+
+#define GASPI_COLL_MAX_RULES (256)
+#define GASPI_COLL_TUNE_WARMUP (50)
+#define GASPI_COLL_TUNE_ITER (500)
+
+static gaspi_coll_rule glb_gaspi_coll_rules[GASPI_COLL_MAX_RULES];
+static int glb_gaspi_coll_nrules = 0;
+
+/* used while tuning to override the decision table */
+static int gaspi_coll_force[GASPI_COLL_NUM] = { -1, -1 };
+
+static const char *gaspi_coll_names[GASPI_COLL_NUM] = { "barrier", "allreduce" };
+
+static const int gaspi_coll_algs[GASPI_COLL_NUM] = { GASPI_BARRIER_ALGS, GASPI_ALLREDUCE_ALGS };
+
+static const char *gaspi_coll_alg_names[GASPI_COLL_NUM][2] =
+  {
+    { "dissemination", "pairwise" },
+    { "recursive_doubling", "dissemination" }
+  };
+
+static int
+_gaspi_coll_add_rule (const gaspi_coll_t coll, const int group_size,
+		      const int bytes, const int alg)
+{
+  int i;
+
+  for (i = 0; i < glb_gaspi_coll_nrules; i++)
+    {
+      if (glb_gaspi_coll_rules[i].coll == coll
+	  && glb_gaspi_coll_rules[i].group_size == group_size
+	  && glb_gaspi_coll_rules[i].bytes == bytes)
+	{
+	  glb_gaspi_coll_rules[i].alg = alg;
+	  return 0;
+	}
+    }
+
+  if (glb_gaspi_coll_nrules >= GASPI_COLL_MAX_RULES)
+    {
+      gaspi_print_error ("Too many collective decision rules (max %d)", GASPI_COLL_MAX_RULES);
+      return -1;
+    }
+
+  glb_gaspi_coll_rules[glb_gaspi_coll_nrules].coll = coll;
+  glb_gaspi_coll_rules[glb_gaspi_coll_nrules].group_size = group_size;
+  glb_gaspi_coll_rules[glb_gaspi_coll_nrules].bytes = bytes;
+  glb_gaspi_coll_rules[glb_gaspi_coll_nrules].alg = alg;
+  glb_gaspi_coll_nrules++;
+
+  return 0;
+}
+
+/* Decision file format, one rule per line:
+   <collective> <min. group size> <max. bytes> <algorithm>
+   Lines starting with '#' are comments. */
+int
+gaspi_coll_load (const char *file)
+{
+  char *line = NULL;
+  size_t len = 0;
+  int c, a, lineno = 0;
+
+  FILE *fp = fopen (file, "r");
+  if (fp == NULL)
+    {
+      gaspi_print_error ("Failed to open collectives decision file %s", file);
+      return -1;
+    }
+
+  while (getline (&line, &len, fp) != -1)
+    {
+      char cname[32], aname[32];
+      int group_size, bytes, coll = -1, alg = -1;
+
+      lineno++;
+
+      if (line[0] == '#' || line[0] == '\n')
+	continue;
+
+      if (sscanf (line, "%31s %d %d %31s", cname, &group_size, &bytes, aname) != 4)
+	{
+	  gaspi_printf ("Warning: ignoring malformed line %d in %s\n", lineno, file);
+	  continue;
+	}
+
+      for (c = 0; c < GASPI_COLL_NUM; c++)
+	{
+	  if (strcmp (cname, gaspi_coll_names[c]) == 0)
+	    {
+	      coll = c;
+	      for (a = 0; a < gaspi_coll_algs[c]; a++)
+		{
+		  if (strcmp (aname, gaspi_coll_alg_names[c][a]) == 0)
+		    alg = a;
+		}
+	    }
+	}
+
+      if (coll < 0 || alg < 0 || group_size < 1 || bytes < 0)
+	{
+	  gaspi_printf ("Warning: ignoring unknown rule at line %d in %s\n", lineno, file);
+	  continue;
+	}
+
+      if (_gaspi_coll_add_rule (coll, group_size, bytes, alg) < 0)
+	break;
+    }
+
+  if (line)
+    free (line);
+
+  fclose (fp);
+
+  return 0;
+}
+
+int
+gaspi_coll_select (const gaspi_coll_t coll, const int group_size, const int bytes)
+{
+  int i;
+  int gsize = -1, best = -1;
+
+  //closest group size bucket below
+  for (i = 0; i < glb_gaspi_coll_nrules; i++)
+    {
+      if (glb_gaspi_coll_rules[i].coll == coll
+	  && glb_gaspi_coll_rules[i].group_size <= group_size)
+	gsize = MAX (gsize, glb_gaspi_coll_rules[i].group_size);
+    }
+
+  if (gsize < 0)
+    return 0;
+
+  //smallest message bucket that fits (or the largest one)
+  for (i = 0; i < glb_gaspi_coll_nrules; i++)
+    {
+      const gaspi_coll_rule *r = &glb_gaspi_coll_rules[i];
+
+      if (r->coll != coll || r->group_size != gsize)
+	continue;
+
+      if (best < 0)
+	{
+	  best = i;
+	  continue;
+	}
+
+      const gaspi_coll_rule *b = &glb_gaspi_coll_rules[best];
+
+      if (b->bytes < bytes)
+	{
+	  if (r->bytes > b->bytes)
+	    best = i;
+	}
+      else if (r->bytes >= bytes && r->bytes < b->bytes)
+	best = i;
+    }
+
+  return glb_gaspi_coll_rules[best].alg;
+}
+
+void
+gaspi_coll_setup_group (const gaspi_group_t g)
+{
+  int b;
+  gaspi_ib_group *grp = &glb_gaspi_group_ib[g];
+
+  grp->barrier_alg = gaspi_coll_force[GASPI_COLL_BARRIER];
+  if (grp->barrier_alg < 0)
+    grp->barrier_alg = gaspi_coll_select (GASPI_COLL_BARRIER, grp->tnc, 0);
+
+  if (grp->barrier_alg == GASPI_BARRIER_PAIRWISE && grp->tnc != grp->next_pof2)
+    grp->barrier_alg = GASPI_BARRIER_DISSEMINATION;
+
+  for (b = 0; b < GASPI_COLL_BUCKETS; b++)
+    {
+      grp->allreduce_alg[b] = gaspi_coll_force[GASPI_COLL_ALLREDUCE];
+      if (grp->allreduce_alg[b] < 0)
+	grp->allreduce_alg[b] = gaspi_coll_select (GASPI_COLL_ALLREDUCE, grp->tnc, 1 << b);
+    }
+}
+
+/* average time (usecs) of a collective with a given algorithm on
+   GASPI_GROUP_ALL, agreed among all ranks */
+static int
+_gaspi_coll_time (const gaspi_coll_t coll, const int alg, const int elems,
+		  const gaspi_timeout_t timeout_ms, double *usecs)
+{
+  int i;
+  double send[255], recv[255];
+  gaspi_cycles_t s0, sum = 0;
+  gaspi_return_t ret;
+
+  for (i = 0; i < elems; i++)
+    send[i] = (double) glb_gaspi_ctx.rank;
+
+  gaspi_coll_force[coll] = alg;
+  gaspi_coll_setup_group (GASPI_GROUP_ALL);
+
+  for (i = 0; i < GASPI_COLL_TUNE_WARMUP + GASPI_COLL_TUNE_ITER; i++)
+    {
+      s0 = gaspi_get_cycles ();
+
+      if (coll == GASPI_COLL_BARRIER)
+	ret = gaspi_barrier (GASPI_GROUP_ALL, timeout_ms);
+      else
+	ret = gaspi_allreduce (send, recv, elems, GASPI_OP_MAX, GASPI_TYPE_DOUBLE,
+			       GASPI_GROUP_ALL, timeout_ms);
+
+      if (ret != GASPI_SUCCESS)
+	return -1;
+
+      if (i >= GASPI_COLL_TUNE_WARMUP)
+	sum += gaspi_get_cycles () - s0;
+    }
+
+  send[0] = (double) sum / GASPI_COLL_TUNE_ITER / glb_gaspi_ctx.mhz;
+
+  //slowest rank decides
+  if (gaspi_allreduce (send, usecs, 1, GASPI_OP_MAX, GASPI_TYPE_DOUBLE,
+		       GASPI_GROUP_ALL, timeout_ms) != GASPI_SUCCESS)
+    return -1;
+
+  return 0;
+}
+
+static int
+_gaspi_coll_tune_one (const gaspi_coll_t coll, const int elems,
+		      const gaspi_timeout_t timeout_ms)
+{
+  int alg, best = 0;
+  double t, tbest = 0.0;
+  const gaspi_ib_group *grp = &glb_gaspi_group_ib[GASPI_GROUP_ALL];
+
+  for (alg = 0; alg < gaspi_coll_algs[coll]; alg++)
+    {
+      if (coll == GASPI_COLL_BARRIER && alg == GASPI_BARRIER_PAIRWISE
+	  && grp->tnc != grp->next_pof2)
+	continue;
+
+      if (_gaspi_coll_time (coll, alg, elems, timeout_ms, &t) < 0)
+	return -1;
+
+      if (alg == 0 || t < tbest)
+	{
+	  tbest = t;
+	  best = alg;
+	}
+    }
+
+  if (glb_gaspi_ctx.rank == 0)
+    gaspi_printf ("Tuning %s (%d ranks, %d bytes): %s (%.2f usecs)\n",
+		  gaspi_coll_names[coll], grp->tnc, elems * 8,
+		  gaspi_coll_alg_names[coll][best], tbest);
+
+  return best;
+}
+
+/* Benchmark all algorithms on GASPI_GROUP_ALL, merge the results
+   into the decision table and write it to file (rank 0) */
+int
+gaspi_coll_tune (const char *file, const gaspi_timeout_t timeout_ms)
+{
+  int i, b, alg;
+  const int tnc = glb_gaspi_group_ib[GASPI_GROUP_ALL].tnc;
+
+  //drop old rules for this size
+  for (i = 0; i < glb_gaspi_coll_nrules;)
+    {
+      if (glb_gaspi_coll_rules[i].group_size == tnc)
+	glb_gaspi_coll_rules[i] = glb_gaspi_coll_rules[--glb_gaspi_coll_nrules];
+      else
+	i++;
+    }
+
+  alg = _gaspi_coll_tune_one (GASPI_COLL_BARRIER, 0, timeout_ms);
+  if (alg < 0 || _gaspi_coll_add_rule (GASPI_COLL_BARRIER, tnc, 0, alg) < 0)
+    goto errL;
+
+  //8 bytes up to the max. allreduce size
+  for (b = 3; b < GASPI_COLL_BUCKETS; b++)
+    {
+      alg = _gaspi_coll_tune_one (GASPI_COLL_ALLREDUCE, MIN ((1 << b) / 8, 255), timeout_ms);
+      if (alg < 0 || _gaspi_coll_add_rule (GASPI_COLL_ALLREDUCE, tnc, 1 << b, alg) < 0)
+	goto errL;
+    }
+
+  gaspi_coll_force[GASPI_COLL_BARRIER] = -1;
+  gaspi_coll_force[GASPI_COLL_ALLREDUCE] = -1;
+
+  for (i = 0; i < glb_gaspi_cfg.group_max; i++)
+    {
+      if (glb_gaspi_group_ib[i].id >= 0 && glb_gaspi_group_ib[i].next_pof2)
+	gaspi_coll_setup_group (i);
+    }
+
+  if (glb_gaspi_ctx.rank == 0)
+    {
+      FILE *fp = fopen (file, "w");
+      if (fp == NULL)
+	{
+	  gaspi_print_error ("Failed to write collectives decision file %s", file);
+	  return -1;
+	}
+
+      fprintf (fp, "# GPI-2 collectives decision table\n");
+      fprintf (fp, "# <collective> <min. group size> <max. bytes> <algorithm>\n");
+
+      for (i = 0; i < glb_gaspi_coll_nrules; i++)
+	{
+	  const gaspi_coll_rule *r = &glb_gaspi_coll_rules[i];
+	  fprintf (fp, "%s %d %d %s\n", gaspi_coll_names[r->coll], r->group_size,
+		   r->bytes, gaspi_coll_alg_names[r->coll][r->alg]);
+	}
+
+      fclose (fp);
+    }
+
+  return 0;
+
+ errL:
+  gaspi_coll_force[GASPI_COLL_BARRIER] = -1;
+  gaspi_coll_force[GASPI_COLL_ALLREDUCE] = -1;
+  gaspi_coll_setup_group (GASPI_GROUP_ALL);
+
+  return -1;
+}
+
+/* Algorithm a group uses for coll (for bytes, allreduce only), as
+   chosen by the decision table. Not part of the API, the tests check
+   the decisions with it */
+int
+gaspi_coll_algorithm (const gaspi_group_t group, const gaspi_coll_t coll,
+		      const int bytes, const char **const alg)
+{
+  if (!glb_gaspi_init || group >= glb_gaspi_cfg.group_max
+      || glb_gaspi_group_ib[group].id < 0)
+    {
+      gaspi_print_error ("Invalid group %d", group);
+      return -1;
+    }
+
+  const gaspi_ib_group *grp = &glb_gaspi_group_ib[group];
+
+  switch (coll)
+    {
+    case GASPI_COLL_BARRIER:
+      *alg = gaspi_coll_alg_names[GASPI_COLL_BARRIER][grp->barrier_alg];
+      return 0;
+
+    case GASPI_COLL_ALLREDUCE:
+      *alg = gaspi_coll_alg_names[GASPI_COLL_ALLREDUCE]
+	[grp->allreduce_alg[MIN (gaspi_coll_bucket (bytes), GASPI_COLL_BUCKETS - 1)]];
+      return 0;
+
+    default:
+      gaspi_print_error ("Unknown collective %d", coll);
+      return -1;
+    }
+}
@@ -0,0 +1,68 @@
+/*
+Copyright (c) Fraunhofer ITWM - Carsten Lojewski <lojewski@itwm.fhg.de>, 2013-2014
+
+This file is part of GPI-2.
+
+GPI-2 is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License
+version 3 as published by the Free Software Foundation.
+
+GPI-2 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with GPI-2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _GPI2_COLL_H_
+#define _GPI2_COLL_H_ 1
+
+#include "GASPI.h"
+
+/* Collectives with more than one algorithm */
+typedef enum
+{
+  GASPI_COLL_BARRIER = 0,
+  GASPI_COLL_ALLREDUCE = 1
+} gaspi_coll_t;
+
+#define GASPI_COLL_NUM (2)
+
+/* Barrier algorithms */
+enum
+{
+  GASPI_BARRIER_DISSEMINATION = 0, /* default */
+  GASPI_BARRIER_PAIRWISE = 1,      /* power of 2 groups only */
+  GASPI_BARRIER_ALGS = 2
+};
+
+/* Allreduce algorithms */
+enum
+{
+  GASPI_ALLREDUCE_REC_DOUBLING = 0,  /* default */
+  GASPI_ALLREDUCE_DISSEMINATION = 1, /* GASPI_OP_MIN/MAX only */
+  GASPI_ALLREDUCE_ALGS = 2
+};
+
+/* Allreduce message size buckets (2^0 ... 2^11 bytes) */
+#define GASPI_COLL_BUCKETS (12)
+
+static inline int
+gaspi_coll_bucket (const int bytes)
+{
+  if (bytes <= 1)
+    return 0;
+
+  return 32 - __builtin_clz (bytes - 1);
+}
+
+int gaspi_coll_load (const char *file);
+int gaspi_coll_select (const gaspi_coll_t coll, const int group_size, const int bytes);
+void gaspi_coll_setup_group (const gaspi_group_t g);
+int gaspi_coll_tune (const char *file, const gaspi_timeout_t timeout_ms);
+int gaspi_coll_algorithm (const gaspi_group_t group, const gaspi_coll_t coll,
+			  const int bytes, const char **const alg);
+
+#endif //_GPI2_COLL_H_
@@ -169,7 +169,7 @@ gaspi_handle_env(gaspi_context *ctx)
 {
   int env_miss = 0;
   
-  char *socketPtr, *typePtr, *mfilePtr, *numaPtr;
+  char *socketPtr, *typePtr, *mfilePtr, *numaPtr, *collPtr, *tunePtr;
   socketPtr = getenv ("GASPI_SOCKET");
   numaPtr = getenv ("GASPI_SET_NUMA_SOCKET");
   
@@ -181,6 +181,17 @@ gaspi_handle_env(gaspi_context *ctx)
   
   mfilePtr = getenv ("GASPI_MFILE");
 
+  //collectives decision table (optional)
+  collPtr = getenv ("GASPI_COLL_FILE");
+  if(collPtr)
+    {
+      snprintf (ctx->cfile, 1024, "%s", collPtr);
+
+      tunePtr = getenv ("GASPI_COLL_TUNE");
+      if(tunePtr)
+	ctx->coll_tune = (atoi (tunePtr) == 1);
+    }
+
   if(socketPtr)
     {
 #ifdef LOADLEVELER
@@ -218,17 +218,14 @@ static int _gaspi_event_send(gaspi_cuda_event *event, int queue)
   swr.send_flags = IBV_SEND_SIGNALED;
   swr.next       = NULL;
 
-  slist.addr = (uintptr_t) (char*)(glb_gaspi_ctx_ib.rrmd[event->segment_local][event->rank].host_ptr+NOTIFY_OFFSET+event->offset_local);
+  slist.addr = (uintptr_t) (char*)(glb_gaspi_ctx_ib.lmsd[event->segment_local].host_ptr+GASPI_GPU_STAGE_OFFSET+event->offset_local);
 
   slist.length = event->size;
-  slist.lkey = glb_gaspi_ctx_ib.rrmd[event->segment_local][glb_gaspi_ctx.rank].host_mr->lkey;
+  slist.lkey = glb_gaspi_ctx_ib.lmsd[event->segment_local].host_mr->lkey;
 
-  if(glb_gaspi_ctx_ib.rrmd[event->segment_remote][event->rank].cudaDevId >= 0)
-    swr.wr.rdma.remote_addr = (glb_gaspi_ctx_ib.rrmd[event->segment_remote][event->rank].addr+event->offset_remote);
-  else
-    swr.wr.rdma.remote_addr = (glb_gaspi_ctx_ib.rrmd[event->segment_remote][event->rank].addr+NOTIFY_OFFSET+event->offset_remote);
+  swr.wr.rdma.remote_addr = (glb_gaspi_ctx_ib.rrmd[event->segment_remote][event->rank].addr+event->offset_remote);
 
-  if(ibv_post_send(glb_gaspi_ctx_ib.qpC[queue][event->rank],&swr,&bad_wr))
+  if(ibv_post_send(glb_gaspi_ctx_ib.peer[event->rank]->qpC[queue],&swr,&bad_wr))
   {
     glb_gaspi_ctx.qp_state_vec[queue][event->rank]=1;       
     return GASPI_ERROR; 
@@ -252,6 +249,14 @@ gaspi_return_t pgaspi_gpu_write(const gaspi_segment_id_t segment_id_local,
     const gaspi_queue_id_t queue,
     const gaspi_timeout_t timeout_ms)
 {
+  const gaspi_return_t eret = gaspi_segment_remote(segment_id_remote, rank, timeout_ms);
+  if(eret != GASPI_SUCCESS)
+    return eret;
+
+  const gaspi_return_t qret = gaspi_queue_remote(queue, rank, timeout_ms);
+  if(qret != GASPI_SUCCESS)
+    return qret;
+
   if(glb_gaspi_ctx_ib.rrmd[segment_id_local][glb_gaspi_ctx.rank].cudaDevId < 0)
     return gaspi_write(segment_id_local, offset_local, rank, segment_id_remote, offset_remote, size, queue, timeout_ms);
 
@@ -261,7 +266,7 @@ gaspi_return_t pgaspi_gpu_write(const gaspi_segment_id_t segment_id_local,
   if(lock_gaspi_tout (&glb_gaspi_ctx.lockC[queue], timeout_ms))
     return GASPI_TIMEOUT;
 
-  char* host_ptr = (char*)(glb_gaspi_ctx_ib.rrmd[segment_id_local][glb_gaspi_ctx.rank].host_ptr+NOTIFY_OFFSET+offset_local);
+  char* host_ptr = (char*)(glb_gaspi_ctx_ib.lmsd[segment_id_local].host_ptr+GASPI_GPU_STAGE_OFFSET+offset_local);
   char* device_ptr =(char*)(glb_gaspi_ctx_ib.rrmd[segment_id_local][glb_gaspi_ctx.rank].addr+offset_local);
 
   int size_left = size;
@@ -398,6 +403,20 @@ gaspi_return_t pgaspi_gpu_write_notify(const gaspi_segment_id_t segment_id_local
     const gaspi_queue_id_t queue,
     const gaspi_timeout_t timeout_ms)
 {
+  if(notification_id >= glb_gaspi_cfg.notification_num)
+    {
+      gaspi_print_error("Invalid notification id: %u (gaspi_gpu_write_notify)", notification_id);
+      return GASPI_ERROR;
+    }
+
+  const gaspi_return_t eret = gaspi_segment_remote(segment_id_remote, rank, timeout_ms);
+  if(eret != GASPI_SUCCESS)
+    return eret;
+
+  const gaspi_return_t qret = gaspi_queue_remote(queue, rank, timeout_ms);
+  if(qret != GASPI_SUCCESS)
+    return qret;
+
 
   if(glb_gaspi_ctx_ib.rrmd[segment_id_local][glb_gaspi_ctx.rank].cudaDevId < 0)
     return gaspi_write_notify(segment_id_local, offset_local, rank, segment_id_remote, offset_remote, size,notification_id, notification_value, queue, timeout_ms);
@@ -408,7 +427,7 @@ gaspi_return_t pgaspi_gpu_write_notify(const gaspi_segment_id_t segment_id_local
   if(lock_gaspi_tout (&glb_gaspi_ctx.lockC[queue], timeout_ms))
     return GASPI_TIMEOUT;
 
-  char *host_ptr = (char*)(glb_gaspi_ctx_ib.rrmd[segment_id_local][glb_gaspi_ctx.rank].host_ptr+NOTIFY_OFFSET+offset_local);
+  char *host_ptr = (char*)(glb_gaspi_ctx_ib.lmsd[segment_id_local].host_ptr+GASPI_GPU_STAGE_OFFSET+offset_local);
   char* device_ptr =(char*)(glb_gaspi_ctx_ib.rrmd[segment_id_local][glb_gaspi_ctx.rank].addr+offset_local);
 
   int size_left = size;
@@ -545,9 +564,9 @@ gaspi_return_t pgaspi_gpu_write_notify(const gaspi_segment_id_t segment_id_local
   else
   {
     swrN.wr.rdma.remote_addr =
-      (glb_gaspi_ctx_ib.rrmd[segment_id_remote][rank].addr +
+      (glb_gaspi_ctx_ib.rrmd[segment_id_remote][rank].notif_addr +
        notification_id * 4);
-    swrN.wr.rdma.rkey = glb_gaspi_ctx_ib.rrmd[segment_id_remote][rank].rkey;
+    swrN.wr.rdma.rkey = glb_gaspi_ctx_ib.rrmd[segment_id_remote][rank].notif_rkey;
   }
 
   swrN.sg_list = &slistN;
@@ -557,7 +576,7 @@ gaspi_return_t pgaspi_gpu_write_notify(const gaspi_segment_id_t segment_id_local
   swrN.send_flags = IBV_SEND_SIGNALED | IBV_SEND_INLINE;;
   swrN.next = NULL;
 
-  if (ibv_post_send (glb_gaspi_ctx_ib.qpC[queue][rank], &swrN, &bad_wr))
+  if (ibv_post_send (glb_gaspi_ctx_ib.peer[rank]->qpC[queue], &swrN, &bad_wr))
   {
     glb_gaspi_ctx.qp_state_vec[queue][rank] = 1;
     unlock_gaspi (&glb_gaspi_ctx.lockC[queue]);
@@ -17,6 +17,7 @@ along with GPI-2. If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include <errno.h>
+#include <poll.h>
 #include <sys/mman.h>
 #include <sys/time.h>
 #include <sys/timeb.h>
@@ -32,11 +33,16 @@ along with GPI-2. If not, see <http://www.gnu.org/licenses/>.
 #include "GASPI.h"
 #include "GPI2.h"
 #include "GPI2_IB.h"
+#include "GPI2_Mem.h"
 #include "GPI2_SN.h"
 
 /* Globals */
 extern gaspi_config_t glb_gaspi_cfg;
 
+static int gaspi_mr_pools_cleanup (void);
+static int gaspi_segment_release (const gaspi_segment_id_t segment_id);
+static void gaspi_segment_rrmd_free (const gaspi_segment_id_t segment_id);
+
 static char *port_state_str[] = {
   "NOP",
   "Down",
@@ -96,13 +102,70 @@ pgaspi_state_vec_get (gaspi_state_vector_t state_vector)
     {
       for (j = 0; j < (GASPI_MAX_QP + 3); j++)
 	{
-	  state_vector[i] |= glb_gaspi_ctx.qp_state_vec[j][i];
+	  if (glb_gaspi_ctx.qp_state_vec[j] != NULL)
+	    state_vector[i] |= glb_gaspi_ctx.qp_state_vec[j][i];
 	}
     }
 
   return GASPI_SUCCESS;
 }
 
+#pragma weak gaspi_memory_report = pgaspi_memory_report
+gaspi_return_t
+pgaspi_memory_report (gaspi_number_t * const peers,
+		      gaspi_size_t * const peer_bytes,
+		      gaspi_size_t * const total_bytes)
+{
+  int i;
+  gaspi_qp_spare *spare;
+
+  gaspi_verify_null_ptr(peers);
+  gaspi_verify_null_ptr(peer_bytes);
+  gaspi_verify_null_ptr(total_bytes);
+
+  if (!glb_gaspi_ib_init)
+    return GASPI_ERROR;
+
+  const gaspi_size_t tnc = glb_gaspi_ctx.tnc;
+  gaspi_number_t n = 0;
+  gaspi_size_t pb = tnc * sizeof (gaspi_peer *);
+
+  lock_gaspi_tout (&gaspi_create_lock, GASPI_BLOCK);
+
+  for (i = 0; i < tnc; i++)
+    if (glb_gaspi_ctx_ib.peer[i] != NULL)
+      n++;
+
+  pb += n * sizeof (gaspi_peer);
+  for (spare = glb_gaspi_ctx_ib.qp_spare; spare != NULL; spare = spare->next)
+    pb += sizeof (gaspi_qp_spare);
+
+  unlock_gaspi (&gaspi_create_lock);
+
+  //sockets, host names and state vectors
+  gaspi_size_t tb = pb + tnc * (sizeof (int) + 65);
+
+  for (i = 0; i < GASPI_MAX_QP + 3; i++)
+    if (glb_gaspi_ctx.qp_state_vec[i] != NULL)
+      tb += tnc;
+
+  for (i = 0; i < GASPI_SEGMENTS_LIMIT; i++)
+    if (glb_gaspi_ctx_ib.rrmd[i] != NULL)
+      tb += tnc * sizeof (gaspi_rc_mseg);
+
+  for (i = 0; i < glb_gaspi_cfg.group_max; i++)
+    if (glb_gaspi_group_ib[i].id >= 0)
+      tb += glb_gaspi_group_ib[i].size
+	+ glb_gaspi_group_ib[i].rank_grp_size * sizeof (int)
+	+ glb_gaspi_group_ib[i].tnc * sizeof (gaspi_rc_grp);
+
+  *peers = n;
+  *peer_bytes = pb;
+  *total_bytes = tb;
+
+  return GASPI_SUCCESS;
+}
+
 int
 gaspi_init_ib_core ()
 {
@@ -112,20 +175,23 @@ gaspi_init_ib_core ()
   if (glb_gaspi_ib_init)
     return -1;
 
-  //change/override num of queues at large scale
-  if (glb_gaspi_ctx.tnc > 1000 && glb_gaspi_cfg.queue_num > 1)
+  memset (&glb_gaspi_ctx_ib, 0, sizeof (gaspi_ib_ctx));
+  if (glb_gaspi_group_ib == NULL)
     {
-      gaspi_printf("Warning: setting number of queues to 1\n");
-      glb_gaspi_cfg.queue_num = 1;
+      glb_gaspi_group_ib = (gaspi_ib_group *) calloc (glb_gaspi_cfg.group_max, sizeof (gaspi_ib_group));
+      if (glb_gaspi_group_ib == NULL)
+	{
+	  gaspi_print_error ("Memory allocation failed");
+	  return -1;
+	}
     }
-  
-      
-  memset (&glb_gaspi_ctx_ib, 0, sizeof (gaspi_ib_ctx));
-  memset (&glb_gaspi_group_ib, 0, GASPI_MAX_GROUPS * sizeof (gaspi_ib_group));
+  else
+    memset (glb_gaspi_group_ib, 0, glb_gaspi_cfg.group_max * sizeof (gaspi_ib_group));
 
-  for(i = 0; i < 256; i++){glb_gaspi_ctx_ib.rrmd[i] = NULL;}
+  for(i = 0; i < GASPI_SEGMENTS_LIMIT; i++){glb_gaspi_ctx_ib.rrmd[i] = NULL;}
+  memset (glb_gaspi_ctx_ib.lmsd, 0, sizeof (glb_gaspi_ctx_ib.lmsd));
 
-  for (i = 0; i < GASPI_MAX_GROUPS; i++){ 
+  for (i = 0; i < glb_gaspi_cfg.group_max; i++){ 
     glb_gaspi_group_ib[i].id = -1;
     glb_gaspi_group_ib[i].coll_op = GASPI_NONE;
     glb_gaspi_group_ib[i].lastmask = 0x1;
@@ -453,32 +519,12 @@ gaspi_init_ib_core ()
 	  gaspi_print_error ("Failed to create CQ (libibverbs)");
 	  return -1;
 	}
-      
-    glb_gaspi_ctx_ib.rcqC[c] = ibv_create_cq (glb_gaspi_ctx_ib.context, glb_gaspi_cfg.queue_depth,NULL, NULL, 0);
-    
-    if(!glb_gaspi_ctx_ib.rcqC[c])
-      {
-	gaspi_print_error ("Failed to create CQ (libibverbs)");
-	return -1;
-      }
-    
     }
 
 
-  glb_gaspi_ctx_ib.qpGroups = (struct ibv_qp **) malloc (glb_gaspi_ctx.tnc * sizeof (struct ibv_qp));
-  if(!glb_gaspi_ctx_ib.qpGroups)
-    {
-      return -1;
-    }
-
-  for(c = 0; c < glb_gaspi_cfg.queue_num; c++)
-    {
-      glb_gaspi_ctx_ib.qpC[c] = (struct ibv_qp **) malloc (glb_gaspi_ctx.tnc *sizeof (struct ibv_qp));
-      if(!glb_gaspi_ctx_ib.qpC[c]) return -1;
-    }
-  
-  glb_gaspi_ctx_ib.qpP = (struct ibv_qp **) malloc (glb_gaspi_ctx.tnc * sizeof (struct ibv_qp));
-  if(!glb_gaspi_ctx_ib.qpP)
+  //per peer state is allocated with the endpoint
+  glb_gaspi_ctx_ib.peer = (gaspi_peer **) calloc (glb_gaspi_ctx.tnc, sizeof (gaspi_peer *));
+  if(!glb_gaspi_ctx_ib.peer)
     {
       return -1;
     }
@@ -510,48 +556,28 @@ gaspi_init_ib_core ()
 	}
   }
 
-  glb_gaspi_ctx_ib.lrcd = (gaspi_rc_all *) calloc (glb_gaspi_ctx.tnc,sizeof (gaspi_rc_all));
-  if(!glb_gaspi_ctx_ib.lrcd)
-    {
-      return -1;
-    }
-
-  glb_gaspi_ctx_ib.rrcd = (gaspi_rc_all *) calloc (glb_gaspi_ctx.tnc,sizeof (gaspi_rc_all));
- 
-  if(!glb_gaspi_ctx_ib.rrcd)
+  if(glb_gaspi_cfg.port_check)
     {
-      return -1;
-    }
-  
-  for(i = 0; i < glb_gaspi_ctx.tnc; i++)
-    {
-      
-      glb_gaspi_ctx_ib.lrcd[i].lid = glb_gaspi_ctx_ib.port_attr[glb_gaspi_ctx_ib.ib_port - 1].lid;
-      
-      struct timeval tv;
-      gettimeofday (&tv, NULL);
-      srand48 (tv.tv_usec);
-      glb_gaspi_ctx_ib.lrcd[i].psn = lrand48 () & 0xffffff;
-      
-      if(glb_gaspi_cfg.port_check)
+      if(!glb_gaspi_ctx_ib.port_attr[glb_gaspi_ctx_ib.ib_port - 1].lid && (glb_gaspi_cfg.network == GASPI_IB))
 	{
-	  if(!glb_gaspi_ctx_ib.lrcd[i].lid && (glb_gaspi_cfg.network == GASPI_IB))
-	    {
-	      gaspi_print_error("Failed to find topology! Is subnet-manager running ?");
-	      return -1;
-	    }
-	}
-
-      if(glb_gaspi_cfg.network == GASPI_ETHERNET)
-	{
-	  glb_gaspi_ctx_ib.lrcd[i].gid = glb_gaspi_ctx_ib.gid;
+	  gaspi_print_error("Failed to find topology! Is subnet-manager running ?");
+	  return -1;
 	}
     }
 
+  //psn of each endpoint
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+  srand48 (tv.tv_usec);
+
   gaspi_init_collectives();
 
+  //state of the configured queues, collectives, passive and SN
   for(i = 0; i < GASPI_MAX_QP + 3; i++)
     {
+      if(i >= glb_gaspi_cfg.queue_num && i < GASPI_MAX_QP)
+	continue;
+
       glb_gaspi_ctx.qp_state_vec[i] = (unsigned char *) malloc (glb_gaspi_ctx.tnc);
       if(!glb_gaspi_ctx.qp_state_vec[i])
 	{
@@ -566,16 +592,10 @@ gaspi_init_ib_core ()
 }
 
 
-int
-gaspi_create_endpoint(const int i)
+/* Create a RC QP and bring it to INIT */
+static struct ibv_qp *
+gaspi_qp_create(struct ibv_cq *send_cq, struct ibv_cq *recv_cq, struct ibv_srq *srq)
 {
-  int c;
-
-  lock_gaspi_tout(&gaspi_create_lock, GASPI_BLOCK);
-
-  if(glb_gaspi_ctx_ib.lrcd[i].istat) goto okL;//already created
-
-  //create
   struct ibv_qp_init_attr qpi_attr;
   memset (&qpi_attr, 0, sizeof (struct ibv_qp_init_attr));
   qpi_attr.cap.max_send_wr = glb_gaspi_cfg.queue_depth;
@@ -584,39 +604,15 @@ gaspi_create_endpoint(const int i)
   qpi_attr.cap.max_recv_sge = 1;
   qpi_attr.cap.max_inline_data = MAX_INLINE_BYTES;
   qpi_attr.qp_type = IBV_QPT_RC;
-  qpi_attr.send_cq = glb_gaspi_ctx_ib.scqGroups;
-  qpi_attr.recv_cq = glb_gaspi_ctx_ib.rcqGroups;
+  qpi_attr.send_cq = send_cq;
+  qpi_attr.recv_cq = recv_cq;
+  qpi_attr.srq = srq;
 
-  glb_gaspi_ctx_ib.qpGroups[i] = ibv_create_qp (glb_gaspi_ctx_ib.pd, &qpi_attr);
-  if(!glb_gaspi_ctx_ib.qpGroups[i])
+  struct ibv_qp *qp = ibv_create_qp (glb_gaspi_ctx_ib.pd, &qpi_attr);
+  if(!qp)
     {
       gaspi_print_error ("Failed to create QP (libibverbs)");
-      goto errL;
-    }
-
-  
-  for(c = 0; c < glb_gaspi_cfg.queue_num; c++)
-    {
-      qpi_attr.send_cq = glb_gaspi_ctx_ib.scqC[c];
-      qpi_attr.recv_cq = glb_gaspi_ctx_ib.rcqC[c];
-      
-      glb_gaspi_ctx_ib.qpC[c][i] = ibv_create_qp (glb_gaspi_ctx_ib.pd, &qpi_attr);
-      if(!glb_gaspi_ctx_ib.qpC[c][i])
-	{
-	  gaspi_print_error ("Failed to create QP (libibverbs)");
-	  goto errL;
-	}
-    }
-  
-  qpi_attr.send_cq = glb_gaspi_ctx_ib.scqP;
-  qpi_attr.recv_cq = glb_gaspi_ctx_ib.rcqP;
-  qpi_attr.srq = glb_gaspi_ctx_ib.srqP;
-
-  glb_gaspi_ctx_ib.qpP[i] = ibv_create_qp (glb_gaspi_ctx_ib.pd, &qpi_attr);
-  if(!glb_gaspi_ctx_ib.qpP[i])
-    {
-    gaspi_print_error ("Failed to create QP (libibverbs)");
-    goto errL;
+      return NULL;
     }
 
   //init
@@ -628,59 +624,113 @@ gaspi_create_endpoint(const int i)
   qp_attr.port_num = glb_gaspi_ctx_ib.ib_port;
   qp_attr.qp_access_flags = IBV_ACCESS_REMOTE_READ | IBV_ACCESS_REMOTE_WRITE |IBV_ACCESS_REMOTE_ATOMIC;
 
-
-  if(ibv_modify_qp(glb_gaspi_ctx_ib.qpGroups[i], &qp_attr,
-		   IBV_QP_STATE  
+  if(ibv_modify_qp(qp, &qp_attr,
+		   IBV_QP_STATE
 		   | IBV_QP_PKEY_INDEX
 		   | IBV_QP_PORT
 		   | IBV_QP_ACCESS_FLAGS))
     {
       gaspi_print_error ("Failed to modify QP (libibverbs)");
-      goto errL;
+      ibv_destroy_qp (qp);
+      return NULL;
     }
-  
-  
+
+  return qp;
+}
+
+/* Destroy the QPs of a peer and free it */
+static int
+gaspi_peer_free(gaspi_peer *peer)
+{
+  int c, ret = 0;
+
+  if(peer->qpGroup != NULL && ibv_destroy_qp (peer->qpGroup))
+    ret = -1;
+
   for(c = 0; c < glb_gaspi_cfg.queue_num; c++)
     {
-      if(ibv_modify_qp(glb_gaspi_ctx_ib.qpC[c][i], &qp_attr,
-		       IBV_QP_STATE
-		       | IBV_QP_PKEY_INDEX
-		       |IBV_QP_PORT
-		       | IBV_QP_ACCESS_FLAGS))
-	{
-	  gaspi_print_error ("Failed to modify QP (libibverbs)");
-	  goto errL;
-	}
+      if(peer->qpC[c] != NULL && ibv_destroy_qp (peer->qpC[c]))
+	ret = -1;
     }
-  
-  
-  if(ibv_modify_qp (glb_gaspi_ctx_ib.qpP[i], &qp_attr,
-		    IBV_QP_STATE 
-		    | IBV_QP_PKEY_INDEX
-		    | IBV_QP_PORT
-		    | IBV_QP_ACCESS_FLAGS))
+
+  if(peer->qpP != NULL && ibv_destroy_qp (peer->qpP))
+    ret = -1;
+
+  if(ret != 0)
     {
-      gaspi_print_error ("Failed to modify QP (libibverbs)");
+      gaspi_print_error ("Failed to destroy QP (libibverbs)");
+    }
+
+  free (peer);
+  return ret;
+}
+
+int
+gaspi_create_endpoint(const int i)
+{
+  int c;
+  gaspi_peer *peer = NULL;
+
+  if(i < 0 || i >= glb_gaspi_ctx.tnc)
+    return GASPI_ERROR;
+
+  lock_gaspi_tout(&gaspi_create_lock, GASPI_BLOCK);
+
+  if(glb_gaspi_ctx_ib.peer[i] != NULL) goto okL;//already created
+
+  if(posix_memalign ((void **) &peer, 64, sizeof (gaspi_peer)) != 0)
+    {
+      gaspi_print_error ("Memory allocation (posix_memalign) failed");
+      peer = NULL;
       goto errL;
     }
+  memset (peer, 0, sizeof (gaspi_peer));
 
-  
-  glb_gaspi_ctx_ib.lrcd[i].qpnGroup = glb_gaspi_ctx_ib.qpGroups[i]->qp_num;
+  peer->lrcd.lid = glb_gaspi_ctx_ib.port_attr[glb_gaspi_ctx_ib.ib_port - 1].lid;
+  peer->lrcd.psn = lrand48 () & 0xffffff;
 
-  glb_gaspi_ctx_ib.lrcd[i].qpnP = glb_gaspi_ctx_ib.qpP[i]->qp_num;
-  
+  if(glb_gaspi_cfg.network == GASPI_ETHERNET)
+    {
+      peer->lrcd.gid = glb_gaspi_ctx_ib.gid;
+    }
+
+  //create
+  peer->qpGroup = gaspi_qp_create (glb_gaspi_ctx_ib.scqGroups, glb_gaspi_ctx_ib.rcqGroups, NULL);
+  if(!peer->qpGroup)
+    goto errL;
+
+  //no receives are posted on the queues, they share one recv CQ
   for(c = 0; c < glb_gaspi_cfg.queue_num; c++)
     {
-      glb_gaspi_ctx_ib.lrcd[i].qpnC[c] = glb_gaspi_ctx_ib.qpC[c][i]->qp_num;
+      //at large scale queue c > 0 is set up on first use (gaspi_queue_connect)
+      if(c > 0 && glb_gaspi_ctx.tnc > glb_gaspi_cfg.queue_lazy_tnc)
+	continue;
+
+      peer->qpC[c] = gaspi_qp_create (glb_gaspi_ctx_ib.scqC[c], glb_gaspi_ctx_ib.rcqGroups, NULL);
+      if(!peer->qpC[c])
+	goto errL;
+
+      peer->lrcd.qpnC[c] = peer->qpC[c]->qp_num;
     }
 
-  glb_gaspi_ctx_ib.lrcd[i].istat=1;
+  peer->qpP = gaspi_qp_create (glb_gaspi_ctx_ib.scqP, glb_gaspi_ctx_ib.rcqP, glb_gaspi_ctx_ib.srqP);
+  if(!peer->qpP)
+    goto errL;
+
+  peer->lrcd.qpnGroup = peer->qpGroup->qp_num;
+
+  peer->lrcd.qpnP = peer->qpP->qp_num;
+
+  glb_gaspi_ctx_ib.peer[i] = peer;
 
 okL:
   unlock_gaspi(&gaspi_create_lock);
   return GASPI_SUCCESS;
 
 errL:
+  if(peer != NULL)
+    gaspi_peer_free (peer);
+
   glb_gaspi_ctx.qp_state_vec[GASPI_SN][i] = 1;
   unlock_gaspi (&gaspi_create_lock);
   return GASPI_ERROR;
@@ -697,51 +747,42 @@ pgaspi_connect (const gaspi_rank_t rank,const gaspi_timeout_t timeout_ms)
   if(!glb_gaspi_ib_init) return GASPI_ERROR;
 
   const int i=rank;
+  if(i >= glb_gaspi_ctx.tnc) return GASPI_ERROR;
   if(gaspi_create_endpoint(i)<0) return GASPI_ERROR;
 
   if(lock_gaspi_tout (&glb_gaspi_ctx_lock, timeout_ms))
     return GASPI_TIMEOUT;
 
-  if(glb_gaspi_ctx_ib.lrcd[i].cstat)
+  if(glb_gaspi_ctx_ib.peer[i]->cstat)
     goto okL;//already connected
 
   gaspi_cd_header cdh;
+  gaspi_sn_req req;
+
+  memset(&cdh, 0, sizeof(gaspi_cd_header));
   cdh.op_len = sizeof(gaspi_rc_all);
   cdh.op = GASPI_SN_CONNECT;
   cdh.rank = glb_gaspi_ctx.rank;
-           
-  int ret;
-  if(-1 == glb_gaspi_ctx.sockfd[i])
-    {
-      gaspi_print_error("Invalid socket fd %d for rank %u\n", glb_gaspi_ctx.sockfd[i], i);
-      goto errL;
-    }
-  
-  ret=write(glb_gaspi_ctx.sockfd[i],&cdh,sizeof(gaspi_cd_header));
-  if(ret !=sizeof(gaspi_cd_header))
-    {
-      gaspi_print_error("Failed to write(%d, %p, %lu)",
-			glb_gaspi_ctx.sockfd[i], &cdh,sizeof(gaspi_cd_header));
-      eret=GASPI_ERROR;
-      goto errL;
-    }
 
-  ret=write(glb_gaspi_ctx.sockfd[i],&glb_gaspi_ctx_ib.lrcd[i],sizeof(gaspi_rc_all));
-  if(ret != sizeof(gaspi_rc_all))
+  if(gaspi_sn_post(i, &cdh, &glb_gaspi_ctx_ib.peer[i]->lrcd, sizeof(gaspi_rc_all),
+		   &req, &glb_gaspi_ctx_ib.peer[i]->rrcd, sizeof(gaspi_rc_all), timeout_ms) != 0)
     {
-      gaspi_print_error("Failed to write(%d. %p, %lu)",
-			glb_gaspi_ctx.sockfd[i],&glb_gaspi_ctx_ib.lrcd[i],sizeof(gaspi_rc_all));
-
+      gaspi_print_error("Failed to send connect request to %d", i);
       eret = GASPI_ERROR;
       goto errL;
     }
 
-  ret=read(glb_gaspi_ctx.sockfd[i],&glb_gaspi_ctx_ib.rrcd[i],sizeof(gaspi_rc_all));
-  if(ret != sizeof(gaspi_rc_all))
+  eret = gaspi_sn_waitall(&req, 1, timeout_ms);
+  if(eret != GASPI_SUCCESS)
     {
-      gaspi_print_error("Failed to read from (%d %p %lu)",
-			glb_gaspi_ctx.sockfd[i],&glb_gaspi_ctx_ib.rrcd[i],sizeof(gaspi_rc_all));
-      eret = GASPI_ERROR;
+      gaspi_sn_cancel(&req);
+      if(eret == GASPI_TIMEOUT)
+	{
+	  unlock_gaspi(&glb_gaspi_ctx_lock);
+	  return GASPI_TIMEOUT;
+	}
+
+      gaspi_print_error("Failed to read connect reply of %d", i);
       goto errL;
     }
             
@@ -762,116 +803,257 @@ pgaspi_connect (const gaspi_rank_t rank,const gaspi_timeout_t timeout_ms)
   return eret;
 }
 
-#pragma weak gaspi_disconnect = pgaspi_disconnect
+/* QP transitions of gaspi_connect_list, shared by the calling thread
+   and the workers: each takes the next rank whose remote info is in */
+typedef struct
+{
+  const gaspi_rank_t *rank_list;
+  const unsigned char *ready;
+  gaspi_number_t num;
+  volatile gaspi_number_t next;
+  volatile int err;
+} gaspi_connect_work;
+
+static void *
+gaspi_connect_worker (void *arg)
+{
+  gaspi_connect_work * const w = (gaspi_connect_work *) arg;
+  gaspi_number_t i;
+
+  while((i = __sync_fetch_and_add (&w->next, 1)) < w->num)
+    {
+      if(w->ready[i] && gaspi_connect_context(w->rank_list[i], GASPI_BLOCK) != 0)
+	w->err = 1;
+    }
+
+  return NULL;
+}
+
+#pragma weak gaspi_connect_list = pgaspi_connect_list
 gaspi_return_t
-pgaspi_disconnect(const gaspi_rank_t rank,const gaspi_timeout_t timeout_ms)
+pgaspi_connect_list (const gaspi_rank_t * const rank_list,
+		     const gaspi_number_t num,
+		     const gaspi_timeout_t timeout_ms)
 {
-  int c;
+  gaspi_number_t i;
+  gaspi_cd_header cdh;
+  gaspi_return_t eret = GASPI_ERROR;
+  pthread_t workers[GASPI_CONNECT_WORKERS];
+  int t, nworkers = 0, nready = 0;
 
-  if(!glb_gaspi_ib_init) return GASPI_ERROR;
+  if(!glb_gaspi_ib_init)
+    return GASPI_ERROR;
 
-  const int i=rank;
+  gaspi_verify_null_ptr(rank_list);
+
+  for(i = 0; i < num; i++)
+    {
+      if(rank_list[i] >= glb_gaspi_ctx.tnc)
+	{
+	  gaspi_print_error("Invalid rank %u to connect to", rank_list[i]);
+	  return GASPI_ERROR;
+	}
+
+      if(gaspi_create_endpoint(rank_list[i]) != GASPI_SUCCESS)
+	return GASPI_ERROR;
+    }
 
   if(lock_gaspi_tout (&glb_gaspi_ctx_lock, timeout_ms))
     return GASPI_TIMEOUT;
 
-  if(glb_gaspi_ctx_ib.lrcd[i].cstat == 0)
-    goto errL;//not connected
-
-  if(ibv_destroy_qp(glb_gaspi_ctx_ib.qpGroups[i]))
+  gaspi_sn_req *reqs = (gaspi_sn_req *) calloc (num, sizeof (gaspi_sn_req));
+  unsigned char *ready = (unsigned char *) calloc (num, sizeof (unsigned char));
+  if(reqs == NULL || ready == NULL)
     {
-      gaspi_print_error ("Failed to destroy QP (libibverbs)");
+      free (reqs);
+      free (ready);
       goto errL;
     }
 
-  for(c = 0; c < glb_gaspi_cfg.queue_num; c++)
+  memset(&cdh, 0, sizeof(gaspi_cd_header));
+  cdh.op_len = sizeof(gaspi_rc_all);
+  cdh.op = GASPI_SN_CONNECT;
+  cdh.rank = glb_gaspi_ctx.rank;
+
+  //send all requests first, the remote SN threads work concurrently
+  for(i = 0; i < num; i++)
+    {
+      const gaspi_rank_t rank = rank_list[i];
+
+      if(glb_gaspi_ctx_ib.peer[rank]->cstat)
+	continue;
+
+      if(gaspi_sn_post(rank, &cdh, &glb_gaspi_ctx_ib.peer[rank]->lrcd, sizeof(gaspi_rc_all),
+		       &reqs[i], &glb_gaspi_ctx_ib.peer[rank]->rrcd, sizeof(gaspi_rc_all), timeout_ms) != 0)
+	{
+	  gaspi_print_error("Failed to send connect request to %u", rank);
+	  break;
+	}
+    }
+
+  eret = (i == num) ? GASPI_SUCCESS : GASPI_ERROR;
+
+  const gaspi_return_t wret = gaspi_sn_waitall(reqs, num, timeout_ms);
+  if(wret != GASPI_SUCCESS && eret == GASPI_SUCCESS)
+    eret = wret;
+
+  for(i = 0; i < num; i++)
     {
-      if(ibv_destroy_qp(glb_gaspi_ctx_ib.qpC[c][i]))
+      if(reqs[i].state == GASPI_SN_REQ_DONE)
 	{
-	  gaspi_print_error ("Failed to destroy QP (libibverbs)");
-	  goto errL;
+	  ready[i] = 1;
+	  nready++;
 	}
+      else
+	gaspi_sn_cancel(&reqs[i]);
     }
-    
-  if(ibv_destroy_qp(glb_gaspi_ctx_ib.qpP[i]))
+
+  //bring the QPs up, with helper threads for many peers
+  gaspi_connect_work work = { rank_list, ready, num, 0, 0 };
+
+  for(t = 0; t < MIN(GASPI_CONNECT_WORKERS, nready / GASPI_CONNECT_PER_WORKER); t++)
     {
-      gaspi_print_error ("Failed to destroy QP (libibverbs)");
-      goto errL;
+      if(pthread_create (&workers[t], NULL, gaspi_connect_worker, &work) != 0)
+	break;
+      nworkers++;
     }
-  
-  glb_gaspi_ctx_ib.lrcd[i].qpnGroup = 0;
-  glb_gaspi_ctx_ib.lrcd[i].qpnP = 0;
-  
-  for(c = 0; c < glb_gaspi_cfg.queue_num; c++)
+
+  gaspi_connect_worker (&work);
+
+  for(t = 0; t < nworkers; t++)
+    pthread_join (workers[t], NULL);
+
+  if(work.err)
     {
-      glb_gaspi_ctx_ib.lrcd[i].qpnC[c] = 0;
+      gaspi_print_error("Failed to connect context");
+      eret = GASPI_ERROR;
     }
-  
-  glb_gaspi_ctx_ib.lrcd[i].istat=0;
-  glb_gaspi_ctx_ib.lrcd[i].cstat=0;
-  
-  unlock_gaspi(&glb_gaspi_ctx_lock);
-  return GASPI_SUCCESS;
+
+  free (reqs);
+  free (ready);
+  unlock_gaspi (&glb_gaspi_ctx_lock);
+  return eret;
 
 errL:
   unlock_gaspi (&glb_gaspi_ctx_lock);
   return GASPI_ERROR;
 }
 
-
-int 
-gaspi_connect_context(const int i, gaspi_timeout_t timeout_ms)
+#pragma weak gaspi_connect_all = pgaspi_connect_all
+gaspi_return_t
+pgaspi_connect_all (const gaspi_timeout_t timeout_ms)
 {
+  int i;
+
   if(!glb_gaspi_ib_init)
-    {
-      return GASPI_ERROR;
-    }
+    return GASPI_ERROR;
 
-  if(lock_gaspi_tout(&gaspi_ccontext_lock, timeout_ms))
-    return GASPI_TIMEOUT;
-  
+  gaspi_rank_t *rank_list = (gaspi_rank_t *) malloc (glb_gaspi_ctx.tnc * sizeof (gaspi_rank_t));
+  if(rank_list == NULL)
+    return GASPI_ERROR;
 
-  if(glb_gaspi_ctx_ib.lrcd[i].cstat)
-    {
-      goto okL;//already connected
-    }
-  
-  struct ibv_qp_attr qp_attr;
-  int c;
+  for(i = 0; i < glb_gaspi_ctx.tnc; i++)
+    rank_list[i] = i;
 
-  memset(&qp_attr, 0, sizeof (qp_attr));
+  const gaspi_return_t eret = pgaspi_connect_list (rank_list, glb_gaspi_ctx.tnc, timeout_ms);
 
-  switch(glb_gaspi_cfg.mtu){
-    case 1024:
-      qp_attr.path_mtu = IBV_MTU_1024;
-      break;
-    case 2048:
-      qp_attr.path_mtu = IBV_MTU_2048;
-      break;
-    case 4096:
-      qp_attr.path_mtu = IBV_MTU_4096;
-      break;
+  free (rank_list);
+  return eret;
+}
+
+#pragma weak gaspi_disconnect = pgaspi_disconnect
+gaspi_return_t
+pgaspi_disconnect(const gaspi_rank_t rank,const gaspi_timeout_t timeout_ms)
+{
+  if(!glb_gaspi_ib_init) return GASPI_ERROR;
+
+  const int i=rank;
+
+  if(lock_gaspi_tout (&glb_gaspi_ctx_lock, timeout_ms))
+    return GASPI_TIMEOUT;
+
+  if(i >= glb_gaspi_ctx.tnc || glb_gaspi_ctx_ib.peer[i] == NULL
+     || glb_gaspi_ctx_ib.peer[i]->cstat == 0)
+    goto errL;//not connected
+
+  lock_gaspi_tout(&gaspi_create_lock, GASPI_BLOCK);
+
+  gaspi_peer * const peer = glb_gaspi_ctx_ib.peer[i];
+  glb_gaspi_ctx_ib.peer[i] = NULL;
+
+  //spare QPs of lazy queues to rank
+  gaspi_qp_spare **sp = &glb_gaspi_ctx_ib.qp_spare;
+  while(*sp != NULL)
+    {
+      gaspi_qp_spare *spare = *sp;
+
+      if(spare->rank != i)
+	{
+	  sp = &spare->next;
+	  continue;
+	}
+
+      *sp = spare->next;
+      if(ibv_destroy_qp (spare->qp))
+	{
+	  gaspi_print_error ("Failed to destroy QP (libibverbs)");
+	}
+      free (spare);
+    }
+
+  unlock_gaspi(&gaspi_create_lock);
+
+  if(gaspi_peer_free (peer) != 0)
+    goto errL;
+  
+  unlock_gaspi(&glb_gaspi_ctx_lock);
+  return GASPI_SUCCESS;
+
+errL:
+  unlock_gaspi (&glb_gaspi_ctx_lock);
+  return GASPI_ERROR;
+}
+
+
+/* Bring a QP from INIT to RTS, connected to QP dest_qpn of rank i */
+static int
+gaspi_qp_connect(struct ibv_qp *qp, const int i, const int dest_qpn)
+{
+  struct ibv_qp_attr qp_attr;
+
+  memset(&qp_attr, 0, sizeof (qp_attr));
+
+  switch(glb_gaspi_cfg.mtu){
+    case 1024:
+      qp_attr.path_mtu = IBV_MTU_1024;
+      break;
+    case 2048:
+      qp_attr.path_mtu = IBV_MTU_2048;
+      break;
+    case 4096:
+      qp_attr.path_mtu = IBV_MTU_4096;
+      break;
     default:
       printf("unexpected MTU:%d\n",glb_gaspi_cfg.mtu);
-      goto errL;
+      return -1;
   };
 
   //ready2recv
   qp_attr.qp_state = IBV_QPS_RTR;
-  qp_attr.dest_qp_num = glb_gaspi_ctx_ib.rrcd[i].qpnGroup;
-  qp_attr.rq_psn = glb_gaspi_ctx_ib.rrcd[i].psn;
+  qp_attr.dest_qp_num = dest_qpn;
+  qp_attr.rq_psn = glb_gaspi_ctx_ib.peer[i]->rrcd.psn;
   qp_attr.max_dest_rd_atomic = glb_gaspi_ctx_ib.max_rd_atomic;
   qp_attr.min_rnr_timer = 12;
 
   if(glb_gaspi_cfg.network == GASPI_IB)
     {
       qp_attr.ah_attr.is_global = 0;
-      qp_attr.ah_attr.dlid = (unsigned short) glb_gaspi_ctx_ib.rrcd[i].lid;
+      qp_attr.ah_attr.dlid = (unsigned short) glb_gaspi_ctx_ib.peer[i]->rrcd.lid;
     }
   else
     {
       qp_attr.ah_attr.is_global = 1;
-      qp_attr.ah_attr.grh.dgid = glb_gaspi_ctx_ib.rrcd[i].gid;
+      qp_attr.ah_attr.grh.dgid = glb_gaspi_ctx_ib.peer[i]->rrcd.gid;
       qp_attr.ah_attr.grh.hop_limit = 1;
     }
 
@@ -879,7 +1061,7 @@ gaspi_connect_context(const int i, gaspi_timeout_t timeout_ms)
   qp_attr.ah_attr.src_path_bits = 0;
   qp_attr.ah_attr.port_num = glb_gaspi_ctx_ib.ib_port;
 
-  if(ibv_modify_qp(glb_gaspi_ctx_ib.qpGroups[i], &qp_attr,
+  if(ibv_modify_qp(qp, &qp_attr,
 		   IBV_QP_STATE
 		   | IBV_QP_AV
 		   | IBV_QP_PATH_MTU
@@ -889,53 +1071,18 @@ gaspi_connect_context(const int i, gaspi_timeout_t timeout_ms)
 		   | IBV_QP_MAX_DEST_RD_ATOMIC))
     {
       gaspi_print_error ("Failed to modify QP (libibverbs)");
-      goto errL;
-    }
-
-  
-  for(c = 0; c < glb_gaspi_cfg.queue_num; c++)
-    {
-      qp_attr.dest_qp_num = glb_gaspi_ctx_ib.rrcd[i].qpnC[c];
-      
-      if(ibv_modify_qp(glb_gaspi_ctx_ib.qpC[c][i], &qp_attr,
-		       IBV_QP_STATE
-		       | IBV_QP_AV
-		       | IBV_QP_PATH_MTU
-		       | IBV_QP_DEST_QPN
-		       | IBV_QP_RQ_PSN
-		       | IBV_QP_MIN_RNR_TIMER
-		       | IBV_QP_MAX_DEST_RD_ATOMIC))
-	{
-	  gaspi_print_error ("Failed to modify QP (libibverbs)");
-	  goto errL;
-	}
+      return -1;
     }
-  
-  
-  qp_attr.dest_qp_num = glb_gaspi_ctx_ib.rrcd[i].qpnP;
 
-  if(ibv_modify_qp(glb_gaspi_ctx_ib.qpP[i], &qp_attr,
-		   IBV_QP_STATE
-		   | IBV_QP_AV
-		   | IBV_QP_PATH_MTU
-		   | IBV_QP_DEST_QPN
-		   | IBV_QP_RQ_PSN
-		   | IBV_QP_MIN_RNR_TIMER
-		   | IBV_QP_MAX_DEST_RD_ATOMIC))
-    {
-      gaspi_print_error ("Failed to modify QP (libibverbs)");
-      goto errL;
-    }
-  
   //ready2send
   qp_attr.timeout = GASPI_QP_TIMEOUT;
   qp_attr.retry_cnt = GASPI_QP_RETRY;
   qp_attr.rnr_retry = GASPI_QP_RETRY;
   qp_attr.qp_state = IBV_QPS_RTS;
-  qp_attr.sq_psn = glb_gaspi_ctx_ib.lrcd[i].psn;
+  qp_attr.sq_psn = glb_gaspi_ctx_ib.peer[i]->lrcd.psn;
   qp_attr.max_rd_atomic = glb_gaspi_ctx_ib.max_rd_atomic;
 
-  if(ibv_modify_qp(glb_gaspi_ctx_ib.qpGroups[i], &qp_attr,
+  if(ibv_modify_qp(qp, &qp_attr,
 		   IBV_QP_STATE
 		   | IBV_QP_SQ_PSN
 		   | IBV_QP_TIMEOUT
@@ -944,129 +1091,225 @@ gaspi_connect_context(const int i, gaspi_timeout_t timeout_ms)
 		   | IBV_QP_MAX_QP_RD_ATOMIC))
     {
       gaspi_print_error ("Failed to modify QP (libibverbs)");
-      goto errL;
+      return -1;
     }
-  
 
-  for(c = 0; c < glb_gaspi_cfg.queue_num; c++)
+  return 0;
+}
+
+int 
+gaspi_connect_context(const int i, gaspi_timeout_t timeout_ms)
+{
+  int c;
+
+  if(!glb_gaspi_ib_init)
     {
-      
-      if(ibv_modify_qp(glb_gaspi_ctx_ib.qpC[c][i], &qp_attr,
-		       IBV_QP_STATE
-		       | IBV_QP_SQ_PSN
-		       | IBV_QP_TIMEOUT
-		       | IBV_QP_RETRY_CNT
-		       | IBV_QP_RNR_RETRY
-		       | IBV_QP_MAX_QP_RD_ATOMIC))
-	{
-	  gaspi_print_error ("Failed to modify QP (libibverbs)"); 
-      goto errL;
-	}
+      return GASPI_ERROR;
     }
+
+  //per peer: several peers can be brought up at once (gaspi_connect_list)
+  if(lock_gaspi_tout(&glb_gaspi_ctx_ib.peer[i]->lock, timeout_ms))
+    return GASPI_TIMEOUT;
   
-  
-  if(ibv_modify_qp(glb_gaspi_ctx_ib.qpP[i], &qp_attr,
-		   IBV_QP_STATE
-		   | IBV_QP_SQ_PSN
-		   | IBV_QP_TIMEOUT
-		   | IBV_QP_RETRY_CNT
-		   | IBV_QP_RNR_RETRY
-		   | IBV_QP_MAX_QP_RD_ATOMIC))
+
+  if(glb_gaspi_ctx_ib.peer[i]->cstat)
     {
-      gaspi_print_error ("Failed to modify QP (libibverbs)");
-      goto errL;
+      goto okL;//already connected
     }
+
+  if(gaspi_qp_connect(glb_gaspi_ctx_ib.peer[i]->qpGroup, i, glb_gaspi_ctx_ib.peer[i]->rrcd.qpnGroup) != 0)
+    goto errL;
+
+  for(c = 0; c < glb_gaspi_cfg.queue_num; c++)
+    {
+      //lazy queues are connected by gaspi_queue_connect
+      if(glb_gaspi_ctx_ib.peer[i]->qpC[c] == NULL)
+	continue;
+
+      if(gaspi_qp_connect(glb_gaspi_ctx_ib.peer[i]->qpC[c], i, glb_gaspi_ctx_ib.peer[i]->rrcd.qpnC[c]) != 0)
+	goto errL;
+    }
+
+  if(gaspi_qp_connect(glb_gaspi_ctx_ib.peer[i]->qpP, i, glb_gaspi_ctx_ib.peer[i]->rrcd.qpnP) != 0)
+    goto errL;
   
-  
-  glb_gaspi_ctx_ib.lrcd[i].cstat=1;
+  glb_gaspi_ctx_ib.peer[i]->cstat=1;
   
  okL:
-  unlock_gaspi(&gaspi_ccontext_lock);
+  unlock_gaspi(&glb_gaspi_ctx_ib.peer[i]->lock);
   return GASPI_SUCCESS;
   
  errL:
   glb_gaspi_ctx.qp_state_vec[GASPI_SN][i] = 1;
-  unlock_gaspi (&gaspi_ccontext_lock);
+  unlock_gaspi (&glb_gaspi_ctx_ib.peer[i]->lock);
   return GASPI_ERROR;
   
 }
 
+/* Put a connected QP of a lazy queue in place. One that lost a race
+   with the remote side (both ends connecting the queue at once) is
+   kept as spare, its peer may already be using the other end */
+static void
+gaspi_queue_install(const int q, const int i, struct ibv_qp *qp)
+{
+  lock_gaspi_tout(&gaspi_create_lock, GASPI_BLOCK);
+
+  if(glb_gaspi_ctx_ib.peer[i]->qpC[q] == NULL)
+    {
+      glb_gaspi_ctx_ib.peer[i]->lrcd.qpnC[q] = qp->qp_num;
+      glb_gaspi_ctx_ib.peer[i]->qpC[q] = qp;
+    }
+  else
+    {
+      gaspi_qp_spare *spare = (gaspi_qp_spare *) malloc (sizeof (gaspi_qp_spare));
+      if(spare != NULL)
+	{
+	  spare->qp = qp;
+	  spare->rank = i;
+	  spare->next = glb_gaspi_ctx_ib.qp_spare;
+	  glb_gaspi_ctx_ib.qp_spare = spare;
+	}
+    }
 
+  unlock_gaspi(&gaspi_create_lock);
+}
 
+/* Remote side of gaspi_queue_connect (SN thread): returns the QP
+   number to connect to or -1 */
 int
-gaspi_cleanup_ib_core ()
+gaspi_queue_accept(const int i, const int q, const int qpn)
 {
-  int i, c;
+  if(!glb_gaspi_ib_init || i < 0 || i >= glb_gaspi_ctx.tnc
+     || q < 0 || q >= glb_gaspi_cfg.queue_num
+     || glb_gaspi_ctx_ib.peer[i] == NULL || !glb_gaspi_ctx_ib.peer[i]->cstat)
+    return -1;
 
-  if(!glb_gaspi_ib_init)
+  struct ibv_qp *qp = gaspi_qp_create (glb_gaspi_ctx_ib.scqC[q], glb_gaspi_ctx_ib.rcqGroups, NULL);
+  if(qp == NULL)
+    return -1;
+
+  if(gaspi_qp_connect(qp, i, qpn) != 0)
     {
+      ibv_destroy_qp (qp);
       return -1;
     }
 
-  for(i = 0; i < glb_gaspi_ctx.tnc; i++)
+  const int lqpn = qp->qp_num;
+  gaspi_queue_install (q, i, qp);
+
+  return lqpn;
+}
+
+/* Create and connect the QP of queue q to rank on first use */
+gaspi_return_t
+gaspi_queue_connect(const gaspi_queue_id_t q, const gaspi_rank_t rank,
+		    const gaspi_timeout_t timeout_ms)
+{
+  struct ibv_qp *qp;
+  gaspi_cd_header cdh;
+  gaspi_sn_req req;
+  int rqpn = -1;
+
+  gaspi_return_t eret = gaspi_connect_remote (rank, timeout_ms);
+  if(eret != GASPI_SUCCESS)
+    return eret;
+
+  if(lock_gaspi_tout (&glb_gaspi_ctx_lock, timeout_ms))
+    return GASPI_TIMEOUT;
+
+  if(glb_gaspi_ctx_ib.peer[rank]->qpC[q] != NULL)
+    goto okL;
+
+  qp = gaspi_qp_create (glb_gaspi_ctx_ib.scqC[q], glb_gaspi_ctx_ib.rcqGroups, NULL);
+  if(qp == NULL)
+    goto errL;
+
+  memset(&cdh, 0, sizeof(cdh));
+  cdh.op = GASPI_SN_QUEUE_CONNECT;
+  cdh.op_len = 0;
+  cdh.rank = glb_gaspi_ctx.rank;
+  cdh.tnc = q;
+  cdh.ret = qp->qp_num;
+
+  if(gaspi_sn_post(rank, &cdh, NULL, 0, &req, &rqpn, sizeof(int), timeout_ms) != 0)
     {
-      if(glb_gaspi_ctx_ib.lrcd[i].istat==0)
-	continue;
-      
-      if(ibv_destroy_qp (glb_gaspi_ctx_ib.qpGroups[i]))
+      gaspi_print_error("Failed to set up queue %u with %u", q, rank);
+      ibv_destroy_qp (qp);
+      goto errL;
+    }
+
+  eret = gaspi_sn_waitall(&req, 1, timeout_ms);
+  if(eret != GASPI_SUCCESS || rqpn < 0)
+    {
+      gaspi_sn_cancel(&req);
+      ibv_destroy_qp (qp);
+
+      if(eret == GASPI_TIMEOUT)
 	{
-	  gaspi_print_error ("Failed to destroy QP (libibverbs)");  
-	  return -1;
+	  unlock_gaspi(&glb_gaspi_ctx_lock);
+	  return GASPI_TIMEOUT;
 	}
+
+      gaspi_print_error("Failed to set up queue %u with %u", q, rank);
+      goto errL;
     }
 
-  if(glb_gaspi_ctx_ib.qpGroups)
+  if(gaspi_qp_connect(qp, rank, rqpn) != 0)
     {
-      free (glb_gaspi_ctx_ib.qpGroups);
+      ibv_destroy_qp (qp);
+      goto errL;
     }
 
-  glb_gaspi_ctx_ib.qpGroups = NULL;
+  gaspi_queue_install (q, rank, qp);
 
-  for(i = 0; i < glb_gaspi_ctx.tnc; i++)
-    {
-      if(glb_gaspi_ctx_ib.lrcd[i].istat==0)
-	{
-	  continue;
-	}
+ okL:
+  unlock_gaspi(&glb_gaspi_ctx_lock);
+  return GASPI_SUCCESS;
 
-      if(ibv_destroy_qp (glb_gaspi_ctx_ib.qpP[i]))
-	{
-	  gaspi_print_error ("Failed to destroy QP (libibverbs)");
-	  return -1;
-	}
+ errL:
+  glb_gaspi_ctx.qp_state_vec[q][rank] = 1;
+  unlock_gaspi(&glb_gaspi_ctx_lock);
+  return GASPI_ERROR;
+}
+
+
+int
+gaspi_cleanup_ib_core ()
+{
+  int i, c;
+
+  if(!glb_gaspi_ib_init)
+    {
+      return -1;
     }
 
-  if(glb_gaspi_ctx_ib.qpP)
+  for(i = 0; i < glb_gaspi_ctx.tnc; i++)
     {
-      free (glb_gaspi_ctx_ib.qpP);
+      if(glb_gaspi_ctx_ib.peer[i] == NULL)
+	continue;
+
+      const int ret = gaspi_peer_free (glb_gaspi_ctx_ib.peer[i]);
+      glb_gaspi_ctx_ib.peer[i] = NULL;
+
+      if(ret != 0)
+	return -1;
     }
-  
-  glb_gaspi_ctx_ib.qpP = NULL;
 
-  for(c = 0; c < glb_gaspi_cfg.queue_num; c++)
+  free (glb_gaspi_ctx_ib.peer);
+  glb_gaspi_ctx_ib.peer = NULL;
+
+  while(glb_gaspi_ctx_ib.qp_spare != NULL)
     {
-      
-      for(i = 0; i < glb_gaspi_ctx.tnc; i++)
+      gaspi_qp_spare *spare = glb_gaspi_ctx_ib.qp_spare;
+
+      glb_gaspi_ctx_ib.qp_spare = spare->next;
+      if(ibv_destroy_qp (spare->qp))
 	{
-	  if(glb_gaspi_ctx_ib.lrcd[i].istat==0)
-	    {
-	      continue;
-	    }
-	  
-	  if(ibv_destroy_qp (glb_gaspi_ctx_ib.qpC[c][i]))
-	    {
-	      gaspi_print_error ("Failed to destroy QP (libibverbs)");
-	      return -1;
-	    }
+	  gaspi_print_error ("Failed to destroy QP (libibverbs)");
+	  return -1;
 	}
-      
-    if(glb_gaspi_ctx_ib.qpC[c])
-      {
-	free (glb_gaspi_ctx_ib.qpC[c]);
-      }
-    
-    glb_gaspi_ctx_ib.qpC[c] = NULL;
-  }
+      free (spare);
+    }
 
   if(ibv_destroy_srq (glb_gaspi_ctx_ib.srqP))
     {
@@ -1105,101 +1348,47 @@ gaspi_cleanup_ib_core ()
 	  gaspi_print_error ("Failed to destroy CQ (libibverbs)");
 	  return -1;
 	}
-
-      if(ibv_destroy_cq (glb_gaspi_ctx_ib.rcqC[c]))
-	{
-	  gaspi_print_error ("Failed to destroy CQ (libibverbs)");
-	  return -1;
-	}
     }
   
-  for(i = 0; i < GASPI_MAX_GROUPS; i++)
+  for(i = 0; i < glb_gaspi_cfg.group_max; i++)
     {
       if(glb_gaspi_group_ib[i].id >= 0)
 	{
+	  glb_gaspi_group_ib[i].buf = NULL;
 
-	  if(munlock (glb_gaspi_group_ib[i].buf, glb_gaspi_group_ib[i].size)!= 0)
+	  if(glb_gaspi_group_ib[i].rrcd)
 	    {
-	      gaspi_print_error ("Failed to unlock memory (munlock)");
-	      return -1;
+	      free (glb_gaspi_group_ib[i].rrcd);
 	    }
+	  glb_gaspi_group_ib[i].rrcd = NULL;
 
-      if(ibv_dereg_mr (glb_gaspi_group_ib[i].mr))
-	{  
-	  gaspi_print_error ("Failed to de-register memory (libiverbs)");
-	  return -1;
-	}
-
-      if(glb_gaspi_group_ib[i].buf)
-	{
-	  free (glb_gaspi_group_ib[i].buf);
-	}
-      
-      glb_gaspi_group_ib[i].buf = NULL;
-
-      if(glb_gaspi_group_ib[i].rrcd)
-	{
-	  free (glb_gaspi_group_ib[i].rrcd);
+	  if(glb_gaspi_group_ib[i].rank_grp)
+	    {
+	      free (glb_gaspi_group_ib[i].rank_grp);
+	    }
+	  glb_gaspi_group_ib[i].rank_grp = NULL;
 	}
-      glb_gaspi_group_ib[i].rrcd = NULL;
     }
-  }
 
-  for(i = 0; i < 256; i++)
+  for(i = 0; i < GASPI_SEGMENTS_LIMIT; i++)
     {
       if(glb_gaspi_ctx_ib.rrmd[i] != NULL)
       {
 	if(glb_gaspi_ctx_ib.rrmd[i][glb_gaspi_ctx.rank].size)
 	  {
-#ifdef GPI2_CUDA
-            if(glb_gaspi_ctx.use_gpus == 0 || glb_gaspi_ctx.gpu_count == 0)
-#endif	      
-	    if(munlock(glb_gaspi_ctx_ib.rrmd[i][glb_gaspi_ctx.rank].buf,glb_gaspi_ctx_ib.rrmd[i][glb_gaspi_ctx.rank].size +NOTIFY_OFFSET) != 0)
-	      {
-		
-		gaspi_print_error ("Failed to unlock memory (munlock)");
-		return -1;
-	      }
-	    
-	    if(ibv_dereg_mr(glb_gaspi_ctx_ib.rrmd[i][glb_gaspi_ctx.rank].mr))
-	      {
-		gaspi_print_error("Failed to de-register memory (libiverbs)");
-		return -1;
-	      }
-#if GPI2_CUDA
-	    if(glb_gaspi_ctx_ib.rrmd[i][glb_gaspi_ctx.rank].cudaDevId >= 0)
-	      {
-		if(ibv_dereg_mr(glb_gaspi_ctx_ib.rrmd[i][glb_gaspi_ctx.rank].host_mr))
-		  {
-		    gaspi_print_error("Failed to de-register memory (libiverbs)\n");
-		    return -1;
-		  }
-		cudaSetDevice( (glb_gaspi_ctx_ib.rrmd[i][glb_gaspi_ctx.rank].cudaDevId));
-		if(glb_gaspi_ctx_ib.rrmd[i][glb_gaspi_ctx.rank].buf)
-		  cudaFree(glb_gaspi_ctx_ib.rrmd[i][glb_gaspi_ctx.rank].buf);
-
-		if(glb_gaspi_ctx_ib.rrmd[i][glb_gaspi_ctx.rank].host_ptr)
-		  cudaFreeHost(glb_gaspi_ctx_ib.rrmd[i][glb_gaspi_ctx.rank].host_ptr);
-	    }
-	    else if(glb_gaspi_ctx.use_gpus != 0 && glb_gaspi_ctx.gpu_count > 0)
-	      cudaFreeHost(glb_gaspi_ctx_ib.rrmd[i][glb_gaspi_ctx.rank].buf);
-	    else
-#endif	    
-	    if(glb_gaspi_ctx_ib.rrmd[i][glb_gaspi_ctx.rank].buf)
-	      {
-		free (glb_gaspi_ctx_ib.rrmd[i][glb_gaspi_ctx.rank].buf);
-	      }
-	    
-	    glb_gaspi_ctx_ib.rrmd[i][glb_gaspi_ctx.rank].buf = NULL;
+	    if(gaspi_segment_release (i) != 0)
+	      return -1;
+	  }
+
+	gaspi_segment_rrmd_free (i);
       }
+    }
 
-      if(glb_gaspi_ctx_ib.rrmd[i])
-	{
-	  free (glb_gaspi_ctx_ib.rrmd[i]);
-	}
-      glb_gaspi_ctx_ib.rrmd[i] = NULL;
+  //group buffers and notification areas
+  if(gaspi_mr_pools_cleanup () != 0)
+    {
+      return -1;
     }
-  }
 
   //dereg nsrc
   if(munlock(glb_gaspi_ctx_ib.nsrc.buf,NOTIFY_OFFSET) != 0)
@@ -1257,90 +1446,163 @@ gaspi_cleanup_ib_core ()
       glb_gaspi_ctx.qp_state_vec[i] = NULL;
     }
   
-  if(glb_gaspi_ctx_ib.lrcd)
-    {
-      free (glb_gaspi_ctx_ib.lrcd);
-    }
-  
-  glb_gaspi_ctx_ib.lrcd = NULL;
-
-  if(glb_gaspi_ctx_ib.rrcd)
-    {
-      free (glb_gaspi_ctx_ib.rrcd);
-    }
-  
-  glb_gaspi_ctx_ib.rrcd = NULL;
 
   return 0;
 }
 
-#pragma weak gaspi_group_create = pgaspi_group_create
-gaspi_return_t
-pgaspi_group_create (gaspi_group_t * const group)
+/* Group buffers and segment notification areas are carved out of
+   pools of registered chunks, grown on demand and kept for reuse. The
+   group pool is protected by the context lock, the notification pool
+   by the segment lock */
+typedef struct gaspi_mr_chunk
 {
+  unsigned char *buf;
+  unsigned long size;
+  struct ibv_mr *mr;
+  unsigned char *used;
+  int npages;
+  struct gaspi_mr_chunk *next;
+} gaspi_mr_chunk;
 
-  int i, id = GASPI_MAX_GROUPS;
-  unsigned int size, page_size;
+static gaspi_mr_chunk *grp_pool = NULL;
+static gaspi_mr_chunk *notif_pool = NULL;
 
-  if (!glb_gaspi_init)
+static int
+gaspi_mr_pool_alloc (gaspi_mr_chunk **pool, const unsigned long size,
+		     unsigned char **buf, struct ibv_mr **mr)
+{
+  int i, j;
+  gaspi_mr_chunk *c;
+  const long page_size = sysconf (_SC_PAGESIZE);
+  const int npages = (size + page_size - 1) / page_size;
+
+  for (c = *pool; c != NULL; c = c->next)
     {
-      return GASPI_ERROR;
+      for (i = 0; i + npages <= c->npages; i++)
+	{
+	  for (j = 0; j < npages && !c->used[i + j]; j++);
+
+	  if (j == npages)
+	    goto found;
+
+	  i += j;
+	}
     }
 
-  lock_gaspi_tout (&glb_gaspi_ctx_lock, GASPI_BLOCK);
+  c = (gaspi_mr_chunk *) calloc (1, sizeof (gaspi_mr_chunk));
+  if (c == NULL)
+    return -1;
 
-  if (glb_gaspi_ctx.group_cnt >= GASPI_MAX_GROUPS)
-    goto errL;
+  c->npages = MAX (npages, GASPI_MR_POOL_CHUNK / page_size);
+  c->size = (unsigned long) c->npages * page_size;
+  c->used = (unsigned char *) calloc (c->npages, sizeof (unsigned char));
 
-  for (i = 0; i < GASPI_MAX_GROUPS; i++)
+  if (c->used == NULL
+      || posix_memalign ((void **) &c->buf, page_size, c->size) != 0)
     {
-      if (glb_gaspi_group_ib[i].id == -1)
-	{
-	  id = i;
-	  break;
-	}
+      gaspi_print_error ("Memory allocation (posix_memalign) failed");
+      free (c->used);
+      free (c);
+      return -1;
     }
-  if (id == GASPI_MAX_GROUPS)
+
+  if (mlock (c->buf, c->size) != 0)
     {
-      goto errL;
+      gaspi_print_error ("Memory locking (mlock) failed (of size %lu)", c->size);
+      free (c->buf);
+      free (c->used);
+      free (c);
+      return -1;
     }
-  
 
-  //TODO: for now as before
-  if(id == GASPI_GROUP_ALL)
-    size = NEXT_OFFSET + 128 + NOTIFY_OFFSET; 
-  else
-    size = NEXT_OFFSET;
+  c->mr = ibv_reg_mr (glb_gaspi_ctx_ib.pd, c->buf, c->size,
+		      IBV_ACCESS_REMOTE_WRITE | IBV_ACCESS_LOCAL_WRITE |
+		      IBV_ACCESS_REMOTE_READ | IBV_ACCESS_REMOTE_ATOMIC);
+  if (!c->mr)
+    {
+      gaspi_print_error ("Memory registration failed (libibverbs)");
+      munlock (c->buf, c->size);
+      free (c->buf);
+      free (c->used);
+      free (c);
+      return -1;
+    }
+
+  c->next = *pool;
+  *pool = c;
+  i = 0;
+
+ found:
+  memset (c->used + i, 1, npages);
+  *buf = c->buf + (unsigned long) i * page_size;
+  *mr = c->mr;
+  memset (*buf, 0, size);
+
+  return 0;
+}
 
-  page_size = sysconf (_SC_PAGESIZE);
+static void
+gaspi_mr_pool_free (gaspi_mr_chunk *pool, unsigned char *buf,
+		    const unsigned long size)
+{
+  gaspi_mr_chunk *c;
+  const long page_size = sysconf (_SC_PAGESIZE);
 
-  if (posix_memalign ((void **) &glb_gaspi_group_ib[id].ptr, page_size, size)
-      != 0)
+  for (c = pool; c != NULL; c = c->next)
     {
-      gaspi_print_error ("Memory allocation (posix_memalign) failed");
-      goto errL;
+      if (buf >= c->buf && buf < c->buf + c->size)
+	{
+	  memset (c->used + (buf - c->buf) / page_size, 0,
+		  (size + page_size - 1) / page_size);
+	  return;
+	}
     }
+}
 
-  if (mlock (glb_gaspi_group_ib[id].buf, size) != 0)
+static int
+gaspi_mr_pool_cleanup (gaspi_mr_chunk **pool)
+{
+  while (*pool != NULL)
     {
-      gaspi_print_error ("Memory locking (mlock) failed (of size %d)", size);
-      goto errL;
-    }
+      gaspi_mr_chunk *c = *pool;
 
-  memset (glb_gaspi_group_ib[id].buf, 0, size);
+      if (munlock (c->buf, c->size) != 0)
+	{
+	  gaspi_print_error ("Failed to unlock memory (munlock)");
+	  return -1;
+	}
 
-  glb_gaspi_group_ib[id].mr =
-    ibv_reg_mr (glb_gaspi_ctx_ib.pd, glb_gaspi_group_ib[id].buf, size,
-		IBV_ACCESS_REMOTE_WRITE | IBV_ACCESS_LOCAL_WRITE |
-		IBV_ACCESS_REMOTE_READ | IBV_ACCESS_REMOTE_ATOMIC);
+      if (ibv_dereg_mr (c->mr))
+	{
+	  gaspi_print_error ("Failed to de-register memory (libiverbs)");
+	  return -1;
+	}
 
-  if (!glb_gaspi_group_ib[id].mr)
-    {
-      gaspi_print_error ("Memory registration failed (libibverbs)");
-      goto errL;
+      *pool = c->next;
+      free (c->buf);
+      free (c->used);
+      free (c);
     }
 
-  glb_gaspi_group_ib[id].size = size;
+  return 0;
+}
+
+static int
+gaspi_mr_pools_cleanup (void)
+{
+  if (gaspi_mr_pool_cleanup (&grp_pool) != 0)
+    return -1;
+
+  return gaspi_mr_pool_cleanup (&notif_pool);
+}
+
+/* Initialize the group entry id (context lock held) */
+static int
+gaspi_group_init (const gaspi_group_t id)
+{
+  glb_gaspi_group_ib[id].buf = NULL;
+  glb_gaspi_group_ib[id].mr = NULL;
+  glb_gaspi_group_ib[id].size = 0;
   glb_gaspi_group_ib[id].id = id;
   glb_gaspi_group_ib[id].gl.lock = 0;
   glb_gaspi_group_ib[id].togle = 0;
@@ -1356,23 +1618,116 @@ pgaspi_group_create (gaspi_group_t * const group)
   glb_gaspi_group_ib[id].next_pof2 = 0;
   glb_gaspi_group_ib[id].pof2_exp = 0;
 
-  glb_gaspi_group_ib[id].rank_grp = (int *) malloc (glb_gaspi_ctx.tnc * sizeof (int));
-  if(!glb_gaspi_group_ib[id].rank_grp) goto errL;
+  glb_gaspi_group_ib[id].barrier_alg = GASPI_BARRIER_DISSEMINATION;
+  glb_gaspi_group_ib[id].coll_alg = GASPI_ALLREDUCE_REC_DOUBLING;
+  memset (glb_gaspi_group_ib[id].allreduce_alg, 0, sizeof (glb_gaspi_group_ib[id].allreduce_alg));
 
-  for (i = 0; i < glb_gaspi_ctx.tnc; i++)
-    glb_gaspi_group_ib[id].rank_grp[i] = -1;
+  glb_gaspi_group_ib[id].repro_pass = 0;
+  glb_gaspi_group_ib[id].split_id = -1;
+
+  glb_gaspi_group_ib[id].ready = 0;
+  glb_gaspi_group_ib[id].cs = 0;
+  glb_gaspi_group_ib[id].commit_state = NULL;
+
+  //grows with gaspi_group_add
+  glb_gaspi_group_ib[id].rank_grp_size = MIN (16, glb_gaspi_ctx.tnc);
+  glb_gaspi_group_ib[id].rank_grp =
+    (int *) malloc (glb_gaspi_group_ib[id].rank_grp_size * sizeof (int));
+  if(!glb_gaspi_group_ib[id].rank_grp) return -1;
+
+  //allocated once the members are known
+  glb_gaspi_group_ib[id].rrcd = NULL;
+
+  return 0;
+}
+
+/* Collective buffer and member-indexed rkeys of a group with known
+   members. GASPI_GROUP_ALL keeps the fixed layout since notifications
+   and atomics live behind its collective area. */
+static int
+gaspi_group_alloc (const gaspi_group_t id)
+{
+  const int tnc = glb_gaspi_group_ib[id].tnc;
+  unsigned long size;
+
+  if (id == GASPI_GROUP_ALL)
+    {
+      glb_gaspi_group_ib[id].coll_slots = 18;
+      glb_gaspi_group_ib[id].coll_send = COLL_MEM_SEND;
+      glb_gaspi_group_ib[id].coll_recv = COLL_MEM_RECV;
+      size = NEXT_OFFSET + 128 + NOTIFY_OFFSET;
+      glb_gaspi_group_ib[id].coll_gather = size;
+    }
+  else
+    {
+      int exp = 0;
+      while ((2 << exp) <= tnc)
+	exp++;
+
+      //barrier flags, then one 2048 bytes slot per round
+      glb_gaspi_group_ib[id].coll_slots = MIN (exp + 3, 18);
+      glb_gaspi_group_ib[id].coll_send = (2 * tnc + 2 + 63) & ~63;
+      glb_gaspi_group_ib[id].coll_recv = glb_gaspi_group_ib[id].coll_send
+	+ 2 * glb_gaspi_group_ib[id].coll_slots * 2048;
+      size = glb_gaspi_group_ib[id].coll_recv
+	+ 2 * glb_gaspi_group_ib[id].coll_slots * 2048;
+      glb_gaspi_group_ib[id].coll_gather = size;
+    }
+
+  //allgathered records of all members (segment descriptors, split)
+  size += 2 * tnc * GASPI_GATHER_BLOCK;
+
+  if (gaspi_mr_pool_alloc (&grp_pool, size, &glb_gaspi_group_ib[id].buf,
+			    &glb_gaspi_group_ib[id].mr) != 0)
+    return -1;
 
-  glb_gaspi_group_ib[id].rrcd = (gaspi_rc_grp *) malloc (glb_gaspi_ctx.tnc * sizeof (gaspi_rc_grp));
-  if(!glb_gaspi_group_ib[id].rrcd) goto errL;
+  glb_gaspi_group_ib[id].size = size;
 
-  memset (glb_gaspi_group_ib[id].rrcd, 0,
-	  glb_gaspi_ctx.tnc * sizeof (gaspi_rc_grp));
+  glb_gaspi_group_ib[id].rrcd = (gaspi_rc_grp *) calloc (tnc, sizeof (gaspi_rc_grp));
+  if(!glb_gaspi_group_ib[id].rrcd) return -1;
 
-  glb_gaspi_group_ib[id].rrcd[glb_gaspi_ctx.rank].rkeyGroup =
+  glb_gaspi_group_ib[id].rrcd[glb_gaspi_group_ib[id].rank].rkeyGroup =
     glb_gaspi_group_ib[id].mr->rkey;
-  glb_gaspi_group_ib[id].rrcd[glb_gaspi_ctx.rank].vaddrGroup =
+  glb_gaspi_group_ib[id].rrcd[glb_gaspi_group_ib[id].rank].vaddrGroup =
     (uintptr_t) glb_gaspi_group_ib[id].buf;
 
+  return 0;
+}
+
+#pragma weak gaspi_group_create = pgaspi_group_create
+gaspi_return_t
+pgaspi_group_create (gaspi_group_t * const group)
+{
+
+  int i, id = glb_gaspi_cfg.group_max;
+
+  if (!glb_gaspi_init)
+    {
+      return GASPI_ERROR;
+    }
+
+  lock_gaspi_tout (&glb_gaspi_ctx_lock, GASPI_BLOCK);
+
+  if (glb_gaspi_ctx.group_cnt >= glb_gaspi_cfg.group_max)
+    goto errL;
+
+  for (i = 0; i < glb_gaspi_cfg.group_max; i++)
+    {
+      if (glb_gaspi_group_ib[i].id == -1)
+	{
+	  id = i;
+	  break;
+	}
+    }
+  if (id == glb_gaspi_cfg.group_max)
+    {
+      goto errL;
+    }
+  
+
+  if (gaspi_group_init (id) != 0)
+    goto errL;
+
   glb_gaspi_ctx.group_cnt++;
   *group = id;
 
@@ -1397,27 +1752,17 @@ pgaspi_group_delete (const gaspi_group_t group)
 
   lock_gaspi_tout (&glb_gaspi_ctx_lock, GASPI_BLOCK);
 
-  if (group==0 || group >= GASPI_MAX_GROUPS
+  if (group==0 || group >= glb_gaspi_cfg.group_max
       || glb_gaspi_group_ib[group].id < 0)
     {
       gaspi_print_error ("Invalid group to delete");
       goto errL;
     }
 
-  if (munlock (glb_gaspi_group_ib[group].buf, glb_gaspi_group_ib[group].size)
-      != 0)
-    {
-      gaspi_print_error ("Memory unlocking (munlock) failed");
-      goto errL;
-    }
-  if (ibv_dereg_mr (glb_gaspi_group_ib[group].mr))
-    {
-      gaspi_print_error ("Memory de-registration failed (libibverbs)");
-      goto errL;
-    }
-
-  free (glb_gaspi_group_ib[group].buf);
+  if (glb_gaspi_group_ib[group].buf)
+    gaspi_mr_pool_free (grp_pool, glb_gaspi_group_ib[group].buf, glb_gaspi_group_ib[group].size);
   glb_gaspi_group_ib[group].buf = NULL;
+  glb_gaspi_group_ib[group].mr = NULL;
 
   if (glb_gaspi_group_ib[group].rank_grp)
     free (glb_gaspi_group_ib[group].rank_grp);
@@ -1427,6 +1772,11 @@ pgaspi_group_delete (const gaspi_group_t group)
     free (glb_gaspi_group_ib[group].rrcd);
   glb_gaspi_group_ib[group].rrcd = NULL;
 
+  if (glb_gaspi_group_ib[group].commit_state)
+    free (glb_gaspi_group_ib[group].commit_state);
+  glb_gaspi_group_ib[group].commit_state = NULL;
+  glb_gaspi_group_ib[group].ready = 0;
+
   glb_gaspi_group_ib[group].id = -1;
   glb_gaspi_ctx.group_cnt--;
 
@@ -1438,12 +1788,6 @@ errL:
   return GASPI_ERROR;
 }
 
-static int
-gaspi_comp_ranks (const void *a, const void *b)
-{
-  return (*(int *) a - *(int *) b);
-}
-
 #pragma weak gaspi_group_add = pgaspi_group_add
 gaspi_return_t
 pgaspi_group_add (const gaspi_group_t group, const gaspi_rank_t rank)
@@ -1458,7 +1802,7 @@ pgaspi_group_add (const gaspi_group_t group, const gaspi_rank_t rank)
 
   lock_gaspi_tout (&glb_gaspi_ctx_lock, GASPI_BLOCK);
 
-  if (group >= GASPI_MAX_GROUPS
+  if (group >= glb_gaspi_cfg.group_max
       || glb_gaspi_group_ib[group].id < 0)
     goto errL;
 
@@ -1468,18 +1812,46 @@ pgaspi_group_add (const gaspi_group_t group, const gaspi_rank_t rank)
       goto errL;
     }
 
-  for (i = 0; i < glb_gaspi_group_ib[group].tnc; i++)
+  int *rank_grp = glb_gaspi_group_ib[group].rank_grp;
+  const int tnc = glb_gaspi_group_ib[group].tnc;
+
+  //sorted insert
+  int lo = 0, hi = tnc;
+  while (lo < hi)
     {
-      if (glb_gaspi_group_ib[group].rank_grp[i] == rank)
+      const int mid = (lo + hi) / 2;
+      if (rank_grp[mid] < rank)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+
+  if (lo < tnc && rank_grp[lo] == rank)
+    {
+      gaspi_print_error("Rank already present in group");
+      goto errL;
+    }
+
+  if (tnc == glb_gaspi_group_ib[group].rank_grp_size)
+    {
+      const int nsize = MIN (2 * tnc, glb_gaspi_ctx.tnc);
+
+      rank_grp = (int *) realloc (rank_grp, nsize * sizeof (int));
+      if (rank_grp == NULL)
 	{
-	  gaspi_print_error("Rank already present in group");
+	  gaspi_print_error("Memory allocation failed");
 	  goto errL;
 	}
+
+      glb_gaspi_group_ib[group].rank_grp = rank_grp;
+      glb_gaspi_group_ib[group].rank_grp_size = nsize;
     }
 
-  glb_gaspi_group_ib[group].rank_grp[glb_gaspi_group_ib[group].tnc++] = rank;
-  qsort (glb_gaspi_group_ib[group].rank_grp, glb_gaspi_group_ib[group].tnc,
-	 sizeof (int), gaspi_comp_ranks);
+  for (i = tnc; i > lo; i--)
+    rank_grp[i] = rank_grp[i - 1];
+
+  rank_grp[lo] = rank;
+  glb_gaspi_group_ib[group].tnc++;
 
   unlock_gaspi (&glb_gaspi_ctx_lock);
   return GASPI_SUCCESS;
@@ -1490,21 +1862,40 @@ errL:
 }
 
 
+/* Collective parameters of a group with known members */
+static void
+gaspi_group_setup (const gaspi_group_t group)
+{
+  glb_gaspi_group_ib[group].next_pof2 = 1;
+
+  while (glb_gaspi_group_ib[group].next_pof2 <= glb_gaspi_group_ib[group].tnc)
+    {
+      glb_gaspi_group_ib[group].next_pof2 <<= 1;
+    }
+
+  glb_gaspi_group_ib[group].next_pof2 >>= 1;
+
+  glb_gaspi_group_ib[group].pof2_exp =
+    (__builtin_clz (glb_gaspi_group_ib[group].next_pof2) ^ 31U);
+
+  gaspi_coll_setup_group (group);
+}
+
 #pragma weak gaspi_group_commit = pgaspi_group_commit
 gaspi_return_t
 pgaspi_group_commit (const gaspi_group_t group,
 		     const gaspi_timeout_t timeout_ms)
 {
 
-  int i, r;
-  gaspi_return_t eret = GASPI_ERROR;
+  int i;
+  gaspi_return_t eret = GASPI_SUCCESS;
 
   if (!glb_gaspi_init)
     return GASPI_ERROR;
 
   lock_gaspi_tout (&glb_gaspi_ctx_lock, GASPI_BLOCK);
 
-  if (group >= GASPI_MAX_GROUPS
+  if (group >= glb_gaspi_cfg.group_max
       || glb_gaspi_group_ib[group].id == -1)
     {
       gaspi_print_error("Invalid group to commit to");
@@ -1534,179 +1925,380 @@ pgaspi_group_commit (const gaspi_group_t group,
       goto errL;
     }
 
-  glb_gaspi_group_ib[group].next_pof2 = 1;
+  gaspi_group_setup (group);
 
-  while (glb_gaspi_group_ib[group].next_pof2 <= glb_gaspi_group_ib[group].tnc)
+  const int tnc = glb_gaspi_group_ib[group].tnc;
+  unsigned char *state = glb_gaspi_group_ib[group].commit_state;
+
+  //first call (not resuming after a timeout)
+  if (state == NULL)
     {
-      glb_gaspi_group_ib[group].next_pof2 <<= 1;
-    }
+      state = (unsigned char *) calloc (tnc, sizeof (unsigned char));
+      if (state == NULL)
+	{
+	  gaspi_print_error ("Memory allocation failed");
+	  goto errL;
+	}
 
-  glb_gaspi_group_ib[group].next_pof2 >>= 1;
+      glb_gaspi_group_ib[group].commit_state = state;
+      glb_gaspi_group_ib[group].cs = 0;
 
-  glb_gaspi_group_ib[group].pof2_exp =
-    (__builtin_clz (glb_gaspi_group_ib[group].next_pof2) ^ 31U);
+      if (glb_gaspi_group_ib[group].buf == NULL
+	  && gaspi_group_alloc (group) != 0)
+	{
+	  gaspi_print_error ("Failed to allocate group buffer");
+	  goto errL;
+	}
 
-  struct
-  {
-    int tnc, cs, ret;
-  }gb, rem_gb;
+      for (i = 0; i < tnc; i++)
+	glb_gaspi_group_ib[group].cs ^= glb_gaspi_group_ib[group].rank_grp[i];
 
+      state[glb_gaspi_group_ib[group].rank] = GASPI_GRP_CHECK_DONE;
 
-  gb.cs = 0;
-  gb.tnc = glb_gaspi_group_ib[group].tnc;
-  
-  for (i = 0; i < glb_gaspi_group_ib[group].tnc; i++){
-    gb.cs ^= glb_gaspi_group_ib[group].rank_grp[i];
-  }
+      //answer checks of the other members
+      glb_gaspi_group_ib[group].ready = 1;
+      gaspi_sn_group_ready (group);
+    }
 
+  //one-sided: post the checks to all members at once
+  gaspi_sn_req *reqs = (gaspi_sn_req *) calloc (tnc, sizeof (gaspi_sn_req));
+  gaspi_grp_check *rem_gb = (gaspi_grp_check *) malloc (tnc * sizeof (gaspi_grp_check));
+  if (reqs == NULL || rem_gb == NULL)
+    {
+      free (reqs);
+      free (rem_gb);
+      gaspi_print_error ("Memory allocation failed");
+      goto errL;
+    }
 
-  //one-sided
   gaspi_cd_header cdh;
-  cdh.op_len = sizeof (gb);
+  memset (&cdh, 0, sizeof (gaspi_cd_header));
+  cdh.op_len = sizeof (gaspi_grp_check);
   cdh.op = GASPI_SN_GRP_CHECK;
   cdh.rank = group;
-  cdh.tnc = gb.tnc;
-  cdh.ret = gb.cs;
+  cdh.tnc = tnc;
+  cdh.ret = glb_gaspi_group_ib[group].cs;
 
-  struct timeb t0,t1;
-  ftime(&t0);
+  for (i = 0; i < tnc; i++)
+    {
+      if (state[i] != GASPI_GRP_CHECK_TODO)
+	continue;
+
+      const int rank = glb_gaspi_group_ib[group].rank_grp[i];
+
+      if (gaspi_sn_post (rank, &cdh, NULL, 0, &reqs[i], &rem_gb[i],
+			 sizeof (gaspi_grp_check), timeout_ms) != 0)
+	{
+	  gaspi_print_error("Failed to send group check to %d", rank);
+	  eret = GASPI_ERROR;
+	  break;
+	}
+
+      state[i] = GASPI_GRP_CHECK_SENT;
+    }
+
+  //replies arrive once the members have committed the group
+  const gaspi_return_t wret = gaspi_sn_waitall (reqs, tnc, timeout_ms);
+  if (eret == GASPI_SUCCESS)
+    eret = wret;
 
-  for(r = 1;r <= gb.tnc; r++)
+  for (i = 0; i < tnc; i++)
     {
-      int i = (glb_gaspi_group_ib[group].rank+r)%gb.tnc;
+      if (state[i] != GASPI_GRP_CHECK_SENT)
+	continue;
 
-      if(glb_gaspi_group_ib[group].rank_grp[i]==glb_gaspi_ctx.rank) continue;
+      //not answered yet: asked again on the next call
+      if (reqs[i].state != GASPI_SN_REQ_DONE)
+	{
+	  gaspi_sn_cancel (&reqs[i]);
+	  state[i] = GASPI_GRP_CHECK_TODO;
+	  continue;
+	}
 
-      do
+      //check if groups match
+      if (rem_gb[i].ret < 0 || rem_gb[i].tnc != tnc
+	  || rem_gb[i].cs != glb_gaspi_group_ib[group].cs)
 	{
-	  memset(&rem_gb,0,sizeof(rem_gb));
-	  
-	  int ret;
-	  ret = write(glb_gaspi_ctx.sockfd[glb_gaspi_group_ib[group].rank_grp[i]],&cdh,sizeof(gaspi_cd_header));
-	  if(ret != sizeof(gaspi_cd_header))
-	    {
-	      gaspi_print_error("Failed to write (%d %p %lu)",
-				glb_gaspi_ctx.sockfd[glb_gaspi_group_ib[group].rank_grp[i]],&cdh,sizeof(gaspi_cd_header));
-	      eret = GASPI_ERROR;
-	      goto errL;
-	    }
-	
-	  ret = read(glb_gaspi_ctx.sockfd[glb_gaspi_group_ib[group].rank_grp[i]],&rem_gb,sizeof(rem_gb));
-	  if(ret != sizeof(rem_gb))
-	    {
-	      gaspi_print_error("Failed to read (%d %p %lu)",
-				glb_gaspi_ctx.sockfd[glb_gaspi_group_ib[group].rank_grp[i]],&rem_gb,sizeof(rem_gb));
+	  gaspi_print_error("Mismatch with rank %d: ranks in group dont match",
+			    glb_gaspi_group_ib[group].rank_grp[i]);
+	  eret = GASPI_ERROR;
+	  continue;
+	}
 
-	      eret = GASPI_ERROR;
-	      goto errL;
-	    }
+      glb_gaspi_group_ib[group].rrcd[i] = rem_gb[i].rrcd;
+      state[i] = GASPI_GRP_CHECK_DONE;
+    }
 
-	  if((rem_gb.ret < 0) || (gb.cs != rem_gb.cs))
-	    { 
-	      ftime(&t1);
-	      const unsigned int delta_ms = (t1.time - t0.time) * 1000 + (t1.millitm - t0.millitm);
-	      if(delta_ms > timeout_ms)
-		{
-		  eret = GASPI_TIMEOUT;
-		  goto errL;
-		}
-	    
-	      if(gaspi_thread_sleep(250) < 0)
-		{
-		  gaspi_printf("gaspi_thread_sleep Error %d: (%s)\n",ret, (char*)strerror(errno));
-		}
-
-	      //check if groups match
-	      /* if(gb.cs != rem_gb.cs) */
-	      /* { */
-	      /* gaspi_print_error("Mismatch with rank %d: ranks in group dont match\n", */
-	      /* glb_gaspi_group_ib[group].rank_grp[i]); */
-	      /* eret = GASPI_ERROR; */
-	      /* goto errL; */
-	      /* } */
-	      
-	      //usleep(250000);
-	      //gaspi_delay();
-	    }
-	  else
-	    { 
-	      //connect groups
-	      gaspi_cd_header cdh;
-	      cdh.op_len = sizeof(gaspi_rc_grp);
-	      cdh.op = GASPI_SN_GRP_CONNECT;
-	      cdh.rank = glb_gaspi_ctx.rank;
-	      cdh.ret = group;
-	    
-	      int ret;
-	      ret = write(glb_gaspi_ctx.sockfd[glb_gaspi_group_ib[group].rank_grp[i]],&cdh,sizeof(gaspi_cd_header));
-	      if(ret !=sizeof(gaspi_cd_header))
-		{
-		  gaspi_print_error("Failed to write (%d %p %lu)",
-				    glb_gaspi_ctx.sockfd[glb_gaspi_group_ib[group].rank_grp[i]],
-				    &cdh,
-				    sizeof(gaspi_cd_header));
-
-		  glb_gaspi_ctx.qp_state_vec[GASPI_SN][glb_gaspi_group_ib[group].rank_grp[i]] = 1;
-		  eret = GASPI_ERROR;
-		  goto errL;
-		}
-	    
-	      ret=read(glb_gaspi_ctx.sockfd[glb_gaspi_group_ib[group].rank_grp[i]],
-		       &glb_gaspi_group_ib[group].rrcd[glb_gaspi_group_ib[group].rank_grp[i]],
-		       sizeof(gaspi_rc_grp));
-
-	      if(ret != sizeof(gaspi_rc_grp))
-		{
-		  gaspi_print_error("Failed to read (%d %p %lu)",
-				    glb_gaspi_ctx.sockfd[glb_gaspi_group_ib[group].rank_grp[i]],
-				    &glb_gaspi_group_ib[group].rrcd[glb_gaspi_group_ib[group].rank_grp[i]],
-				    sizeof(gaspi_rc_grp));
-		
-		  glb_gaspi_ctx.qp_state_vec[GASPI_SN][glb_gaspi_group_ib[group].rank_grp[i]] = 1;
-		  eret = GASPI_ERROR;
-		  goto errL;
-		}
-	    
-	      break;
-	    }
-	}while(1);
-    }//for
+  free (reqs);
+  free (rem_gb);
+
+  if (eret == GASPI_TIMEOUT)
+    {
+      //resume with the outstanding replies on the next call
+      unlock_gaspi (&glb_gaspi_ctx_lock);
+      return GASPI_TIMEOUT;
+    }
+
+  if (eret != GASPI_SUCCESS)
+    goto errL;
+
+  free (state);
+  glb_gaspi_group_ib[group].commit_state = NULL;
 
   unlock_gaspi (&glb_gaspi_ctx_lock);
   return GASPI_SUCCESS;
 
  errL:
+  if (group < glb_gaspi_cfg.group_max && glb_gaspi_group_ib[group].commit_state)
+    {
+      free (glb_gaspi_group_ib[group].commit_state);
+      glb_gaspi_group_ib[group].commit_state = NULL;
+    }
+
   unlock_gaspi (&glb_gaspi_ctx_lock);
-  return eret;
+  return GASPI_ERROR;
 }
 
-#pragma weak gaspi_group_num = pgaspi_group_num
-gaspi_return_t
-pgaspi_group_num (gaspi_number_t * const group_num)
+typedef struct
 {
+  int key, prank, rank;
+} gaspi_split_member;
 
-  if (glb_gaspi_init)
-    {
-      gaspi_verify_null_ptr(group_num);
+static int
+gaspi_comp_split (const void *a, const void *b)
+{
+  const gaspi_split_member *ma = (const gaspi_split_member *) a;
+  const gaspi_split_member *mb = (const gaspi_split_member *) b;
 
-      *group_num = glb_gaspi_ctx.group_cnt;
-      return GASPI_SUCCESS;
-    }
-  gaspi_print_error("Invalid function before gaspi_proc_init");
-  return GASPI_ERROR;
+  if (ma->key != mb->key)
+    return (ma->key < mb->key) ? -1 : 1;
+
+  return (ma->prank - mb->prank);
 }
 
-#pragma weak gaspi_group_size = pgaspi_group_size
+#pragma weak gaspi_group_split = pgaspi_group_split
 gaspi_return_t
-pgaspi_group_size (const gaspi_group_t group,
-		  gaspi_number_t * const group_size)
+pgaspi_group_split (const gaspi_group_t parent,
+		    const int color,
+		    const int key,
+		    gaspi_group_t * const group,
+		    const gaspi_timeout_t timeout_ms)
 {
+  int i, b, n = 0;
+  gaspi_return_t eret;
+  gaspi_split_info info;
+  gaspi_split_buf sbuf;
+  unsigned char *gather;
+  unsigned char used[GASPI_GROUPS_LIMIT / 8];
+  gaspi_split_member *members = NULL;
 
-  if (glb_gaspi_init && group < glb_gaspi_ctx.group_cnt)
+  if (!glb_gaspi_init)
     {
-      gaspi_verify_null_ptr(group_size);
+      gaspi_print_error("Invalid function before gaspi_proc_init");
+      return GASPI_ERROR;
+    }
 
-      *group_size = glb_gaspi_group_ib[group].tnc;
+  gaspi_verify_null_ptr(group);
+
+  if (parent >= glb_gaspi_cfg.group_max || glb_gaspi_group_ib[parent].id < 0
+      || !glb_gaspi_group_ib[parent].ready)
+    {
+      gaspi_print_error("Invalid parent group to split");
+      return GASPI_ERROR;
+    }
+
+  const int ptnc = glb_gaspi_group_ib[parent].tnc;
+  const int prank = glb_gaspi_group_ib[parent].rank;
+
+  //a split that timed out resumes with the buffer exchange
+  int id = glb_gaspi_group_ib[parent].split_id;
+
+  if (id < 0)
+    {
+      //color, key and the group ids in use, in one allgather
+      memset (&info, 0, sizeof (info));
+      info.color = color;
+      info.key = key;
+
+      lock_gaspi_tout (&glb_gaspi_ctx_lock, GASPI_BLOCK);
+      for (i = 0; i < glb_gaspi_cfg.group_max; i++)
+	{
+	  if (glb_gaspi_group_ib[i].id != -1)
+	    info.used[i / 8] |= 1 << (i % 8);
+	}
+      unlock_gaspi (&glb_gaspi_ctx_lock);
+
+      eret = gaspi_group_allgather (parent, &info, sizeof (info), &gather, timeout_ms);
+      if (eret != GASPI_SUCCESS)
+	return eret;
+
+      members = (gaspi_split_member *) malloc (ptnc * sizeof (gaspi_split_member));
+      if (members == NULL)
+	{
+	  gaspi_print_error("Memory allocation failed (gaspi_group_split)");
+	  return GASPI_ERROR;
+	}
+
+      //slot j holds the record of parent member prank + j
+      memset (used, 0, sizeof (used));
+      for (i = 0; i < ptnc; i++)
+	{
+	  const gaspi_split_info *const m = (gaspi_split_info *) (gather + i * sizeof (info));
+	  const int p = (prank + i) % ptnc;
+
+	  for (b = 0; b < sizeof (used); b++)
+	    used[b] |= m->used[b];
+
+	  if (m->color != color)
+	    continue;
+
+	  members[n].key = m->key;
+	  members[n].prank = p;
+	  members[n].rank = glb_gaspi_group_ib[parent].rank_grp[p];
+	  n++;
+	}
+
+      //lowest group id free on all members
+      for (i = 0; i < glb_gaspi_cfg.group_max; i++)
+	{
+	  if (!(used[i / 8] & (1 << (i % 8))))
+	    break;
+	}
+
+      if (i == glb_gaspi_cfg.group_max)
+	{
+	  free (members);
+	  gaspi_print_error("No group id free on all members");
+	  return GASPI_ERROR;
+	}
+
+      id = i;
+
+      lock_gaspi_tout (&glb_gaspi_ctx_lock, GASPI_BLOCK);
+      if (glb_gaspi_group_ib[id].id != -1 || gaspi_group_init (id) != 0)
+	{
+	  unlock_gaspi (&glb_gaspi_ctx_lock);
+	  free (members);
+	  return GASPI_ERROR;
+	}
+      glb_gaspi_ctx.group_cnt++;
+
+      //group ranks ordered by key, ties by parent rank
+      qsort (members, n, sizeof (gaspi_split_member), gaspi_comp_split);
+
+      if (n > glb_gaspi_group_ib[id].rank_grp_size)
+	{
+	  int *rank_grp = (int *) realloc (glb_gaspi_group_ib[id].rank_grp, n * sizeof (int));
+	  if (rank_grp == NULL)
+	    {
+	      unlock_gaspi (&glb_gaspi_ctx_lock);
+	      goto errL;
+	    }
+
+	  glb_gaspi_group_ib[id].rank_grp = rank_grp;
+	  glb_gaspi_group_ib[id].rank_grp_size = n;
+	}
+
+      glb_gaspi_group_ib[id].tnc = n;
+      glb_gaspi_group_ib[id].cs = 0;
+
+      for (i = 0; i < n; i++)
+	{
+	  glb_gaspi_group_ib[id].rank_grp[i] = members[i].rank;
+	  glb_gaspi_group_ib[id].cs ^= members[i].rank;
+
+	  if (members[i].prank == prank)
+	    glb_gaspi_group_ib[id].rank = i;
+	}
+
+      if (gaspi_group_alloc (id) != 0)
+	{
+	  unlock_gaspi (&glb_gaspi_ctx_lock);
+	  goto errL;
+	}
+
+      unlock_gaspi (&glb_gaspi_ctx_lock);
+
+      free (members);
+      members = NULL;
+
+      glb_gaspi_group_ib[parent].split_id = id;
+    }
+
+  //the buffers (rkey, address) of the new groups, in a second one
+  memset (&sbuf, 0, sizeof (sbuf));
+  sbuf.vaddr = (uintptr_t) glb_gaspi_group_ib[id].buf;
+  sbuf.rkey = glb_gaspi_group_ib[id].mr->rkey;
+  sbuf.color = color;
+  sbuf.rank = glb_gaspi_group_ib[id].rank;
+
+  eret = gaspi_group_allgather (parent, &sbuf, sizeof (sbuf), &gather, timeout_ms);
+  if (eret == GASPI_TIMEOUT)
+    return GASPI_TIMEOUT;
+
+  if (eret != GASPI_SUCCESS)
+    goto errL;
+
+  for (i = 0; i < ptnc; i++)
+    {
+      const gaspi_split_buf *const m = (gaspi_split_buf *) (gather + i * sizeof (sbuf));
+
+      if (m->color != color)
+	continue;
+
+      glb_gaspi_group_ib[id].rrcd[m->rank].rkeyGroup = m->rkey;
+      glb_gaspi_group_ib[id].rrcd[m->rank].vaddrGroup = m->vaddr;
+    }
+
+  lock_gaspi_tout (&glb_gaspi_ctx_lock, GASPI_BLOCK);
+
+  gaspi_group_setup (id);
+
+  glb_gaspi_group_ib[id].ready = 1;
+  gaspi_sn_group_ready (id);
+
+  unlock_gaspi (&glb_gaspi_ctx_lock);
+
+  glb_gaspi_group_ib[parent].split_id = -1;
+  *group = id;
+
+  return GASPI_SUCCESS;
+
+ errL:
+  free (members);
+  glb_gaspi_group_ib[parent].split_id = -1;
+  pgaspi_group_delete (id);
+
+  return GASPI_ERROR;
+}
+
+#pragma weak gaspi_group_num = pgaspi_group_num
+gaspi_return_t
+pgaspi_group_num (gaspi_number_t * const group_num)
+{
+
+  if (glb_gaspi_init)
+    {
+      gaspi_verify_null_ptr(group_num);
+
+      *group_num = glb_gaspi_ctx.group_cnt;
+      return GASPI_SUCCESS;
+    }
+  gaspi_print_error("Invalid function before gaspi_proc_init");
+  return GASPI_ERROR;
+}
+
+#pragma weak gaspi_group_size = pgaspi_group_size
+gaspi_return_t
+pgaspi_group_size (const gaspi_group_t group,
+		  gaspi_number_t * const group_size)
+{
+
+  if (glb_gaspi_init && group < glb_gaspi_ctx.group_cnt)
+    {
+      gaspi_verify_null_ptr(group_size);
+
+      *group_size = glb_gaspi_group_ib[group].tnc;
       return GASPI_SUCCESS;
     }
 
@@ -1738,18 +2330,128 @@ pgaspi_group_max (gaspi_number_t * const group_max)
   gaspi_verify_null_ptr(group_max);
 
 
-  *group_max = GASPI_MAX_GROUPS;
+  *group_max = glb_gaspi_cfg.group_max;
   return GASPI_SUCCESS;
 }
 
+/* Size of the descriptor table (one entry per rank) of a segment */
+#define GASPI_RRMD_SIZE (glb_gaspi_ctx.tnc * sizeof (gaspi_rc_mseg))
+
+/* Allocate the descriptor table of a segment. It is mapped
+   anonymously: page aligned, zero-filled and only backed by memory
+   where ranks actually registered the segment with us */
+static int
+gaspi_segment_rrmd_alloc (const gaspi_segment_id_t segment_id)
+{
+  if (glb_gaspi_ctx_ib.rrmd[segment_id] != NULL)
+    return 0;
+
+  void *table = mmap (NULL, GASPI_RRMD_SIZE, PROT_READ | PROT_WRITE,
+		      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (table == MAP_FAILED)
+    return -1;
+
+  glb_gaspi_ctx_ib.rrmd[segment_id] = (gaspi_rc_mseg *) table;
+
+  return 0;
+}
+
+static void
+gaspi_segment_rrmd_free (const gaspi_segment_id_t segment_id)
+{
+  if (glb_gaspi_ctx_ib.rrmd[segment_id] != NULL)
+    munmap (glb_gaspi_ctx_ib.rrmd[segment_id], GASPI_RRMD_SIZE);
+
+  glb_gaspi_ctx_ib.rrmd[segment_id] = NULL;
+}
+
+/* Get the notification area of a local segment from the pool
+   (segment lock held) */
+static int
+gaspi_segment_notif_alloc (const gaspi_segment_id_t segment_id)
+{
+  gaspi_lc_mseg *lseg = &glb_gaspi_ctx_ib.lmsd[segment_id];
+  gaspi_rc_mseg *seg = &glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank];
+
+  if (gaspi_mr_pool_alloc (&notif_pool, GASPI_NOTIF_SIZE,
+			   &lseg->notif_buf, &lseg->notif_mr) != 0)
+    {
+      gaspi_print_error ("Failed to allocate notification area");
+      return -1;
+    }
+
+  seg->notif_rkey = lseg->notif_mr->rkey;
+  seg->notif_addr = (uintptr_t) lseg->notif_buf;
+
+  return 0;
+}
+
+/* De-register and free the memory of a local segment. Memory bound
+   by the application is only de-registered */
+static int
+gaspi_segment_release (const gaspi_segment_id_t segment_id)
+{
+  gaspi_lc_mseg *lseg = &glb_gaspi_ctx_ib.lmsd[segment_id];
+  gaspi_rc_mseg *seg = &glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank];
+
+  if (lseg->notif_mr != NULL)
+    {
+      gaspi_mr_pool_free (notif_pool, lseg->notif_buf, GASPI_NOTIF_SIZE);
+      lseg->notif_mr = NULL;
+    }
+  lseg->notif_buf = NULL;
+
+#ifdef GPI2_CUDA
+  if(glb_gaspi_ctx.use_gpus == 0 || glb_gaspi_ctx.gpu_count == 0)
+#endif
+    if (!lseg->user_mem && munlock (lseg->buf, seg->size) != 0)
+      {
+	gaspi_print_error ("Memory unlocking (munlock) failed");
+	return -1;
+      }
+
+  if (ibv_dereg_mr (lseg->mr))
+    {
+      gaspi_print_error ("Memory de-registration failed (libibverbs)");
+      return -1;
+    }
+
+#ifdef GPI2_CUDA
+  if(lseg->user_mem)
+    ;
+  else if(seg->cudaDevId >= 0)
+    {
+      if (ibv_dereg_mr (lseg->host_mr))
+	{
+	  gaspi_print_error ("Memory de-registration failed (libibverbs)");
+	  return -1;
+	}
+      cudaSetDevice(seg->cudaDevId);
+      cudaFreeHost(lseg->host_ptr);
+      lseg->host_ptr=NULL;
+      cudaFree(lseg->buf);
+    }
+  else if(glb_gaspi_ctx.use_gpus != 0 && glb_gaspi_ctx.gpu_count > 0)
+    cudaFreeHost(lseg->buf);
+  else
+#endif
+  if (!lseg->user_mem)
+    gaspi_segment_mem_free (lseg->buf, lseg->map_size);
+
+  free (lseg->trans);
+  free (lseg->fetched);
+  gaspi_arena_destroy (lseg->arena);
+  memset (lseg, 0, sizeof (gaspi_lc_mseg));
+
+  return 0;
+}
+
 #pragma weak gaspi_segment_alloc = pgaspi_segment_alloc
 gaspi_return_t
 pgaspi_segment_alloc (const gaspi_segment_id_t segment_id,
 		     const gaspi_size_t size,
 		     const gaspi_alloc_t alloc_policy)
 {
-  unsigned int page_size;
-
   if (!glb_gaspi_init)
     {
       gaspi_print_error("Invalid function before gaspi_proc_init");
@@ -1758,25 +2460,17 @@ pgaspi_segment_alloc (const gaspi_segment_id_t segment_id,
 
   lock_gaspi_tout (&gaspi_mseg_lock, GASPI_BLOCK);
 
-  if (glb_gaspi_ctx.mseg_cnt >= GASPI_MAX_MSEGS || size == 0)
+  if (glb_gaspi_ctx.mseg_cnt >= glb_gaspi_cfg.segment_max || size == 0)
     goto errL;
 
-  if (glb_gaspi_ctx_ib.rrmd[segment_id] == NULL)
-    {
-      glb_gaspi_ctx_ib.rrmd[segment_id] = (gaspi_rc_mseg *) malloc (glb_gaspi_ctx.tnc * sizeof (gaspi_rc_mseg));
-      if(!glb_gaspi_ctx_ib.rrmd[segment_id]) goto errL;
-
-      memset (glb_gaspi_ctx_ib.rrmd[segment_id], 0,glb_gaspi_ctx.tnc * sizeof (gaspi_rc_mseg));
-
-    }
+  if (gaspi_segment_rrmd_alloc (segment_id) != 0)
+    goto errL;
 
   if (glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].size)
     {
       goto okL;
     }
 
-  page_size = sysconf (_SC_PAGESIZE);
-
 #ifdef GPI2_CUDA
   if(alloc_policy&GASPI_MEM_GPU)
     {
@@ -1793,42 +2487,42 @@ pgaspi_segment_alloc (const gaspi_segment_id_t segment_id,
 	  gaspi_print_error("No GPU found. Maybe foregt to call gaspi_init_GPUs?\n");
 	  return GASPI_ERROR;
 	}
-      if(cudaMalloc((void**)&glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].ptr,size) != 0)
+      if(cudaMalloc((void**)&glb_gaspi_ctx_ib.lmsd[segment_id].ptr,size) != 0)
 	{
 	  gaspi_print_error("GPU memory allocation (cudaMalloc) failed!\n");
 	  goto errL;
 	}
-      if(cudaMallocHost((void**)&glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].host_ptr,size+NOTIFY_OFFSET)!=0)
+      if(cudaMallocHost((void**)&glb_gaspi_ctx_ib.lmsd[segment_id].host_ptr,size+GASPI_GPU_STAGE_OFFSET)!=0)
 	{
 	  gaspi_print_error("Memory allocattion (cudaMallocHost)  failed!\n");
 	  goto errL;
 	}
-      memset(glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].host_ptr, 0, size+NOTIFY_OFFSET);
-      glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].host_mr = ibv_reg_mr(glb_gaspi_ctx_ib.pd,glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].host_ptr,
-										 NOTIFY_OFFSET+size,IBV_ACCESS_REMOTE_WRITE | IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_READ|IBV_ACCESS_REMOTE_ATOMIC);
-      if(!glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].host_mr)
+      memset(glb_gaspi_ctx_ib.lmsd[segment_id].host_ptr, 0, size+GASPI_GPU_STAGE_OFFSET);
+      glb_gaspi_ctx_ib.lmsd[segment_id].host_mr = ibv_reg_mr(glb_gaspi_ctx_ib.pd,glb_gaspi_ctx_ib.lmsd[segment_id].host_ptr,
+										 GASPI_GPU_STAGE_OFFSET+size,IBV_ACCESS_REMOTE_WRITE | IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_READ|IBV_ACCESS_REMOTE_ATOMIC);
+      if(!glb_gaspi_ctx_ib.lmsd[segment_id].host_mr)
 	{
 	  gaspi_print_error("Memory registration failed (libibverbs)\n");
 	  goto errL;
 	}
       
-      if(alloc_policy == GASPI_MEM_INITIALIZED)
-	cudaMemset(glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].ptr,0,size);
+      if(alloc_policy & GASPI_MEM_INITIALIZED)
+	cudaMemset(glb_gaspi_ctx_ib.lmsd[segment_id].ptr,0,size);
 
-      glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].mr = ibv_reg_mr (glb_gaspi_ctx_ib.pd,
-									     glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].buf,
+      glb_gaspi_ctx_ib.lmsd[segment_id].mr = ibv_reg_mr (glb_gaspi_ctx_ib.pd,
+									     glb_gaspi_ctx_ib.lmsd[segment_id].buf,
 									     size,
 									     IBV_ACCESS_REMOTE_WRITE | IBV_ACCESS_LOCAL_WRITE |
 									     IBV_ACCESS_REMOTE_READ | IBV_ACCESS_REMOTE_ATOMIC);
-      if (!glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].mr)
+      if (!glb_gaspi_ctx_ib.lmsd[segment_id].mr)
 	{
 	  gaspi_print_error ("Memory registration failed (libibverbs)");
 	  goto errL;
 	}
       
-      glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].host_rkey = glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].host_mr->rkey;
+      glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].host_rkey = glb_gaspi_ctx_ib.lmsd[segment_id].host_mr->rkey;
       
-      glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].host_addr = (uintptr_t)glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].host_ptr;
+      glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].host_addr = (uintptr_t)glb_gaspi_ctx_ib.lmsd[segment_id].host_ptr;
     }
 
   else
@@ -1838,7 +2532,7 @@ pgaspi_segment_alloc (const gaspi_segment_id_t segment_id,
       glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].host_addr = 0;
       if(glb_gaspi_ctx.use_gpus!=0 &&glb_gaspi_ctx.gpu_count==0)
 	{
-	  if( cudaMallocHost((void**)&glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].ptr, size+NOTIFY_OFFSET))
+	  if( cudaMallocHost((void**)&glb_gaspi_ctx_ib.lmsd[segment_id].ptr, size))
 	    {
 	      gaspi_print_error("Memory allocation (cudaMallocHost) failed !\n");
 	      goto errL;
@@ -1846,63 +2540,302 @@ pgaspi_segment_alloc (const gaspi_segment_id_t segment_id,
 	}
       else
 #endif
-	if (posix_memalign
-      ((void **) &glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].ptr,
-       page_size, size + NOTIFY_OFFSET) != 0)
+	if (gaspi_segment_mem_alloc
+	    (&glb_gaspi_ctx_ib.lmsd[segment_id].ptr,
+	     size, alloc_policy,
+	     &glb_gaspi_ctx_ib.lmsd[segment_id].map_size) != 0)
     {
-      gaspi_print_error ("Memory allocation (posix_memalign) failed");
+      gaspi_print_error ("Memory allocation failed");
       goto errL;
     }
 
-  memset (glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].ptr, 0,
-	  NOTIFY_OFFSET);
-
-  if (alloc_policy == GASPI_MEM_INITIALIZED)
-    memset (glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].ptr, 0,
-	    size + NOTIFY_OFFSET);
+  //mmap'ed memory is already zero-ed
+  if (glb_gaspi_ctx_ib.lmsd[segment_id].map_size == 0
+      && (alloc_policy & GASPI_MEM_INITIALIZED))
+    memset (glb_gaspi_ctx_ib.lmsd[segment_id].ptr, 0, size);
 
 #ifdef GPI2_CUDA
   if(glb_gaspi_ctx.use_gpus == 0 || glb_gaspi_ctx.gpu_count == 0)
 #endif
-    if (mlock(glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].buf,
-	      size + NOTIFY_OFFSET) != 0)
+    if (mlock(glb_gaspi_ctx_ib.lmsd[segment_id].buf,
+	      size) != 0)
       {
 	gaspi_print_error ("Memory locking (mlock) failed");
 	goto errL;
       }
   
-  glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].mr =
+  glb_gaspi_ctx_ib.lmsd[segment_id].mr =
     ibv_reg_mr (glb_gaspi_ctx_ib.pd,
-		glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].buf,
-		size + NOTIFY_OFFSET,
+		glb_gaspi_ctx_ib.lmsd[segment_id].buf,
+		size,
 		IBV_ACCESS_REMOTE_WRITE | IBV_ACCESS_LOCAL_WRITE |
 		IBV_ACCESS_REMOTE_READ | IBV_ACCESS_REMOTE_ATOMIC);
   
-  if (!glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].mr)
+  if (!glb_gaspi_ctx_ib.lmsd[segment_id].mr)
     {
       gaspi_print_error ("Memory registration failed (libibverbs)");
       goto errL;
     }
 #ifdef GPI2_CUDA
     }
-#endif
 
-  glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].rkey =
-    glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].mr->rkey;
-  glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].addr =
-    (uintptr_t) glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].buf;
+  if(alloc_policy&GASPI_MEM_GPU)
+    {
+      glb_gaspi_ctx_ib.lmsd[segment_id].notif_buf = glb_gaspi_ctx_ib.lmsd[segment_id].host_ptr;
+      glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].notif_rkey = glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].host_rkey;
+      glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].notif_addr = glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].host_addr;
+    }
+  else
+#endif
+  if (gaspi_segment_notif_alloc (segment_id) != 0)
+    goto errL;
+
+  glb_gaspi_ctx_ib.lmsd[segment_id].lkey =
+    glb_gaspi_ctx_ib.lmsd[segment_id].mr->lkey;
+  glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].rkey =
+    glb_gaspi_ctx_ib.lmsd[segment_id].mr->rkey;
+  glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].addr =
+    (uintptr_t) glb_gaspi_ctx_ib.lmsd[segment_id].buf;
+
+  glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].size = size;
+  glb_gaspi_ctx.mseg_cnt++;
+
+okL:
+  unlock_gaspi (&gaspi_mseg_lock);
+  return GASPI_SUCCESS;
+
+errL:
+  unlock_gaspi (&gaspi_mseg_lock);
+  return GASPI_ERROR;
+
+}
+
+#pragma weak gaspi_segment_bind = pgaspi_segment_bind
+gaspi_return_t
+pgaspi_segment_bind (const gaspi_segment_id_t segment_id,
+		     const gaspi_pointer_t pointer,
+		     const gaspi_size_t size,
+		     const gaspi_memory_description_t memory_description)
+{
+  if (!glb_gaspi_init)
+    {
+      gaspi_print_error("Invalid function before gaspi_proc_init");
+      return GASPI_ERROR;
+    }
+
+  gaspi_verify_null_ptr(pointer);
+
+  lock_gaspi_tout (&gaspi_mseg_lock, GASPI_BLOCK);
+
+  if (glb_gaspi_ctx.mseg_cnt >= glb_gaspi_cfg.segment_max || size == 0)
+    goto errL;
+
+  if (gaspi_segment_rrmd_alloc (segment_id) != 0)
+    goto errL;
+
+  gaspi_lc_mseg *lseg = &glb_gaspi_ctx_ib.lmsd[segment_id];
+  gaspi_rc_mseg *seg = &glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank];
+
+  if (seg->size)
+    {
+      gaspi_print_error ("Segment %u already exists", segment_id);
+      goto errL;
+    }
+
+  lseg->mr = ibv_reg_mr (glb_gaspi_ctx_ib.pd, pointer, size,
+			 IBV_ACCESS_REMOTE_WRITE | IBV_ACCESS_LOCAL_WRITE |
+			 IBV_ACCESS_REMOTE_READ | IBV_ACCESS_REMOTE_ATOMIC);
+  if (!lseg->mr)
+    {
+      gaspi_print_error ("Memory registration failed (libibverbs)");
+      goto errL;
+    }
+
+  if (gaspi_segment_notif_alloc (segment_id) != 0)
+    {
+      ibv_dereg_mr (lseg->mr);
+      lseg->mr = NULL;
+      goto errL;
+    }
+
+  lseg->ptr = pointer;
+  lseg->user_mem = 1;
+  lseg->map_size = 0;
+  lseg->lkey = lseg->mr->lkey;
+#ifdef GPI2_CUDA
+  seg->cudaDevId = -1;
+#endif
+  seg->rkey = lseg->mr->rkey;
+  seg->addr = (uintptr_t) pointer;
+  seg->size = size;
+  glb_gaspi_ctx.mseg_cnt++;
+
+  unlock_gaspi (&gaspi_mseg_lock);
+  return GASPI_SUCCESS;
+
+errL:
+  unlock_gaspi (&gaspi_mseg_lock);
+  return GASPI_ERROR;
+}
+
+#pragma weak gaspi_segment_alloc_file = pgaspi_segment_alloc_file
+gaspi_return_t
+pgaspi_segment_alloc_file (const gaspi_segment_id_t segment_id,
+			   const char * const path,
+			   const gaspi_size_t size)
+{
+  if (!glb_gaspi_init)
+    {
+      gaspi_print_error("Invalid function before gaspi_proc_init");
+      return GASPI_ERROR;
+    }
+
+  gaspi_verify_null_ptr(path);
+
+  lock_gaspi_tout (&gaspi_mseg_lock, GASPI_BLOCK);
+
+  if (glb_gaspi_ctx.mseg_cnt >= glb_gaspi_cfg.segment_max || size == 0)
+    goto errL;
+
+  if (gaspi_segment_rrmd_alloc (segment_id) != 0)
+    goto errL;
+
+  gaspi_lc_mseg *lseg = &glb_gaspi_ctx_ib.lmsd[segment_id];
+  gaspi_rc_mseg *seg = &glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank];
+
+  if (seg->size)
+    {
+      gaspi_print_error ("Segment %u already exists", segment_id);
+      goto errL;
+    }
+
+  if (gaspi_segment_mem_map_file (&lseg->ptr, path, size, &lseg->map_size) != 0)
+    goto errL;
+
+  if (mlock (lseg->buf, size) != 0)
+    {
+      gaspi_print_error ("Memory locking (mlock) failed");
+      goto unmapL;
+    }
+
+  lseg->mr = ibv_reg_mr (glb_gaspi_ctx_ib.pd, lseg->buf, size,
+			 IBV_ACCESS_REMOTE_WRITE | IBV_ACCESS_LOCAL_WRITE |
+			 IBV_ACCESS_REMOTE_READ | IBV_ACCESS_REMOTE_ATOMIC);
+  if (!lseg->mr)
+    {
+      gaspi_print_error ("Memory registration failed (libibverbs)");
+      munlock (lseg->buf, size);
+      goto unmapL;
+    }
+
+  if (gaspi_segment_notif_alloc (segment_id) != 0)
+    {
+      ibv_dereg_mr (lseg->mr);
+      lseg->mr = NULL;
+      munlock (lseg->buf, size);
+      goto unmapL;
+    }
+
+  lseg->user_mem = 0;
+  lseg->file_mem = 1;
+  lseg->lkey = lseg->mr->lkey;
+#ifdef GPI2_CUDA
+  seg->cudaDevId = -1;
+#endif
+  seg->rkey = lseg->mr->rkey;
+  seg->addr = (uintptr_t) lseg->buf;
+  seg->size = size;
+  glb_gaspi_ctx.mseg_cnt++;
+
+  unlock_gaspi (&gaspi_mseg_lock);
+  return GASPI_SUCCESS;
+
+unmapL:
+  gaspi_segment_mem_free (lseg->ptr, lseg->map_size);
+  lseg->ptr = NULL;
+  lseg->map_size = 0;
+
+errL:
+  unlock_gaspi (&gaspi_mseg_lock);
+  return GASPI_ERROR;
+}
+
+#pragma weak gaspi_segment_sync = pgaspi_segment_sync
+gaspi_return_t
+pgaspi_segment_sync (const gaspi_segment_id_t segment_id,
+		     const gaspi_offset_t offset,
+		     const gaspi_size_t size,
+		     const gaspi_sync_mode_t mode)
+{
+  const long page_size = sysconf (_SC_PAGESIZE);
+  gaspi_lc_mseg *lseg = &glb_gaspi_ctx_ib.lmsd[segment_id];
+
+  if (!glb_gaspi_init)
+    {
+      gaspi_print_error("Invalid function before gaspi_proc_init");
+      return GASPI_ERROR;
+    }
+
+  if (!lseg->file_mem
+      || offset + size > glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].size)
+    {
+      gaspi_print_error ("Invalid segment or range (gaspi_segment_sync)");
+      return GASPI_ERROR;
+    }
+
+  const unsigned long start = offset & ~(page_size - 1);
+
+  if (msync (lseg->buf + start, offset + size - start,
+	     (mode == GASPI_SYNC_ASYNC) ? MS_ASYNC : MS_SYNC) != 0)
+    {
+      gaspi_print_error ("Failed to flush segment %u (msync)", segment_id);
+      return GASPI_ERROR;
+    }
+
+  return GASPI_SUCCESS;
+}
 
-  glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].size = size;
-  glb_gaspi_ctx.mseg_cnt++;
+/* Tell the ranks that fetched the descriptor of a deleted segment
+   to forget it, so that they fetch it again if the segment id is
+   used anew. Ranks that are gone are skipped */
+static void
+gaspi_segment_invalidate (const gaspi_segment_id_t segment_id,
+			  const unsigned char * const fetched)
+{
+  int r, n = 0;
+  gaspi_cd_header cdh;
 
-okL:
-  unlock_gaspi (&gaspi_mseg_lock);
-  return GASPI_SUCCESS;
+  for(r = 0; r < glb_gaspi_ctx.tnc; r++)
+    n += fetched[r];
 
-errL:
-  unlock_gaspi (&gaspi_mseg_lock);
-  return GASPI_ERROR;
+  gaspi_sn_req *reqs = (gaspi_sn_req *) calloc (n, sizeof (gaspi_sn_req));
+  int *rret = (int *) malloc (n * sizeof (int));
+  if(reqs == NULL || rret == NULL)
+    goto endL;
+
+  memset(&cdh, 0, sizeof(gaspi_cd_header));
+  cdh.op = GASPI_SN_SEG_DELETE;
+  cdh.rank = glb_gaspi_ctx.rank;
+  cdh.seg_id = segment_id;
+
+  lock_gaspi_tout (&glb_gaspi_ctx_lock, GASPI_BLOCK);
+
+  for(r = 0, n = 0; r < glb_gaspi_ctx.tnc; r++)
+    {
+      if(!fetched[r])
+	continue;
+
+      gaspi_sn_post(r, &cdh, NULL, 0, &reqs[n], &rret[n], sizeof(int), GASPI_BLOCK);
+      n++;
+    }
+
+  gaspi_sn_waitall(reqs, n, GASPI_BLOCK);
+
+  unlock_gaspi (&glb_gaspi_ctx_lock);
 
+ endL:
+  free (reqs);
+  free (rret);
 }
 
 #pragma weak gaspi_segment_delete = pgaspi_segment_delete
@@ -1925,53 +2858,28 @@ pgaspi_segment_delete (const gaspi_segment_id_t segment_id)
       gaspi_print_error("Invalid segment to delete");
       goto errL;
     }
-#ifdef GPI2_CUDA 
-if(glb_gaspi_ctx.use_gpus!=0 && glb_gaspi_ctx.gpu_count>0)
-#endif
 
-  if (munlock
-      (glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].buf,
-       glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].size +
-       NOTIFY_OFFSET) != 0)
-    {
-      gaspi_print_error ("Memory unlocking (munlock) failed");
-      goto errL;
-    }
+  unsigned char *fetched = glb_gaspi_ctx_ib.lmsd[segment_id].fetched;
+  glb_gaspi_ctx_ib.lmsd[segment_id].fetched = NULL;
 
-  //here the problem ! different threads are allocating/registering. should not be a problem ?
-  if (ibv_dereg_mr (glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].mr))
+  if (gaspi_segment_release (segment_id) != 0)
     {
-      gaspi_print_error ("Memory de-registration failed (libibverbs)");
+      glb_gaspi_ctx_ib.lmsd[segment_id].fetched = fetched;
       goto errL;
     }
 
-#ifdef GPI2_CUDA
-  if(glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].cudaDevId >= 0)
-    {
-      if (ibv_dereg_mr (glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].host_mr))
-	{
-	  gaspi_print_error ("Memory de-registration failed (libibverbs)");
-	  goto errL;
-	}
-      cudaFreeHost(glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].host_ptr);
-      glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].host_ptr=NULL;
-      cudaFree(glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].buf);
-    }
-  else if(glb_gaspi_ctx.use_gpus != 0 && glb_gaspi_ctx.gpu_count > 0)
-    cudaFreeHost(glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].buf);
-  else
-#endif
-
-  free (glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].buf);
-  glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].buf = NULL;
-
-  memset(glb_gaspi_ctx_ib.rrmd[segment_id], 0, glb_gaspi_ctx.tnc * sizeof (gaspi_rc_mseg));
-  free(glb_gaspi_ctx_ib.rrmd[segment_id]);
-  glb_gaspi_ctx_ib.rrmd[segment_id]=NULL;
+  gaspi_segment_rrmd_free (segment_id);
 
   glb_gaspi_ctx.mseg_cnt--;
 
   unlock_gaspi (&gaspi_mseg_lock);
+
+  if (fetched != NULL)
+    {
+      gaspi_segment_invalidate (segment_id, fetched);
+      free (fetched);
+    }
+
   return GASPI_SUCCESS;
 
 errL:
@@ -2010,33 +2918,27 @@ pgaspi_segment_register(const gaspi_segment_id_t segment_id,
   cdh.rkey = glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].rkey;
   cdh.addr = glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].addr;
   cdh.size = glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].size;
+  cdh.notif_rkey = glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].notif_rkey;
+  cdh.notif_addr = glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].notif_addr;
 #ifdef GPI2_CUDA
   cdh.host_rkey = glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].host_rkey;
   cdh.host_addr = glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].host_addr;
 #endif
 
-  int ret;
-  ret=write(glb_gaspi_ctx.sockfd[rank],&cdh,sizeof(gaspi_cd_header));
-  if(ret != sizeof(gaspi_cd_header))
-    {
-      gaspi_print_error("Failed to write (%d %p %lu)",
-			glb_gaspi_ctx.sockfd[rank],&cdh,sizeof(gaspi_cd_header));
+  gaspi_sn_req req;
+  int rret = -1;
 
-      glb_gaspi_ctx.qp_state_vec[GASPI_SN][rank] = 1;
-      goto errL;
-    }
+  if(gaspi_sn_post(rank, &cdh, NULL, 0, &req, &rret, sizeof(int), timeout_ms) != 0)
+    goto errL;
 
-  int rret;
-  ret=read(glb_gaspi_ctx.sockfd[rank],&rret,sizeof(int));
-  if(ret !=sizeof(int))
+  const gaspi_return_t eret = gaspi_sn_waitall(&req, 1, timeout_ms);
+  if(eret != GASPI_SUCCESS)
     {
-      gaspi_print_error("Failed to read (%d %p %lu)",
-			glb_gaspi_ctx.sockfd[rank],&rret, sizeof(int));
-
-      glb_gaspi_ctx.qp_state_vec[GASPI_SN][rank] = 1;
-      goto errL;
+      gaspi_sn_cancel(&req);
+      unlock_gaspi(&glb_gaspi_ctx_lock);
+      return eret;
     }
-  
+
   if(rret < 0) 
     goto errL;
   
@@ -2059,15 +2961,8 @@ gaspi_seg_reg_sn(const gaspi_cd_header snp)
 
   lock_gaspi_tout(&gaspi_mseg_lock,GASPI_BLOCK);
 
-  if(glb_gaspi_ctx_ib.rrmd[snp.seg_id] == NULL)
-    {
-      glb_gaspi_ctx_ib.rrmd[snp.seg_id] = (gaspi_rc_mseg *) malloc (glb_gaspi_ctx.tnc * sizeof (gaspi_rc_mseg));
-
-      if(!glb_gaspi_ctx_ib.rrmd[snp.seg_id]) 
-	goto errL;
-      
-    memset(glb_gaspi_ctx_ib.rrmd[snp.seg_id], 0, glb_gaspi_ctx.tnc * sizeof (gaspi_rc_mseg));
-  }
+  if(gaspi_segment_rrmd_alloc (snp.seg_id) != 0)
+    goto errL;
 
   //TODO: don't allow re-registration
   //for now we allow re-registration
@@ -2076,6 +2971,8 @@ gaspi_seg_reg_sn(const gaspi_cd_header snp)
   glb_gaspi_ctx_ib.rrmd[snp.seg_id][snp.rank].rkey = snp.rkey;
   glb_gaspi_ctx_ib.rrmd[snp.seg_id][snp.rank].addr = snp.addr;
   glb_gaspi_ctx_ib.rrmd[snp.seg_id][snp.rank].size = snp.size;
+  glb_gaspi_ctx_ib.rrmd[snp.seg_id][snp.rank].notif_rkey = snp.notif_rkey;
+  glb_gaspi_ctx_ib.rrmd[snp.seg_id][snp.rank].notif_addr = snp.notif_addr;
 #ifdef GPI2_CUDA
   glb_gaspi_ctx_ib.rrmd[snp.seg_id][snp.rank].host_rkey=snp.host_rkey;
   glb_gaspi_ctx_ib.rrmd[snp.seg_id][snp.rank].host_addr=snp.host_addr;
@@ -2094,31 +2991,209 @@ errL:
 
 }
 
-#pragma weak gaspi_segment_create = pgaspi_segment_create
-gaspi_return_t
-pgaspi_segment_create(const gaspi_segment_id_t segment_id,
-		      const gaspi_size_t size, const gaspi_group_t group,
-		      const gaspi_timeout_t timeout_ms,
-		      const gaspi_alloc_t alloc_policy){
+//sn-deletion of a segment of rank: forget its descriptor
+int
+gaspi_seg_del_sn(const gaspi_cd_header snp)
+{
+  if(!glb_gaspi_ib_init || snp.rank >= glb_gaspi_ctx.tnc)
+    return -1;
 
-  int r;
-  gaspi_return_t eret = GASPI_ERROR;
+  lock_gaspi_tout(&gaspi_mseg_lock,GASPI_BLOCK);
+
+  if(glb_gaspi_ctx_ib.rrmd[snp.seg_id] != NULL)
+    memset(&glb_gaspi_ctx_ib.rrmd[snp.seg_id][snp.rank], 0, sizeof(gaspi_rc_mseg));
+
+  unlock_gaspi(&gaspi_mseg_lock);
+  return 0;
+}
+
+//sn-reply to a segment info request of rank, which is told when the
+//segment is deleted
+int
+gaspi_seg_info_sn(const gaspi_segment_id_t segment_id, const gaspi_rank_t rank,
+		  gaspi_cd_header *cdh)
+{
+  memset(cdh, 0, sizeof(gaspi_cd_header));
+  cdh->op = GASPI_SN_SEG_FETCH;
+  cdh->rank = glb_gaspi_ctx.rank;
+  cdh->seg_id = segment_id;
 
   if(!glb_gaspi_ib_init)
+    return -1;
+
+  lock_gaspi_tout(&gaspi_mseg_lock,GASPI_BLOCK);
+
+  if(glb_gaspi_ctx_ib.rrmd[segment_id] != NULL)
     {
-      gaspi_print_error("Invalid function before gaspi_proc_init");
-      return GASPI_ERROR;
+      const gaspi_rc_mseg *seg = &glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank];
+
+      cdh->rkey = seg->rkey;
+      cdh->addr = seg->addr;
+      cdh->size = seg->size;
+      cdh->notif_rkey = seg->notif_rkey;
+      cdh->notif_addr = seg->notif_addr;
+#ifdef GPI2_CUDA
+      cdh->host_rkey = seg->host_rkey;
+      cdh->host_addr = seg->host_addr;
+#endif
     }
 
-  if(pgaspi_segment_alloc (segment_id, size, alloc_policy) != 0)
+  if(cdh->size > 0 && rank < glb_gaspi_ctx.tnc)
     {
-      gaspi_print_error("Segment allocation failed");
+      gaspi_lc_mseg *lseg = &glb_gaspi_ctx_ib.lmsd[segment_id];
+
+      if(lseg->fetched == NULL)
+	lseg->fetched = (unsigned char *) calloc (glb_gaspi_ctx.tnc, sizeof (unsigned char));
+
+      //without the table, the rank would keep a stale descriptor
+      if(lseg->fetched == NULL)
+	cdh->size = 0;
+      else
+	lseg->fetched[rank] = 1;
+    }
+
+  unlock_gaspi(&gaspi_mseg_lock);
+
+  return (cdh->size > 0) ? 0 : -1;
+}
+
+/* Fetch the descriptors of a segment from a list of ranks. All
+   requests are sent before the replies are read, so the round trips
+   overlap. Descriptors already known are not requested again */
+static gaspi_return_t
+gaspi_segment_fetch_list (const gaspi_segment_id_t segment_id,
+			  const gaspi_rank_t * const rank_list,
+			  const gaspi_number_t num,
+			  const gaspi_timeout_t timeout_ms)
+{
+  gaspi_number_t i;
+  gaspi_cd_header cdh;
+  gaspi_return_t eret = GASPI_ERROR;
+
+  for(i = 0; i < num; i++)
+    {
+      if(rank_list[i] >= glb_gaspi_ctx.tnc || rank_list[i] == glb_gaspi_ctx.rank)
+	{
+	  gaspi_print_error("Invalid rank %u to fetch segment from", rank_list[i]);
+	  return GASPI_ERROR;
+	}
+    }
+
+  lock_gaspi_tout (&gaspi_mseg_lock, GASPI_BLOCK);
+  const int ret_alloc = gaspi_segment_rrmd_alloc (segment_id);
+  unlock_gaspi (&gaspi_mseg_lock);
+
+  if(ret_alloc != 0)
+    return GASPI_ERROR;
+
+  if(lock_gaspi_tout (&glb_gaspi_ctx_lock, timeout_ms))
+    return GASPI_TIMEOUT;
+
+  gaspi_sn_req *reqs = (gaspi_sn_req *) calloc (num, sizeof (gaspi_sn_req));
+  gaspi_cd_header *reply = (gaspi_cd_header *) malloc (num * sizeof (gaspi_cd_header));
+  if(reqs == NULL || reply == NULL)
+    goto errL;
+
+  memset(&cdh, 0, sizeof(gaspi_cd_header));
+  cdh.op_len = 0;
+  cdh.op = GASPI_SN_SEG_FETCH;
+  cdh.rank = glb_gaspi_ctx.rank;
+  cdh.seg_id = segment_id;
+
+  for(i = 0; i < num; i++)
+    {
+      const gaspi_rank_t rank = rank_list[i];
+
+      if(gaspi_load_ulong(&glb_gaspi_ctx_ib.rrmd[segment_id][rank].size) > 0)
+	continue;
+
+      if(gaspi_sn_post(rank, &cdh, NULL, 0, &reqs[i], &reply[i],
+		       sizeof(gaspi_cd_header), timeout_ms) != 0)
+	{
+	  gaspi_print_error("Failed to request segment info from %u", rank);
+	  break;
+	}
+    }
+
+  eret = (i == num) ? GASPI_SUCCESS : GASPI_ERROR;
+
+  const gaspi_return_t wret = gaspi_sn_waitall(reqs, num, timeout_ms);
+  if(wret != GASPI_SUCCESS && eret == GASPI_SUCCESS)
+    eret = wret;
+
+  for(i = 0; i < num; i++)
+    {
+      if(reqs[i].state != GASPI_SN_REQ_DONE)
+	{
+	  gaspi_sn_cancel(&reqs[i]);
+	  continue;
+	}
+
+      //segment not (yet) there
+      if(reply[i].size == 0 || reply[i].rank != rank_list[i])
+	{
+	  eret = GASPI_ERROR;
+	  continue;
+	}
+
+      if(gaspi_seg_reg_sn (reply[i]) != 0)
+	eret = GASPI_ERROR;
+    }
+
+  free (reqs);
+  free (reply);
+  unlock_gaspi (&glb_gaspi_ctx_lock);
+  return eret;
+
+errL:
+  free (reqs);
+  free (reply);
+  unlock_gaspi (&glb_gaspi_ctx_lock);
+  return GASPI_ERROR;
+}
+
+gaspi_return_t
+gaspi_segment_fetch (const gaspi_segment_id_t segment_id,
+		     const gaspi_rank_t rank,
+		     const gaspi_timeout_t timeout_ms)
+{
+  if(!glb_gaspi_ib_init)
+    return GASPI_ERROR;
+
+  return gaspi_segment_fetch_list (segment_id, &rank, 1, timeout_ms);
+}
+
+#pragma weak gaspi_segment_prefetch = pgaspi_segment_prefetch
+gaspi_return_t
+pgaspi_segment_prefetch (const gaspi_segment_id_t segment_id,
+			 const gaspi_rank_t * const rank_list,
+			 const gaspi_number_t num,
+			 const gaspi_timeout_t timeout_ms)
+{
+  if(!glb_gaspi_ib_init)
+    {
+      gaspi_print_error("Invalid function before gaspi_proc_init");
       return GASPI_ERROR;
     }
 
-  if(group >= GASPI_MAX_GROUPS || glb_gaspi_group_ib[group].id < 0)
+  gaspi_verify_null_ptr(rank_list);
+
+  return gaspi_segment_fetch_list (segment_id, rank_list, num, timeout_ms);
+}
+
+/* Register a local segment with all members of a group and wait
+   for theirs (second half of gaspi_segment_create/use) */
+static gaspi_return_t
+gaspi_segment_register_group (const gaspi_segment_id_t segment_id,
+			      const gaspi_group_t group,
+			      const gaspi_timeout_t timeout_ms)
+{
+  int r;
+  gaspi_return_t eret = GASPI_ERROR;
+
+  if(group >= glb_gaspi_cfg.group_max || glb_gaspi_group_ib[group].id < 0)
     {
-      gaspi_print_error("Invalid group ( > GASPI_MAX_GROUPS || < 0)");
+      gaspi_print_error("Invalid group ( > group_max || < 0)");
       return GASPI_ERROR;
     }
 
@@ -2129,7 +3204,7 @@ pgaspi_segment_create(const gaspi_segment_id_t segment_id,
   if(glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].size==0)
     {
       gaspi_print_error("Segment size is 0");
-      return GASPI_ERROR;
+      goto errL;
     }
 
   //register segment to all other group members  
@@ -2141,59 +3216,86 @@ pgaspi_segment_create(const gaspi_segment_id_t segment_id,
   cdh.rkey=glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].rkey;
   cdh.addr=glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].addr;
   cdh.size=glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].size;
+  cdh.notif_rkey=glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].notif_rkey;
+  cdh.notif_addr=glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].notif_addr;
 
 #ifdef GPI2_CUDA
   cdh.host_rkey=glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].host_rkey;
   cdh.host_addr=glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].host_addr;
 #endif
-  //dont write several times !!!
-  for(r=1;r<=glb_gaspi_group_ib[group].tnc;r++)
+
+  unsigned char *trans = glb_gaspi_ctx_ib.lmsd[segment_id].trans;
+  if(trans == NULL)
+    {
+      trans = (unsigned char *) calloc (glb_gaspi_ctx.tnc, sizeof (unsigned char));
+      if(trans == NULL)
+	{
+	  gaspi_print_error("Memory allocation failed");
+	  goto errL;
+	}
+      glb_gaspi_ctx_ib.lmsd[segment_id].trans = trans;
+    }
+
+  const int gtnc = glb_gaspi_group_ib[group].tnc;
+  gaspi_sn_req *reqs = (gaspi_sn_req *) calloc (gtnc, sizeof (gaspi_sn_req));
+  int *rret = (int *) malloc (gtnc * sizeof (int));
+  if(reqs == NULL || rret == NULL)
+    {
+      free (reqs);
+      free (rret);
+      gaspi_print_error("Memory allocation failed");
+      goto errL;
+    }
+
+  //dont write several times !!! All requests go out before the replies are read
+  for(r=1;r<=gtnc;r++)
     {
-      int i = (glb_gaspi_group_ib[group].rank+r)%glb_gaspi_group_ib[group].tnc;
+      int i = (glb_gaspi_group_ib[group].rank+r)%gtnc;
 
       if(glb_gaspi_group_ib[group].rank_grp[i]==glb_gaspi_ctx.rank)
 	{
-	  glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_group_ib[group].rank_grp[i]].trans=1; 
+	  trans[glb_gaspi_group_ib[group].rank_grp[i]] = 1;
 	  continue;
 	}
 
-      if(glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_group_ib[group].rank_grp[i]].trans) 
+      if(trans[glb_gaspi_group_ib[group].rank_grp[i]])
 	continue;
 
-      int ret;
-      ret=write(glb_gaspi_ctx.sockfd[glb_gaspi_group_ib[group].rank_grp[i]],
-		&cdh,
-		sizeof(gaspi_cd_header));
-
-      if(ret != sizeof(gaspi_cd_header))
+      if(gaspi_sn_post(glb_gaspi_group_ib[group].rank_grp[i], &cdh, NULL, 0,
+		       &reqs[i], &rret[i], sizeof(int), timeout_ms) != 0)
 	{
+	  gaspi_print_error("Failed to register segment with %d",
+			    glb_gaspi_group_ib[group].rank_grp[i]);
+	  break;
+	}
+    }
 
-	  gaspi_print_error("Failed write (%d %p %lu)",
-			    glb_gaspi_ctx.sockfd[glb_gaspi_group_ib[group].rank_grp[i]],
-			    &cdh,
-			    sizeof(gaspi_cd_header));
+  eret = gaspi_sn_waitall(reqs, gtnc, timeout_ms);
 
-	  glb_gaspi_ctx.qp_state_vec[GASPI_SN][glb_gaspi_group_ib[group].rank_grp[i]] = 1;
-	  goto errL;
-	}
-    
-      int rret;
-      ret=read(glb_gaspi_ctx.sockfd[glb_gaspi_group_ib[group].rank_grp[i]],&rret,sizeof(int));
-      if(ret != sizeof(int))
-	{
-	  gaspi_print_error("Failed to read (%d %p %lu)",
-			    glb_gaspi_ctx.sockfd[glb_gaspi_group_ib[group].rank_grp[i]],&rret,sizeof(int));
+  for(r = 0; r < gtnc; r++)
+    {
+      if(reqs[r].state == GASPI_SN_REQ_DONE && rret[r] >= 0)
+	trans[glb_gaspi_group_ib[group].rank_grp[r]] = 1;
+      else if(reqs[r].state == GASPI_SN_REQ_DONE)
+	eret = GASPI_ERROR;
+      else
+	gaspi_sn_cancel(&reqs[r]);
+    }
 
-	  glb_gaspi_ctx.qp_state_vec[GASPI_SN][glb_gaspi_group_ib[group].rank_grp[i]] = 1;
-	  goto errL;
-	}
-      
-      if(rret < 0) 
-	goto errL;
+  free (reqs);
+  free (rret);
 
-      glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_group_ib[group].rank_grp[i]].trans=1;
+  if(eret == GASPI_SUCCESS)
+    {
+      for(r = 0; r < gtnc; r++)
+	{
+	  if(!trans[glb_gaspi_group_ib[group].rank_grp[r]])
+	    eret = GASPI_ERROR;
+	}
+    }
 
-    }//for
+  if(eret != GASPI_SUCCESS)
+    goto errL;
 
   //wait for remote registration
   struct timeb t0,t1;
@@ -2241,6 +3343,78 @@ errL:
   return eret;
 }
 
+/* Whether the segment info can be allgathered over the collective
+   QPs of a group: committed (the collectives connect to their
+   partners on first use). Must not depend on local connection
+   state, all members have to take the same path */
+static int
+gaspi_group_committed (const gaspi_group_t group)
+{
+  return (group < glb_gaspi_cfg.group_max && glb_gaspi_group_ib[group].id >= 0
+	  && glb_gaspi_group_ib[group].ready
+	  && glb_gaspi_group_ib[group].commit_state == NULL);
+}
+
+#pragma weak gaspi_segment_create = pgaspi_segment_create
+gaspi_return_t
+pgaspi_segment_create(const gaspi_segment_id_t segment_id,
+		      const gaspi_size_t size, const gaspi_group_t group,
+		      const gaspi_timeout_t timeout_ms,
+		      const gaspi_alloc_t alloc_policy){
+
+  if(!glb_gaspi_ib_init)
+    {
+      gaspi_print_error("Invalid function before gaspi_proc_init");
+      return GASPI_ERROR;
+    }
+
+  if(pgaspi_segment_alloc (segment_id, size, alloc_policy) != 0)
+    {
+      gaspi_print_error("Segment allocation failed");
+      return GASPI_ERROR;
+    }
+
+  //peers fetch the segment info on first access
+  if(glb_gaspi_cfg.segment_lazy)
+    return gaspi_barrier (group, timeout_ms);
+
+  //one allgather instead of a SN round trip per member
+  if(gaspi_group_committed (group))
+    return gaspi_segment_allgather (segment_id, group, timeout_ms);
+
+  return gaspi_segment_register_group (segment_id, group, timeout_ms);
+}
+
+#pragma weak gaspi_segment_use = pgaspi_segment_use
+gaspi_return_t
+pgaspi_segment_use (const gaspi_segment_id_t segment_id,
+		    const gaspi_pointer_t pointer,
+		    const gaspi_size_t size,
+		    const gaspi_group_t group,
+		    const gaspi_timeout_t timeout_ms,
+		    const gaspi_memory_description_t memory_description)
+{
+  if(!glb_gaspi_ib_init)
+    {
+      gaspi_print_error("Invalid function before gaspi_proc_init");
+      return GASPI_ERROR;
+    }
+
+  if(pgaspi_segment_bind (segment_id, pointer, size, memory_description) != 0)
+    {
+      gaspi_print_error("Segment bind failed");
+      return GASPI_ERROR;
+    }
+
+  if(glb_gaspi_cfg.segment_lazy)
+    return gaspi_barrier (group, timeout_ms);
+
+  if(gaspi_group_committed (group))
+    return gaspi_segment_allgather (segment_id, group, timeout_ms);
+
+  return gaspi_segment_register_group (segment_id, group, timeout_ms);
+}
+
 
 #pragma weak gaspi_segment_num = pgaspi_segment_num
 gaspi_return_t
@@ -2270,10 +3444,11 @@ pgaspi_segment_list (const gaspi_number_t num,
       return GASPI_ERROR;
     }
 
-  //TODO: 256 -> readable
-  for (i = 0; i < 256; i++)
+  //tables also exist for segments only known from other ranks
+  for (i = 0; i < GASPI_SEGMENTS_LIMIT; i++)
     {
-      if (glb_gaspi_ctx_ib.rrmd[i] != NULL)
+      if (glb_gaspi_ctx_ib.rrmd[i] != NULL
+	  && glb_gaspi_ctx_ib.rrmd[i][glb_gaspi_ctx.rank].size > 0)
 	segment_id_list[idx++] = i;
     }
 
@@ -2308,14 +3483,9 @@ pgaspi_segment_ptr (const gaspi_segment_id_t segment_id, gaspi_pointer_t * ptr)
     }
 
   gaspi_verify_null_ptr(ptr);
-#ifdef GPI2_CUDA
-  if(glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].cudaDevId>=0)
-     *ptr = 
-         glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].buf;
-  else
-#endif
+
   *ptr =
-    glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank].buf + NOTIFY_OFFSET;
+    glb_gaspi_ctx_ib.lmsd[segment_id].buf;
   return GASPI_SUCCESS;
 
 }
@@ -2356,7 +3526,7 @@ pgaspi_segment_max (gaspi_number_t * const segment_max)
 {
   gaspi_verify_null_ptr(segment_max);
 
-  *segment_max = GASPI_MAX_MSEGS;
+  *segment_max = glb_gaspi_cfg.segment_max;
   return GASPI_SUCCESS;
 }
 
@@ -22,19 +22,52 @@ along with GPI-2. If not, see <http://www.gnu.org/licenses/>.
 #include <infiniband/verbs.h>
 #include <infiniband/driver.h>
 
+#include "GPI2_Coll.h"
+
 #define GASPI_GID_INDEX   (0)
 #define PORT_LINK_UP      (5)
 #define MAX_INLINE_BYTES  (128)
 #define GASPI_QP_TIMEOUT  (20)
 #define GASPI_QP_RETRY    (7)
 
+/* Default of queue_lazy_tnc: above this many ranks the QPs of queues
+   other than the first one are created on first use of a (queue,
+   rank) pair */
+#define GASPI_QUEUE_LAZY_TNC (1000)
+
+/* gaspi_connect_list: at most this many helper threads for the QP
+   transitions, one per so many peers */
+#define GASPI_CONNECT_WORKERS (7)
+#define GASPI_CONNECT_PER_WORKER (8)
+
+/* Notification area of a segment: the notifications followed by the
+   counter of the remote heap (gaspi_segment_remote_malloc) */
+#define GASPI_NOTIF_HEAP_OFFSET						\
+  ((glb_gaspi_cfg.notification_num * sizeof (gaspi_notification_t) + 7) & ~7UL)
+#define GASPI_NOTIF_SIZE (GASPI_NOTIF_HEAP_OFFSET + sizeof (gaspi_atomic_value_t))
+
+/* GPU segments: the host staging buffer starts with the notification
+   area, the staged data follows page aligned */
+#define GASPI_GPU_STAGE_OFFSET ((GASPI_NOTIF_SIZE + 4095) & ~4095UL)
+
 typedef enum{
   GASPI_BARRIER = 1,
   GASPI_ALLREDUCE = 2,
   GASPI_ALLREDUCE_USER = 4,
-  GASPI_NONE = 7
+  GASPI_ALLGATHER = 8,
+  GASPI_NONE = 15
 }gaspi_async_coll_t;
 
+/* QPs connected in a race with the remote side (both ends set up a
+   queue at the same time): usable by the peer, freed when rank is
+   disconnected or at cleanup */
+typedef struct gaspi_qp_spare
+{
+  struct ibv_qp *qp;
+  int rank;
+  struct gaspi_qp_spare *next;
+} gaspi_qp_spare;
+
 typedef struct
 {
   int lid;
@@ -44,9 +77,21 @@ typedef struct
   int qpnC[GASPI_MAX_QP];
   int psn;
   int rank,ret;
-  volatile int istat,cstat;
 } gaspi_rc_all;
 
+/* All we keep about a peer, allocated with its endpoint
+   (gaspi_create_endpoint). The fields needed to post come first */
+typedef struct
+{
+  volatile int cstat;	/* connected */
+  int passive_busy;	/* passive send not completed yet */
+  struct ibv_qp *qpGroup;
+  struct ibv_qp *qpP;
+  struct ibv_qp *qpC[GASPI_MAX_QP];
+  gaspi_rc_all lrcd, rrcd;
+  gaspi_lock_t lock;	/* QP transitions (gaspi_connect_context) */
+} ALIGN64 gaspi_peer;
+
 
 typedef struct
 {
@@ -55,6 +100,43 @@ typedef struct
 } gaspi_rc_grp;
 
 
+/* Segment descriptor of a rank, as seen by the others. Kept to the
+   fields the communication calls need (32 bytes without CUDA), so a
+   lookup never crosses a cache line */
+typedef struct
+{
+  unsigned long addr;
+  unsigned long size;
+  unsigned long notif_addr;
+  unsigned int rkey;
+  unsigned int notif_rkey;
+#ifdef GPI2_CUDA
+  int cudaDevId;
+  unsigned int host_rkey;
+  unsigned long host_addr;
+#endif
+} __attribute__ ((aligned (32))) gaspi_rc_mseg;
+
+/* Records allgathered over the parent by gaspi_group_split */
+typedef struct
+{
+  int color;
+  int key;
+  unsigned char used[GASPI_GROUPS_LIMIT / 8]; /* group ids in use */
+} gaspi_split_info;
+
+typedef struct
+{
+  unsigned long vaddr;
+  unsigned int rkey;
+  int color;
+  int rank;			/* in the new group */
+} gaspi_split_buf;
+
+/* Largest record allgathered among the members of a group */
+#define GASPI_GATHER_BLOCK (MAX (sizeof (gaspi_rc_mseg), sizeof (gaspi_split_info)))
+
+/* Local only part of a segment */
 typedef struct
 {
   union
@@ -63,20 +145,20 @@ typedef struct
     void *ptr;
   };
   struct ibv_mr *mr;
-  unsigned int rkey;
-  unsigned long addr,size;
-  int trans;
+  unsigned int lkey;
+  int user_mem;           /* memory provided by the application */
+  unsigned long map_size; /* mmap'ed length, 0 if from posix_memalign */
+  int file_mem;           /* mapped from a file (gaspi_segment_alloc_file) */
+  unsigned char *notif_buf; /* notification area, apart from the data */
+  struct ibv_mr *notif_mr;
+  unsigned char *trans;   /* per rank, registration sent */
+  unsigned char *fetched; /* per rank, descriptor fetched by it */
+  struct gaspi_arena *arena; /* sub-allocator (gaspi_segment_malloc) */
 #ifdef GPI2_CUDA
-  int cudaDevId;
-  union
-  {
-   void* host_ptr;
-   unsigned long host_addr;
-  };
+  void *host_ptr;
   struct ibv_mr *host_mr;
-  unsigned int host_rkey;
 #endif
-} gaspi_rc_mseg;
+} gaspi_lc_mseg;
 
 typedef struct
 {
@@ -93,24 +175,30 @@ typedef struct
   int max_rd_atomic;
   int ib_port;
   struct ibv_cq *scqGroups, *rcqGroups;
-  struct ibv_qp **qpGroups;
   struct ibv_wc wc_grp_send[64];
   struct ibv_srq *srqP;
-  struct ibv_qp **qpP;
   struct ibv_cq *scqP;
   struct ibv_cq *rcqP;
-  struct ibv_cq *scqC[GASPI_MAX_QP], *rcqC[GASPI_MAX_QP];
-  struct ibv_qp **qpC[GASPI_MAX_QP];
+  struct ibv_cq *scqC[GASPI_MAX_QP];
+  gaspi_qp_spare *qp_spare;
   union ibv_gid gid;
-  gaspi_rc_all *lrcd, *rrcd;
-  gaspi_rc_mseg *rrmd[256];
+  gaspi_peer **peer;
+  gaspi_rc_mseg *rrmd[GASPI_SEGMENTS_LIMIT];
+  gaspi_lc_mseg lmsd[GASPI_SEGMENTS_LIMIT];
   int ne_count_grp;
   int ne_count_c[GASPI_MAX_QP];
-  unsigned char ne_count_p[8192];
-  gaspi_rc_mseg nsrc;
+  gaspi_lc_mseg nsrc;
 } gaspi_ib_ctx;
 
 
+/* Per member progress of a group commit */
+enum
+{
+  GASPI_GRP_CHECK_TODO = 0,
+  GASPI_GRP_CHECK_SENT = 1,
+  GASPI_GRP_CHECK_DONE = 2
+};
+
 typedef struct{
   union
   {
@@ -130,18 +218,89 @@ typedef struct{
   int next_pof2;
   int pof2_exp;
   int *rank_grp;
+  int rank_grp_size;
   gaspi_rc_grp *rrcd;
+  int coll_slots;
+  unsigned int coll_send, coll_recv;
+  unsigned int coll_gather;
+  int barrier_alg;
+  int allreduce_alg[GASPI_COLL_BUCKETS];
+  int coll_alg;
+  int repro_pass;
+  int split_id;			/* group being split off, -1 if none */
+  volatile int ready;
+  int cs;
+  unsigned char *commit_state;
 } gaspi_ib_group;
 
-gaspi_ib_ctx glb_gaspi_ctx_ib;// = {.rrcd=NULL, .lrcd=NULL};
+gaspi_ib_ctx glb_gaspi_ctx_ib;
 
-gaspi_ib_group glb_gaspi_group_ib[GASPI_MAX_GROUPS];
+gaspi_ib_group *glb_gaspi_group_ib;
 
 void gaspi_init_collectives();
 int gaspi_connect_context(const int, gaspi_timeout_t);
 int gaspi_create_endpoint(const int);
+gaspi_return_t gaspi_queue_connect(const gaspi_queue_id_t, const gaspi_rank_t, const gaspi_timeout_t);
+int gaspi_queue_accept(const int, const int, const int);
 int gaspi_init_ib_core();
 int gaspi_cleanup_ib_core();
+gaspi_return_t gaspi_group_allgather(const gaspi_group_t, const void *const, const int,
+				     unsigned char **const, const gaspi_timeout_t);
+gaspi_return_t gaspi_segment_allgather(const gaspi_segment_id_t, const gaspi_group_t, const gaspi_timeout_t);
+gaspi_return_t gaspi_segment_fetch(const gaspi_segment_id_t, const gaspi_rank_t, const gaspi_timeout_t);
+gaspi_return_t gaspi_atomic_post(const gaspi_rank_t, const unsigned long, const unsigned int,
+				 const enum ibv_wr_opcode, const gaspi_atomic_value_t,
+				 const gaspi_atomic_value_t, gaspi_atomic_value_t * const,
+				 const gaspi_timeout_t);
+void gaspi_arena_destroy(struct gaspi_arena *);
+
+/* Connection to rank, set up on first use (connect_lazy or a rank
+   that was left out of the initial connect). The caller waits for
+   the QPs to be ready, the operation is posted afterwards */
+static inline gaspi_return_t
+gaspi_connect_remote(const gaspi_rank_t rank, const gaspi_timeout_t timeout_ms)
+{
+  if(rank < glb_gaspi_ctx.tnc && glb_gaspi_ctx_ib.peer[rank] != NULL
+     && glb_gaspi_ctx_ib.peer[rank]->cstat)
+    return GASPI_SUCCESS;
+
+  return gaspi_connect(rank, timeout_ms);
+}
+
+extern gaspi_config_t glb_gaspi_cfg;
+
+/* QP of a queue to rank, connected on first use with lazy queues
+   (see queue_lazy_tnc). The connection to rank is expected */
+static inline gaspi_return_t
+gaspi_queue_remote(const gaspi_queue_id_t queue, const gaspi_rank_t rank,
+		   const gaspi_timeout_t timeout_ms)
+{
+  if(queue >= glb_gaspi_cfg.queue_num)
+    return GASPI_ERROR;
+
+  const gaspi_peer * const peer = glb_gaspi_ctx_ib.peer[rank];
+  if(peer != NULL && peer->qpC[queue] != NULL)
+    return GASPI_SUCCESS;
+
+  return gaspi_queue_connect(queue, rank, timeout_ms);
+}
+
+/* Descriptor of a remote segment, fetched on first use if the
+   segment was not registered with us, and the connection to rank */
+static inline gaspi_return_t
+gaspi_segment_remote(const gaspi_segment_id_t segment_id, const gaspi_rank_t rank,
+		     const gaspi_timeout_t timeout_ms)
+{
+  const gaspi_return_t eret = gaspi_connect_remote(rank, timeout_ms);
+  if(eret != GASPI_SUCCESS)
+    return eret;
+
+  if(glb_gaspi_ctx_ib.rrmd[segment_id] != NULL && rank < glb_gaspi_ctx.tnc
+     && glb_gaspi_ctx_ib.rrmd[segment_id][rank].size > 0)
+    return GASPI_SUCCESS;
+
+  return gaspi_segment_fetch(segment_id, rank, timeout_ms);
+}
 
 
 #endif
@@ -19,82 +19,41 @@ along with GPI-2. If not, see <http://www.gnu.org/licenses/>.
 #include "GASPI.h"
 #include "GPI2_IB.h"
 
-#pragma weak gaspi_atomic_fetch_add      = pgaspi_atomic_fetch_add
+/* Post an atomic operation on the collective QP and wait for the
+   old value. The remote address must be 8 byte aligned */
 gaspi_return_t
-pgaspi_atomic_fetch_add (const gaspi_segment_id_t segment_id,
-			const gaspi_offset_t offset, const gaspi_rank_t rank,
-			const gaspi_atomic_value_t val_add,
-			gaspi_atomic_value_t * const val_old,
-			const gaspi_timeout_t timeout_ms)
+gaspi_atomic_post (const gaspi_rank_t rank, const unsigned long remote_addr,
+		   const unsigned int rkey, const enum ibv_wr_opcode opcode,
+		   const gaspi_atomic_value_t compare_add,
+		   const gaspi_atomic_value_t swap,
+		   gaspi_atomic_value_t * const val_old,
+		   const gaspi_timeout_t timeout_ms)
 {
-#ifdef DEBUG
-  if (glb_gaspi_ctx_ib.rrmd[segment_id] == NULL)
-    {
-      gaspi_print_error("Invalid segment (gaspi_atomic_fetch_add)");    
-      return GASPI_ERROR;
-    }
-  
-  if( rank >= glb_gaspi_ctx.tnc)
-    {
-      gaspi_print_error("Invalid rank (gaspi_atomic_fetch_add)");    
-      return GASPI_ERROR;
-    }
-  
-  if( offset > glb_gaspi_ctx_ib.rrmd[segment_id][rank].size)
-    {
-      gaspi_print_error("Invalid offsets (gaspi_atomic_fetch_add)");    
-      return GASPI_ERROR;
-    }
-
-  if( val_old == NULL)
-    {
-      gaspi_print_error("Invalid pointer in parameter val_old (gaspi_atomic_fetch_add)");    
-      return GASPI_ERROR;
-    }
-
-  if(timeout_ms < GASPI_TEST || timeout_ms > GASPI_BLOCK)
-    {
-      gaspi_print_error("Invalid timeout: %lu", timeout_ms);
-      return GASPI_ERROR;
-    }
-
-#endif
-  
   struct ibv_send_wr *bad_wr;
   struct ibv_sge slist;
   struct ibv_send_wr swr;
   int i;
 
-  if (offset & 0x7)
-    {
-      gaspi_print_error("Unaligned offset for atomic operation (fetch_add)");
-      return GASPI_ERROR;
-    }
-  
   if(lock_gaspi_tout (&glb_gaspi_group_ib[0].gl, timeout_ms))
     return GASPI_TIMEOUT;
-  
 
   slist.addr = (uintptr_t) (glb_gaspi_group_ib[0].buf + NEXT_OFFSET);
   slist.length = 8;
   slist.lkey = glb_gaspi_group_ib[0].mr->lkey;
 
-  swr.wr.atomic.remote_addr =
-    glb_gaspi_ctx_ib.rrmd[segment_id][rank].addr + NOTIFY_OFFSET + offset;
-
-
-
-  swr.wr.atomic.rkey = glb_gaspi_ctx_ib.rrmd[segment_id][rank].rkey;
-  swr.wr.atomic.compare_add = val_add;
+  swr.wr.atomic.remote_addr = remote_addr;
+  swr.wr.atomic.rkey = rkey;
+  swr.wr.atomic.compare_add = compare_add;
+  swr.wr.atomic.swap = swap;
 
   swr.wr_id = rank;
   swr.sg_list = &slist;
   swr.num_sge = 1;
-  swr.opcode = IBV_WR_ATOMIC_FETCH_AND_ADD;
+  swr.opcode = opcode;
   swr.send_flags = IBV_SEND_SIGNALED;
   swr.next = NULL;
 
-  if (ibv_post_send (glb_gaspi_ctx_ib.qpGroups[rank], &swr, &bad_wr))
+  if (ibv_post_send (glb_gaspi_ctx_ib.peer[rank]->qpGroup, &swr, &bad_wr))
     {
       glb_gaspi_ctx.qp_state_vec[GASPI_COLL_QP][rank] = 1;
       unlock_gaspi (&glb_gaspi_group_ib[0].gl);
@@ -137,7 +96,67 @@ pgaspi_atomic_fetch_add (const gaspi_segment_id_t segment_id,
 
   unlock_gaspi (&glb_gaspi_group_ib[0].gl);
   return GASPI_SUCCESS;
+}
+
+#pragma weak gaspi_atomic_fetch_add      = pgaspi_atomic_fetch_add
+gaspi_return_t
+pgaspi_atomic_fetch_add (const gaspi_segment_id_t segment_id,
+			const gaspi_offset_t offset, const gaspi_rank_t rank,
+			const gaspi_atomic_value_t val_add,
+			gaspi_atomic_value_t * const val_old,
+			const gaspi_timeout_t timeout_ms)
+{
+
+#ifdef DEBUG
+  if( rank >= glb_gaspi_ctx.tnc)
+    {
+      gaspi_print_error("Invalid rank (gaspi_atomic_fetch_add)");    
+      return GASPI_ERROR;
+    }
+  
+  if( val_old == NULL)
+    {
+      gaspi_print_error("Invalid pointer in parameter val_old (gaspi_atomic_fetch_add)");    
+      return GASPI_ERROR;
+    }
+
+  if(timeout_ms < GASPI_TEST || timeout_ms > GASPI_BLOCK)
+    {
+      gaspi_print_error("Invalid timeout: %lu", timeout_ms);
+      return GASPI_ERROR;
+    }
+
+#endif
+
+  if (offset & 0x7)
+    {
+      gaspi_print_error("Unaligned offset for atomic operation (fetch_add)");
+      return GASPI_ERROR;
+    }
+
+  const gaspi_return_t eret = gaspi_segment_remote (segment_id, rank, timeout_ms);
+  if(eret != GASPI_SUCCESS)
+    return eret;
 
+#ifdef DEBUG
+  if (glb_gaspi_ctx_ib.rrmd[segment_id] == NULL)
+    {
+      gaspi_print_error("Invalid segment (gaspi_atomic_fetch_add)");    
+      return GASPI_ERROR;
+    }
+
+  if( offset > glb_gaspi_ctx_ib.rrmd[segment_id][rank].size)
+    {
+      gaspi_print_error("Invalid offsets (gaspi_atomic_fetch_add)");    
+      return GASPI_ERROR;
+    }
+#endif
+
+  return gaspi_atomic_post (rank,
+			    glb_gaspi_ctx_ib.rrmd[segment_id][rank].addr + offset,
+			    glb_gaspi_ctx_ib.rrmd[segment_id][rank].rkey,
+			    IBV_WR_ATOMIC_FETCH_AND_ADD, val_add, 0,
+			    val_old, timeout_ms);
 }
 
 #pragma weak gaspi_atomic_compare_swap = pgaspi_atomic_compare_swap
@@ -152,24 +171,12 @@ pgaspi_atomic_compare_swap (const gaspi_segment_id_t segment_id,
 {
 
 #ifdef DEBUG
-  if (glb_gaspi_ctx_ib.rrmd[segment_id] == NULL)
-    {
-      gaspi_print_error("Invalid segment (gaspi_atomic_compare_swap)");    
-      return GASPI_ERROR;
-    }
-  
   if( rank >= glb_gaspi_ctx.tnc)
     {
       gaspi_print_error("Invalid rank (gaspi_atomic_compare_swap)");    
       return GASPI_ERROR;
     }
   
-  if( offset > glb_gaspi_ctx_ib.rrmd[segment_id][rank].size)
-    {
-      gaspi_print_error("Invalid offsets (gaspi_atomic_compare_swap)");    
-      return GASPI_ERROR;
-    }
-
   if( val_old == NULL)
     {
       gaspi_print_error("Invalid pointer in parameter val_old (gaspi_atomic_compare_swap)");    
@@ -183,11 +190,6 @@ pgaspi_atomic_compare_swap (const gaspi_segment_id_t segment_id,
     }
 
 #endif
-  
-  struct ibv_send_wr *bad_wr;
-  struct ibv_sge slist;
-  struct ibv_send_wr swr;
-  int i;
 
   if (offset & 0x7)
     {
@@ -195,69 +197,27 @@ pgaspi_atomic_compare_swap (const gaspi_segment_id_t segment_id,
       return GASPI_ERROR;
     }
 
-  if(lock_gaspi_tout (&glb_gaspi_group_ib[0].gl, timeout_ms))
-    return GASPI_TIMEOUT;
-
-  slist.addr = (uintptr_t) (glb_gaspi_group_ib[0].buf + NEXT_OFFSET);
-
-  slist.length = 8;
-  slist.lkey = glb_gaspi_group_ib[0].mr->lkey;
-
-  swr.wr.atomic.remote_addr =
-    glb_gaspi_ctx_ib.rrmd[segment_id][rank].addr + NOTIFY_OFFSET + offset;
+  const gaspi_return_t eret = gaspi_segment_remote (segment_id, rank, timeout_ms);
+  if(eret != GASPI_SUCCESS)
+    return eret;
 
-  swr.wr.atomic.rkey = glb_gaspi_ctx_ib.rrmd[segment_id][rank].rkey;
-  swr.wr.atomic.compare_add = comparator;
-  swr.wr.atomic.swap = val_new;
-
-  swr.wr_id = rank;
-  swr.sg_list = &slist;
-  swr.num_sge = 1;
-  swr.opcode = IBV_WR_ATOMIC_CMP_AND_SWP;
-  swr.send_flags = IBV_SEND_SIGNALED;
-  swr.next = NULL;
-
-  if (ibv_post_send (glb_gaspi_ctx_ib.qpGroups[rank], &swr, &bad_wr))
+#ifdef DEBUG
+  if (glb_gaspi_ctx_ib.rrmd[segment_id] == NULL)
     {
-      glb_gaspi_ctx.qp_state_vec[GASPI_COLL_QP][rank] = 1;
-      unlock_gaspi (&glb_gaspi_group_ib[0].gl);
+      gaspi_print_error("Invalid segment (gaspi_atomic_compare_swap)");    
       return GASPI_ERROR;
     }
 
-  glb_gaspi_ctx_ib.ne_count_grp++;
-
-
-  int ne = 0;
-  for (i = 0; i < glb_gaspi_ctx_ib.ne_count_grp; i++)
+  if( offset > glb_gaspi_ctx_ib.rrmd[segment_id][rank].size)
     {
-      do
-	{
-	  ne =
-	    ibv_poll_cq (glb_gaspi_ctx_ib.scqGroups, 1,
-			 glb_gaspi_ctx_ib.wc_grp_send);
-
-	}
-      while (ne == 0);
-
-      if ((ne < 0)
-	  || (glb_gaspi_ctx_ib.wc_grp_send[i].status != IBV_WC_SUCCESS))
-	{
-	  glb_gaspi_ctx.
-	    qp_state_vec[GASPI_COLL_QP][glb_gaspi_ctx_ib.wc_grp_send[i].
-					wr_id] = 1;
-	  unlock_gaspi (&glb_gaspi_group_ib[0].gl);
- 	  gaspi_print_error("Failed request to %lu : %s",
-		       glb_gaspi_ctx_ib.wc_grp_send[i].wr_id, 
-		       ibv_wc_status_str(glb_gaspi_ctx_ib.wc_grp_send[i].status));
-	  return GASPI_ERROR;
-	}
+      gaspi_print_error("Invalid offsets (gaspi_atomic_compare_swap)");    
+      return GASPI_ERROR;
     }
+#endif
 
-  glb_gaspi_ctx_ib.ne_count_grp = 0;
-  *val_old =
-    *((gaspi_atomic_value_t *) (glb_gaspi_group_ib[0].buf + NEXT_OFFSET));
-
-  unlock_gaspi (&glb_gaspi_group_ib[0].gl);
-  return GASPI_SUCCESS;
-
+  return gaspi_atomic_post (rank,
+			    glb_gaspi_ctx_ib.rrmd[segment_id][rank].addr + offset,
+			    glb_gaspi_ctx_ib.rrmd[segment_id][rank].rkey,
+			    IBV_WR_ATOMIC_CMP_AND_SWP, comparator, val_new,
+			    val_old, timeout_ms);
 }
@@ -15,14 +15,80 @@ GNU General Public License for more details.
 You should have received a copy of the GNU General Public License
 along with GPI-2. If not, see <http://www.gnu.org/licenses/>.
 */
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#if defined(__x86_64__) && !defined(MIC)
+#include <immintrin.h>
+#define GASPI_HALF_F16C 1
+#endif
+
 #include "GPI2.h"
 #include "GASPI.h"
 #include "GPI2_IB.h"
 
+extern gaspi_config_t glb_gaspi_cfg;
+
+static gaspi_return_t _gaspi_allreduce_repro (const gaspi_pointer_t buf_send,
+					      gaspi_pointer_t const buf_recv,
+					      const gaspi_number_t elem_cnt,
+					      const gaspi_datatype_t type,
+					      const gaspi_group_t g,
+					      const gaspi_timeout_t timeout_ms);
+
+
+#define GASPI_TYPES (8)
+
+const unsigned int glb_gaspi_typ_size[GASPI_TYPES] = { 4, 4, 4, 8, 8, 8, 2, 2 };
+void (*fctArrayGASPI[3 * GASPI_TYPES]) (void *, void *, void *, const unsigned char cnt) ={NULL};
+
+
+/* Post the barrier flag of the current round (mask) to the peer,
+   connecting to it first if needed */
+static gaspi_return_t
+_gaspi_barrier_post (const gaspi_group_t g, const int mask,
+		     const gaspi_timeout_t timeout_ms)
+{
+  struct ibv_sge slist;
+  struct ibv_send_wr swr;
+  struct ibv_send_wr *bad_wr_send;
+
+  const int size = glb_gaspi_group_ib[g].tnc;
+  const int rank = glb_gaspi_group_ib[g].rank;
+  const int pairwise = (glb_gaspi_group_ib[g].barrier_alg == GASPI_BARRIER_PAIRWISE);
+  const int idx = pairwise ? (rank ^ mask) : (rank + mask) % size;
+  const int dst = glb_gaspi_group_ib[g].rank_grp[idx];
+
+  slist.addr = (uintptr_t) (glb_gaspi_group_ib[g].buf + 2 * size + glb_gaspi_group_ib[g].togle);
+  slist.length = 1;
+  slist.lkey = glb_gaspi_group_ib[g].mr->lkey;
+
+  swr.sg_list = &slist;
+  swr.num_sge = 1;
+  swr.opcode = IBV_WR_RDMA_WRITE;
+  swr.send_flags = IBV_SEND_SIGNALED | IBV_SEND_INLINE;
+  swr.next = NULL;
+  swr.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[idx].vaddrGroup + (2 * rank + glb_gaspi_group_ib[g].togle);
+  swr.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[idx].rkeyGroup;
+  swr.wr_id = dst;
+
+  const gaspi_return_t eret = gaspi_connect_remote(dst, timeout_ms);
+  if (eret == GASPI_TIMEOUT)
+    return GASPI_TIMEOUT;
+
+  if (eret != GASPI_SUCCESS
+      || ibv_post_send (glb_gaspi_ctx_ib.peer[dst]->qpGroup, &swr, &bad_wr_send))
+    {
+      glb_gaspi_ctx.qp_state_vec[GASPI_COLL_QP][dst] = 1;
+      gaspi_print_error("Failed to post request to %u for barrier (%d)",
+			dst,glb_gaspi_ctx_ib.ne_count_grp);
+      return GASPI_ERROR;
+    }
 
-const unsigned int glb_gaspi_typ_size[6] = { 4, 4, 4, 8, 8, 8 };
-void (*fctArrayGASPI[18]) (void *, void *, void *, const unsigned char cnt) ={NULL};
+  glb_gaspi_ctx_ib.ne_count_grp++;
 
+  return GASPI_SUCCESS;
+}
 
 #pragma weak gaspi_barrier      = pgaspi_barrier
 gaspi_return_t
@@ -36,7 +102,7 @@ pgaspi_barrier (const gaspi_group_t g, const gaspi_timeout_t timeout_ms)
       return GASPI_ERROR;
     }
   
-  if (g >= GASPI_MAX_GROUPS || glb_gaspi_group_ib[g].id < 0 )
+  if (g >= glb_gaspi_cfg.group_max || glb_gaspi_group_ib[g].id < 0 )
     {
       gaspi_print_error("Invalid group %u (gaspi_barrier)", g);
       return GASPI_ERROR;
@@ -50,10 +116,8 @@ pgaspi_barrier (const gaspi_group_t g, const gaspi_timeout_t timeout_ms)
 
 #endif  
 
-  struct ibv_sge slist;
-  struct ibv_send_wr swr;
-  struct ibv_send_wr *bad_wr_send;
   int i,index;
+  gaspi_return_t eret;
 
   if(lock_gaspi_tout (&glb_gaspi_group_ib[g].gl, timeout_ms))
     {
@@ -87,40 +151,31 @@ pgaspi_barrier (const gaspi_group_t g, const gaspi_timeout_t timeout_ms)
   int mask = glb_gaspi_group_ib[g].lastmask&0x7fffffff;
   int jmp = glb_gaspi_group_ib[g].lastmask>>31;
 
-  slist.addr = (uintptr_t) barrier_ptr;
-  slist.length = 1;
-  slist.lkey = glb_gaspi_group_ib[g].mr->lkey;
-
-  swr.sg_list = &slist;
-  swr.num_sge = 1;
-  swr.opcode = IBV_WR_RDMA_WRITE;
-  swr.send_flags = IBV_SEND_SIGNALED | IBV_SEND_INLINE;
-  swr.next = NULL;
-
   const gaspi_cycles_t s0 = gaspi_get_cycles();
 
+  const int pairwise = (glb_gaspi_group_ib[g].barrier_alg == GASPI_BARRIER_PAIRWISE);
+
   while (mask < size)
     {
       
-      const int dst = glb_gaspi_group_ib[g].rank_grp[(rank + mask) % size];
-      const int src = (rank - mask + size) % size;
+      const int src = pairwise ? (rank ^ mask) : (rank - mask + size) % size;
       if(jmp){jmp=0;goto B0;}
-      swr.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[dst].vaddrGroup + (2 * rank + glb_gaspi_group_ib[g].togle);
-      swr.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[dst].rkeyGroup;
-      swr.wr_id = dst;
 
-      if (ibv_post_send (glb_gaspi_ctx_ib.qpGroups[dst], &swr, &bad_wr_send))
+      eret = _gaspi_barrier_post (g, mask, timeout_ms);
+      if (eret != GASPI_SUCCESS)
 	{
-	  
-	  glb_gaspi_ctx.qp_state_vec[GASPI_COLL_QP][dst] = 1;
+	  //not posted: the round is redone, a fresh barrier started again
+	  if (eret == GASPI_TIMEOUT)
+	    {
+	      if (mask == 0x1)
+		glb_gaspi_group_ib[g].barrier_cnt--;
+	      glb_gaspi_group_ib[g].lastmask = mask;
+	    }
+
 	  unlock_gaspi (&glb_gaspi_group_ib[g].gl);
-	  gaspi_print_error("Failed to post request to %u for barrier (%d)",
-			    dst,glb_gaspi_ctx_ib.ne_count_grp);
-	  return GASPI_ERROR;
+	  return eret;
 	}
 
-      glb_gaspi_ctx_ib.ne_count_grp++;
-
     B0:
       index = 2 * src + glb_gaspi_group_ib[g].togle;
 
@@ -177,7 +232,287 @@ pgaspi_barrier (const gaspi_group_t g, const gaspi_timeout_t timeout_ms)
   return GASPI_SUCCESS;
 }
 
+#pragma weak gaspi_barrier_begin = pgaspi_barrier_begin
+gaspi_return_t
+pgaspi_barrier_begin (const gaspi_group_t g)
+{
 
+#ifdef DEBUG
+  if (!glb_gaspi_init)
+    {
+      gaspi_print_error("called gaspi_barrier_begin but GPI-2 is not initialized");
+      return GASPI_ERROR;
+    }
+
+  if (g >= glb_gaspi_cfg.group_max || glb_gaspi_group_ib[g].id < 0 )
+    {
+      gaspi_print_error("Invalid group %u (gaspi_barrier_begin)", g);
+      return GASPI_ERROR;
+    }
+#endif
+
+  lock_gaspi_tout (&glb_gaspi_group_ib[g].gl, GASPI_BLOCK);
+
+  //other collectives or a barrier already active ?
+  if(!(glb_gaspi_group_ib[g].coll_op & GASPI_BARRIER)
+     || glb_gaspi_group_ib[g].lastmask != 0x1)
+    {
+      unlock_gaspi (&glb_gaspi_group_ib[g].gl);
+      gaspi_print_error("Barrier begin: other coll. or barrier are active");
+      return GASPI_ERROR;
+    }
+
+  glb_gaspi_group_ib[g].coll_op = GASPI_BARRIER;
+  glb_gaspi_group_ib[g].barrier_cnt++;
+
+  const int size = glb_gaspi_group_ib[g].tnc;
+  unsigned char *barrier_ptr = glb_gaspi_group_ib[g].buf + 2 * size + glb_gaspi_group_ib[g].togle;
+  barrier_ptr[0] = glb_gaspi_group_ib[g].barrier_cnt;
+
+  //first round only, the rest is driven by gaspi_barrier_end
+  if (size > 1 && _gaspi_barrier_post (g, 0x1, GASPI_BLOCK) != GASPI_SUCCESS)
+    {
+      unlock_gaspi (&glb_gaspi_group_ib[g].gl);
+      return GASPI_ERROR;
+    }
+
+  glb_gaspi_group_ib[g].lastmask = 0x1|0x80000000;
+
+  unlock_gaspi (&glb_gaspi_group_ib[g].gl);
+
+  return GASPI_SUCCESS;
+}
+
+#pragma weak gaspi_barrier_end = pgaspi_barrier_end
+gaspi_return_t
+pgaspi_barrier_end (const gaspi_group_t g, const gaspi_timeout_t timeout_ms)
+{
+#ifdef DEBUG
+  if (g >= glb_gaspi_cfg.group_max || glb_gaspi_group_ib[g].id < 0 )
+    {
+      gaspi_print_error("Invalid group %u (gaspi_barrier_end)", g);
+      return GASPI_ERROR;
+    }
+#endif
+
+  if(lock_gaspi_tout (&glb_gaspi_group_ib[g].gl, timeout_ms))
+    {
+      return GASPI_TIMEOUT;
+    }
+
+  //no barrier begun (or other coll. active) ?
+  if(glb_gaspi_group_ib[g].coll_op != GASPI_BARRIER
+     || glb_gaspi_group_ib[g].lastmask == 0x1)
+    {
+      unlock_gaspi (&glb_gaspi_group_ib[g].gl);
+      gaspi_print_error("Barrier end: no barrier begun");
+      return GASPI_ERROR;
+    }
+
+  unlock_gaspi (&glb_gaspi_group_ib[g].gl);
+
+  //resumes the rounds started by gaspi_barrier_begin
+  return pgaspi_barrier (g, timeout_ms);
+}
+
+/* Allgather of bsize bytes (up to GASPI_GATHER_BLOCK) per member of
+   a group (Bruck): in the round with mask, the first
+   min(mask, size - mask) records are written to the member mask ranks
+   below, so that after log2(size) rounds slot j holds the record of
+   the member j ranks above. Runs over the collective QPs with the
+   barrier flags, resumes after a timeout like gaspi_barrier. On
+   success *gathered points to the slots, which stay valid until the
+   next collective on the group */
+gaspi_return_t
+gaspi_group_allgather (const gaspi_group_t g, const void *const local,
+		       const int bsize, unsigned char **const gathered,
+		       const gaspi_timeout_t timeout_ms)
+{
+  struct ibv_send_wr *bad_wr_send;
+  struct ibv_sge slist, slistN;
+  struct ibv_send_wr swr, swrN;
+  gaspi_return_t eret;
+  int i;
+
+  if(lock_gaspi_tout (&glb_gaspi_group_ib[g].gl, timeout_ms))
+    {
+      return GASPI_TIMEOUT;
+    }
+
+  //other collectives active ?
+  if(!(glb_gaspi_group_ib[g].coll_op & GASPI_ALLGATHER))
+    {
+      unlock_gaspi (&glb_gaspi_group_ib[g].gl);
+      gaspi_print_error("allgather: other coll. are active !\n");
+      return GASPI_ERROR;
+    }
+
+  glb_gaspi_group_ib[g].coll_op = GASPI_ALLGATHER;
+
+  const int size = glb_gaspi_group_ib[g].tnc;
+  const int rank = glb_gaspi_group_ib[g].rank;
+
+  unsigned char *gather = glb_gaspi_group_ib[g].buf + glb_gaspi_group_ib[g].coll_gather
+    + glb_gaspi_group_ib[g].togle * size * bsize;
+
+  if(glb_gaspi_group_ib[g].lastmask == 0x1)
+    {
+      glb_gaspi_group_ib[g].barrier_cnt++;
+      memcpy (gather, local, bsize);
+    }
+
+  unsigned char *barrier_ptr = glb_gaspi_group_ib[g].buf + 2 * size + glb_gaspi_group_ib[g].togle;
+  barrier_ptr[0] = glb_gaspi_group_ib[g].barrier_cnt;
+
+  volatile unsigned char *poll_buf = (volatile unsigned char *) (glb_gaspi_group_ib[g].buf);
+
+  slist.addr = (uintptr_t) gather;
+  slist.lkey = glb_gaspi_group_ib[g].mr->lkey;
+
+  swr.sg_list = &slist;
+  swr.num_sge = 1;
+  swr.opcode = IBV_WR_RDMA_WRITE;
+  swr.send_flags = IBV_SEND_SIGNALED;
+  swr.next = &swrN;
+
+  slistN.addr = (uintptr_t) barrier_ptr;
+  slistN.length = 1;
+  slistN.lkey = glb_gaspi_group_ib[g].mr->lkey;
+
+  swrN.sg_list = &slistN;
+  swrN.num_sge = 1;
+  swrN.opcode = IBV_WR_RDMA_WRITE;
+  swrN.send_flags = IBV_SEND_SIGNALED | IBV_SEND_INLINE;
+  swrN.next = NULL;
+
+  int mask = glb_gaspi_group_ib[g].lastmask&0x7fffffff;
+  int jmp = glb_gaspi_group_ib[g].lastmask>>31;
+
+  const gaspi_cycles_t s0 = gaspi_get_cycles();
+
+  while (mask < size)
+    {
+      const int idx = (rank - mask + size) % size;
+      const int dst = glb_gaspi_group_ib[g].rank_grp[idx];
+      const int src = (rank + mask) % size;
+      if(jmp){jmp=0;goto G0;}
+
+      slist.length = MIN (mask, size - mask) * bsize;
+
+      swr.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[idx].vaddrGroup + glb_gaspi_group_ib[g].coll_gather
+	+ (glb_gaspi_group_ib[g].togle * size + mask) * bsize;
+      swr.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[idx].rkeyGroup;
+      swr.wr_id = dst;
+      swrN.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[idx].vaddrGroup + (2 * rank + glb_gaspi_group_ib[g].togle);
+      swrN.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[idx].rkeyGroup;
+      swrN.wr_id = dst;
+
+      eret = gaspi_connect_remote(dst, timeout_ms);
+      if (eret == GASPI_TIMEOUT)
+	{
+	  if (mask == 0x1)
+	    glb_gaspi_group_ib[g].barrier_cnt--;
+	  glb_gaspi_group_ib[g].lastmask = mask;
+	  unlock_gaspi (&glb_gaspi_group_ib[g].gl);
+
+	  return GASPI_TIMEOUT;
+	}
+
+      if (eret != GASPI_SUCCESS
+	  || ibv_post_send (glb_gaspi_ctx_ib.peer[dst]->qpGroup, &swr, &bad_wr_send))
+	{
+	  glb_gaspi_ctx.qp_state_vec[GASPI_COLL_QP][dst] = 1;
+	  unlock_gaspi (&glb_gaspi_group_ib[g].gl);
+
+	  gaspi_print_error("Failed to post request to %u for segment allgather", dst);
+	  return GASPI_ERROR;
+	}
+
+      glb_gaspi_ctx_ib.ne_count_grp += 2;
+
+    G0:
+      while (poll_buf[2 * src + glb_gaspi_group_ib[g].togle] != glb_gaspi_group_ib[g].barrier_cnt)
+	{
+	  const gaspi_cycles_t s1 = gaspi_get_cycles();
+	  const gaspi_cycles_t tdelta = s1 - s0;
+	  const float ms = (float) tdelta * glb_gaspi_ctx.cycles_to_msecs;
+
+	  if(ms > timeout_ms)
+	    {
+	      glb_gaspi_group_ib[g].lastmask = mask|0x80000000;
+	      unlock_gaspi (&glb_gaspi_group_ib[g].gl);
+
+	      return GASPI_TIMEOUT;
+	    }
+	}
+
+      mask <<= 1;
+    }
+
+  const int pret = ibv_poll_cq (glb_gaspi_ctx_ib.scqGroups, glb_gaspi_ctx_ib.ne_count_grp, glb_gaspi_ctx_ib.wc_grp_send);
+
+  if (pret < 0)
+    {
+      for (i = 0; i < glb_gaspi_ctx_ib.ne_count_grp; i++)
+	{
+	  if (glb_gaspi_ctx_ib.wc_grp_send[i].status != IBV_WC_SUCCESS)
+	    {
+	      glb_gaspi_ctx.qp_state_vec[GASPI_COLL_QP][glb_gaspi_ctx_ib.wc_grp_send[i].wr_id] = 1;
+	    }
+	}
+
+      unlock_gaspi (&glb_gaspi_group_ib[g].gl);
+
+      gaspi_print_error("Failed request to %lu. Collectives queue might be broken",
+			glb_gaspi_ctx_ib.wc_grp_send[i].wr_id);
+      return GASPI_ERROR;
+    }
+
+  glb_gaspi_ctx_ib.ne_count_grp -= pret;
+
+  glb_gaspi_group_ib[g].togle = (glb_gaspi_group_ib[g].togle ^ 0x1);
+  glb_gaspi_group_ib[g].coll_op = GASPI_NONE;
+  glb_gaspi_group_ib[g].lastmask = 0x1;
+
+  unlock_gaspi (&glb_gaspi_group_ib[g].gl);
+
+  *gathered = gather;
+
+  return GASPI_SUCCESS;
+}
+
+/* Allgather of the local descriptor of a segment among the members
+   of a group */
+gaspi_return_t
+gaspi_segment_allgather (const gaspi_segment_id_t segment_id,
+			 const gaspi_group_t g, const gaspi_timeout_t timeout_ms)
+{
+  int i;
+  unsigned char *gather;
+
+  const int size = glb_gaspi_group_ib[g].tnc;
+  const int rank = glb_gaspi_group_ib[g].rank;
+  const int bsize = sizeof (gaspi_rc_mseg);
+
+  const gaspi_return_t eret =
+    gaspi_group_allgather (g, &glb_gaspi_ctx_ib.rrmd[segment_id][glb_gaspi_ctx.rank],
+			   bsize, &gather, timeout_ms);
+  if (eret != GASPI_SUCCESS)
+    return eret;
+
+  //slot j holds the descriptor of member rank + j
+  lock_gaspi_tout (&gaspi_mseg_lock, GASPI_BLOCK);
+
+  for (i = 1; i < size; i++)
+    {
+      const int r = glb_gaspi_group_ib[g].rank_grp[(rank + i) % size];
+      memcpy (&glb_gaspi_ctx_ib.rrmd[segment_id][r], gather + i * bsize, bsize);
+    }
+
+  unlock_gaspi (&gaspi_mseg_lock);
+
+  return GASPI_SUCCESS;
+}
 
 
 
@@ -518,7 +853,231 @@ opSumULongGASPI (void *res, void *localVal, void *dstVal,
 
   for (i = 0; i < cnt; i++)
     {
-      *rv = *lv + *dv;
+      *rv = *lv + *dv;
+      lv++;
+      dv++;
+      rv++;
+    }
+}
+
+/* 16-bit floating point types: operands are converted to float,
+   combined in single precision and rounded back (nearest even) */
+static inline float
+_gaspi_half_to_float (const uint16_t h)
+{
+  union { uint32_t u; float f; } v;
+  const uint32_t sign = (uint32_t) (h & 0x8000) << 16;
+  const uint32_t exp = (h >> 10) & 0x1f;
+  const uint32_t mant = h & 0x3ff;
+
+  if (exp == 0x1f)
+    v.u = sign | 0x7f800000 | (mant << 13);
+  else if (exp == 0)
+    {
+      //zero or subnormal: mant * 2^-24
+      v.f = (float) mant * (1.0f / 16777216.0f);
+      v.u |= sign;
+    }
+  else
+    v.u = sign | ((exp + 112) << 23) | (mant << 13);
+
+  return v.f;
+}
+
+static inline uint16_t
+_gaspi_float_to_half (const float f)
+{
+  union { uint32_t u; float f; } v, magic;
+  uint16_t h;
+
+  v.f = f;
+  const uint32_t sign = v.u & 0x80000000;
+  v.u ^= sign;
+
+  if (v.u >= (143 << 23))
+    {
+      //overflow, inf or nan
+      h = (v.u > 0x7f800000) ? 0x7e00 : 0x7c00;
+    }
+  else if (v.u < (113 << 23))
+    {
+      //subnormal or zero
+      magic.u = 126 << 23;
+      v.f += magic.f;
+      h = v.u - magic.u;
+    }
+  else
+    {
+      const uint32_t mant_odd = (v.u >> 13) & 1;
+      v.u += ((uint32_t) (15 - 127) << 23) + 0xfff + mant_odd;
+      h = v.u >> 13;
+    }
+
+  return h | (sign >> 16);
+}
+
+#ifdef GASPI_HALF_F16C
+/* Sum of the leading multiple of 8 elements with the F16C
+   conversions, for CPUs that have them (checked at run time) */
+__attribute__ ((target ("avx,f16c"))) static unsigned char
+_gaspi_sum_half_f16c (uint16_t *rv, const uint16_t *lv, const uint16_t *dv,
+		      const unsigned char cnt)
+{
+  unsigned char i;
+
+  for (i = 0; i + 8 <= cnt; i += 8)
+    {
+      const __m256 l = _mm256_cvtph_ps (_mm_loadu_si128 ((const __m128i *) (lv + i)));
+      const __m256 d = _mm256_cvtph_ps (_mm_loadu_si128 ((const __m128i *) (dv + i)));
+
+      _mm_storeu_si128 ((__m128i *) (rv + i),
+			_mm256_cvtps_ph (_mm256_add_ps (l, d), _MM_FROUND_TO_NEAREST_INT));
+    }
+
+  return i;
+}
+#endif
+
+static inline float
+_gaspi_bf16_to_float (const uint16_t b)
+{
+  union { uint32_t u; float f; } v;
+
+  v.u = (uint32_t) b << 16;
+  return v.f;
+}
+
+static inline uint16_t
+_gaspi_float_to_bf16 (const float f)
+{
+  union { uint32_t u; float f; } v;
+
+  v.f = f;
+  if ((v.u & 0x7fffffff) > 0x7f800000)
+    return (v.u >> 16) | 0x40;
+
+  v.u += 0x7fff + ((v.u >> 16) & 1);
+  return v.u >> 16;
+}
+
+void
+opMinHalfGASPI (void *res, void *localVal, void *dstVal,
+		const unsigned char cnt)
+{
+  unsigned char i;
+
+  uint16_t *rv = (uint16_t *) res;
+  uint16_t *lv = (uint16_t *) localVal;
+  uint16_t *dv = (uint16_t *) dstVal;
+
+  for (i = 0; i < cnt; i++)
+    {
+      *rv = (_gaspi_half_to_float (*lv) < _gaspi_half_to_float (*dv)) ? *lv : *dv;
+      lv++;
+      dv++;
+      rv++;
+    }
+}
+
+void
+opMaxHalfGASPI (void *res, void *localVal, void *dstVal,
+		const unsigned char cnt)
+{
+  unsigned char i;
+
+  uint16_t *rv = (uint16_t *) res;
+  uint16_t *lv = (uint16_t *) localVal;
+  uint16_t *dv = (uint16_t *) dstVal;
+
+  for (i = 0; i < cnt; i++)
+    {
+      *rv = (_gaspi_half_to_float (*lv) > _gaspi_half_to_float (*dv)) ? *lv : *dv;
+      lv++;
+      dv++;
+      rv++;
+    }
+}
+
+void
+opSumHalfGASPI (void *res, void *localVal, void *dstVal,
+		const unsigned char cnt)
+{
+  unsigned char i = 0;
+
+  uint16_t *rv = (uint16_t *) res;
+  uint16_t *lv = (uint16_t *) localVal;
+  uint16_t *dv = (uint16_t *) dstVal;
+
+#ifdef GASPI_HALF_F16C
+  if (__builtin_cpu_supports ("f16c"))
+    {
+      i = _gaspi_sum_half_f16c (rv, lv, dv, cnt);
+      lv += i;
+      dv += i;
+      rv += i;
+    }
+#endif
+
+  for (; i < cnt; i++)
+    {
+      *rv = _gaspi_float_to_half (_gaspi_half_to_float (*lv) + _gaspi_half_to_float (*dv));
+      lv++;
+      dv++;
+      rv++;
+    }
+}
+
+void
+opMinBf16GASPI (void *res, void *localVal, void *dstVal,
+		const unsigned char cnt)
+{
+  unsigned char i;
+
+  uint16_t *rv = (uint16_t *) res;
+  uint16_t *lv = (uint16_t *) localVal;
+  uint16_t *dv = (uint16_t *) dstVal;
+
+  for (i = 0; i < cnt; i++)
+    {
+      *rv = (_gaspi_bf16_to_float (*lv) < _gaspi_bf16_to_float (*dv)) ? *lv : *dv;
+      lv++;
+      dv++;
+      rv++;
+    }
+}
+
+void
+opMaxBf16GASPI (void *res, void *localVal, void *dstVal,
+		const unsigned char cnt)
+{
+  unsigned char i;
+
+  uint16_t *rv = (uint16_t *) res;
+  uint16_t *lv = (uint16_t *) localVal;
+  uint16_t *dv = (uint16_t *) dstVal;
+
+  for (i = 0; i < cnt; i++)
+    {
+      *rv = (_gaspi_bf16_to_float (*lv) > _gaspi_bf16_to_float (*dv)) ? *lv : *dv;
+      lv++;
+      dv++;
+      rv++;
+    }
+}
+
+void
+opSumBf16GASPI (void *res, void *localVal, void *dstVal,
+		const unsigned char cnt)
+{
+  unsigned char i;
+
+  uint16_t *rv = (uint16_t *) res;
+  uint16_t *lv = (uint16_t *) localVal;
+  uint16_t *dv = (uint16_t *) dstVal;
+
+  for (i = 0; i < cnt; i++)
+    {
+      *rv = _gaspi_float_to_bf16 (_gaspi_bf16_to_float (*lv) + _gaspi_bf16_to_float (*dv));
       lv++;
       dv++;
       rv++;
@@ -529,82 +1088,48 @@ void
 gaspi_init_collectives ()
 {
 
-  fctArrayGASPI[0] = &opMinIntGASPI;
-  fctArrayGASPI[1] = &opMinUIntGASPI;
-  fctArrayGASPI[2] = &opMinFloatGASPI;
-  fctArrayGASPI[3] = &opMinDoubleGASPI;
-  fctArrayGASPI[4] = &opMinLongGASPI;
-  fctArrayGASPI[5] = &opMinULongGASPI;
-  fctArrayGASPI[6] = &opMaxIntGASPI;
-  fctArrayGASPI[7] = &opMaxUIntGASPI;
-  fctArrayGASPI[8] = &opMaxFloatGASPI;
-  fctArrayGASPI[9] = &opMaxDoubleGASPI;
-  fctArrayGASPI[10] = &opMaxLongGASPI;
-  fctArrayGASPI[11] = &opMaxULongGASPI;
-  fctArrayGASPI[12] = &opSumIntGASPI;
-  fctArrayGASPI[13] = &opSumIntGASPI;
-  fctArrayGASPI[14] = &opSumFloatGASPI;
-  fctArrayGASPI[15] = &opSumDoubleGASPI;
-  fctArrayGASPI[16] = &opSumLongGASPI;
-  fctArrayGASPI[17] = &opSumULongGASPI;
+  fctArrayGASPI[GASPI_OP_MIN * GASPI_TYPES + GASPI_TYPE_INT] = &opMinIntGASPI;
+  fctArrayGASPI[GASPI_OP_MIN * GASPI_TYPES + GASPI_TYPE_UINT] = &opMinUIntGASPI;
+  fctArrayGASPI[GASPI_OP_MIN * GASPI_TYPES + GASPI_TYPE_FLOAT] = &opMinFloatGASPI;
+  fctArrayGASPI[GASPI_OP_MIN * GASPI_TYPES + GASPI_TYPE_DOUBLE] = &opMinDoubleGASPI;
+  fctArrayGASPI[GASPI_OP_MIN * GASPI_TYPES + GASPI_TYPE_LONG] = &opMinLongGASPI;
+  fctArrayGASPI[GASPI_OP_MIN * GASPI_TYPES + GASPI_TYPE_ULONG] = &opMinULongGASPI;
+  fctArrayGASPI[GASPI_OP_MIN * GASPI_TYPES + GASPI_TYPE_HALF] = &opMinHalfGASPI;
+  fctArrayGASPI[GASPI_OP_MIN * GASPI_TYPES + GASPI_TYPE_BFLOAT16] = &opMinBf16GASPI;
+
+  fctArrayGASPI[GASPI_OP_MAX * GASPI_TYPES + GASPI_TYPE_INT] = &opMaxIntGASPI;
+  fctArrayGASPI[GASPI_OP_MAX * GASPI_TYPES + GASPI_TYPE_UINT] = &opMaxUIntGASPI;
+  fctArrayGASPI[GASPI_OP_MAX * GASPI_TYPES + GASPI_TYPE_FLOAT] = &opMaxFloatGASPI;
+  fctArrayGASPI[GASPI_OP_MAX * GASPI_TYPES + GASPI_TYPE_DOUBLE] = &opMaxDoubleGASPI;
+  fctArrayGASPI[GASPI_OP_MAX * GASPI_TYPES + GASPI_TYPE_LONG] = &opMaxLongGASPI;
+  fctArrayGASPI[GASPI_OP_MAX * GASPI_TYPES + GASPI_TYPE_ULONG] = &opMaxULongGASPI;
+  fctArrayGASPI[GASPI_OP_MAX * GASPI_TYPES + GASPI_TYPE_HALF] = &opMaxHalfGASPI;
+  fctArrayGASPI[GASPI_OP_MAX * GASPI_TYPES + GASPI_TYPE_BFLOAT16] = &opMaxBf16GASPI;
+
+  fctArrayGASPI[GASPI_OP_SUM * GASPI_TYPES + GASPI_TYPE_INT] = &opSumIntGASPI;
+  fctArrayGASPI[GASPI_OP_SUM * GASPI_TYPES + GASPI_TYPE_UINT] = &opSumUIntGASPI;
+  fctArrayGASPI[GASPI_OP_SUM * GASPI_TYPES + GASPI_TYPE_FLOAT] = &opSumFloatGASPI;
+  fctArrayGASPI[GASPI_OP_SUM * GASPI_TYPES + GASPI_TYPE_DOUBLE] = &opSumDoubleGASPI;
+  fctArrayGASPI[GASPI_OP_SUM * GASPI_TYPES + GASPI_TYPE_LONG] = &opSumLongGASPI;
+  fctArrayGASPI[GASPI_OP_SUM * GASPI_TYPES + GASPI_TYPE_ULONG] = &opSumULongGASPI;
+  fctArrayGASPI[GASPI_OP_SUM * GASPI_TYPES + GASPI_TYPE_HALF] = &opSumHalfGASPI;
+  fctArrayGASPI[GASPI_OP_SUM * GASPI_TYPES + GASPI_TYPE_BFLOAT16] = &opSumBf16GASPI;
 
 }
 
-#pragma weak gaspi_allreduce = pgaspi_allreduce
-gaspi_return_t
-pgaspi_allreduce (const gaspi_pointer_t buf_send,
+static gaspi_return_t
+_gaspi_allreduce (const gaspi_pointer_t buf_send,
 		  gaspi_pointer_t const buf_recv,
 		  const gaspi_number_t elem_cnt, const gaspi_operation_t op,
 		  const gaspi_datatype_t type, const gaspi_group_t g,
 		  const gaspi_timeout_t timeout_ms)
 {
-
-#ifdef DEBUG
-  if (!glb_gaspi_init)
-    {
-      gaspi_print_error("called gaspi_allreduce but GPI-2 is not initialized");
-      return GASPI_ERROR;
-    }
-
-  if(buf_send == NULL || buf_recv == NULL)
-    {
-      gaspi_print_error("Invalid buffers (gaspi_allreduce)");
-      return GASPI_ERROR;
-    }
-
-  if(elem_cnt > 255)
-    {
-      gaspi_print_error("Invalid number of elements: %u (gaspi_allreduce)", elem_cnt);
-      return GASPI_ERROR;
-    }
-
-  if(op > GASPI_OP_SUM || type > GASPI_TYPE_ULONG)
-    {
-      gaspi_print_error("Invalid number type or operation (gaspi_allreduce)");
-      return GASPI_ERROR;
-    }
-    
-  if (g >= GASPI_MAX_GROUPS || glb_gaspi_group_ib[g].id < 0 )
-    {
-      gaspi_print_error("Invalid group %u (gaspi_allreduce)", g);
-      return GASPI_ERROR;
-    }
-
-  if(timeout_ms < GASPI_TEST || timeout_ms > GASPI_BLOCK)
-    {
-      gaspi_print_error("Invalid timeout: %lu", timeout_ms);
-      return GASPI_ERROR;
-    }
-
-#endif  
-
-
-
   struct ibv_send_wr *bad_wr_send;
   struct ibv_sge slist, slistN;
   struct ibv_send_wr swr, swrN;
   int idst, dst, bid = 0;
   int i, mask, tmprank, tmpdst;
+  gaspi_return_t cret;
 
 
   if(lock_gaspi_tout (&glb_gaspi_group_ib[g].gl, timeout_ms))
@@ -628,6 +1153,11 @@ pgaspi_allreduce (const gaspi_pointer_t buf_send,
   if( glb_gaspi_group_ib[g].level==0 )
     {
       glb_gaspi_group_ib[g].barrier_cnt++;
+      glb_gaspi_group_ib[g].coll_alg = glb_gaspi_group_ib[g].allreduce_alg[gaspi_coll_bucket(dsize)];
+
+      //dissemination requires an idempotent operation
+      if(op == GASPI_OP_SUM)
+	glb_gaspi_group_ib[g].coll_alg = GASPI_ALLREDUCE_REC_DOUBLING;
     }
   
 
@@ -639,10 +1169,10 @@ pgaspi_allreduce (const gaspi_pointer_t buf_send,
 
   volatile unsigned char *poll_buf = (volatile unsigned char *) (glb_gaspi_group_ib[g].buf);
 
-  unsigned char *send_ptr = glb_gaspi_group_ib[g].buf + COLL_MEM_SEND + (glb_gaspi_group_ib[g].togle * 18 * 2048);
+  unsigned char *send_ptr = glb_gaspi_group_ib[g].buf + glb_gaspi_group_ib[g].coll_send + (glb_gaspi_group_ib[g].togle * glb_gaspi_group_ib[g].coll_slots * 2048);
   memcpy (send_ptr, buf_send, dsize);
 
-  unsigned char *recv_ptr = glb_gaspi_group_ib[g].buf + COLL_MEM_RECV;
+  unsigned char *recv_ptr = glb_gaspi_group_ib[g].buf + glb_gaspi_group_ib[g].coll_recv;
 
   const int rest = size - glb_gaspi_group_ib[g].next_pof2;
 
@@ -667,6 +1197,88 @@ pgaspi_allreduce (const gaspi_pointer_t buf_send,
 
   const gaspi_cycles_t s0 = gaspi_get_cycles();
 
+  if(glb_gaspi_group_ib[g].coll_alg == GASPI_ALLREDUCE_DISSEMINATION)
+    {
+      if(glb_gaspi_group_ib[g].level >= 2)
+	{
+	  bid = glb_gaspi_group_ib[g].bid;
+	  send_ptr += glb_gaspi_group_ib[g].dsize;
+	}
+
+      glb_gaspi_group_ib[g].level = 2;
+
+      mask = glb_gaspi_group_ib[g].lastmask&0x7fffffff;
+      int jmp = glb_gaspi_group_ib[g].lastmask>>31;
+
+      while (mask < size)
+	{
+
+	  dst = glb_gaspi_group_ib[g].rank_grp[(rank + mask) % size];
+	  idst = (rank - mask + size) % size;
+	  if(jmp){jmp=0;goto JD;}
+
+	  slist.addr = (uintptr_t) send_ptr;
+	  swr.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[(rank + mask) % size].vaddrGroup + (glb_gaspi_group_ib[g].coll_recv + (2 * bid + glb_gaspi_group_ib[g].togle) * 2048);
+	  swr.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[(rank + mask) % size].rkeyGroup;
+	  swr.wr_id = dst;
+	  swrN.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[(rank + mask) % size].vaddrGroup + (2 * rank + glb_gaspi_group_ib[g].togle);
+	  swrN.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[(rank + mask) % size].rkeyGroup;
+	  swrN.wr_id = dst;
+
+	  cret = gaspi_connect_remote(dst, timeout_ms);
+	  if (cret == GASPI_TIMEOUT)
+	    {
+	      glb_gaspi_group_ib[g].lastmask = mask;
+	      glb_gaspi_group_ib[g].bid = bid;
+	      unlock_gaspi (&glb_gaspi_group_ib[g].gl);
+
+	      return GASPI_TIMEOUT;
+	    }
+
+	  if (cret != GASPI_SUCCESS
+	      || ibv_post_send (glb_gaspi_ctx_ib.peer[dst]->qpGroup, &swr, &bad_wr_send))
+	    {
+	      glb_gaspi_ctx.qp_state_vec[GASPI_COLL_QP][dst] = 1;
+	      unlock_gaspi (&glb_gaspi_group_ib[g].gl);
+
+	      gaspi_print_error("Failed to post request to %u for gaspi_allreduce",dst);
+	      return GASPI_ERROR;
+	    }
+
+	  glb_gaspi_ctx_ib.ne_count_grp += 2;
+	JD:
+	  dst = 2 * idst + glb_gaspi_group_ib[g].togle;
+
+	  while (poll_buf[dst] != glb_gaspi_group_ib[g].barrier_cnt)
+	    {
+	      //timeout...
+	      const gaspi_cycles_t s1 = gaspi_get_cycles();
+	      const gaspi_cycles_t tdelta = s1 - s0;
+	      const float ms = (float) tdelta * glb_gaspi_ctx.cycles_to_msecs;
+
+	      if(ms > timeout_ms){
+		glb_gaspi_group_ib[g].lastmask = mask|0x80000000;
+		glb_gaspi_group_ib[g].bid = bid;
+		unlock_gaspi (&glb_gaspi_group_ib[g].gl);
+
+		return GASPI_TIMEOUT;
+	      }
+	    }
+
+	  void *dst_val = (void *) (recv_ptr + (2 * bid + glb_gaspi_group_ib[g].togle) * 2048);
+	  void *local_val = (void *) send_ptr;
+	  send_ptr += dsize;
+	  glb_gaspi_group_ib[g].dsize+=dsize;
+
+	  fctArrayGASPI[op * GASPI_TYPES + type] ((void *) send_ptr, local_val, dst_val,elem_cnt);
+
+	  mask <<= 1;
+	  bid++;
+	}
+
+      goto L4;
+    }
+
   if(glb_gaspi_group_ib[g].level >= 2)
     {
       tmprank = glb_gaspi_group_ib[g].tmprank;
@@ -685,14 +1297,24 @@ pgaspi_allreduce (const gaspi_pointer_t buf_send,
       
 	  dst = glb_gaspi_group_ib[g].rank_grp[rank + 1];
 	  slist.addr = (uintptr_t) send_ptr;
-	  swr.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[dst].vaddrGroup + (COLL_MEM_RECV + (2 * bid + glb_gaspi_group_ib[g].togle) * 2048);
-	  swr.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[dst].rkeyGroup;
+	  swr.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[rank + 1].vaddrGroup + (glb_gaspi_group_ib[g].coll_recv + (2 * bid + glb_gaspi_group_ib[g].togle) * 2048);
+	  swr.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[rank + 1].rkeyGroup;
 	  swr.wr_id = dst;
-	  swrN.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[dst].vaddrGroup + (2 * rank + glb_gaspi_group_ib[g].togle);
-	  swrN.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[dst].rkeyGroup;
+	  swrN.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[rank + 1].vaddrGroup + (2 * rank + glb_gaspi_group_ib[g].togle);
+	  swrN.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[rank + 1].rkeyGroup;
 	  swrN.wr_id = dst;
 
-	  if (ibv_post_send(glb_gaspi_ctx_ib.qpGroups[dst], &swr, &bad_wr_send))
+	  cret = gaspi_connect_remote(dst, timeout_ms);
+	  if (cret == GASPI_TIMEOUT)
+	    {
+	      glb_gaspi_group_ib[g].level = 1;
+	      unlock_gaspi (&glb_gaspi_group_ib[g].gl);
+
+	      return GASPI_TIMEOUT;
+	    }
+
+	  if (cret != GASPI_SUCCESS
+	      || ibv_post_send (glb_gaspi_ctx_ib.peer[dst]->qpGroup, &swr, &bad_wr_send))
 	    {
 	      glb_gaspi_ctx.qp_state_vec[GASPI_COLL_QP][dst] = 1;
 	      unlock_gaspi (&glb_gaspi_group_ib[g].gl);
@@ -733,7 +1355,7 @@ pgaspi_allreduce (const gaspi_pointer_t buf_send,
 	  send_ptr += dsize;
 	  glb_gaspi_group_ib[g].dsize+=dsize;
 
-	  fctArrayGASPI[op * 6 + type] ((void *) send_ptr, local_val, dst_val,elem_cnt);
+	  fctArrayGASPI[op * GASPI_TYPES + type] ((void *) send_ptr, local_val, dst_val,elem_cnt);
 	  tmprank = rank >> 1;
 	}
 
@@ -770,14 +1392,25 @@ pgaspi_allreduce (const gaspi_pointer_t buf_send,
 	  if(jmp){jmp=0;goto J2;}
 
 	  slist.addr = (uintptr_t) send_ptr;
-	  swr.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[dst].vaddrGroup + (COLL_MEM_RECV + (2 * bid +glb_gaspi_group_ib[g].togle) * 2048);
-	  swr.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[dst].rkeyGroup;
+	  swr.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[idst].vaddrGroup + (glb_gaspi_group_ib[g].coll_recv + (2 * bid +glb_gaspi_group_ib[g].togle) * 2048);
+	  swr.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[idst].rkeyGroup;
 	  swr.wr_id = dst;
-	  swrN.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[dst].vaddrGroup + (2 * rank + glb_gaspi_group_ib[g].togle);
-	  swrN.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[dst].rkeyGroup;
+	  swrN.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[idst].vaddrGroup + (2 * rank + glb_gaspi_group_ib[g].togle);
+	  swrN.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[idst].rkeyGroup;
 	  swrN.wr_id = dst;
 
-	  if (ibv_post_send(glb_gaspi_ctx_ib.qpGroups[dst], &swr, &bad_wr_send))
+	  cret = gaspi_connect_remote(dst, timeout_ms);
+	  if (cret == GASPI_TIMEOUT)
+	    {
+	      glb_gaspi_group_ib[g].lastmask = mask;
+	      glb_gaspi_group_ib[g].bid = bid;
+	      unlock_gaspi (&glb_gaspi_group_ib[g].gl);
+
+	      return GASPI_TIMEOUT;
+	    }
+
+	  if (cret != GASPI_SUCCESS
+	      || ibv_post_send (glb_gaspi_ctx_ib.peer[dst]->qpGroup, &swr, &bad_wr_send))
 	    {
 
 	      glb_gaspi_ctx.qp_state_vec[GASPI_COLL_QP][dst] = 1;
@@ -813,7 +1446,7 @@ pgaspi_allreduce (const gaspi_pointer_t buf_send,
 	  send_ptr += dsize;
 	  glb_gaspi_group_ib[g].dsize+=dsize;
 
-	  fctArrayGASPI[op * 6 + type] ((void *) send_ptr, local_val, dst_val,elem_cnt);
+	  fctArrayGASPI[op * GASPI_TYPES + type] ((void *) send_ptr, local_val, dst_val,elem_cnt);
 
 	  mask <<= 1;
 	  bid++;
@@ -834,14 +1467,23 @@ pgaspi_allreduce (const gaspi_pointer_t buf_send,
 	dst = glb_gaspi_group_ib[g].rank_grp[rank - 1];
 
 	slist.addr = (uintptr_t) send_ptr;
-	swr.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[dst].vaddrGroup + (COLL_MEM_RECV + (2 * bid + glb_gaspi_group_ib[g].togle) * 2048);
-	swr.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[dst].rkeyGroup;
+	swr.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[rank - 1].vaddrGroup + (glb_gaspi_group_ib[g].coll_recv + (2 * bid + glb_gaspi_group_ib[g].togle) * 2048);
+	swr.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[rank - 1].rkeyGroup;
 	swr.wr_id = dst;
-	swrN.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[dst].vaddrGroup + (2 * rank + glb_gaspi_group_ib[g].togle);
-	swrN.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[dst].rkeyGroup;
+	swrN.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[rank - 1].vaddrGroup + (2 * rank + glb_gaspi_group_ib[g].togle);
+	swrN.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[rank - 1].rkeyGroup;
 	swrN.wr_id = dst;
 	  
-	if (ibv_post_send(glb_gaspi_ctx_ib.qpGroups[dst], &swr, &bad_wr_send)){
+	cret = gaspi_connect_remote(dst, timeout_ms);
+	if (cret == GASPI_TIMEOUT)
+	  {
+	    unlock_gaspi (&glb_gaspi_group_ib[g].gl);
+
+	    return GASPI_TIMEOUT;
+	  }
+
+	if (cret != GASPI_SUCCESS
+	    || ibv_post_send (glb_gaspi_ctx_ib.peer[dst]->qpGroup, &swr, &bad_wr_send)){
 	      
 	  glb_gaspi_ctx.qp_state_vec[GASPI_COLL_QP][dst] = 1;
 	  unlock_gaspi (&glb_gaspi_group_ib[g].gl);
@@ -880,7 +1522,7 @@ pgaspi_allreduce (const gaspi_pointer_t buf_send,
 
     }
 
-
+ L4:;
   const int pret = ibv_poll_cq (glb_gaspi_ctx_ib.scqGroups, glb_gaspi_ctx_ib.ne_count_grp,glb_gaspi_ctx_ib.wc_grp_send);
   
   if (pret < 0)
@@ -918,6 +1560,63 @@ pgaspi_allreduce (const gaspi_pointer_t buf_send,
 }
 
 
+#pragma weak gaspi_allreduce = pgaspi_allreduce
+gaspi_return_t
+pgaspi_allreduce (const gaspi_pointer_t buf_send,
+		  gaspi_pointer_t const buf_recv,
+		  const gaspi_number_t elem_cnt, const gaspi_operation_t op,
+		  const gaspi_datatype_t type, const gaspi_group_t g,
+		  const gaspi_timeout_t timeout_ms)
+{
+
+#ifdef DEBUG
+  if (!glb_gaspi_init)
+    {
+      gaspi_print_error("called gaspi_allreduce but GPI-2 is not initialized");
+      return GASPI_ERROR;
+    }
+
+  if(buf_send == NULL || buf_recv == NULL)
+    {
+      gaspi_print_error("Invalid buffers (gaspi_allreduce)");
+      return GASPI_ERROR;
+    }
+
+  if(elem_cnt > 255)
+    {
+      gaspi_print_error("Invalid number of elements: %u (gaspi_allreduce)", elem_cnt);
+      return GASPI_ERROR;
+    }
+
+  if(op > GASPI_OP_SUM || type > GASPI_TYPE_BFLOAT16)
+    {
+      gaspi_print_error("Invalid number type or operation (gaspi_allreduce)");
+      return GASPI_ERROR;
+    }
+    
+  if (g >= glb_gaspi_cfg.group_max || glb_gaspi_group_ib[g].id < 0 )
+    {
+      gaspi_print_error("Invalid group %u (gaspi_allreduce)", g);
+      return GASPI_ERROR;
+    }
+
+  if(timeout_ms < GASPI_TEST || timeout_ms > GASPI_BLOCK)
+    {
+      gaspi_print_error("Invalid timeout: %lu", timeout_ms);
+      return GASPI_ERROR;
+    }
+
+#endif
+
+  if(glb_gaspi_cfg.allreduce_reproducible && op == GASPI_OP_SUM
+     && (type == GASPI_TYPE_FLOAT || type == GASPI_TYPE_DOUBLE))
+    {
+      return _gaspi_allreduce_repro (buf_send, buf_recv, elem_cnt, type, g, timeout_ms);
+    }
+
+  return _gaspi_allreduce (buf_send, buf_recv, elem_cnt, op, type, g, timeout_ms);
+}
+
 #pragma weak gaspi_allreduce_user = pgaspi_allreduce_user
 gaspi_return_t
 pgaspi_allreduce_user (const gaspi_pointer_t buf_send,
@@ -948,7 +1647,7 @@ pgaspi_allreduce_user (const gaspi_pointer_t buf_send,
       return GASPI_ERROR;
     }
     
-  if (g >= GASPI_MAX_GROUPS || glb_gaspi_group_ib[g].id == -1 )
+  if (g >= glb_gaspi_cfg.group_max || glb_gaspi_group_ib[g].id == -1 )
     {
       gaspi_print_error("Invalid group %u (gaspi_allreduce_user)", g);
       return GASPI_ERROR;
@@ -968,6 +1667,7 @@ pgaspi_allreduce_user (const gaspi_pointer_t buf_send,
   struct ibv_send_wr swr, swrN;
   int idst, dst, bid = 0;
   int i, mask, tmprank, tmpdst;
+  gaspi_return_t cret;
 
 
   if(lock_gaspi_tout (&glb_gaspi_group_ib[g].gl, timeout_ms))
@@ -1002,10 +1702,10 @@ pgaspi_allreduce_user (const gaspi_pointer_t buf_send,
 
   volatile unsigned char *poll_buf = (volatile unsigned char *) (glb_gaspi_group_ib[g].buf);
 
-  unsigned char *send_ptr = glb_gaspi_group_ib[g].buf + COLL_MEM_SEND + (glb_gaspi_group_ib[g].togle * 18 * 2048);
+  unsigned char *send_ptr = glb_gaspi_group_ib[g].buf + glb_gaspi_group_ib[g].coll_send + (glb_gaspi_group_ib[g].togle * glb_gaspi_group_ib[g].coll_slots * 2048);
   memcpy (send_ptr, buf_send, dsize);
 
-  unsigned char *recv_ptr = glb_gaspi_group_ib[g].buf + COLL_MEM_RECV;
+  unsigned char *recv_ptr = glb_gaspi_group_ib[g].buf + glb_gaspi_group_ib[g].coll_recv;
 
   const int rest = size - glb_gaspi_group_ib[g].next_pof2;
 
@@ -1049,14 +1749,24 @@ pgaspi_allreduce_user (const gaspi_pointer_t buf_send,
 	  dst = glb_gaspi_group_ib[g].rank_grp[rank + 1];
 
 	  slist.addr = (uintptr_t) send_ptr;
-	  swr.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[dst].vaddrGroup + (COLL_MEM_RECV + (2 * bid + glb_gaspi_group_ib[g].togle) * 2048);
-	  swr.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[dst].rkeyGroup;
+	  swr.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[rank + 1].vaddrGroup + (glb_gaspi_group_ib[g].coll_recv + (2 * bid + glb_gaspi_group_ib[g].togle) * 2048);
+	  swr.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[rank + 1].rkeyGroup;
 	  swr.wr_id = dst;
-	  swrN.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[dst].vaddrGroup + (2 * rank + glb_gaspi_group_ib[g].togle);
-	  swrN.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[dst].rkeyGroup;
+	  swrN.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[rank + 1].vaddrGroup + (2 * rank + glb_gaspi_group_ib[g].togle);
+	  swrN.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[rank + 1].rkeyGroup;
 	  swrN.wr_id = dst;
 
-	  if (ibv_post_send(glb_gaspi_ctx_ib.qpGroups[dst], &swr, &bad_wr_send))
+	  cret = gaspi_connect_remote(dst, timeout_ms);
+	  if (cret == GASPI_TIMEOUT)
+	    {
+	      glb_gaspi_group_ib[g].level = 1;
+	      unlock_gaspi (&glb_gaspi_group_ib[g].gl);
+
+	      return GASPI_TIMEOUT;
+	    }
+
+	  if (cret != GASPI_SUCCESS
+	      || ibv_post_send (glb_gaspi_ctx_ib.peer[dst]->qpGroup, &swr, &bad_wr_send))
 	    {
 
 	      glb_gaspi_ctx.qp_state_vec[GASPI_COLL_QP][dst] = 1;
@@ -1132,14 +1842,25 @@ pgaspi_allreduce_user (const gaspi_pointer_t buf_send,
 	  if(jmp){jmp=0;goto J2;}
 
 	  slist.addr = (uintptr_t) send_ptr;
-	  swr.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[dst].vaddrGroup + (COLL_MEM_RECV + (2 * bid + glb_gaspi_group_ib[g].togle) * 2048);
-	  swr.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[dst].rkeyGroup;
+	  swr.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[idst].vaddrGroup + (glb_gaspi_group_ib[g].coll_recv + (2 * bid + glb_gaspi_group_ib[g].togle) * 2048);
+	  swr.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[idst].rkeyGroup;
 	  swr.wr_id = dst;
-	  swrN.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[dst].vaddrGroup + (2 * rank + glb_gaspi_group_ib[g].togle);
-	  swrN.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[dst].rkeyGroup;
+	  swrN.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[idst].vaddrGroup + (2 * rank + glb_gaspi_group_ib[g].togle);
+	  swrN.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[idst].rkeyGroup;
 	  swrN.wr_id = dst;
 
-	  if (ibv_post_send(glb_gaspi_ctx_ib.qpGroups[dst], &swr, &bad_wr_send))
+	  cret = gaspi_connect_remote(dst, timeout_ms);
+	  if (cret == GASPI_TIMEOUT)
+	    {
+	      glb_gaspi_group_ib[g].lastmask = mask;
+	      glb_gaspi_group_ib[g].bid = bid;
+	      unlock_gaspi (&glb_gaspi_group_ib[g].gl);
+
+	      return GASPI_TIMEOUT;
+	    }
+
+	  if (cret != GASPI_SUCCESS
+	      || ibv_post_send (glb_gaspi_ctx_ib.peer[dst]->qpGroup, &swr, &bad_wr_send))
 	    {
 	      glb_gaspi_ctx.qp_state_vec[GASPI_COLL_QP][dst] = 1;
 	      unlock_gaspi (&glb_gaspi_group_ib[g].gl);
@@ -1196,14 +1917,23 @@ pgaspi_allreduce_user (const gaspi_pointer_t buf_send,
 	  dst = glb_gaspi_group_ib[g].rank_grp[rank - 1];
 
 	  slist.addr = (uintptr_t) send_ptr;
-	  swr.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[dst].vaddrGroup + (COLL_MEM_RECV + (2 * bid +glb_gaspi_group_ib[g].togle) * 2048);
-	  swr.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[dst].rkeyGroup;
+	  swr.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[rank - 1].vaddrGroup + (glb_gaspi_group_ib[g].coll_recv + (2 * bid +glb_gaspi_group_ib[g].togle) * 2048);
+	  swr.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[rank - 1].rkeyGroup;
 	  swr.wr_id = dst;
-	  swrN.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[dst].vaddrGroup + (2 * rank +glb_gaspi_group_ib[g].togle);
-	  swrN.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[dst].rkeyGroup;
+	  swrN.wr.rdma.remote_addr = glb_gaspi_group_ib[g].rrcd[rank - 1].vaddrGroup + (2 * rank +glb_gaspi_group_ib[g].togle);
+	  swrN.wr.rdma.rkey = glb_gaspi_group_ib[g].rrcd[rank - 1].rkeyGroup;
 	  swrN.wr_id = dst;
 
-	  if (ibv_post_send(glb_gaspi_ctx_ib.qpGroups[dst], &swr, &bad_wr_send))
+	  cret = gaspi_connect_remote(dst, timeout_ms);
+	  if (cret == GASPI_TIMEOUT)
+	    {
+	      unlock_gaspi (&glb_gaspi_group_ib[g].gl);
+
+	      return GASPI_TIMEOUT;
+	    }
+
+	  if (cret != GASPI_SUCCESS
+	      || ibv_post_send (glb_gaspi_ctx_ib.peer[dst]->qpGroup, &swr, &bad_wr_send))
 	    {
 	      glb_gaspi_ctx.qp_state_vec[GASPI_COLL_QP][dst] = 1;
 	      unlock_gaspi (&glb_gaspi_group_ib[g].gl);
@@ -1276,3 +2006,201 @@ pgaspi_allreduce_user (const gaspi_pointer_t buf_send,
 
   return GASPI_SUCCESS;
 }
+
+
+/* Reproducible sum of floats/doubles by binned summation: each value
+   is split into parts that fall into fixed bins of GASPI_REPRO_WIDTH
+   bits. A bin sums its parts exactly, so merging partial sums bin by
+   bin gives the same bits whatever the reduction order or the group
+   size, and it takes a single user allreduce per chunk. */
+#define GASPI_REPRO_LEVELS (3) //bins kept per double, float needs 2
+#define GASPI_REPRO_BOUND  (16) //log2 (GASPI_MAX_NODES)
+#define GASPI_REPRO_WIDTH  (32)
+#define GASPI_REPRO_EMIN   (DBL_MIN_EXP - 1)
+#define GASPI_REPRO_TOP    ((DBL_MAX_EXP - 1 - GASPI_REPRO_EMIN) / GASPI_REPRO_WIDTH)
+#define GASPI_REPRO_BYTES  (2048) //one collective slot
+
+static inline double
+_gaspi_repro_sigma (const int bin)
+{
+  return ldexp (1.5, GASPI_REPRO_EMIN + bin * GASPI_REPRO_WIDTH);
+}
+
+//a bin holds sigma plus its sum, which keeps the exponent of sigma
+static inline int
+_gaspi_repro_bin (const double part)
+{
+  int e;
+
+  frexp (part, &e);
+
+  return (e - 1 - GASPI_REPRO_EMIN) / GASPI_REPRO_WIDTH;
+}
+
+/* The first bin is the lowest one leaving room for GASPI_MAX_NODES
+   summands. Values out of range are kept as they are, flagged by a
+   negative first part, and summed without the guarantee. */
+static void
+_gaspi_repro_split (const double x, const int levels, double *const st)
+{
+  int e, l;
+  int bin = levels - 1;
+  double r = x;
+
+  if (x != 0.0 && isfinite (x))
+    {
+      frexp (x, &e);
+
+      const int need = e + 2 + GASPI_REPRO_BOUND - GASPI_REPRO_EMIN;
+      bin = MAX (bin, (need + GASPI_REPRO_WIDTH - 1) / GASPI_REPRO_WIDTH);
+    }
+
+  if (!isfinite (x) || bin > GASPI_REPRO_TOP)
+    {
+      st[0] = -1.0;
+      st[1] = x;
+      for (l = 2; l < levels; l++)
+	st[l] = 0.0;
+
+      return;
+    }
+
+  for (l = 0; l < levels; l++)
+    {
+      const double sigma = _gaspi_repro_sigma (bin - l);
+      volatile double t = sigma + r;
+
+      st[l] = t;
+      r -= t - sigma;
+    }
+}
+
+static double
+_gaspi_repro_value (const double *const st, const int levels)
+{
+  int l;
+  double s = 0.0;
+
+  if (st[0] < 0.0)
+    return st[1];
+
+  const int bin = _gaspi_repro_bin (st[0]);
+
+  //smallest parts first
+  for (l = levels - 1; l >= 0; l--)
+    s += st[l] - _gaspi_repro_sigma (bin - l);
+
+  return s;
+}
+
+/* Aligns both operands to the higher first bin and adds them bin by
+   bin. Bins below the window of the result are dropped, which they
+   would be in any order. */
+static gaspi_return_t
+_gaspi_repro_merge (gaspi_pointer_t const op_one,
+		    gaspi_pointer_t const op_two,
+		    gaspi_pointer_t const op_res,
+		    gaspi_state_t const state,
+		    const gaspi_number_t num,
+		    const gaspi_size_t elem_size,
+		    const gaspi_timeout_t timeout_ms)
+{
+  int l;
+  gaspi_number_t i;
+  double tmp[GASPI_REPRO_LEVELS];
+
+  const int levels = elem_size / sizeof (double);
+
+  for (i = 0; i < num; i++)
+    {
+      const double *const a = (double *) op_one + i * levels;
+      const double *const b = (double *) op_two + i * levels;
+
+      if (a[0] < 0.0 || b[0] < 0.0)
+	{
+	  tmp[0] = -1.0;
+	  tmp[1] = _gaspi_repro_value (a, levels) + _gaspi_repro_value (b, levels);
+	  for (l = 2; l < levels; l++)
+	    tmp[l] = 0.0;
+	}
+      else
+	{
+	  const int bin_a = _gaspi_repro_bin (a[0]);
+	  const int bin_b = _gaspi_repro_bin (b[0]);
+	  const double *const hi = (bin_a >= bin_b) ? a : b;
+	  const double *const lo = (bin_a >= bin_b) ? b : a;
+	  const int top = MAX (bin_a, bin_b);
+	  const int shift = abs (bin_a - bin_b);
+
+	  for (l = 0; l < levels; l++)
+	    {
+	      tmp[l] = hi[l];
+	      if (l >= shift)
+		tmp[l] += lo[l - shift] - _gaspi_repro_sigma (top - l);
+	    }
+	}
+
+      memcpy ((double *) op_res + i * levels, tmp, levels * sizeof (double));
+    }
+
+  return GASPI_SUCCESS;
+}
+
+static gaspi_return_t
+_gaspi_allreduce_repro (const gaspi_pointer_t buf_send,
+			gaspi_pointer_t const buf_recv,
+			const gaspi_number_t elem_cnt,
+			const gaspi_datatype_t type, const gaspi_group_t g,
+			const gaspi_timeout_t timeout_ms)
+{
+  int i, first;
+  gaspi_return_t ret;
+  double st[GASPI_REPRO_BYTES / sizeof (double)];
+  double sum[GASPI_REPRO_BYTES / sizeof (double)];
+  gaspi_ib_group *grp = &glb_gaspi_group_ib[g];
+
+  const int levels = (type == GASPI_TYPE_FLOAT) ? 2 : GASPI_REPRO_LEVELS;
+  const gaspi_size_t elem_size = levels * sizeof (double);
+  const int chunk = GASPI_REPRO_BYTES / elem_size;
+
+  //a timeout resumes at the chunk where it stopped
+  if (lock_gaspi_tout (&grp->gl, timeout_ms))
+    return GASPI_TIMEOUT;
+
+  first = grp->repro_pass * chunk;
+  unlock_gaspi (&grp->gl);
+
+  for (; first < elem_cnt; first += chunk)
+    {
+      const int cnt = MIN (chunk, elem_cnt - first);
+
+      for (i = 0; i < cnt; i++)
+	{
+	  const double x = (type == GASPI_TYPE_FLOAT)
+	    ? (double) ((float *) buf_send)[first + i]
+	    : ((double *) buf_send)[first + i];
+
+	  _gaspi_repro_split (x, levels, &st[i * levels]);
+	}
+
+      ret = pgaspi_allreduce_user (st, sum, cnt, elem_size, _gaspi_repro_merge, NULL, g, timeout_ms);
+      if (ret != GASPI_SUCCESS)
+	return ret;
+
+      for (i = 0; i < cnt; i++)
+	{
+	  const double s = _gaspi_repro_value (&sum[i * levels], levels);
+
+	  if (type == GASPI_TYPE_FLOAT)
+	    ((float *) buf_recv)[first + i] = (float) s;
+	  else
+	    ((double *) buf_recv)[first + i] = s;
+	}
+
+      lock_gaspi_tout (&grp->gl, GASPI_BLOCK);
+      grp->repro_pass = (first + cnt < elem_cnt) ? first / chunk + 1 : 0;
+      unlock_gaspi (&grp->gl);
+    }
+
+  return GASPI_SUCCESS;
+}
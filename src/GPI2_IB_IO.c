@@ -57,8 +57,7 @@ static void _print_func_params(char *func_name, const gaspi_segment_id_t segment
 
 static int _check_func_params(char *func_name, const gaspi_segment_id_t segment_id_local,
 			      const gaspi_offset_t offset_local, const gaspi_rank_t rank,
-			      const gaspi_segment_id_t segment_id_remote,
-			      const gaspi_offset_t offset_remote, const gaspi_size_t size,
+			      const gaspi_size_t size,
 			      const gaspi_queue_id_t queue, const gaspi_timeout_t timeout)
 {
 
@@ -68,30 +67,20 @@ static int _check_func_params(char *func_name, const gaspi_segment_id_t segment_
       return -1;
     }
   
-  if (glb_gaspi_ctx_ib.rrmd[segment_id_remote] == NULL)
-    {
-      gaspi_print_error("Invalid remote segment %d (%s)", segment_id_remote, func_name);    
-      return -1;
-    }
-
   if( rank >= glb_gaspi_ctx.tnc)
     {
       gaspi_print_error("Invalid rank: %u (%s)", rank, func_name);    
       return -1;
     }
   
-  if( offset_local > glb_gaspi_ctx_ib.rrmd[segment_id_local][glb_gaspi_ctx.rank].size
-      || offset_remote > glb_gaspi_ctx_ib.rrmd[segment_id_remote][rank].size
-      )
+  if( offset_local > glb_gaspi_ctx_ib.rrmd[segment_id_local][glb_gaspi_ctx.rank].size)
     {
-      gaspi_print_error("Invalid offsets: local %lu remote %lu (%s)",
-			offset_local, offset_remote, func_name);    
+      gaspi_print_error("Invalid local offset: %lu (%s)", offset_local, func_name);    
       return -1;
     }
     
   if(   size < 1
      || size > GASPI_MAX_TSIZE_C
-     || size > glb_gaspi_ctx_ib.rrmd[segment_id_remote][rank].size
      || size > glb_gaspi_ctx_ib.rrmd[segment_id_local][glb_gaspi_ctx.rank].size)
     {
       gaspi_print_error("Invalid size: %lu (%s)", size,func_name);    
@@ -114,6 +103,33 @@ static int _check_func_params(char *func_name, const gaspi_segment_id_t segment_
   return 0;
 }
 
+/* The checks that need the remote segment, once it is looked up */
+static int _check_remote_params(char *func_name, const gaspi_segment_id_t segment_id_remote,
+				const gaspi_rank_t rank, const gaspi_offset_t offset_remote,
+				const gaspi_size_t size)
+{
+
+  if (glb_gaspi_ctx_ib.rrmd[segment_id_remote] == NULL)
+    {
+      gaspi_print_error("Invalid remote segment %d (%s)", segment_id_remote, func_name);    
+      return -1;
+    }
+
+  if( offset_remote > glb_gaspi_ctx_ib.rrmd[segment_id_remote][rank].size)
+    {
+      gaspi_print_error("Invalid remote offset: %lu (%s)", offset_remote, func_name);    
+      return -1;
+    }
+
+  if( size > glb_gaspi_ctx_ib.rrmd[segment_id_remote][rank].size)
+    {
+      gaspi_print_error("Invalid size: %lu (%s)", size,func_name);    
+      return -1;
+    }
+
+  return 0;
+}
+
 
 #endif
 
@@ -135,12 +151,24 @@ pgaspi_write (const gaspi_segment_id_t segment_id_local,
     }
 
   if(_check_func_params("gaspi_write", segment_id_local, offset_local, rank,
-			segment_id_remote, offset_remote, size,
-			queue, timeout_ms) < 0)
+			size, queue, timeout_ms) < 0)
     return GASPI_ERROR;
   
 #endif
-  
+
+  const gaspi_return_t eret = gaspi_segment_remote (segment_id_remote, rank, timeout_ms);
+  if(eret != GASPI_SUCCESS)
+    return eret;
+
+  const gaspi_return_t qret = gaspi_queue_remote (queue, rank, timeout_ms);
+  if(qret != GASPI_SUCCESS)
+    return qret;
+
+#ifdef DEBUG
+  if(_check_remote_params("gaspi_write", segment_id_remote, rank, offset_remote, size) < 0)
+    return GASPI_ERROR;
+#endif
+
   struct ibv_send_wr *bad_wr;
   struct ibv_sge slist;
   struct ibv_send_wr swr;
@@ -166,12 +194,12 @@ pgaspi_write (const gaspi_segment_id_t segment_id_local,
      slist.addr =
        (uintptr_t) (glb_gaspi_ctx_ib.
 		    rrmd[segment_id_local][glb_gaspi_ctx.rank].addr +
-		    NOTIFY_OFFSET + offset_local);
+		    offset_local);
    }
   
   slist.length = size;
   slist.lkey =
-    glb_gaspi_ctx_ib.rrmd[segment_id_local][glb_gaspi_ctx.rank].mr->lkey;
+    glb_gaspi_ctx_ib.lmsd[segment_id_local].lkey;
 
 #ifdef GPI2_CUDA
   if(glb_gaspi_ctx_ib.rrmd[segment_id_remote][rank].cudaDevId >= 0)
@@ -180,7 +208,7 @@ pgaspi_write (const gaspi_segment_id_t segment_id_local,
   else
 #endif
     swr.wr.rdma.remote_addr =
-      (glb_gaspi_ctx_ib.rrmd[segment_id_remote][rank].addr + NOTIFY_OFFSET +
+      (glb_gaspi_ctx_ib.rrmd[segment_id_remote][rank].addr +
        offset_remote);
 
   swr.wr.rdma.rkey = glb_gaspi_ctx_ib.rrmd[segment_id_remote][rank].rkey;
@@ -191,7 +219,7 @@ pgaspi_write (const gaspi_segment_id_t segment_id_local,
   swr.send_flags = sf;
   swr.next = NULL;
 
-  if (ibv_post_send (glb_gaspi_ctx_ib.qpC[queue][rank], &swr, &bad_wr))
+  if (ibv_post_send (glb_gaspi_ctx_ib.peer[rank]->qpC[queue], &swr, &bad_wr))
     {
       glb_gaspi_ctx.qp_state_vec[queue][rank] = 1;
       unlock_gaspi (&glb_gaspi_ctx.lockC[queue]);
@@ -229,8 +257,20 @@ pgaspi_read (const gaspi_segment_id_t segment_id_local,
     return GASPI_ERROR;
   
   if(_check_func_params("gaspi_read", segment_id_local, offset_local, rank,
-			segment_id_remote, offset_remote, size,
-			queue, timeout_ms) < 0)
+			size, queue, timeout_ms) < 0)
+    return GASPI_ERROR;
+#endif
+
+  const gaspi_return_t eret = gaspi_segment_remote (segment_id_remote, rank, timeout_ms);
+  if(eret != GASPI_SUCCESS)
+    return eret;
+
+  const gaspi_return_t qret = gaspi_queue_remote (queue, rank, timeout_ms);
+  if(qret != GASPI_SUCCESS)
+    return qret;
+
+#ifdef DEBUG
+  if(_check_remote_params("gaspi_read", segment_id_remote, rank, offset_remote, size) < 0)
     return GASPI_ERROR;
 #endif
 
@@ -252,10 +292,10 @@ pgaspi_read (const gaspi_segment_id_t segment_id_local,
     slist.addr =
       (uintptr_t) (glb_gaspi_ctx_ib.
 		   rrmd[segment_id_local][glb_gaspi_ctx.rank].addr +
-		   NOTIFY_OFFSET + offset_local);
+		   offset_local);
   slist.length = size;
   slist.lkey =
-    glb_gaspi_ctx_ib.rrmd[segment_id_local][glb_gaspi_ctx.rank].mr->lkey;
+    glb_gaspi_ctx_ib.lmsd[segment_id_local].lkey;
   
 #ifdef GPI2_CUDA
   if(glb_gaspi_ctx_ib.rrmd[segment_id_remote][rank].cudaDevId >= 0)
@@ -265,7 +305,7 @@ pgaspi_read (const gaspi_segment_id_t segment_id_local,
 #endif
     
     swr.wr.rdma.remote_addr =
-      (glb_gaspi_ctx_ib.rrmd[segment_id_remote][rank].addr + NOTIFY_OFFSET +
+      (glb_gaspi_ctx_ib.rrmd[segment_id_remote][rank].addr +
        offset_remote);
   
   swr.wr.rdma.rkey = glb_gaspi_ctx_ib.rrmd[segment_id_remote][rank].rkey;
@@ -276,7 +316,7 @@ pgaspi_read (const gaspi_segment_id_t segment_id_local,
   swr.send_flags = IBV_SEND_SIGNALED;// | IBV_SEND_FENCE;
   swr.next = NULL;
 
-  if (ibv_post_send (glb_gaspi_ctx_ib.qpC[queue][rank], &swr, &bad_wr))
+  if (ibv_post_send (glb_gaspi_ctx_ib.peer[rank]->qpC[queue], &swr, &bad_wr))
     {
       glb_gaspi_ctx.qp_state_vec[queue][rank] = 1;
       unlock_gaspi (&glb_gaspi_ctx.lockC[queue]);
@@ -380,6 +420,8 @@ pgaspi_write_list (const gaspi_number_t num,
 		  const gaspi_timeout_t timeout_ms)
 {
 
+  gaspi_number_t r;
+
 #ifdef DEBUG
   gaspi_number_t n;
   
@@ -395,13 +437,32 @@ pgaspi_write_list (const gaspi_number_t num,
   for(n = 0; n < num; n++)
     {
       if(_check_func_params("gaspi_write_list", segment_id_local[n], offset_local[n], rank,
-			    segment_id_remote[n], offset_remote[n], size[n],
-			    queue, timeout_ms) < 0)
+			    size[n], queue, timeout_ms) < 0)
 	return GASPI_ERROR;
     }
   
 #endif
-  
+
+  for(r = 0; r < num; r++)
+    {
+      const gaspi_return_t eret = gaspi_segment_remote (segment_id_remote[r], rank, timeout_ms);
+      if(eret != GASPI_SUCCESS)
+	return eret;
+    }
+
+  const gaspi_return_t qret = gaspi_queue_remote (queue, rank, timeout_ms);
+  if(qret != GASPI_SUCCESS)
+    return qret;
+
+#ifdef DEBUG
+  for(r = 0; r < num; r++)
+    {
+      if(_check_remote_params("gaspi_write_list", segment_id_remote[r], rank,
+			      offset_remote[r], size[r]) < 0)
+	return GASPI_ERROR;
+    }
+#endif
+
   struct ibv_send_wr *bad_wr;
   struct ibv_sge slist[256];
   struct ibv_send_wr swr[256];
@@ -423,12 +484,11 @@ pgaspi_write_list (const gaspi_number_t num,
 #endif
       slist[i].addr =
 	(uintptr_t) (glb_gaspi_ctx_ib.rrmd[segment_id_local[i]]
-		     [glb_gaspi_ctx.rank].addr + NOTIFY_OFFSET +
+		     [glb_gaspi_ctx.rank].addr +
 		     offset_local[i]);
       slist[i].length = size[i];
       slist[i].lkey =
-	glb_gaspi_ctx_ib.rrmd[segment_id_local[i]][glb_gaspi_ctx.rank].
-	mr->lkey;
+	glb_gaspi_ctx_ib.lmsd[segment_id_local[i]].lkey;
 #ifdef GPI2_CUDA
      if(glb_gaspi_ctx_ib.rrmd[segment_id_remote[i]][rank].cudaDevId >= 0)
       swr[i].wr.rdma.remote_addr =
@@ -438,7 +498,7 @@ pgaspi_write_list (const gaspi_number_t num,
 #endif
       swr[i].wr.rdma.remote_addr =
 	(glb_gaspi_ctx_ib.rrmd[segment_id_remote[i]][rank].addr +
-	 NOTIFY_OFFSET + offset_remote[i]);
+	 offset_remote[i]);
       swr[i].wr.rdma.rkey =
 	glb_gaspi_ctx_ib.rrmd[segment_id_remote[i]][rank].rkey;
       swr[i].sg_list = &slist[i];
@@ -452,7 +512,7 @@ pgaspi_write_list (const gaspi_number_t num,
 	swr[i].next = &swr[i + 1];
     }
 
-  if (ibv_post_send (glb_gaspi_ctx_ib.qpC[queue][rank], &swr[0], &bad_wr))
+  if (ibv_post_send (glb_gaspi_ctx_ib.peer[rank]->qpC[queue], &swr[0], &bad_wr))
     {
       glb_gaspi_ctx.qp_state_vec[queue][rank] = 1;
       unlock_gaspi (&glb_gaspi_ctx.lockC[queue]);
@@ -486,6 +546,8 @@ pgaspi_read_list (const gaspi_number_t num,
 		 const gaspi_timeout_t timeout_ms)
 {
 
+  gaspi_number_t r;
+
 #ifdef DEBUG
   gaspi_number_t n;
   
@@ -502,11 +564,30 @@ pgaspi_read_list (const gaspi_number_t num,
   for(n = 0; n < num; n++)
     {
       if(_check_func_params("gaspi_read_list", segment_id_local[n], offset_local[n], rank,
-			    segment_id_remote[n], offset_remote[n], size[n],
-			    queue, timeout_ms) < 0)
+			    size[n], queue, timeout_ms) < 0)
 	return GASPI_ERROR;
     }
   
+#endif
+
+  for(r = 0; r < num; r++)
+    {
+      const gaspi_return_t eret = gaspi_segment_remote (segment_id_remote[r], rank, timeout_ms);
+      if(eret != GASPI_SUCCESS)
+	return eret;
+    }
+
+  const gaspi_return_t qret = gaspi_queue_remote (queue, rank, timeout_ms);
+  if(qret != GASPI_SUCCESS)
+    return qret;
+
+#ifdef DEBUG
+  for(r = 0; r < num; r++)
+    {
+      if(_check_remote_params("gaspi_read_list", segment_id_remote[r], rank,
+			      offset_remote[r], size[r]) < 0)
+	return GASPI_ERROR;
+    }
 #endif
 
   struct ibv_send_wr *bad_wr;
@@ -530,12 +611,11 @@ pgaspi_read_list (const gaspi_number_t num,
 #endif
       slist[i].addr =
 	(uintptr_t) (glb_gaspi_ctx_ib.rrmd[segment_id_local[i]]
-		     [glb_gaspi_ctx.rank].addr + NOTIFY_OFFSET +
+		     [glb_gaspi_ctx.rank].addr +
 		     offset_local[i]);
       slist[i].length = size[i];
       slist[i].lkey =
-	glb_gaspi_ctx_ib.rrmd[segment_id_local[i]][glb_gaspi_ctx.rank].
-	mr->lkey;
+	glb_gaspi_ctx_ib.lmsd[segment_id_local[i]].lkey;
 #ifdef GPI2_CUDA
      if(glb_gaspi_ctx_ib.rrmd[segment_id_remote[i]][rank].cudaDevId >= 0)
       swr[i].wr.rdma.remote_addr =
@@ -545,7 +625,7 @@ pgaspi_read_list (const gaspi_number_t num,
 #endif 
      swr[i].wr.rdma.remote_addr =
 	(glb_gaspi_ctx_ib.rrmd[segment_id_remote[i]][rank].addr +
-	 NOTIFY_OFFSET + offset_remote[i]);
+	 offset_remote[i]);
       swr[i].wr.rdma.rkey =
 	glb_gaspi_ctx_ib.rrmd[segment_id_remote[i]][rank].rkey;
       swr[i].sg_list = &slist[i];
@@ -559,7 +639,7 @@ pgaspi_read_list (const gaspi_number_t num,
 	swr[i].next = &swr[i + 1];
     }
 
-  if (ibv_post_send (glb_gaspi_ctx_ib.qpC[queue][rank], &swr[0], &bad_wr))
+  if (ibv_post_send (glb_gaspi_ctx_ib.peer[rank]->qpC[queue], &swr[0], &bad_wr))
     {
       glb_gaspi_ctx.qp_state_vec[queue][rank] = 1;
       unlock_gaspi (&glb_gaspi_ctx.lockC[queue]);
@@ -592,12 +672,6 @@ pgaspi_notify (const gaspi_segment_id_t segment_id_remote,
 {
 
 #ifdef DEBUG
-  if (glb_gaspi_ctx_ib.rrmd[segment_id_remote] == NULL)
-    {
-      gaspi_print_error("Invalid remote segment: %u (gaspi_notify)", segment_id_remote);    
-      return GASPI_ERROR;
-    }
-  
   if( rank >= glb_gaspi_ctx.tnc)
     {
       gaspi_print_error("Invalid rank: %u (gaspi_notify)", rank);    
@@ -609,8 +683,31 @@ pgaspi_notify (const gaspi_segment_id_t segment_id_remote,
       gaspi_print_error("Invalid queue: %d (gaspi_notify)", queue);    
       return GASPI_ERROR;
     } 
+
 #endif
-  
+
+  if (notification_id >= glb_gaspi_cfg.notification_num)
+    {
+      gaspi_print_error("Invalid notification id: %u (gaspi_notify)", notification_id);
+      return GASPI_ERROR;
+    }
+
+  const gaspi_return_t eret = gaspi_segment_remote (segment_id_remote, rank, timeout_ms);
+  if(eret != GASPI_SUCCESS)
+    return eret;
+
+  const gaspi_return_t qret = gaspi_queue_remote (queue, rank, timeout_ms);
+  if(qret != GASPI_SUCCESS)
+    return qret;
+
+#ifdef DEBUG
+  if (glb_gaspi_ctx_ib.rrmd[segment_id_remote] == NULL)
+    {
+      gaspi_print_error("Invalid remote segment: %u (gaspi_notify)", segment_id_remote);
+      return GASPI_ERROR;
+    }
+#endif
+
   struct ibv_send_wr *bad_wr;
   struct ibv_sge slistN;
   struct ibv_send_wr swrN;
@@ -635,9 +732,9 @@ pgaspi_notify (const gaspi_segment_id_t segment_id_remote,
 #endif
     {
       swrN.wr.rdma.remote_addr =
-	(glb_gaspi_ctx_ib.rrmd[segment_id_remote][rank].addr +
+	(glb_gaspi_ctx_ib.rrmd[segment_id_remote][rank].notif_addr +
 	 notification_id * 4);
-      swrN.wr.rdma.rkey = glb_gaspi_ctx_ib.rrmd[segment_id_remote][rank].rkey;
+      swrN.wr.rdma.rkey = glb_gaspi_ctx_ib.rrmd[segment_id_remote][rank].notif_rkey;
     }
   
   swrN.sg_list = &slistN;
@@ -647,7 +744,7 @@ pgaspi_notify (const gaspi_segment_id_t segment_id_remote,
   swrN.send_flags = IBV_SEND_SIGNALED | IBV_SEND_INLINE;;
   swrN.next = NULL;
 
-  if (ibv_post_send (glb_gaspi_ctx_ib.qpC[queue][rank], &swrN, &bad_wr))
+  if (ibv_post_send (glb_gaspi_ctx_ib.peer[rank]->qpC[queue], &swrN, &bad_wr))
     {
       glb_gaspi_ctx.qp_state_vec[queue][rank] = 1;
       unlock_gaspi (&glb_gaspi_ctx.lockC[queue]);
@@ -676,12 +773,6 @@ pgaspi_notify_waitsome (const gaspi_segment_id_t segment_id_local,
       return GASPI_ERROR;
     }
   
-  if( num >= GASPI_MAX_NOTIFICATION)
-    {
-      gaspi_print_error("Waiting for invalid notifications number: %u  (gaspi_notify_waitsome)", num);    
-      return GASPI_ERROR;
-    }
-
   if(first_id == NULL)
     {
       gaspi_print_error("Invalid pointer on parameter first_id (gaspi_notify_waitsome)");    
@@ -689,6 +780,13 @@ pgaspi_notify_waitsome (const gaspi_segment_id_t segment_id_local,
     }
   
 #endif
+
+  if(notification_begin + num > glb_gaspi_cfg.notification_num)
+    {
+      gaspi_print_error("Waiting for invalid notifications number: %u  (gaspi_notify_waitsome)", num);
+      return GASPI_ERROR;
+    }
+
   volatile unsigned char *segPtr;
   int n, loop = 1;
 
@@ -702,7 +800,7 @@ pgaspi_notify_waitsome (const gaspi_segment_id_t segment_id_local,
 #endif
     segPtr =
       (volatile unsigned char *)
-      glb_gaspi_ctx_ib.rrmd[segment_id_local][glb_gaspi_ctx.rank].addr;
+      glb_gaspi_ctx_ib.rrmd[segment_id_local][glb_gaspi_ctx.rank].notif_addr;
 
   volatile unsigned int *p = (volatile unsigned int *) segPtr;
 
@@ -784,14 +882,19 @@ pgaspi_notify_reset (const gaspi_segment_id_t segment_id_local,
       gaspi_print_error("Invalid segment: %u (gaspi_notify_reset)", segment_id_local);    
       return GASPI_ERROR;
     }
-  
+
   if(old_notification_val == NULL)
     {
       printf("Warning: NULL pointer on parameter old_notification_val (gaspi_notify_reset)\n");    
     }
 #endif
 
-  
+  if (notification_id >= glb_gaspi_cfg.notification_num)
+    {
+      gaspi_print_error("Invalid notification id: %u (gaspi_notify_reset)", notification_id);
+      return GASPI_ERROR;
+    }
+
   volatile unsigned char *segPtr;
 
 #ifdef GPI2_CUDA
@@ -800,7 +903,7 @@ pgaspi_notify_reset (const gaspi_segment_id_t segment_id_local,
   else
 #endif
     segPtr = (volatile unsigned char *)
-      glb_gaspi_ctx_ib.rrmd[segment_id_local][glb_gaspi_ctx.rank].addr;
+      glb_gaspi_ctx_ib.rrmd[segment_id_local][glb_gaspi_ctx.rank].notif_addr;
   
   volatile unsigned int *p = (volatile unsigned int *) segPtr;
 
@@ -835,10 +938,28 @@ pgaspi_write_notify (const gaspi_segment_id_t segment_id_local,
     }
 
   if(_check_func_params("gaspi_write_notify", segment_id_local, offset_local, rank,
-			segment_id_remote, offset_remote, size,
-			queue, timeout_ms) < 0)
+			size, queue, timeout_ms) < 0)
+    return GASPI_ERROR;
+
+#endif
+
+  if (notification_id >= glb_gaspi_cfg.notification_num)
+    {
+      gaspi_print_error("Invalid notification id: %u (gaspi_write_notify)", notification_id);
+      return GASPI_ERROR;
+    }
+
+  const gaspi_return_t eret = gaspi_segment_remote (segment_id_remote, rank, timeout_ms);
+  if(eret != GASPI_SUCCESS)
+    return eret;
+
+  const gaspi_return_t qret = gaspi_queue_remote (queue, rank, timeout_ms);
+  if(qret != GASPI_SUCCESS)
+    return qret;
+
+#ifdef DEBUG
+  if(_check_remote_params("gaspi_write_notify", segment_id_remote, rank, offset_remote, size) < 0)
     return GASPI_ERROR;
-  
 #endif
 
   struct ibv_send_wr *bad_wr;
@@ -859,11 +980,11 @@ pgaspi_write_notify (const gaspi_segment_id_t segment_id_local,
     slist.addr =
       (uintptr_t) (glb_gaspi_ctx_ib.
 		   rrmd[segment_id_local][glb_gaspi_ctx.rank].addr +
-		   NOTIFY_OFFSET + offset_local);
+		   offset_local);
 
   slist.length = size;
   slist.lkey =
-    glb_gaspi_ctx_ib.rrmd[segment_id_local][glb_gaspi_ctx.rank].mr->lkey;
+    glb_gaspi_ctx_ib.lmsd[segment_id_local].lkey;
 
 #ifdef GPI2_CUDA
   if(glb_gaspi_ctx_ib.rrmd[segment_id_remote][rank].cudaDevId >= 0)
@@ -872,7 +993,7 @@ pgaspi_write_notify (const gaspi_segment_id_t segment_id_local,
   else
 #endif
     swr.wr.rdma.remote_addr =
-      (glb_gaspi_ctx_ib.rrmd[segment_id_remote][rank].addr + NOTIFY_OFFSET +
+      (glb_gaspi_ctx_ib.rrmd[segment_id_remote][rank].addr +
        offset_remote);
 
   swr.wr.rdma.rkey = glb_gaspi_ctx_ib.rrmd[segment_id_remote][rank].rkey;
@@ -900,9 +1021,9 @@ pgaspi_write_notify (const gaspi_segment_id_t segment_id_local,
 #endif
   {
     swrN.wr.rdma.remote_addr =
-      (glb_gaspi_ctx_ib.rrmd[segment_id_remote][rank].addr +
+      (glb_gaspi_ctx_ib.rrmd[segment_id_remote][rank].notif_addr +
        notification_id * 4);
-    swrN.wr.rdma.rkey = glb_gaspi_ctx_ib.rrmd[segment_id_remote][rank].rkey;
+    swrN.wr.rdma.rkey = glb_gaspi_ctx_ib.rrmd[segment_id_remote][rank].notif_rkey;
   }
 
   swrN.sg_list = &slistN;
@@ -912,7 +1033,7 @@ pgaspi_write_notify (const gaspi_segment_id_t segment_id_local,
   swrN.send_flags = IBV_SEND_SIGNALED | IBV_SEND_INLINE;;
   swrN.next = NULL;
 
-  if (ibv_post_send (glb_gaspi_ctx_ib.qpC[queue][rank], &swr, &bad_wr))
+  if (ibv_post_send (glb_gaspi_ctx_ib.peer[rank]->qpC[queue], &swr, &bad_wr))
   {
     glb_gaspi_ctx.qp_state_vec[queue][rank] = 1;
     unlock_gaspi (&glb_gaspi_ctx.lockC[queue]);
@@ -951,6 +1072,8 @@ pgaspi_write_list_notify (const gaspi_number_t num,
 			 const gaspi_timeout_t timeout_ms)
 {
 
+  gaspi_number_t r;
+
 #ifdef DEBUG
   gaspi_number_t n;
   
@@ -969,11 +1092,47 @@ pgaspi_write_list_notify (const gaspi_number_t num,
   for(n = 0; n < num; n++)
     {
       if(_check_func_params("gaspi_write_list_notify", segment_id_local[n], offset_local[n], rank,
-			    segment_id_remote[n], offset_remote[n], size[n],
-			    queue, timeout_ms) < 0)
+			    size[n], queue, timeout_ms) < 0)
 	return GASPI_ERROR;
     }
-  
+
+#endif
+
+  if (notification_id >= glb_gaspi_cfg.notification_num)
+    {
+      gaspi_print_error("Invalid notification id: %u (gaspi_write_list_notify)", notification_id);
+      return GASPI_ERROR;
+    }
+
+  for(r = 0; r < num; r++)
+    {
+      const gaspi_return_t eret = gaspi_segment_remote (segment_id_remote[r], rank, timeout_ms);
+      if(eret != GASPI_SUCCESS)
+	return eret;
+    }
+
+  const gaspi_return_t qret = gaspi_queue_remote (queue, rank, timeout_ms);
+  if(qret != GASPI_SUCCESS)
+    return qret;
+
+  const gaspi_return_t nret = gaspi_segment_remote (segment_id_notification, rank, timeout_ms);
+  if(nret != GASPI_SUCCESS)
+    return nret;
+
+#ifdef DEBUG
+  for(r = 0; r < num; r++)
+    {
+      if(_check_remote_params("gaspi_write_list_notify", segment_id_remote[r], rank,
+			      offset_remote[r], size[r]) < 0)
+	return GASPI_ERROR;
+    }
+
+  if(glb_gaspi_ctx_ib.rrmd[segment_id_notification] == NULL)
+    {
+      gaspi_print_error("Invalid notification segment %d (gaspi_write_list_notify)",
+			segment_id_notification);
+      return GASPI_ERROR;
+    }
 #endif
 
   struct ibv_send_wr *bad_wr;
@@ -998,13 +1157,12 @@ pgaspi_write_list_notify (const gaspi_number_t num,
 #endif
 	slist[i].addr =
 	  (uintptr_t) (glb_gaspi_ctx_ib.rrmd[segment_id_local[i]]
-		       [glb_gaspi_ctx.rank].addr + NOTIFY_OFFSET +
+		       [glb_gaspi_ctx.rank].addr +
 		       offset_local[i]);
 
       slist[i].length = size[i];
       slist[i].lkey =
-	glb_gaspi_ctx_ib.rrmd[segment_id_local[i]][glb_gaspi_ctx.rank].
-	mr->lkey;
+	glb_gaspi_ctx_ib.lmsd[segment_id_local[i]].lkey;
 
 #ifdef GPI2_CUDA
       if(glb_gaspi_ctx_ib.rrmd[segment_id_remote[i]][rank].cudaDevId>=0)
@@ -1015,7 +1173,7 @@ pgaspi_write_list_notify (const gaspi_number_t num,
 #endif
 	swr[i].wr.rdma.remote_addr =
 	  (glb_gaspi_ctx_ib.rrmd[segment_id_remote[i]][rank].addr +
-	   NOTIFY_OFFSET + offset_remote[i]);
+	   offset_remote[i]);
 
       swr[i].wr.rdma.rkey =
 	glb_gaspi_ctx_ib.rrmd[segment_id_remote[i]][rank].rkey;
@@ -1047,10 +1205,10 @@ pgaspi_write_list_notify (const gaspi_number_t num,
 #endif
     {
       swrN.wr.rdma.remote_addr =
-	(glb_gaspi_ctx_ib.rrmd[segment_id_notification][rank].addr +
+	(glb_gaspi_ctx_ib.rrmd[segment_id_notification][rank].notif_addr +
 	 notification_id * 4);
       swrN.wr.rdma.rkey =
-	glb_gaspi_ctx_ib.rrmd[segment_id_notification][rank].rkey;
+	glb_gaspi_ctx_ib.rrmd[segment_id_notification][rank].notif_rkey;
     }
   
   swrN.sg_list = &slistN;
@@ -1060,7 +1218,7 @@ pgaspi_write_list_notify (const gaspi_number_t num,
   swrN.send_flags = IBV_SEND_SIGNALED | IBV_SEND_INLINE;;
   swrN.next = NULL;
   
-  if (ibv_post_send (glb_gaspi_ctx_ib.qpC[queue][rank], &swr[0], &bad_wr))
+  if (ibv_post_send (glb_gaspi_ctx_ib.peer[rank]->qpC[queue], &swr[0], &bad_wr))
     {
       glb_gaspi_ctx.qp_state_vec[queue][rank] = 1;
       unlock_gaspi (&glb_gaspi_ctx.lockC[queue]);
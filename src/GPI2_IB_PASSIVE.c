@@ -65,22 +65,24 @@ pgaspi_passive_send (const gaspi_segment_id_t segment_id_local,
   struct ibv_wc wc_send;
   gaspi_cycles_t s0;
 
+  const gaspi_return_t eret = gaspi_connect_remote(rank, timeout_ms);
+  if(eret != GASPI_SUCCESS)
+    return eret;
+
   if(lock_gaspi_tout (&glb_gaspi_ctx.lockPS, timeout_ms))
     return GASPI_TIMEOUT;
 
-  const int byte_id = rank >> 3;
-  const int bit_pos = rank - (byte_id * 8);
-  const unsigned char bit_cmp = 1 << bit_pos;
-  if (glb_gaspi_ctx_ib.ne_count_p[byte_id] & bit_cmp)
+  gaspi_peer * const peer = glb_gaspi_ctx_ib.peer[rank];
+  if (peer->passive_busy)
     goto checkL;
 
   slist.addr =
     (uintptr_t) (glb_gaspi_ctx_ib.
 		 rrmd[segment_id_local][glb_gaspi_ctx.rank].addr +
-		 NOTIFY_OFFSET + offset_local);
+		 offset_local);
   slist.length = size;
   slist.lkey =
-    glb_gaspi_ctx_ib.rrmd[segment_id_local][glb_gaspi_ctx.rank].mr->lkey;
+    glb_gaspi_ctx_ib.lmsd[segment_id_local].lkey;
 
   swr.sg_list = &slist;
   swr.num_sge = 1;
@@ -89,14 +91,14 @@ pgaspi_passive_send (const gaspi_segment_id_t segment_id_local,
   swr.send_flags = IBV_SEND_SIGNALED;
   swr.next = NULL;
 
-  if (ibv_post_send (glb_gaspi_ctx_ib.qpP[rank], &swr, &bad_wr))
+  if (ibv_post_send (peer->qpP, &swr, &bad_wr))
     {
       glb_gaspi_ctx.qp_state_vec[GASPI_PASSIVE_QP][rank] = 1;
       unlock_gaspi (&glb_gaspi_ctx.lockPS);
       return GASPI_ERROR;
     }
 
-  glb_gaspi_ctx_ib.ne_count_p[byte_id] |= bit_cmp;
+  peer->passive_busy = 1;
 
 checkL:
 
@@ -130,7 +132,7 @@ checkL:
       return GASPI_ERROR;
     }
 
-  glb_gaspi_ctx_ib.ne_count_p[byte_id] &= (~bit_cmp);
+  peer->passive_busy = 0;
 
   unlock_gaspi (&glb_gaspi_ctx.lockPS);
   return GASPI_SUCCESS;
@@ -194,10 +196,10 @@ pgaspi_passive_receive (const gaspi_segment_id_t segment_id_local,
   rlist.addr =
     (uintptr_t) (glb_gaspi_ctx_ib.
 		 rrmd[segment_id_local][glb_gaspi_ctx.rank].addr +
-		 NOTIFY_OFFSET + offset_local);
+		 offset_local);
   rlist.length = size;
   rlist.lkey =
-    glb_gaspi_ctx_ib.rrmd[segment_id_local][glb_gaspi_ctx.rank].mr->lkey;
+    glb_gaspi_ctx_ib.lmsd[segment_id_local].lkey;
   rwr.wr_id = glb_gaspi_ctx.rank;
   rwr.sg_list = &rlist;
   rwr.num_sge = 1;
@@ -267,7 +269,8 @@ pgaspi_passive_receive (const gaspi_segment_id_t segment_id_local,
   *rem_rank = 0xffff;
   for (i = 0; i < glb_gaspi_ctx.tnc; i++)
     {
-      if (glb_gaspi_ctx_ib.qpP[i]->qp_num == wc_recv.qp_num)
+      if (glb_gaspi_ctx_ib.peer[i] != NULL
+	  && glb_gaspi_ctx_ib.peer[i]->qpP->qp_num == wc_recv.qp_num)
 	{
 	  *rem_rank = i;
 	  break;
@@ -16,7 +16,18 @@ You should have received a copy of the GNU General Public License
 along with GPI-2. If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/vfs.h>
+#include <linux/magic.h>
+
 #include "GPI2_Mem.h"
+#include "GPI2_Utility.h"
 
 gaspi_size_t gaspi_get_system_mem()
 {
@@ -73,3 +84,370 @@ gaspi_size_t gaspi_get_mem_in_use(void)
 
   return (gaspi_size_t) rss * (size_t)sysconf( _SC_PAGESIZE);
 }
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+#define GASPI_MEM_HUGEPAGE_ANY (GASPI_MEM_HUGEPAGE | GASPI_MEM_HUGEPAGE_2M | GASPI_MEM_HUGEPAGE_1G)
+#define GASPI_MEM_NUMA_ANY (GASPI_MEM_NUMA_LOCAL | GASPI_MEM_NUMA_INTERLEAVE | GASPI_MEM_NUMA_BIND)
+#define GASPI_THP_SIZE (2UL << 20)
+
+static unsigned long
+gaspi_hugepage_default_size (void)
+{
+  unsigned long kb = 0;
+  char line[128];
+
+  FILE *fp = fopen ("/proc/meminfo", "r");
+  if (fp == NULL)
+    return GASPI_THP_SIZE;
+
+  while (fgets (line, sizeof (line), fp) != NULL)
+    {
+      if (sscanf (line, "Hugepagesize: %lu kB", &kb) == 1)
+	break;
+    }
+  fclose (fp);
+
+  return kb ? kb << 10 : GASPI_THP_SIZE;
+}
+
+static void *
+gaspi_mmap_hugetlb (const unsigned long size, const int log2_page,
+		    unsigned long *map_size)
+{
+  const unsigned long page = (log2_page) ? (1UL << log2_page) : gaspi_hugepage_default_size ();
+  const unsigned long len = (size + page - 1) & ~(page - 1);
+
+  void *ptr = mmap (NULL, len, PROT_READ | PROT_WRITE,
+		    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (log2_page << MAP_HUGE_SHIFT),
+		    -1, 0);
+  if (ptr == MAP_FAILED)
+    return NULL;
+
+  *map_size = len;
+  return ptr;
+}
+
+/* Transparent huge pages: map 2 MB aligned memory and advise the
+   kernel to back it with huge pages */
+static void *
+gaspi_mmap_thp (const unsigned long size, unsigned long *map_size)
+{
+  const unsigned long len = (size + GASPI_THP_SIZE - 1) & ~(GASPI_THP_SIZE - 1);
+
+  char *raw = mmap (NULL, len + GASPI_THP_SIZE, PROT_READ | PROT_WRITE,
+		    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (raw == MAP_FAILED)
+    return NULL;
+
+  char *ptr = (char *) (((uintptr_t) raw + GASPI_THP_SIZE - 1) & ~(GASPI_THP_SIZE - 1));
+  if (ptr > raw)
+    munmap (raw, ptr - raw);
+  munmap (ptr + len, raw + GASPI_THP_SIZE - ptr);
+
+#ifdef MADV_HUGEPAGE
+  madvise (ptr, len, MADV_HUGEPAGE);
+#endif
+
+  *map_size = len;
+  return ptr;
+}
+
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#define MPOL_BIND 2
+#define MPOL_INTERLEAVE 3
+#endif
+
+#ifndef MPOL_F_MEMS_ALLOWED
+#define MPOL_F_MEMS_ALLOWED (1 << 2)
+#endif
+
+#define GASPI_NUMA_MAX_NODES (1024)
+#define GASPI_TOUCH_MAX_THREADS (64)
+#define GASPI_MEM_PREFAULT_MIN (64UL << 20)
+
+/* Set the NUMA policy of a fresh mapping (before any page is
+   touched). Returns 0 on success, -1 otherwise */
+static int
+gaspi_numa_policy (void *ptr, const unsigned long len,
+		   const gaspi_alloc_t alloc_policy)
+{
+  int mode;
+  unsigned int cpu, node;
+  unsigned long nodemask[GASPI_NUMA_MAX_NODES / (8 * sizeof (unsigned long))];
+  const unsigned long bits = 8 * sizeof (unsigned long);
+
+  memset (nodemask, 0, sizeof (nodemask));
+
+  if (alloc_policy & GASPI_MEM_NUMA_BIND)
+    {
+      node = (alloc_policy >> 16) & 0xffff;
+      mode = MPOL_BIND;
+    }
+  else if (alloc_policy & GASPI_MEM_NUMA_INTERLEAVE)
+    {
+      if (syscall (SYS_get_mempolicy, NULL, nodemask, GASPI_NUMA_MAX_NODES,
+		   NULL, MPOL_F_MEMS_ALLOWED) != 0)
+	return -1;
+
+      return syscall (SYS_mbind, ptr, len, MPOL_INTERLEAVE, nodemask,
+		      GASPI_NUMA_MAX_NODES, 0) == 0 ? 0 : -1;
+    }
+  else
+    {
+      if (syscall (SYS_getcpu, &cpu, &node, NULL) != 0)
+	return -1;
+      mode = MPOL_PREFERRED;
+    }
+
+  if (node >= GASPI_NUMA_MAX_NODES)
+    return -1;
+
+  nodemask[node / bits] = 1UL << (node % bits);
+
+  return syscall (SYS_mbind, ptr, len, mode, nodemask,
+		  GASPI_NUMA_MAX_NODES, 0) == 0 ? 0 : -1;
+}
+
+typedef struct
+{
+  pthread_t tid;
+  int cpu;
+  char *start, *end;
+} gaspi_touch_arg;
+
+static void *
+gaspi_touch_pages (void *arg)
+{
+  cpu_set_t mask;
+  char *p;
+  gaspi_touch_arg *t = (gaspi_touch_arg *) arg;
+  const long page_size = sysconf (_SC_PAGESIZE);
+
+  CPU_ZERO (&mask);
+  CPU_SET (t->cpu, &mask);
+  pthread_setaffinity_np (pthread_self (), sizeof (mask), &mask);
+
+  for (p = t->start; p < t->end; p += page_size)
+    *(volatile char *) p = 0;
+
+  return NULL;
+}
+
+/* First touch a fresh mapping in contiguous blocks spread over the
+   CPUs of the process affinity mask, in CPU order. Threads that use
+   the memory with the same static partitioning find their part
+   local. The ranks of a node share the online CPUs, and no rank
+   starts more than GASPI_TOUCH_MAX_THREADS */
+static int
+gaspi_parallel_touch (void *ptr, const unsigned long len)
+{
+  int i, n = 0, c = 0, cpu;
+  cpu_set_t mask;
+  gaspi_rank_t local_num;
+  gaspi_touch_arg *args;
+  const long page_size = sysconf (_SC_PAGESIZE);
+  const unsigned long npages = len / page_size;
+
+  if (sched_getaffinity (0, sizeof (mask), &mask) != 0)
+    return -1;
+
+  if (gaspi_proc_local_num (&local_num) != GASPI_SUCCESS || local_num == 0)
+    local_num = 1;
+
+  const long online = sysconf (_SC_NPROCESSORS_ONLN);
+  const int ncpus = (int) MIN (CPU_COUNT (&mask), online);
+  const long share = MAX (online / local_num, 1);
+  const int nthreads =
+    (int) MIN (MIN (MIN (ncpus, share), GASPI_TOUCH_MAX_THREADS), (long) npages);
+  if (nthreads <= 1)
+    {
+      memset (ptr, 0, len);
+      return 0;
+    }
+
+  args = calloc (nthreads, sizeof (gaspi_touch_arg));
+  if (args == NULL)
+    return -1;
+
+  //thread n on the (n * ncpus / nthreads)-th CPU of the mask
+  for (cpu = 0; cpu < CPU_SETSIZE && n < nthreads; cpu++)
+    {
+      if (!CPU_ISSET (cpu, &mask))
+	continue;
+
+      if (c++ != n * ncpus / nthreads)
+	continue;
+
+      args[n].cpu = cpu;
+      args[n].start = (char *) ptr + (npages * n / nthreads) * page_size;
+      args[n].end = (char *) ptr + (npages * (n + 1) / nthreads) * page_size;
+
+      if (pthread_create (&args[n].tid, NULL, gaspi_touch_pages, &args[n]) != 0)
+	break;
+      n++;
+    }
+
+  for (i = 0; i < n; i++)
+    pthread_join (args[i].tid, NULL);
+
+  //whatever was not covered by a thread
+  if (n < nthreads)
+    memset (args[n].start, 0, (char *) ptr + len - args[n].start);
+
+  free (args);
+
+  return 0;
+}
+
+/* Allocate the memory of a segment. Huge page policies try the
+   requested huge page size first, then smaller huge pages and finally
+   transparent huge pages. NUMA and first touch policies need a fresh
+   mapping, so they mmap regular pages too. Large segments are always
+   mmap'ed (zero-ed by the kernel) and faulted in by all CPUs of the
+   process, so that neither zeroing nor mlock fault them serially.
+   Returns 0 on success, -1 otherwise */
+int
+gaspi_segment_mem_alloc (void **ptr, const unsigned long size,
+			 const gaspi_alloc_t alloc_policy,
+			 unsigned long *map_size)
+{
+  const int prefault = (size >= GASPI_MEM_PREFAULT_MIN);
+
+  *map_size = 0;
+
+  if (!(alloc_policy & (GASPI_MEM_HUGEPAGE_ANY | GASPI_MEM_NUMA_ANY | GASPI_MEM_PARALLEL_TOUCH))
+      && !prefault)
+    {
+      const long page_size = sysconf (_SC_PAGESIZE);
+
+      return (posix_memalign (ptr, page_size, size) != 0) ? -1 : 0;
+    }
+
+  *ptr = NULL;
+
+  if (alloc_policy & GASPI_MEM_HUGEPAGE_ANY)
+    {
+      if (alloc_policy & GASPI_MEM_HUGEPAGE_1G)
+	*ptr = gaspi_mmap_hugetlb (size, 30, map_size);
+
+      if (*ptr == NULL && (alloc_policy & (GASPI_MEM_HUGEPAGE_1G | GASPI_MEM_HUGEPAGE_2M)))
+	*ptr = gaspi_mmap_hugetlb (size, 21, map_size);
+
+      if (*ptr == NULL)
+	*ptr = gaspi_mmap_hugetlb (size, 0, map_size);
+
+      if (*ptr == NULL)
+	*ptr = gaspi_mmap_thp (size, map_size);
+    }
+  else
+    {
+      const long page_size = sysconf (_SC_PAGESIZE);
+      const unsigned long len = (size + page_size - 1) & ~(page_size - 1);
+
+      *ptr = mmap (NULL, len, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (*ptr == MAP_FAILED)
+	*ptr = NULL;
+      else
+	*map_size = len;
+    }
+
+  if (*ptr == NULL)
+    return -1;
+
+  if ((alloc_policy & GASPI_MEM_NUMA_ANY)
+      && gaspi_numa_policy (*ptr, *map_size, alloc_policy) != 0)
+    {
+      gaspi_print_error ("Failed to set NUMA policy (mbind)");
+      goto errL;
+    }
+
+  /* keep the pages on the node of the caller, as a serial touch
+     would (best effort) */
+  if (prefault && !(alloc_policy & (GASPI_MEM_NUMA_ANY | GASPI_MEM_PARALLEL_TOUCH)))
+    gaspi_numa_policy (*ptr, *map_size, GASPI_MEM_NUMA_LOCAL);
+
+  if (((alloc_policy & GASPI_MEM_PARALLEL_TOUCH) || prefault)
+      && gaspi_parallel_touch (*ptr, *map_size) != 0)
+    {
+      gaspi_print_error ("Failed to first touch memory");
+      goto errL;
+    }
+
+  return 0;
+
+errL:
+  munmap (*ptr, *map_size);
+  *ptr = NULL;
+  *map_size = 0;
+  return -1;
+}
+
+/* Map a file shared as the memory of a segment. The file is created
+   or grown (with zeroes) to size; existing content is kept, which is
+   what a restart needs. Only tmpfs and hugetlbfs files: pages of a
+   disk file cannot stay pinned for the HCA, and remote writes would
+   not be seen by the write-back. Returns 0 on success, -1 otherwise */
+int
+gaspi_segment_mem_map_file (void **ptr, const char *path,
+			    const unsigned long size,
+			    unsigned long *map_size)
+{
+  struct stat st;
+  struct statfs fs;
+  const long page_size = sysconf (_SC_PAGESIZE);
+  const unsigned long len = (size + page_size - 1) & ~(page_size - 1);
+
+  *ptr = NULL;
+  *map_size = 0;
+
+  const int fd = open (path, O_RDWR | O_CREAT, 0600);
+  if (fd < 0)
+    {
+      gaspi_print_error ("Failed to open %s", path);
+      return -1;
+    }
+
+  if (fstatfs (fd, &fs) != 0
+      || (fs.f_type != TMPFS_MAGIC && fs.f_type != HUGETLBFS_MAGIC))
+    {
+      gaspi_print_error ("%s is not on tmpfs or hugetlbfs", path);
+      close (fd);
+      return -1;
+    }
+
+  if (fstat (fd, &st) != 0
+      || ((unsigned long) st.st_size < size && ftruncate (fd, size) != 0))
+    {
+      gaspi_print_error ("Failed to size %s to %lu", path, size);
+      close (fd);
+      return -1;
+    }
+
+  void *p = mmap (NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close (fd);
+
+  if (p == MAP_FAILED)
+    {
+      gaspi_print_error ("Failed to map %s", path);
+      return -1;
+    }
+
+  *ptr = p;
+  *map_size = len;
+
+  return 0;
+}
+
+void
+gaspi_segment_mem_free (void *ptr, const unsigned long map_size)
+{
+  if (map_size)
+    munmap (ptr, map_size);
+  else
+    free (ptr);
+}
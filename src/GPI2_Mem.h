@@ -30,4 +30,12 @@ gaspi_size_t gaspi_get_mem_peak(void);
 
 gaspi_size_t gaspi_get_mem_in_use(void);
 
+int gaspi_segment_mem_alloc (void **ptr, const unsigned long size,
+			     const gaspi_alloc_t alloc_policy,
+			     unsigned long *map_size);
 
+int gaspi_segment_mem_map_file (void **ptr, const char *path,
+				const unsigned long size,
+				unsigned long *map_size);
+
+void gaspi_segment_mem_free (void *ptr, const unsigned long map_size);
@@ -18,8 +18,10 @@ along with GPI-2. If not, see <http://www.gnu.org/licenses/>.
 
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <netdb.h>
 #include <netinet/tcp.h>
+#include <poll.h>
 #include <signal.h>
 #include <sys/resource.h>
 #include <sys/socket.h>
@@ -27,14 +29,20 @@ along with GPI-2. If not, see <http://www.gnu.org/licenses/>.
 #include <sys/epoll.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "GPI2.h"
 #include "GPI2_SN.h"
 
 /* Status and return value of SN thread: mostly for error detection */
 volatile enum gaspi_sn_status gaspi_sn_status = GASPI_SN_STATE_OK;
 volatile gaspi_return_t gaspi_sn_err = GASPI_SUCCESS;
 
+/* bootstrap tree: connection from our parent, go-ahead received */
+volatile int gaspi_sn_parent_fd = -1;
+volatile int gaspi_sn_go = 0;
+
 
 extern gaspi_config_t glb_gaspi_cfg;
 
@@ -182,6 +190,351 @@ int gaspi_connect2port(const char *hn,const unsigned short port,const unsigned l
   return sockfd;
 }
 
+/* Open the SN connection to a rank on first use (context lock
+   held). Returns 0 on success, -1 otherwise */
+int
+gaspi_sn_connect (const gaspi_rank_t rank, const gaspi_timeout_t timeout_ms)
+{
+  if (glb_gaspi_ctx.sockfd[rank] >= 0)
+    return 0;
+
+  const int fd = gaspi_connect2port (gaspi_get_hn (rank),
+				     glb_gaspi_cfg.sn_port + glb_gaspi_ctx.poff[rank],
+				     timeout_ms);
+  if (fd < 0)
+    {
+      gaspi_sn_print_error ("Failed to connect to rank %u", rank);
+      return -1;
+    }
+
+  glb_gaspi_ctx.sockfd[rank] = fd;
+  return 0;
+}
+
+/* Requests waiting for their reply, per rank and oldest first (the
+   order replies usually come in). Like the sockets they are used with
+   the context lock held */
+static gaspi_sn_req **sn_outstanding = NULL;
+static gaspi_sn_req **sn_last = NULL;
+static int sn_req_id = 0;
+
+/* gaspi_sn_waitall: polled ranks are marked, each socket is polled once */
+static unsigned char *sn_polled = NULL;
+
+static int
+gaspi_sn_write_full(const int fd, const void *buf, const int len)
+{
+  int done = 0;
+
+  while(done < len)
+    {
+      const int ret = write(fd, (const char *) buf + done, len - done);
+      if(ret < 0 && errno == EINTR)
+	continue;
+      if(ret <= 0)
+	return -1;
+
+      done += ret;
+    }
+
+  return 0;
+}
+
+static int
+gaspi_sn_read_full(const int fd, void *buf, const int len)
+{
+  int done = 0;
+
+  while(done < len)
+    {
+      const int ret = read(fd, (char *) buf + done, len - done);
+      if(ret < 0 && errno == EINTR)
+	continue;
+      if(ret <= 0)
+	return -1;
+
+      done += ret;
+    }
+
+  return 0;
+}
+
+static void
+gaspi_sn_unlink(gaspi_sn_req *req)
+{
+  gaspi_sn_req *prev = NULL, *p = sn_outstanding[req->rank];
+
+  while(p != NULL && p != req)
+    {
+      prev = p;
+      p = p->next;
+    }
+
+  if(p == NULL)
+    return;
+
+  if(prev == NULL)
+    sn_outstanding[req->rank] = req->next;
+  else
+    prev->next = req->next;
+
+  if(sn_last[req->rank] == req)
+    sn_last[req->rank] = prev;
+
+  req->next = NULL;
+}
+
+/* The connection to rank is broken: fail what is outstanding on it,
+   it is opened again on the next request */
+static void
+gaspi_sn_fail(const gaspi_rank_t rank)
+{
+  gaspi_sn_req *req = sn_outstanding[rank];
+
+  while(req != NULL)
+    {
+      gaspi_sn_req *next = req->next;
+
+      req->state = GASPI_SN_REQ_FAILED;
+      req->next = NULL;
+      req = next;
+    }
+  sn_outstanding[rank] = NULL;
+  sn_last[rank] = NULL;
+
+  if(glb_gaspi_ctx.sockfd[rank] >= 0)
+    {
+      shutdown(glb_gaspi_ctx.sockfd[rank], SHUT_RDWR);
+      close(glb_gaspi_ctx.sockfd[rank]);
+      glb_gaspi_ctx.sockfd[rank] = -1;
+    }
+
+  glb_gaspi_ctx.qp_state_vec[GASPI_SN][rank] = 1;
+}
+
+/* Send a request (header and len bytes of data) to the SN thread of
+   rank. With req, its reply of rlen bytes is expected in reply, see
+   gaspi_sn_waitall. Returns 0 on success, -1 otherwise */
+int
+gaspi_sn_post(const gaspi_rank_t rank, gaspi_cd_header *cdh,
+	      const void *data, const int len,
+	      gaspi_sn_req *req, void *reply, const int rlen,
+	      const gaspi_timeout_t timeout_ms)
+{
+  if(sn_outstanding == NULL)
+    {
+      sn_outstanding = (gaspi_sn_req **) calloc(glb_gaspi_ctx.tnc, sizeof(gaspi_sn_req *));
+      sn_last = (gaspi_sn_req **) calloc(glb_gaspi_ctx.tnc, sizeof(gaspi_sn_req *));
+      sn_polled = (unsigned char *) calloc(glb_gaspi_ctx.tnc, sizeof(unsigned char));
+      if(sn_outstanding == NULL || sn_last == NULL || sn_polled == NULL)
+	{
+	  gaspi_sn_requests_free();
+	  return -1;
+	}
+    }
+
+  if(gaspi_sn_connect(rank, timeout_ms) != 0)
+    {
+      glb_gaspi_ctx.qp_state_vec[GASPI_SN][rank] = 1;
+      return -1;
+    }
+
+  cdh->id = ++sn_req_id;
+
+  if(req != NULL)
+    {
+      req->id = cdh->id;
+      req->rank = rank;
+      req->state = GASPI_SN_REQ_POSTED;
+      req->reply = reply;
+      req->rlen = rlen;
+      req->next = NULL;
+
+      if(sn_last[rank] == NULL)
+	sn_outstanding[rank] = req;
+      else
+	sn_last[rank]->next = req;
+      sn_last[rank] = req;
+    }
+
+  if(gaspi_sn_write_full(glb_gaspi_ctx.sockfd[rank], cdh, sizeof(gaspi_cd_header)) != 0
+     || (len > 0 && gaspi_sn_write_full(glb_gaspi_ctx.sockfd[rank], data, len) != 0))
+    {
+      gaspi_sn_print_error("Failed to send request to rank %u", rank);
+      gaspi_sn_fail(rank);
+      return -1;
+    }
+
+  return 0;
+}
+
+/* Read one reply from rank and hand it to its request. Replies to
+   requests given up on (gaspi_sn_cancel) are dropped */
+static void
+gaspi_sn_progress(const gaspi_rank_t rank)
+{
+  gaspi_sn_reply_hdr hdr;
+  gaspi_sn_req *req;
+  const int fd = glb_gaspi_ctx.sockfd[rank];
+
+  if(gaspi_sn_read_full(fd, &hdr, sizeof(hdr)) != 0 || hdr.len < 0)
+    {
+      gaspi_sn_fail(rank);
+      return;
+    }
+
+  for(req = sn_outstanding[rank]; req != NULL; req = req->next)
+    {
+      if(req->id == hdr.id)
+	break;
+    }
+
+  int done = 0;
+
+  if(req != NULL)
+    {
+      done = MIN(hdr.len, req->rlen);
+      if(gaspi_sn_read_full(fd, req->reply, done) != 0)
+	{
+	  gaspi_sn_fail(rank);
+	  return;
+	}
+
+      gaspi_sn_unlink(req);
+      req->state = (hdr.len == req->rlen) ? GASPI_SN_REQ_DONE : GASPI_SN_REQ_FAILED;
+    }
+
+  while(done < hdr.len)
+    {
+      char drop[256];
+      const int len = MIN(hdr.len - done, (int) sizeof(drop));
+
+      if(gaspi_sn_read_full(fd, drop, len) != 0)
+	{
+	  gaspi_sn_fail(rank);
+	  return;
+	}
+      done += len;
+    }
+}
+
+/* Wait for the replies to the posted requests of reqs. Returns
+   GASPI_TIMEOUT if some are still outstanding after timeout_ms (they
+   can be waited for again or cancelled) and GASPI_ERROR if one
+   failed */
+gaspi_return_t
+gaspi_sn_waitall(gaspi_sn_req *reqs, const int num, const gaspi_timeout_t timeout_ms)
+{
+  int i, r;
+  gaspi_return_t eret = GASPI_SUCCESS;
+  struct timespec t0, t1;
+
+  struct pollfd *pfd = (struct pollfd *) malloc(num * sizeof(struct pollfd));
+  int *prank = (int *) malloc(num * sizeof(int));
+  if(pfd == NULL || prank == NULL)
+    {
+      free(pfd);
+      free(prank);
+      return GASPI_ERROR;
+    }
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+
+  for(;;)
+    {
+      int n = 0;
+
+      for(i = 0; i < num; i++)
+	{
+	  if(reqs[i].state != GASPI_SN_REQ_POSTED || sn_polled[reqs[i].rank])
+	    continue;
+
+	  sn_polled[reqs[i].rank] = 1;
+	  pfd[n].fd = glb_gaspi_ctx.sockfd[reqs[i].rank];
+	  pfd[n].events = POLLIN;
+	  pfd[n].revents = 0;
+	  prank[n++] = reqs[i].rank;
+	}
+
+      for(r = 0; r < n; r++)
+	sn_polled[prank[r]] = 0;
+
+      if(n == 0)
+	break;
+
+      int wait_ms = -1;
+      if(timeout_ms != GASPI_BLOCK)
+	{
+	  clock_gettime(CLOCK_MONOTONIC, &t1);
+	  const unsigned long delta_ms = (t1.tv_sec - t0.tv_sec) * 1000
+	    + (t1.tv_nsec - t0.tv_nsec) / 1000000;
+
+	  wait_ms = (delta_ms >= timeout_ms) ? 0 : (int) MIN(timeout_ms - delta_ms, INT_MAX);
+	}
+
+      const int pret = poll(pfd, n, wait_ms);
+      if(pret < 0 && errno != EINTR)
+	{
+	  eret = GASPI_ERROR;
+	  break;
+	}
+
+      if(pret == 0)
+	{
+	  eret = GASPI_TIMEOUT;
+	  break;
+	}
+
+      for(r = 0; r < n; r++)
+	{
+	  if(!(pfd[r].revents & (POLLIN | POLLERR | POLLHUP)))
+	    continue;
+
+	  //take all replies that are in
+	  do
+	    {
+	      gaspi_sn_progress(prank[r]);
+	      pfd[r].revents = 0;
+	    }
+	  while(glb_gaspi_ctx.sockfd[prank[r]] >= 0
+		&& sn_outstanding[prank[r]] != NULL
+		&& poll(&pfd[r], 1, 0) > 0);
+	}
+    }
+
+  free(pfd);
+  free(prank);
+
+  for(i = 0; eret == GASPI_SUCCESS && i < num; i++)
+    {
+      if(reqs[i].state == GASPI_SN_REQ_FAILED)
+	eret = GASPI_ERROR;
+    }
+
+  return eret;
+}
+
+/* Give up on a request, a late reply is dropped */
+void
+gaspi_sn_cancel(gaspi_sn_req *req)
+{
+  if(req->state == GASPI_SN_REQ_POSTED)
+    gaspi_sn_unlink(req);
+
+  req->state = GASPI_SN_REQ_IDLE;
+}
+
+void
+gaspi_sn_requests_free(void)
+{
+  free(sn_outstanding);
+  free(sn_last);
+  free(sn_polled);
+  sn_outstanding = NULL;
+  sn_last = NULL;
+  sn_polled = NULL;
+}
+
 void gaspi_sn_cleanup(int sig)
 {
   //do cleanup here
@@ -190,10 +543,213 @@ void gaspi_sn_cleanup(int sig)
 }
 
 extern gaspi_ib_ctx glb_gaspi_ctx_ib;
-extern gaspi_ib_group glb_gaspi_group_ib[GASPI_MAX_GROUPS];
+extern gaspi_ib_group *glb_gaspi_group_ib;
 
 int gaspi_seg_reg_sn(const gaspi_cd_header snp);
 
+/* The epoll set of the SN thread: replies that cannot be written at
+   once wait in the connection's buffer until the socket is writable */
+static int gaspi_sn_esock = -1;
+
+static int
+gaspi_sn_flush(gaspi_mgmt_header *mgmt)
+{
+  struct epoll_event ev;
+
+  while(mgmt->odone < mgmt->olen)
+    {
+      const int ret = write(mgmt->fd, mgmt->obuf + mgmt->odone, mgmt->olen - mgmt->odone);
+
+      if(ret < 0)
+	{
+	  if(errno == EINTR)
+	    continue;
+
+	  if(errno != EAGAIN && errno != EWOULDBLOCK)
+	    {
+	      gaspi_sn_print_error("Failed to write.");
+	      return -1;
+	    }
+	  break;
+	}
+
+      mgmt->odone += ret;
+    }
+
+  const int want_out = (mgmt->odone < mgmt->olen);
+
+  if(mgmt->odone == mgmt->olen)
+    mgmt->odone = mgmt->olen = 0;
+
+  if(want_out != mgmt->epollout)
+    {
+      ev.data.ptr = mgmt;
+      ev.events = want_out ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+
+      if(epoll_ctl(gaspi_sn_esock, EPOLL_CTL_MOD, mgmt->fd, &ev) < 0)
+	{
+	  gaspi_sn_print_error("Failed to modify IO event facility");
+	  return -1;
+	}
+      mgmt->epollout = want_out;
+    }
+
+  return 0;
+}
+
+/* Queue the reply to request id on a connection: a gaspi_sn_reply_hdr
+   followed by len bytes of data */
+static int
+gaspi_sn_reply(gaspi_mgmt_header *mgmt, const int id, const void *data, const int len)
+{
+  gaspi_sn_reply_hdr hdr;
+  const int need = mgmt->olen + (int) sizeof(hdr) + len;
+
+  if(need > mgmt->ocap)
+    {
+      const int ocap = MAX(need, 2 * mgmt->ocap);
+      char *obuf = (char *) realloc(mgmt->obuf, ocap);
+      if(obuf == NULL)
+	{
+	  gaspi_sn_print_error("Failed to allocate memory");
+	  return -1;
+	}
+      mgmt->obuf = obuf;
+      mgmt->ocap = ocap;
+    }
+
+  hdr.id = id;
+  hdr.len = len;
+
+  memcpy(mgmt->obuf + mgmt->olen, &hdr, sizeof(hdr));
+  memcpy(mgmt->obuf + mgmt->olen + sizeof(hdr), data, len);
+  mgmt->olen = need;
+
+  return gaspi_sn_flush(mgmt);
+}
+
+/* Answer a segment info request with our descriptor (size 0 if the
+   segment does not exist) */
+static int
+gaspi_sn_seg_reply(gaspi_mgmt_header *mgmt, const int segment_id)
+{
+  gaspi_cd_header cdh;
+
+  gaspi_seg_info_sn((gaspi_segment_id_t) segment_id, mgmt->cdh.rank, &cdh);
+
+  return gaspi_sn_reply(mgmt, mgmt->cdh.id, &cdh, sizeof(cdh));
+}
+
+/* Answer a request with a single int */
+static int
+gaspi_sn_int_reply(gaspi_mgmt_header *mgmt, int val)
+{
+  return gaspi_sn_reply(mgmt, mgmt->cdh.id, &val, sizeof(int));
+}
+
+/* Group checks received before the local commit are answered once the
+   group is ready. The pipe wakes up the SN thread for that. */
+typedef struct gaspi_grp_pending
+{
+  gaspi_mgmt_header *mgmt;
+  int id,tnc;
+  struct gaspi_grp_pending *next;
+} gaspi_grp_pending;
+
+static gaspi_grp_pending **grp_pending = NULL;
+static int gaspi_sn_wakeup[2] = {-1, -1};
+
+void
+gaspi_sn_group_ready(const gaspi_group_t group)
+{
+  if(gaspi_sn_wakeup[1] < 0)
+    return;
+
+  const int g = group;
+  if(write(gaspi_sn_wakeup[1], &g, sizeof(g)) != sizeof(g))
+    {
+      gaspi_sn_print_error("Failed to wake up SN thread");
+    }
+}
+
+static int
+gaspi_sn_grp_reply(gaspi_mgmt_header *mgmt, const int id, const int group, const int tnc)
+{
+  int i;
+  gaspi_grp_check gb;
+
+  memset(&gb, 0, sizeof(gb));
+  gb.ret = -1;
+
+  //an invalid group fails the check, the asking rank must not hang
+  if(group >= 0 && group < glb_gaspi_cfg.group_max
+     && glb_gaspi_group_ib[group].id >= 0 && glb_gaspi_group_ib[group].tnc == tnc
+     && glb_gaspi_group_ib[group].buf != NULL)
+    {
+      gb.ret = 0;
+      gb.tnc = tnc;
+
+      for(i = 0; i < tnc; i++)
+	gb.cs ^= glb_gaspi_group_ib[group].rank_grp[i];
+
+      gb.rrcd.rkeyGroup = glb_gaspi_group_ib[group].mr->rkey;
+      gb.rrcd.vaddrGroup = (uintptr_t) glb_gaspi_group_ib[group].buf;
+    }
+
+  return gaspi_sn_reply(mgmt, id, &gb, sizeof(gb));
+}
+
+static void
+gaspi_sn_grp_flush(const int group)
+{
+  gaspi_grp_pending *p = grp_pending[group];
+
+  grp_pending[group] = NULL;
+
+  while(p != NULL)
+    {
+      gaspi_grp_pending *next = p->next;
+
+      if(gaspi_sn_grp_reply(p->mgmt, p->id, group, p->tnc) != 0)
+	{
+	  gaspi_sn_print_error("Failed to answer group check");
+	}
+      free(p);
+      p = next;
+    }
+}
+
+/* Close a connection: its queued replies and pending group checks go
+   with it */
+static void
+gaspi_sn_close(gaspi_mgmt_header *mgmt)
+{
+  int g;
+
+  for(g = 0; grp_pending != NULL && g < glb_gaspi_cfg.group_max; g++)
+    {
+      gaspi_grp_pending **pp = &grp_pending[g];
+
+      while(*pp != NULL)
+	{
+	  gaspi_grp_pending *p = *pp;
+
+	  if(p->mgmt == mgmt)
+	    {
+	      *pp = p->next;
+	      free(p);
+	    }
+	  else
+	    pp = &p->next;
+	}
+    }
+
+  shutdown(mgmt->fd,SHUT_RDWR);
+  close(mgmt->fd);
+  free(mgmt->obuf);
+  free(mgmt);
+}
+
 void *gaspi_sn_backend(void *arg)
 {
   int esock,lsock,n,i;
@@ -279,9 +835,10 @@ void *gaspi_sn_backend(void *arg)
       
       return NULL;
     }
+  gaspi_sn_esock = esock;
   
   //add lsock
-  ev.data.ptr = malloc(sizeof(gaspi_mgmt_header));
+  ev.data.ptr = calloc(1, sizeof(gaspi_mgmt_header));
   if(ev.data.ptr == NULL)
     {
       gaspi_sn_print_error("Failed to allocate memory");
@@ -304,6 +861,49 @@ void *gaspi_sn_backend(void *arg)
       return NULL;
     }
 
+  //add wake-up pipe
+  grp_pending = (gaspi_grp_pending **) calloc(glb_gaspi_cfg.group_max, sizeof(gaspi_grp_pending *));
+  if(grp_pending == NULL)
+    {
+      gaspi_sn_print_error("Failed to allocate memory");
+      gaspi_sn_status = GASPI_SN_STATE_ERROR;
+      gaspi_sn_err = GASPI_ERROR;
+
+      return NULL;
+    }
+
+  if(pipe(gaspi_sn_wakeup) < 0 || gaspi_set_non_blocking(gaspi_sn_wakeup[0]) != 0)
+    {
+      gaspi_sn_print_error("Failed to create wake-up pipe");
+      gaspi_sn_status = GASPI_SN_STATE_ERROR;
+      gaspi_sn_err = GASPI_ERROR;
+
+      return NULL;
+    }
+
+  ev.data.ptr = calloc(1, sizeof(gaspi_mgmt_header));
+  if(ev.data.ptr == NULL)
+    {
+      gaspi_sn_print_error("Failed to allocate memory");
+      gaspi_sn_status = GASPI_SN_STATE_ERROR;
+      gaspi_sn_err = GASPI_ERROR;
+
+      return NULL;
+    }
+
+  ev_mgmt = ev.data.ptr;
+  ev_mgmt->fd = gaspi_sn_wakeup[0];
+  ev.events = EPOLLIN ;//read only
+
+  if(epoll_ctl(esock,EPOLL_CTL_ADD,gaspi_sn_wakeup[0],&ev) < 0)
+    {
+      gaspi_sn_print_error("Failed to modify IO event facility");
+      gaspi_sn_status = GASPI_SN_STATE_ERROR;
+      gaspi_sn_err = GASPI_ERROR;
+
+      return NULL;
+    }
+
   ret_ev = calloc(GASPI_EPOLL_MAX_EVENTS,sizeof(ev));
   if(ret_ev == NULL)
     {
@@ -332,9 +932,7 @@ void *gaspi_sn_backend(void *arg)
 	    {
 	      
 	      /* an error has occured on this fd. close it => removed from event list. */
-	      shutdown(mgmt->fd,2);
-	      close(mgmt->fd);
-	      free(mgmt);
+	      gaspi_sn_close(mgmt);
 	      continue;
 	    }
 	  else if(mgmt->fd == lsock)
@@ -378,7 +976,14 @@ void *gaspi_sn_backend(void *arg)
 		  gaspi_set_non_blocking(nsock);
 
 		  /* add nsock */
-		  ev.data.ptr = malloc(sizeof(gaspi_mgmt_header));
+		  ev.data.ptr = calloc(1, sizeof(gaspi_mgmt_header));
+		  if(ev.data.ptr == NULL)
+		    {
+		      gaspi_sn_print_error("Failed to allocate memory");
+		      close(nsock);
+		      continue;
+		    }
+
 		  ev_mgmt = ev.data.ptr;
 		  ev_mgmt->fd = nsock;
 		  ev_mgmt->blen = sizeof(gaspi_cd_header);//at first we need a header
@@ -395,28 +1000,33 @@ void *gaspi_sn_backend(void *arg)
 		      return NULL;
 		    }
 
-		  /* count number of connections: main thread is waiting for this */
-		  if(__sync_fetch_and_add(&glb_gaspi_init, 1) == -1)
-		    {
-		      gaspi_sn_print_error("Failed to increase no. of connections");
- 		      gaspi_sn_status = GASPI_SN_STATE_ERROR;
-		      gaspi_sn_err = GASPI_ERROR;
-
-		      return NULL;
-		    }
-		  
-		  
-		  // gaspi_thread_sleep(600000);
 		  // }//while(1) accept
 	      
 	      continue;
 	    }/* new connection(s) */
+	  else if(mgmt->fd == gaspi_sn_wakeup[0])
+	    {
+	      /* groups committed locally: answer pending checks */
+	      int group;
+
+	      while(read(gaspi_sn_wakeup[0], &group, sizeof(group)) == sizeof(group))
+		{
+		  if(group >= 0 && group < glb_gaspi_cfg.group_max)
+		    gaspi_sn_grp_flush(group);
+		}
+
+	      continue;
+	    }
 	  else
 	    {
 	      /* read or write ops */
 	      int io_err=0;
+
+	      //queued replies
+	      if((ret_ev[i].events & EPOLLOUT) && gaspi_sn_flush(mgmt) != 0)
+		io_err = 1;
 	      
-	      if(ret_ev[i].events & EPOLLIN) //read in
+	      if(!io_err && (ret_ev[i].events & EPOLLIN)) //read in
 		{
 
 		  while(1)
@@ -439,7 +1049,7 @@ void *gaspi_sn_backend(void *arg)
 			}
 		      else if(mgmt->op == GASPI_SN_CONNECT)
 			{
-			  ptr = (char*)&glb_gaspi_ctx_ib.rrcd[mgmt->cdh.rank];//gaspi_get_rrmd(mgmt->cdh.rank);
+			  ptr = (char*)&glb_gaspi_ctx_ib.peer[mgmt->cdh.rank]->rrcd;//gaspi_get_rrmd(mgmt->cdh.rank);
 			  rcount = read(mgmt->fd,ptr + mgmt->bdone,rsize);
 			  
 			}
@@ -453,7 +1063,7 @@ void *gaspi_sn_backend(void *arg)
 			      gaspi_printf("%s: %s\n", "reset/notconn", strerror(errsv));    
 			    }
 			  
-			  if(errsv != EAGAIN || errsv != EWOULDBLOCK)
+			  if(errsv != EAGAIN && errsv != EWOULDBLOCK)
 			    {
 			      io_err=1;
 			    }
@@ -496,7 +1106,16 @@ void *gaspi_sn_backend(void *arg)
 				  }
 				else if(mgmt->cdh.op == GASPI_SN_CONNECT)
 				  {
-				    /* connect */
+				    /* connect: the endpoint keeps the remote info read next */
+				    if(gaspi_create_endpoint(mgmt->cdh.rank) != 0)
+				      {
+					gaspi_sn_print_error("Failed to create endpoint");
+					gaspi_sn_status = GASPI_SN_STATE_ERROR;
+					gaspi_sn_err = GASPI_ERROR;
+
+					return NULL;
+				      }
+
 				    mgmt->bdone = 0;
 				    mgmt->blen = mgmt->cdh.op_len;
 				    mgmt->op = mgmt->cdh.op;
@@ -504,113 +1123,71 @@ void *gaspi_sn_backend(void *arg)
 				  }
 				else if(mgmt->cdh.op==GASPI_SN_GRP_CHECK)
 				  {
-				    /* grp check */
-				    struct{int tnc,cs,ret;} gb;
-				    gb.ret = -1;
-				    gb.cs = 0;
-				    
+				    /* grp check: answer now or once committed */
 				    const int group = mgmt->cdh.rank;
-				    const int tnc = mgmt->cdh.tnc;
-				    
-				    if(glb_gaspi_group_ib[group].id >= 0)
-				      {
-					if(glb_gaspi_group_ib[group].tnc == tnc)
-					  {
-					    gb.ret=0;gb.tnc=tnc;
-					    
-					    for(i = 0;i < tnc; i++)
-					      {
-						if(NULL != glb_gaspi_group_ib[group].rank_grp)
-						  gb.cs ^= glb_gaspi_group_ib[group].rank_grp[i];
-					      }
-					  }
-				      }
-				    
-				    /* write back */
-				    int done = 0;
-				    int len = sizeof(gb);
-				    char *ptr = (char*)&gb;
-				    
-				    while(done < len)
+				    gaspi_grp_pending *p = NULL;
+
+				    if(group >= 0 && group < glb_gaspi_cfg.group_max
+				       && !glb_gaspi_group_ib[group].ready)
+				      p = malloc(sizeof(gaspi_grp_pending));
+
+				    if(p != NULL)
 				      {
-					int ret = write(mgmt->fd,ptr+done,len-done);
-				  
-					if(ret < 0)
-					  {
-					    /* errno==EAGAIN,that means we have written all data */
-					    if(errno!=EAGAIN)
-					      {
-						gaspi_sn_print_error("Failed to write.");
-						break;
-					      }
-					  }
-					
-					if(ret > 0) 
-					  done+=ret;
+					p->mgmt = mgmt;
+					p->id = mgmt->cdh.id;
+					p->tnc = mgmt->cdh.tnc;
+					p->next = grp_pending[group];
+					grp_pending[group] = p;
 				      }
-				    
+				    else
+				      io_err = (gaspi_sn_grp_reply(mgmt, mgmt->cdh.id, group, mgmt->cdh.tnc) != 0);
+
 				    mgmt->bdone = 0;
 				    mgmt->blen = sizeof(gaspi_cd_header);
 				    mgmt->op = GASPI_SN_HEADER;//next we expect new header
 				    mgmt->cdh.op = GASPI_SN_RESET;
 				  }
-				else if(mgmt->cdh.op==GASPI_SN_GRP_CONNECT)
+				else if(mgmt->cdh.op == GASPI_SN_INIT_GO)
 				  {
-				    int done = 0;
-				    int len = sizeof (gaspi_rc_grp);
-				    char *ptr = (char*)&glb_gaspi_group_ib[mgmt->cdh.ret].rrcd[glb_gaspi_ctx.rank];
-				    
-				    while(done < len)
-				      {
-					int ret = write(mgmt->fd,ptr+done,len-done);
-  
-					if(ret < 0)
-					  {
-					    /* errno==EAGAIN,that means we have written all data */
-					    if(errno!=EAGAIN)
-					      {
-						//TODO:exit?
-						gaspi_sn_print_error("Failed to write to rank %d.", mgmt->cdh.rank);
-
-						break;
-					      }
-					  }
-					
-				      if(ret > 0)
-					done+=ret;
-				      }
-				    
+				    /* all ranks are up (bootstrap tree) */
+				    gaspi_sn_go = 1;
+
 				    mgmt->bdone = 0;
 				    mgmt->blen = sizeof(gaspi_cd_header);
 				    mgmt->op = GASPI_SN_HEADER;//next we expect new header
-				    mgmt->cdh.op = GASPI_SN_RESET;//reset
+				    mgmt->cdh.op = GASPI_SN_RESET;
+				  }
+				else if(mgmt->cdh.op == GASPI_SN_QUEUE_CONNECT)
+				  {
+				    /* lazy queue: rank, queue (tnc) and QP number (ret) */
+				    io_err = (gaspi_sn_int_reply(mgmt, gaspi_queue_accept(mgmt->cdh.rank, mgmt->cdh.tnc, mgmt->cdh.ret)) != 0);
+
+				    mgmt->bdone = 0;
+				    mgmt->blen = sizeof(gaspi_cd_header);
+				    mgmt->op = GASPI_SN_HEADER;//next we expect new header
+				    mgmt->cdh.op = GASPI_SN_RESET;
+				  }
+				else if(mgmt->cdh.op == GASPI_SN_SEG_FETCH)
+				  {
+				    io_err = (gaspi_sn_seg_reply(mgmt, mgmt->cdh.seg_id) != 0);
+
+				    mgmt->bdone = 0;
+				    mgmt->blen = sizeof(gaspi_cd_header);
+				    mgmt->op = GASPI_SN_HEADER;//next we expect new header
+				    mgmt->cdh.op = GASPI_SN_RESET;
 				  }
 				else if(mgmt->cdh.op == GASPI_SN_SEG_REGISTER)
 				  {
-				    int rret = gaspi_seg_reg_sn(mgmt->cdh);
-				    int done = 0;
-				    int len = sizeof(int);
-				    char *ptr = (char*) &rret;
-				    
-				    while(done < len)
-				      {
-					int ret = write(mgmt->fd,ptr+done,len-done);
-					
-					if(ret < 0)
-					  {
-					    //errno==EAGAIN,that means we have written all data
-					    if(errno!=EAGAIN)
-					      {
-						//TODO:exit?
-						gaspi_sn_print_error("Failed to write.");
-						
-						break;
-					      }
-					  }
-					
-					if(ret > 0)
-					  done += ret;
-				      }
+				    io_err = (gaspi_sn_int_reply(mgmt, gaspi_seg_reg_sn(mgmt->cdh)) != 0);
+
+				    mgmt->bdone = 0;
+				    mgmt->blen = sizeof(gaspi_cd_header);
+				    mgmt->op = GASPI_SN_HEADER;//next we expect new header
+				    mgmt->cdh.op = GASPI_SN_RESET;
+				  }
+				else if(mgmt->cdh.op == GASPI_SN_SEG_DELETE)
+				  {
+				    io_err = (gaspi_sn_int_reply(mgmt, gaspi_seg_del_sn(mgmt->cdh)) != 0);
 
 				    mgmt->bdone = 0;
 				    mgmt->blen = sizeof(gaspi_cd_header);
@@ -639,6 +1216,9 @@ void *gaspi_sn_backend(void *arg)
 					}
 				    }
 				  
+				  /* readiness goes back to the parent on this connection */
+				  gaspi_sn_parent_fd = mgmt->fd;
+
 				  /* atomic update -> worker activated */
 				  if(__sync_fetch_and_add(&gaspi_master_topo_data, 1) == -1)
 				    {
@@ -651,15 +1231,6 @@ void *gaspi_sn_backend(void *arg)
 				}
 			      else if(mgmt->op == GASPI_SN_CONNECT)
 				{
-				  if(gaspi_create_endpoint(mgmt->cdh.rank) !=0 )
-				    {
-				      gaspi_sn_print_error("Failed to create endpoint");
-				      gaspi_sn_status = GASPI_SN_STATE_ERROR;
-				      gaspi_sn_err = GASPI_ERROR;
-				      
-				      return NULL;
-				    }
-
 				  if(gaspi_connect_context(mgmt->cdh.rank, GASPI_BLOCK) != 0)
 				    {
 				      gaspi_sn_print_error("Failed to connect context");
@@ -669,30 +1240,10 @@ void *gaspi_sn_backend(void *arg)
 				      return NULL;
 				    }
 				  
-				  int done = 0;
-				  int len = sizeof(gaspi_rc_all);
-				  char *ptr = (char*) &glb_gaspi_ctx_ib.lrcd[mgmt->cdh.rank];
-				  
-				  while(done < len)
-				    {
-				      int ret = write(mgmt->fd, ptr+done,len-done);
-				      
-				      if(ret < 0) 
-					{
-					  /* errno==EAGAIN,that means we have written all data */
-					  if(errno != EAGAIN)
-					    {
-					      //TODO: exit?
-					      gaspi_sn_print_error("Failed to write.");
-					      
-					      break;
-					    }
-					}
-				      
-				      if(ret > 0)
-					done += ret;
-				    }
-                  
+				  io_err = (gaspi_sn_reply(mgmt, mgmt->cdh.id,
+							   &glb_gaspi_ctx_ib.peer[mgmt->cdh.rank]->lrcd,
+							   sizeof(gaspi_rc_all)) != 0);
+
 				  mgmt->bdone = 0;
 				  mgmt->blen = sizeof(gaspi_cd_header);
 				  mgmt->op = GASPI_SN_HEADER;//next we expect new header
@@ -715,11 +1266,7 @@ void *gaspi_sn_backend(void *arg)
 		}//read in
 
 	      if(io_err)
-		{
-		  shutdown(mgmt->fd,SHUT_RDWR);
-		  close(mgmt->fd);
-		  free(mgmt);
-		}
+		gaspi_sn_close(mgmt);
 	    } /* else read or write */
 	} /* for(int i... */
     }/* event loop while(1) */
@@ -49,7 +49,11 @@ enum gaspi_sn_ops
   GASPI_SN_CONNECT = 14,
   GASPI_SN_GRP_CHECK= 16,
   GASPI_SN_GRP_CONNECT= 18,
-  GASPI_SN_SEG_REGISTER = 20
+  GASPI_SN_SEG_REGISTER = 20,
+  GASPI_SN_SEG_FETCH = 22,
+  GASPI_SN_INIT_GO = 24,
+  GASPI_SN_QUEUE_CONNECT = 26,
+  GASPI_SN_SEG_DELETE = 28
 };
 
 enum gaspi_sn_status
@@ -63,7 +67,10 @@ typedef struct
 {
   int op,op_len,rank,tnc;
   int ret,rkey,seg_id;
+  int id;		/* request id, echoed in the reply */
   unsigned long addr,size;
+  int notif_rkey;
+  unsigned long notif_addr;
 
 #ifdef GPI2_CUDA
   int host_rkey;
@@ -75,8 +82,42 @@ typedef struct
 {
   int fd,op,rank,blen,bdone;
   gaspi_cd_header cdh;
+  char *obuf;		/* replies not written yet */
+  int olen,odone,ocap,epollout;
 } gaspi_mgmt_header;
 
+/* Every reply of the SN thread starts with this */
+typedef struct
+{
+  int id,len;
+} gaspi_sn_reply_hdr;
+
+enum gaspi_sn_req_state
+{
+  GASPI_SN_REQ_IDLE = 0,
+  GASPI_SN_REQ_POSTED = 1,
+  GASPI_SN_REQ_DONE = 2,
+  GASPI_SN_REQ_FAILED = 3
+};
+
+/* A request to the SN thread of a rank (gaspi_sn_post) and where its
+   reply goes. Several requests can be outstanding on one socket, the
+   replies are matched by id and may come in any order */
+typedef struct gaspi_sn_req
+{
+  int id,rank,state;
+  void *reply;
+  int rlen;
+  struct gaspi_sn_req *next;
+} gaspi_sn_req;
+
+/* reply to GASPI_SN_GRP_CHECK */
+typedef struct
+{
+  int tnc,cs,ret;
+  gaspi_rc_grp rrcd;
+} gaspi_grp_check;
+
 typedef struct
 {
   int fd,busy;
@@ -89,11 +130,13 @@ extern volatile int gaspi_master_topo_data;
 
 extern volatile enum gaspi_sn_status gaspi_sn_status;
 extern volatile gaspi_return_t gaspi_sn_err;
+extern volatile int gaspi_sn_parent_fd;
+extern volatile int gaspi_sn_go;
 
 
 extern gaspi_context glb_gaspi_ctx;
 extern gaspi_ib_ctx glb_gaspi_ctx_ib;
-extern gaspi_ib_group glb_gaspi_group_ib[GASPI_MAX_GROUPS];
+extern gaspi_ib_group *glb_gaspi_group_ib;
 
 
 
@@ -104,10 +147,29 @@ gaspi_connect2port(const char *hn,const unsigned short port,const unsigned long
 
 void gaspi_sn_cleanup(int sig);
 
+int gaspi_sn_connect(const gaspi_rank_t rank, const gaspi_timeout_t timeout_ms);
+
+int gaspi_sn_post(const gaspi_rank_t rank, gaspi_cd_header *cdh,
+		  const void *data, const int len,
+		  gaspi_sn_req *req, void *reply, const int rlen,
+		  const gaspi_timeout_t timeout_ms);
+
+gaspi_return_t
+gaspi_sn_waitall(gaspi_sn_req *reqs, const int num, const gaspi_timeout_t timeout_ms);
+
+void gaspi_sn_cancel(gaspi_sn_req *req);
+
+void gaspi_sn_requests_free(void);
+
 int gaspi_seg_reg_sn(const gaspi_cd_header snp);
+int gaspi_seg_info_sn(const gaspi_segment_id_t segment_id, const gaspi_rank_t rank,
+		      gaspi_cd_header *cdh);
+int gaspi_seg_del_sn(const gaspi_cd_header snp);
 
 void *gaspi_sn_backend(void *arg);
 
+void gaspi_sn_group_ready(const gaspi_group_t group);
+
 gaspi_return_t
 gaspi_sn_ping(const gaspi_rank_t rank, const gaspi_timeout_t timeout_ms);
 
@@ -43,6 +43,8 @@ typedef struct
   float mhz;
   float cycles_to_msecs;
   char mfile[1024];
+  char cfile[1024];
+  int coll_tune;
   int *sockfd;
   char *hn_poff;
   char *poff;
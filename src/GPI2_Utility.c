@@ -17,13 +17,26 @@ along with GPI-2. If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <sys/time.h>
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(MIC)
+#include <cpuid.h>
+#endif
 #include "GPI2.h"
 #include "GPI2_Utility.h"
 
-#define MEASUREMENTS 500
-#define USECSTEP 10
-#define USECSTART 100
+/* Per-node cache of the TSC frequency: the first rank on a node
+   derives it, the co-located ranks read it back. Only values of an
+   invariant TSC are cached, and only files of our own user are
+   trusted */
+#define GASPI_CPUFREQ_CACHE "/dev/shm/gpi2_cpufreq"
+
+/* Calibration against CLOCK_MONOTONIC_RAW: a few short windows, the
+   median of the estimates is taken */
+#define CALIB_ROUNDS 5
+#define CALIB_NSECS 2000000L
 
 ulong
 gaspi_load_ulong(volatile ulong *ptr)
@@ -33,83 +46,212 @@ gaspi_load_ulong(volatile ulong *ptr)
   return v;
 }
 
-/* CPU freq through sampling and linear regression */
-float
-_gaspi_sample_cpu_freq()
+static void
+_gaspi_cpufreq_cache_path (char *path, size_t len)
 {
-  struct timeval tval1,tval2;
-  gaspi_cycles_t start;
-  double sumx = 0.0f;
-  double sumy = 0.0f;
-  double sum_sqr_x = 0.0f;
-  double sum_sqr_y = 0.0f;
-  double sumxy = 0.0f;
-  double tx,ty;
-  int i;
-  
-  long x[MEASUREMENTS];
-  gaspi_cycles_t y[MEASUREMENTS];
-  double beta;
-  double corr_2;
+  snprintf (path, len, "%s.%u", GASPI_CPUFREQ_CACHE, (unsigned) getuid ());
+}
 
-  for(i = 0;i < MEASUREMENTS; ++i)
+static float
+_gaspi_cpufreq_cache_read ()
+{
+  char path[64];
+  float mhz = 0.0f;
+  struct stat st;
+  FILE *f;
+
+  _gaspi_cpufreq_cache_path (path, sizeof (path));
+
+  const int fd = open (path, O_RDONLY | O_NOFOLLOW);
+  if (fd < 0)
+    return 0.0f;
+
+  ///dev/shm is shared: another user may have put a file there first
+  if (fstat (fd, &st) != 0 || !S_ISREG (st.st_mode) || st.st_uid != getuid ()
+      || (f = fdopen (fd, "r")) == NULL)
     {
-      start = gaspi_get_cycles();
+      close (fd);
+      return 0.0f;
+    }
 
-      if(gettimeofday(&tval1,NULL))
-	{
-#ifdef DEBUG	  
-	  printf("gettimeofday failed.\n");
-#endif	  
-	  return 0.0f;
-	}
+  if (fscanf (f, "%f", &mhz) != 1 || mhz <= 0.0f)
+    mhz = 0.0f;
 
-      do
-	{
-	  if(gettimeofday(&tval2,NULL))
-	    {
-#ifdef DEBUG	  
-	      printf("gettimeofday failed.\n");
-#endif	      
-	      return 0.0f;
-	    }
-	}
-      while((tval2.tv_sec - tval1.tv_sec) * 1000000 +
-	    (tval2.tv_usec - tval1.tv_usec) < USECSTART + i * USECSTEP);
+  fclose (f);
 
+  return mhz;
+}
 
-      x[i] = (tval2.tv_sec - tval1.tv_sec) * 1000000 + tval2.tv_usec - tval1.tv_usec;
-      y[i] = gaspi_get_cycles() - start;
+static void
+_gaspi_cpufreq_cache_write (float mhz)
+{
+  char path[64], tmp[80];
+  FILE *f;
+
+  _gaspi_cpufreq_cache_path (path, sizeof (path));
+  snprintf (tmp, sizeof (tmp), "%s.%d", path, (int) getpid ());
+
+  const int fd = open (tmp, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW, 0600);
+  if (fd < 0)
+    return;
+
+  f = fdopen (fd, "w");
+  if (f == NULL)
+    {
+      close (fd);
+      unlink (tmp);
+      return;
     }
-  
-  for(i = 0;i < MEASUREMENTS; ++i)
+
+  if (fprintf (f, "%f\n", mhz) < 0)
     {
-      tx = x[i];
-      ty = y[i];
-      sumx += tx;
-      sumy += ty;
-      sum_sqr_x += tx * tx;
-      sum_sqr_y += ty * ty;
-      sumxy += tx * ty;
+      fclose (f);
+      unlink (tmp);
+      return;
     }
 
-  corr_2 = (MEASUREMENTS * sumxy - sumx * sumy) * (MEASUREMENTS * sumxy - sumx * sumy)
-    / (MEASUREMENTS * sum_sqr_x - sumx * sumx) / (MEASUREMENTS * sum_sqr_y - sumy * sumy);
+  //readers only ever see a complete file
+  if (fclose (f) != 0 || rename (tmp, path) != 0)
+    unlink (tmp);
+}
 
-  if(corr_2 < 0.9)
-      return 0.0f;
+/* Whether the TSC runs at a constant rate (CPUID invariant TSC bit) */
+static int
+_gaspi_tsc_invariant ()
+{
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(MIC)
+  unsigned int eax, ebx, ecx, edx;
 
-  beta = (MEASUREMENTS * sumxy - sumx * sumy) / (MEASUREMENTS * sum_sqr_x - sumx * sumx);
+  if (__get_cpuid_max (0x80000000, NULL) < 0x80000007)
+    return 0;
 
-  return (float)beta;
+  __cpuid (0x80000007, eax, ebx, ecx, edx);
+
+  return (edx & (1 << 8)) != 0;
+#else
+  return 0;
+#endif
+}
+
+/* TSC frequency from CPUID, only with an invariant TSC: leaf 0x15
+   gives the TSC/crystal ratio and (usually) the crystal clock, leaf
+   0x16 the base frequency when the crystal clock is not enumerated */
+static float
+_gaspi_cpuid_tsc_freq ()
+{
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(MIC)
+  unsigned int eax, ebx, ecx, edx;
+  const unsigned int max_leaf = __get_cpuid_max (0, NULL);
+
+  if (!_gaspi_tsc_invariant ())
+    return 0.0f;
+
+  if (max_leaf < 0x15)
+    return 0.0f;
+
+  __cpuid (0x15, eax, ebx, ecx, edx);
+  if (eax == 0 || ebx == 0)
+    return 0.0f;
+
+  if (ecx != 0)
+    return (float) ((double) ecx * ebx / eax / 1.0e6);
+
+  if (max_leaf < 0x16)
+    return 0.0f;
+
+  __cpuid (0x16, eax, ebx, ecx, edx);
+
+  return (float) (eax & 0xffff);
+#else
+  return 0.0f;
+#endif
+}
+
+/* TSC frequency exported by the kernel (kHz) */
+static float
+_gaspi_sysfs_tsc_freq ()
+{
+  unsigned long khz;
+  float mhz = 0.0f;
+  FILE *f;
+
+  f = fopen ("/sys/devices/system/cpu/cpu0/tsc_freq_khz", "r");
+  if (f == NULL)
+    return 0.0f;
+
+  if (fscanf (f, "%lu", &khz) == 1)
+    mhz = (float) khz / 1000.0f;
+
+  fclose (f);
+
+  return mhz;
+}
+
+static int
+_gaspi_float_compare (const void *a, const void *b)
+{
+  const double x = *(const double *) a;
+  const double y = *(const double *) b;
+
+  return (x > y) - (x < y);
+}
+
+/* CPU freq through sampling against CLOCK_MONOTONIC_RAW, ~10 ms */
+float
+_gaspi_sample_cpu_freq ()
+{
+  struct timespec t0, t1;
+  double est[CALIB_ROUNDS];
+  int i;
+
+  for (i = 0; i < CALIB_ROUNDS; i++)
+    {
+      long nsecs;
+      gaspi_cycles_t c0, c1;
+
+      if (clock_gettime (CLOCK_MONOTONIC_RAW, &t0))
+	return 0.0f;
+      c0 = gaspi_get_cycles ();
+
+      do
+	{
+	  c1 = gaspi_get_cycles ();
+	  if (clock_gettime (CLOCK_MONOTONIC_RAW, &t1))
+	    return 0.0f;
+
+	  nsecs = (t1.tv_sec - t0.tv_sec) * 1000000000L
+	    + (t1.tv_nsec - t0.tv_nsec);
+	}
+      while (nsecs < CALIB_NSECS);
+
+      est[i] = (double) (c1 - c0) * 1000.0 / (double) nsecs;
+    }
+
+  qsort (est, CALIB_ROUNDS, sizeof (double), _gaspi_float_compare);
+
+  return (float) est[CALIB_ROUNDS / 2];
 }
 
 float
 gaspi_get_cpufreq ()
 {
-  float mhz = 0.0f;
-  mhz =  _gaspi_sample_cpu_freq();
-  
+  float mhz = _gaspi_cpufreq_cache_read ();
+
+  if (mhz > 0.0f)
+    return mhz;
+
+  mhz = _gaspi_cpuid_tsc_freq ();
+
+  if (0.0f == mhz)
+    mhz = _gaspi_sysfs_tsc_freq ();
+
+  //a calibrated value is not worth keeping beyond this process
+  if (mhz > 0.0f && _gaspi_tsc_invariant ())
+    _gaspi_cpufreq_cache_write (mhz);
+
+  if (0.0f == mhz)
+    mhz = _gaspi_sample_cpu_freq ();
+
   if(0.0f == mhz )
     {
       FILE *f;
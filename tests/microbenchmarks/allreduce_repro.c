@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <GASPI.h>
+
+/* Reproducible float/double sums against plain integer sums of the
+   same size, which take the regular allreduce */
+
+#define ITERATIONS (1000)
+
+static int
+mcycles_compare (const void *aptr, const void *bptr)
+{
+  const gaspi_cycles_t *a = (gaspi_cycles_t *) aptr;
+  const gaspi_cycles_t *b = (gaspi_cycles_t *) bptr;
+  if (*a < *b)
+    return -1;
+  if (*a > *b)
+    return 1;
+  return 0;
+}
+
+static double
+median_usecs (void *send, void *recv, int elems, gaspi_datatype_t type,
+	      gaspi_float cpu_freq)
+{
+  int i;
+  gaspi_cycles_t stamp[ITERATIONS], delta[ITERATIONS - 1];
+
+  for(i = 0; i < ITERATIONS; i++)
+    {
+      gaspi_allreduce(send, recv, elems,
+		      GASPI_OP_SUM, type, GASPI_GROUP_ALL, GASPI_BLOCK);
+      gaspi_time_ticks(&(stamp[i]));
+    }
+
+  for (i = 0; i < ITERATIONS - 1; i++)
+    delta[i] = stamp[i + 1] - stamp[i];
+
+  qsort (delta, ITERATIONS - 1, sizeof *delta, mcycles_compare);
+
+  return (double) delta[ITERATIONS / 2] / cpu_freq;
+}
+
+int main(int argc, char *argv[])
+{
+  int i, elems;
+  gaspi_config_t gconf;
+  gaspi_rank_t grank, gnum;
+  gaspi_float cpu_freq;
+
+  gaspi_config_get(&gconf);
+  gconf.mtu = 4096;
+  gconf.queue_num = 1;
+  gconf.allreduce_reproducible = 1;
+  gaspi_config_set(gconf);
+
+  gaspi_proc_init(GASPI_BLOCK);
+
+  gaspi_cpu_frequency (&cpu_freq);
+
+  gaspi_proc_rank(&grank);
+
+  gaspi_proc_num(&gnum);
+
+  if(0 == grank)
+    printf("CPU freq: %.2f\n", cpu_freq);
+
+  double *send = (double *) malloc(255 * sizeof(double));
+  double *recv = (double *) malloc(255 * sizeof(double));
+  if(send == NULL || recv == NULL)
+    {
+      printf("Failed to allocate memory\n");
+      return EXIT_FAILURE;
+    }
+
+  //small integers, valid as any of the types
+  memset(send, 0, 255 * sizeof(double));
+  for(i = 0; i < 255; i++)
+    ((int *) send)[i] = 1;
+
+  gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK);
+
+  if(0 == grank )
+    printf("#elems\tlong\tdouble\tratio\tint\tfloat\tratio (usecs)\n");
+
+  for(elems = 1; elems < 256; elems++)
+    {
+      const double tl = median_usecs(send, recv, elems, GASPI_TYPE_LONG, cpu_freq);
+      const double td = median_usecs(send, recv, elems, GASPI_TYPE_DOUBLE, cpu_freq);
+      const double ti = median_usecs(send, recv, elems, GASPI_TYPE_INT, cpu_freq);
+      const double tf = median_usecs(send, recv, elems, GASPI_TYPE_FLOAT, cpu_freq);
+
+      if(0 == grank)
+	printf("%d\t%.2f\t%.2f\t%.2f\t%.2f\t%.2f\t%.2f\n",
+	       elems, tl, td, td / tl, ti, tf, tf / ti);
+    }
+
+  gaspi_proc_term(GASPI_BLOCK);
+  free(recv);
+  free(send);
+
+  return EXIT_SUCCESS;
+}
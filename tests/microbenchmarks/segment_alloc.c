@@ -0,0 +1,96 @@
+#include "utils.h"
+#include "common.h"
+
+/* Segment allocation + registration time and local stream (triad)
+   bandwidth for regular and huge pages. Segment size in MB can be
+   given as argument (default 1024) */
+
+#define REPS 5
+
+static const struct
+{
+  const char *name;
+  gaspi_alloc_t policy;
+} policies[] = {
+  { "4K", GASPI_MEM_UNINITIALIZED },
+  { "huge", GASPI_MEM_HUGEPAGE },
+  { "2M", GASPI_MEM_HUGEPAGE_2M },
+  { "1G", GASPI_MEM_HUGEPAGE_1G },
+};
+
+int
+main (int argc, char *argv[])
+{
+  int p, r;
+  unsigned long i;
+  gaspi_rank_t myrank;
+  gaspi_float cpu_freq;
+  gaspi_pointer_t ptr;
+
+  const unsigned long mb = (argc > 1) ? strtoul (argv[1], NULL, 10) : 1024;
+  const gaspi_size_t size = mb << 20;
+  const unsigned long n = size / (3 * sizeof (double));
+
+  if (gaspi_proc_init (GASPI_BLOCK) != GASPI_SUCCESS)
+    {
+      printf ("Initialization failed\n");
+      exit (-1);
+    }
+
+  gaspi_proc_rank (&myrank);
+  gaspi_cpu_frequency (&cpu_freq);
+
+  const double div = 1.0 / cpu_freq / (1000.0 * 1000.0);
+
+  if (myrank == 0)
+    printf ("%-6s %14s %14s\n", "pages", "alloc+reg (s)", "triad (MB/s)");
+
+  for (p = 0; p < (int) (sizeof (policies) / sizeof (policies[0])); p++)
+    {
+      const mcycles_t t0 = get_mcycles ();
+      if (gaspi_segment_alloc (0, size, policies[p].policy) != GASPI_SUCCESS)
+	{
+	  printf ("Failed to allocate segment (%s)\n", policies[p].name);
+	  exit (-1);
+	}
+      const mcycles_t t1 = get_mcycles ();
+
+      gaspi_segment_ptr (0, &ptr);
+
+      double *a = (double *) ptr;
+      double *b = a + n;
+      double *c = b + n;
+
+      for (i = 0; i < n; i++)
+	{
+	  b[i] = 1.0;
+	  c[i] = 2.0;
+	}
+
+      for (r = 0; r < REPS; r++)
+	{
+	  stamp[r] = get_mcycles ();
+	  for (i = 0; i < n; i++)
+	    a[i] = b[i] + 3.0 * c[i];
+	  stamp2[r] = get_mcycles ();
+	  delta[r] = stamp2[r] - stamp[r];
+	}
+
+      qsort (delta, REPS, sizeof *delta, mcycles_compare);
+
+      const double bw_mb = 3.0 * n * sizeof (double) / ((double) delta[0] * div) / (1024.0 * 1024.0);
+
+      if (myrank == 0)
+	printf ("%-6s %14.3f %14.2f\n", policies[p].name, (double) (t1 - t0) * div, bw_mb);
+
+      if (a[n / 2] != 7.0)
+	printf ("Wrong result\n");
+
+      gaspi_segment_delete (0);
+    }
+
+  gaspi_barrier (GASPI_GROUP_ALL, GASPI_BLOCK);
+  gaspi_proc_term (GASPI_BLOCK);
+
+  return 0;
+}
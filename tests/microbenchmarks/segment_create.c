@@ -0,0 +1,92 @@
+#include "utils.h"
+#include "common.h"
+
+/* Time of gaspi_segment_create (allgather over the collective QPs)
+   against gaspi_segment_alloc + gaspi_segment_register with every
+   rank (one SN round trip per rank). Run with an increasing number
+   of processes, e.g. on a single node, to see how both scale with
+   the rank count */
+
+#define REPS 20
+
+static double
+median (double div)
+{
+  qsort (delta, REPS, sizeof *delta, mcycles_compare);
+  return (double) delta[REPS / 2] * div * 1000.0;
+}
+
+int
+main (int argc, char *argv[])
+{
+  int r;
+  gaspi_rank_t i, myrank, nprocs;
+  gaspi_float cpu_freq;
+
+  if (gaspi_proc_init (GASPI_BLOCK) != GASPI_SUCCESS)
+    {
+      printf ("Initialization failed\n");
+      exit (-1);
+    }
+
+  gaspi_proc_rank (&myrank);
+  gaspi_proc_num (&nprocs);
+  gaspi_cpu_frequency (&cpu_freq);
+
+  const double div = 1.0 / cpu_freq / (1000.0 * 1000.0);
+
+  for (r = 0; r < REPS; r++)
+    {
+      gaspi_barrier (GASPI_GROUP_ALL, GASPI_BLOCK);
+
+      stamp[r] = get_mcycles ();
+      if (gaspi_segment_create (0, 4096, GASPI_GROUP_ALL, GASPI_BLOCK,
+				GASPI_MEM_UNINITIALIZED) != GASPI_SUCCESS)
+	{
+	  printf ("Failed to create segment\n");
+	  exit (-1);
+	}
+      stamp2[r] = get_mcycles ();
+      delta[r] = stamp2[r] - stamp[r];
+
+      gaspi_barrier (GASPI_GROUP_ALL, GASPI_BLOCK);
+      gaspi_segment_delete (0);
+    }
+
+  const double t_create = median (div);
+
+  for (r = 0; r < REPS; r++)
+    {
+      gaspi_barrier (GASPI_GROUP_ALL, GASPI_BLOCK);
+
+      stamp[r] = get_mcycles ();
+      if (gaspi_segment_alloc (0, 4096, GASPI_MEM_UNINITIALIZED) != GASPI_SUCCESS)
+	{
+	  printf ("Failed to allocate segment\n");
+	  exit (-1);
+	}
+
+      for (i = 0; i < nprocs; i++)
+	if (i != myrank)
+	  gaspi_segment_register (0, i, GASPI_BLOCK);
+
+      gaspi_barrier (GASPI_GROUP_ALL, GASPI_BLOCK);
+      stamp2[r] = get_mcycles ();
+      delta[r] = stamp2[r] - stamp[r];
+
+      gaspi_segment_delete (0);
+    }
+
+  const double t_register = median (div);
+
+  if (myrank == 0)
+    {
+      printf ("%8s %18s %18s\n", "ranks", "create (ms)", "alloc+reg (ms)");
+      printf ("%8u %18.3f %18.3f\n", nprocs, t_create, t_register);
+    }
+
+  gaspi_barrier (GASPI_GROUP_ALL, GASPI_BLOCK);
+  gaspi_proc_term (GASPI_BLOCK);
+
+  return 0;
+}
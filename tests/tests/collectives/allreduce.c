@@ -119,6 +119,8 @@ gaspi_return_t testOP(gaspi_operation_t op, gaspi_datatype_t type, gaspi_number_
       break;
     case GASPI_TYPE_ULONG: INIT_CALL(uint64_t, send_bf, elems, myrank);
       break;
+    default: //half precision types are covered by allreduce_half
+      return GASPI_ERROR;
     }
 
   //sync
@@ -144,6 +146,8 @@ gaspi_return_t testOP(gaspi_operation_t op, gaspi_datatype_t type, gaspi_number_
       break;
     case GASPI_TYPE_ULONG: ret = CHECK_CALL(uint64_t, recv_bf, elems, op);
       break;
+    default: ret = 0;
+      break;
     }
   if(ret)
     return GASPI_SUCCESS;
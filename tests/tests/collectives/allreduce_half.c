@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <test_utils.h>
+
+/* Allreduce on 16-bit floating point types. Small integers are
+   exactly representable in both formats */
+
+static uint16_t to_half(int v)
+{
+  //exact for |v| < 2048
+  uint16_t sign = 0;
+  int e = 0;
+
+  if(v == 0)
+    return 0;
+  if(v < 0)
+    {
+      sign = 0x8000;
+      v = -v;
+    }
+  while((v >> e) > 1)
+    e++;
+
+  return sign | ((e + 15) << 10) | (((v << 10) >> e) & 0x3ff);
+}
+
+static uint16_t to_bf16(int v)
+{
+  float f = (float) v;
+  uint32_t u;
+
+  memcpy(&u, &f, sizeof(u));
+  return u >> 16;
+}
+
+static uint16_t encode(gaspi_datatype_t type, int v)
+{
+  return (type == GASPI_TYPE_HALF) ? to_half(v) : to_bf16(v);
+}
+
+int main(int argc, char *argv[])
+{
+  int i, n;
+  gaspi_rank_t nprocs, myrank;
+  gaspi_datatype_t type;
+  uint16_t send[255], recv[255];
+
+  TSUITE_INIT(argc, argv);
+
+  ASSERT (gaspi_proc_init(GASPI_BLOCK));
+
+  ASSERT(gaspi_proc_num(&nprocs));
+  ASSERT(gaspi_proc_rank(&myrank));
+
+  //keep the sum exact in bfloat16 (8 bit mantissa)
+  const int v = (myrank % 2) ? -1 : 1;
+  const int sum = (nprocs % 2);
+
+  //ranks are exact in bfloat16 only up to 256
+  const gaspi_datatype_t last = (nprocs <= 256) ? GASPI_TYPE_BFLOAT16 : GASPI_TYPE_HALF;
+
+  for(type = GASPI_TYPE_HALF; type <= last; type++)
+    for(n = 1; n <= 255; n++)
+      {
+	for(i = 0; i < n; i++)
+	  send[i] = encode(type, (myrank % 2) ? -myrank : myrank);
+
+	ASSERT(gaspi_allreduce(send, recv, n, GASPI_OP_MAX, type, GASPI_GROUP_ALL, GASPI_BLOCK));
+	const int max = (nprocs - 1) - ((nprocs - 1) % 2);
+	for(i = 0; i < n; i++)
+	  if(recv[i] != encode(type, max))
+	    return EXIT_FAILURE;
+
+	ASSERT(gaspi_allreduce(send, recv, n, GASPI_OP_MIN, type, GASPI_GROUP_ALL, GASPI_BLOCK));
+	const int min = (nprocs > 1) ? -((nprocs - 1) - (nprocs % 2)) : 0;
+	for(i = 0; i < n; i++)
+	  if(recv[i] != encode(type, min))
+	    return EXIT_FAILURE;
+
+	for(i = 0; i < n; i++)
+	  send[i] = encode(type, v);
+
+	ASSERT(gaspi_allreduce(send, recv, n, GASPI_OP_SUM, type, GASPI_GROUP_ALL, GASPI_BLOCK));
+	for(i = 0; i < n; i++)
+	  if(recv[i] != encode(type, sum))
+	    return EXIT_FAILURE;
+      }
+
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+  ASSERT (gaspi_proc_term(GASPI_BLOCK));
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,122 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <test_utils.h>
+
+/* With allreduce_reproducible, float/double sums must be bitwise
+   identical no matter how values are distributed over the ranks or
+   how large the group is */
+
+#define ELEMS 255
+
+static double value(int j, int i)
+{
+  const double v = ldexp(1.0 + 0.1 * j + 0.01 * i, (j * 7 + i) % 40 - 20);
+  return (j % 2) ? -v : v;
+}
+
+static void fill(void *buf, gaspi_datatype_t type, int j, int n)
+{
+  int i;
+  for(i = 0; i < n; i++)
+    {
+      const double v = (j < 0) ? 0.0 : value(j, i);
+      if(type == GASPI_TYPE_FLOAT)
+	((float *) buf)[i] = (float) v;
+      else
+	((double *) buf)[i] = v;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+  int s, n;
+  gaspi_config_t conf;
+  gaspi_rank_t nprocs, myrank;
+  gaspi_group_t g = 0;
+  gaspi_datatype_t type;
+  double send[ELEMS], recv[ELEMS], ref[ELEMS];
+
+  TSUITE_INIT(argc, argv);
+
+  ASSERT (gaspi_config_get(&conf));
+  conf.allreduce_reproducible = 1;
+  ASSERT (gaspi_config_set(conf));
+
+  ASSERT (gaspi_proc_init(GASPI_BLOCK));
+
+  ASSERT(gaspi_proc_num(&nprocs));
+  ASSERT(gaspi_proc_rank(&myrank));
+
+  //group of the first half of the ranks, only its members commit it
+  const int m = nprocs / 2;
+  if(m >= 2 && myrank < m)
+    {
+      ASSERT (gaspi_group_create(&g));
+      for(s = 0; s < m; s++)
+	ASSERT (gaspi_group_add(g, s));
+      ASSERT (gaspi_group_commit(g, GASPI_BLOCK));
+    }
+
+  for(type = GASPI_TYPE_FLOAT; type <= GASPI_TYPE_DOUBLE; type++)
+    {
+      const size_t bytes = (type == GASPI_TYPE_FLOAT) ? sizeof(float) : sizeof(double);
+
+      for(n = 1; n <= ELEMS; n += 31)
+	{
+	  //same values, rotated over the ranks
+	  for(s = 0; s < nprocs; s++)
+	    {
+	      fill(send, type, (myrank + s) % nprocs, n);
+	      ASSERT (gaspi_allreduce(send, recv, n, GASPI_OP_SUM, type, GASPI_GROUP_ALL, GASPI_BLOCK));
+
+	      if(s == 0)
+		memcpy(ref, recv, n * bytes);
+	      else if(memcmp(ref, recv, n * bytes) != 0)
+		{
+		  gaspi_printf("Rotation %d changed the result (n %d)\n", s, n);
+		  return EXIT_FAILURE;
+		}
+	    }
+
+	  if(m < 2)
+	    continue;
+
+	  //same values on all ranks and on half of them
+	  fill(send, type, (myrank < m) ? myrank : -1, n);
+	  ASSERT (gaspi_allreduce(send, ref, n, GASPI_OP_SUM, type, GASPI_GROUP_ALL, GASPI_BLOCK));
+
+	  if(myrank < m)
+	    {
+	      ASSERT (gaspi_allreduce(send, recv, n, GASPI_OP_SUM, type, g, GASPI_BLOCK));
+	      if(memcmp(ref, recv, n * bytes) != 0)
+		{
+		  gaspi_printf("Group size changed the result (n %d)\n", n);
+		  return EXIT_FAILURE;
+		}
+
+	      //rotated over the group members
+	      for(s = 1; s < m; s++)
+		{
+		  fill(send, type, (myrank + s) % m, n);
+		  ASSERT (gaspi_allreduce(send, recv, n, GASPI_OP_SUM, type, g, GASPI_BLOCK));
+		  if(memcmp(ref, recv, n * bytes) != 0)
+		    {
+		      gaspi_printf("Rotation %d changed the group result (n %d)\n", s, n);
+		      return EXIT_FAILURE;
+		    }
+		}
+	    }
+	}
+    }
+
+  if(m >= 2 && myrank < m)
+    ASSERT (gaspi_group_delete(g));
+
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+  ASSERT (gaspi_proc_term(GASPI_BLOCK));
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,58 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <test_utils.h>
+
+#define ITERATIONS 1000
+
+/* Split-phase barrier, completed blocking and by testing */
+int main(int argc, char *argv[])
+{
+  int i;
+  gaspi_return_t ret;
+  gaspi_rank_t nprocs, myrank;
+  volatile double work = 0.0;
+
+  TSUITE_INIT(argc, argv);
+
+  ASSERT (gaspi_proc_init(GASPI_BLOCK));
+
+  ASSERT(gaspi_proc_num(&nprocs));
+  ASSERT(gaspi_proc_rank(&myrank));
+
+  //nothing to complete without a begin
+  EXPECT_FAIL (gaspi_barrier_end(GASPI_GROUP_ALL, GASPI_BLOCK));
+
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      ASSERT (gaspi_barrier_begin(GASPI_GROUP_ALL));
+
+      //no other barrier while one is started
+      EXPECT_FAIL (gaspi_barrier_begin(GASPI_GROUP_ALL));
+
+      work += (double) (myrank + i);
+      ASSERT (gaspi_barrier_end(GASPI_GROUP_ALL, GASPI_BLOCK));
+    }
+
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      ASSERT (gaspi_barrier_begin(GASPI_GROUP_ALL));
+
+      do
+	{
+	  work += 1.0;
+	  ret = gaspi_barrier_end(GASPI_GROUP_ALL, GASPI_TEST);
+	}
+      while (ret == GASPI_TIMEOUT);
+
+      ASSERT (ret);
+
+      //mixes with the plain barrier
+      ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+      EXPECT_FAIL (gaspi_barrier_end(GASPI_GROUP_ALL, GASPI_TEST));
+    }
+
+  ASSERT (gaspi_proc_term(GASPI_BLOCK));
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <test_utils.h>
+#include <GPI2_Coll.h>
+
+#define ITERATIONS 1000
+
+/* Select the non-default collective algorithms through a decision
+   file, check that the group uses them and check barrier and
+   allreduce results */
+int main(int argc, char *argv[])
+{
+  int i, n;
+  char file[128];
+  gaspi_rank_t nprocs, myrank;
+  double send[255], recv[255];
+  const char *alg;
+
+  TSUITE_INIT(argc, argv);
+
+  snprintf(file, sizeof(file), "/tmp/.gpi2_coll_test.%d", getpid());
+
+  FILE *fp = fopen(file, "w");
+  if(fp == NULL)
+    return EXIT_FAILURE;
+
+  fprintf(fp, "# test decisions\n");
+  fprintf(fp, "barrier 2 0 pairwise\n");
+  fprintf(fp, "allreduce 2 2048 dissemination\n");
+  fclose(fp);
+
+  setenv("GASPI_COLL_FILE", file, 1);
+
+  ASSERT (gaspi_proc_init(GASPI_BLOCK));
+
+  ASSERT(gaspi_proc_num(&nprocs));
+  ASSERT(gaspi_proc_rank(&myrank));
+
+  //pairwise falls back to dissemination for non power of 2 sizes
+  if(gaspi_coll_algorithm(GASPI_GROUP_ALL, GASPI_COLL_BARRIER, 0, &alg) != 0)
+    return EXIT_FAILURE;
+  if(strcmp(alg, (nprocs & (nprocs - 1)) ? "dissemination" : "pairwise") != 0)
+    return EXIT_FAILURE;
+
+  //the rules apply from 2 ranks on
+  for(n = 1; n <= 2048; n *= 2)
+    {
+      if(gaspi_coll_algorithm(GASPI_GROUP_ALL, GASPI_COLL_ALLREDUCE, n, &alg) != 0)
+	return EXIT_FAILURE;
+      if(strcmp(alg, nprocs > 1 ? "dissemination" : "recursive_doubling") != 0)
+	return EXIT_FAILURE;
+    }
+
+  if(gaspi_coll_algorithm(GASPI_GROUP_ALL, GASPI_COLL_NUM, 0, &alg) == 0)
+    return EXIT_FAILURE;
+
+  for (i = 0; i < ITERATIONS; i++)
+    ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+
+  for(n = 1; n <= 255; n++)
+    {
+      for(i = 0; i < n; i++)
+	send[i] = (double) myrank;
+
+      ASSERT(gaspi_allreduce(send, recv, n, GASPI_OP_MIN, GASPI_TYPE_DOUBLE, GASPI_GROUP_ALL, GASPI_BLOCK));
+      for(i = 0; i < n; i++)
+	if(recv[i] != 0.0)
+	  return EXIT_FAILURE;
+
+      ASSERT(gaspi_allreduce(send, recv, n, GASPI_OP_MAX, GASPI_TYPE_DOUBLE, GASPI_GROUP_ALL, GASPI_BLOCK));
+      for(i = 0; i < n; i++)
+	if(recv[i] != (double) (nprocs - 1))
+	  return EXIT_FAILURE;
+
+      //sum uses the default algorithm
+      ASSERT(gaspi_allreduce(send, recv, n, GASPI_OP_SUM, GASPI_TYPE_DOUBLE, GASPI_GROUP_ALL, GASPI_BLOCK));
+      for(i = 0; i < n; i++)
+	if(recv[i] != (double) (nprocs * (nprocs - 1) / 2))
+	  return EXIT_FAILURE;
+    }
+
+  unlink(file);
+
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+  ASSERT (gaspi_proc_term(GASPI_BLOCK));
+
+  return EXIT_SUCCESS;
+}
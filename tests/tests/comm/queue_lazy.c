@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <test_utils.h>
+
+//set up all queues but the first one on first use (queue_lazy_tnc 0):
+//neighbours write to each other on every queue at the same time, so
+//both ends of a queue connect it at once
+int main(int argc, char *argv[])
+{
+  gaspi_config_t conf;
+  gaspi_number_t qnum;
+  gaspi_queue_id_t q;
+  gaspi_rank_t rank, nprocs;
+  gaspi_pointer_t ptr;
+  gaspi_notification_id_t id;
+  gaspi_notification_t val;
+
+  TSUITE_INIT(argc, argv);
+
+  ASSERT (gaspi_config_get(&conf));
+  conf.queue_lazy_tnc = 0;
+  ASSERT (gaspi_config_set(conf));
+
+  ASSERT (gaspi_proc_init(GASPI_BLOCK));
+
+  ASSERT(gaspi_proc_num(&nprocs));
+  ASSERT (gaspi_proc_rank(&rank));
+  ASSERT (gaspi_queue_num(&qnum));
+
+  const gaspi_rank_t right = (rank + 1) % nprocs;
+  const gaspi_rank_t left = (rank + nprocs - 1) % nprocs;
+
+  ASSERT (gaspi_segment_create(0, 4 * qnum * sizeof(int), GASPI_GROUP_ALL, GASPI_BLOCK, GASPI_MEM_INITIALIZED));
+  ASSERT (gaspi_segment_ptr(0, &ptr));
+
+  int *array = (int *) ptr;
+  for(q = 0; q < qnum; q++)
+    array[q] = rank * qnum + q;
+
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+
+  //slot qnum + q from the left, 2 * qnum + q from the right
+  for(q = 0; q < qnum; q++)
+    {
+      ASSERT (gaspi_write_notify(0, q * sizeof(int), right, 0, (qnum + q) * sizeof(int), sizeof(int),
+				 q, 1 + rank, q, GASPI_BLOCK));
+      ASSERT (gaspi_write_notify(0, q * sizeof(int), left, 0, (2 * qnum + q) * sizeof(int), sizeof(int),
+				 qnum + q, 1 + rank, q, GASPI_BLOCK));
+    }
+
+  for(q = 0; q < 2 * qnum; q++)
+    {
+      ASSERT (gaspi_notify_waitsome(0, q, 1, &id, GASPI_BLOCK));
+      ASSERT (gaspi_notify_reset(0, id, &val));
+      if(val != 1 + ((q < qnum) ? left : right))
+	return EXIT_FAILURE;
+    }
+
+  for(q = 0; q < qnum; q++)
+    {
+      if(array[qnum + q] != left * qnum + q || array[2 * qnum + q] != right * qnum + q)
+	return EXIT_FAILURE;
+
+      ASSERT (gaspi_wait(q, GASPI_BLOCK));
+    }
+
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+
+  ASSERT (gaspi_segment_delete(0));
+
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+
+  //also frees the QPs left over from the races
+  if(right != rank)
+    ASSERT (gaspi_disconnect(right, GASPI_BLOCK));
+
+  ASSERT (gaspi_proc_term(GASPI_BLOCK));
+
+  return EXIT_SUCCESS;
+}
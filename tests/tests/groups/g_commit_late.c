@@ -0,0 +1,62 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <test_utils.h>
+
+#define TRIES 10
+
+/* Rank 0 tries to commit while the others have not: each try leaves
+   a group check waiting at the other ranks, and is given up on. A
+   segment registration on the same sockets is answered meanwhile,
+   before the older checks. Once the others commit, the late replies
+   to the checks given up on must be dropped and the last commit take
+   its own reply */
+int main(int argc, char *argv[])
+{
+  int t;
+  gaspi_group_t g;
+  gaspi_rank_t nprocs, myrank, i;
+
+  TSUITE_INIT(argc, argv);
+
+  ASSERT (gaspi_proc_init(GASPI_BLOCK));
+
+  ASSERT(gaspi_proc_num(&nprocs));
+  ASSERT(gaspi_proc_rank(&myrank));
+
+  if(nprocs < 2)
+    return EXIT_SUCCESS;
+
+  ASSERT (gaspi_group_create(&g));
+  for(i = 0; i < nprocs; i++)
+    ASSERT(gaspi_group_add(g, i));
+
+  if(myrank == 0)
+    {
+      ASSERT (gaspi_segment_alloc(0, 1 << 12, GASPI_MEM_INITIALIZED));
+
+      //the sockets are open before trying
+      for(i = 1; i < nprocs; i++)
+	ASSERT (gaspi_connect(i, GASPI_BLOCK));
+
+      for(t = 0; t < TRIES; t++)
+	EXPECT_TIMEOUT (gaspi_group_commit(g, 100));
+
+      for(i = 1; i < nprocs; i++)
+	ASSERT (gaspi_segment_register(0, i, GASPI_BLOCK));
+    }
+
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+
+  ASSERT (gaspi_group_commit(g, GASPI_BLOCK));
+  ASSERT (gaspi_barrier(g, GASPI_BLOCK));
+
+  if(myrank == 0)
+    ASSERT (gaspi_segment_delete(0));
+
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+  ASSERT (gaspi_proc_term(GASPI_BLOCK));
+
+  return EXIT_SUCCESS;
+}
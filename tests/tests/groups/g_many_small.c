@@ -0,0 +1,59 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <test_utils.h>
+
+#define NGROUPS 128
+
+/* Raise group_max and create many small groups (pairs of ranks),
+   using each of them for barrier and allreduce */
+int main(int argc, char *argv[])
+{
+  int i;
+  gaspi_config_t conf;
+  gaspi_number_t gmax, gsize;
+  gaspi_rank_t nprocs, myrank;
+  gaspi_group_t g[NGROUPS];
+
+  TSUITE_INIT(argc, argv);
+
+  ASSERT (gaspi_config_get(&conf));
+  conf.group_max = NGROUPS + 2;
+  ASSERT (gaspi_config_set(conf));
+
+  ASSERT (gaspi_proc_init(GASPI_BLOCK));
+
+  ASSERT(gaspi_proc_num(&nprocs));
+  ASSERT(gaspi_proc_rank(&myrank));
+
+  ASSERT (gaspi_group_max(&gmax));
+  assert(gmax == NGROUPS + 2);
+
+  const int pairs = (nprocs + 1) / 2;
+
+  for(i = 0; i < NGROUPS; i++)
+    {
+      ASSERT (gaspi_group_split(GASPI_GROUP_ALL, myrank / 2, myrank, &g[i], GASPI_BLOCK));
+
+      ASSERT (gaspi_group_size(g[i], &gsize));
+      assert(gsize == ((myrank / 2 == pairs - 1 && nprocs % 2) ? 1 : 2));
+    }
+
+  for(i = 0; i < NGROUPS; i++)
+    {
+      int send = myrank, sum;
+
+      ASSERT (gaspi_barrier(g[i], GASPI_BLOCK));
+      ASSERT (gaspi_allreduce(&send, &sum, 1, GASPI_OP_SUM, GASPI_TYPE_INT, g[i], GASPI_BLOCK));
+      assert(sum == ((gsize == 2) ? 4 * (myrank / 2) + 1 : myrank));
+    }
+
+  for(i = 0; i < NGROUPS; i++)
+    ASSERT (gaspi_group_delete(g[i]));
+
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+  ASSERT (gaspi_proc_term(GASPI_BLOCK));
+
+  return EXIT_SUCCESS;
+}
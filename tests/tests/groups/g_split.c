@@ -0,0 +1,75 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <test_utils.h>
+
+/* Split GASPI_GROUP_ALL into rows and columns of a 2D grid and
+   reduce over both */
+int main(int argc, char *argv[])
+{
+  int i;
+  gaspi_group_t row, col, half;
+  gaspi_return_t ret;
+  gaspi_number_t gsize;
+  gaspi_rank_t nprocs, myrank;
+  gaspi_rank_t *ranks;
+
+  TSUITE_INIT(argc, argv);
+
+  ASSERT (gaspi_proc_init(GASPI_BLOCK));
+
+  ASSERT(gaspi_proc_num(&nprocs));
+  ASSERT(gaspi_proc_rank(&myrank));
+
+  const int ncols = (nprocs % 2 == 0) ? 2 : 1;
+  const int nrows = nprocs / ncols;
+
+  //rows ordered backwards through the key
+  ASSERT (gaspi_group_split(GASPI_GROUP_ALL, myrank / ncols, -(int) myrank, &row, GASPI_BLOCK));
+  ASSERT (gaspi_group_split(GASPI_GROUP_ALL, myrank % ncols, myrank, &col, GASPI_BLOCK));
+
+  ASSERT (gaspi_group_size(row, &gsize));
+  assert(gsize == (gaspi_number_t) ncols);
+  ASSERT (gaspi_group_size(col, &gsize));
+  assert(gsize == (gaspi_number_t) nrows);
+
+  ranks = malloc(nprocs * sizeof(gaspi_rank_t));
+  assert(ranks != NULL);
+
+  ASSERT (gaspi_group_ranks(row, ranks));
+  for(i = 0; i < ncols; i++)
+    assert(ranks[i] == (myrank / ncols) * ncols + (ncols - 1 - i));
+
+  ASSERT (gaspi_group_ranks(col, ranks));
+  for(i = 0; i < nrows; i++)
+    assert(ranks[i] == i * ncols + myrank % ncols);
+
+  ASSERT (gaspi_barrier(row, GASPI_BLOCK));
+  ASSERT (gaspi_barrier(col, GASPI_BLOCK));
+
+  int send = myrank, sum;
+  ASSERT (gaspi_allreduce(&send, &sum, 1, GASPI_OP_SUM, GASPI_TYPE_INT, col, GASPI_BLOCK));
+  assert(sum == nrows * (myrank % ncols) + ncols * nrows * (nrows - 1) / 2);
+
+  //a split that times out completes when called again
+  do
+    ret = gaspi_group_split(GASPI_GROUP_ALL, myrank % 2, myrank, &half, GASPI_TEST);
+  while(ret == GASPI_TIMEOUT);
+  ASSERT (ret);
+
+  ASSERT (gaspi_group_size(half, &gsize));
+  assert(gsize == (gaspi_number_t) (nprocs + 1 - myrank % 2) / 2);
+  ASSERT (gaspi_barrier(half, GASPI_BLOCK));
+
+  ASSERT (gaspi_group_delete(row));
+  ASSERT (gaspi_group_delete(col));
+  ASSERT (gaspi_group_delete(half));
+
+  free(ranks);
+
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+  ASSERT (gaspi_proc_term(GASPI_BLOCK));
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <test_utils.h>
+
+//start without connecting (connect_lazy): the barrier connects its
+//partners, the write to the right neighbour and the atomic on rank
+//0 connect on first use
+int main(int argc, char *argv[])
+{
+  gaspi_config_t conf;
+  gaspi_rank_t rank, nprocs;
+  gaspi_pointer_t ptr;
+  gaspi_notification_id_t id;
+  gaspi_notification_t val;
+  gaspi_atomic_value_t old;
+
+  TSUITE_INIT(argc, argv);
+
+  ASSERT (gaspi_config_get(&conf));
+  conf.connect_lazy = 1;
+  ASSERT (gaspi_config_set(conf));
+
+  ASSERT (gaspi_proc_init(GASPI_BLOCK));
+
+  ASSERT(gaspi_proc_num(&nprocs));
+  ASSERT (gaspi_proc_rank(&rank));
+
+  const gaspi_rank_t right = (rank + 1) % nprocs;
+  const gaspi_rank_t left = (rank + nprocs - 1) % nprocs;
+
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+
+  ASSERT (gaspi_segment_create(0, 64, GASPI_GROUP_ALL, GASPI_BLOCK, GASPI_MEM_INITIALIZED));
+  ASSERT (gaspi_segment_ptr(0, &ptr));
+
+  int *array = (int *) ptr;
+  array[0] = rank;
+
+  ASSERT (gaspi_write_notify(0, 0, right, 0, sizeof(int), sizeof(int),
+			     0, 1 + rank, 0, GASPI_BLOCK));
+
+  ASSERT (gaspi_notify_waitsome(0, 0, 1, &id, GASPI_BLOCK));
+  ASSERT (gaspi_notify_reset(0, id, &val));
+  if(val != 1 + left || array[1] != left)
+    return EXIT_FAILURE;
+
+  ASSERT (gaspi_atomic_fetch_add(0, 8, 0, 1, &old, GASPI_BLOCK));
+
+  ASSERT (gaspi_wait(0, GASPI_BLOCK));
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+
+  if(rank == 0 && *(gaspi_atomic_value_t *) ((char *) ptr + 8) != nprocs)
+    return EXIT_FAILURE;
+
+  ASSERT (gaspi_segment_delete(0));
+
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+  ASSERT (gaspi_proc_term(GASPI_BLOCK));
+
+  return EXIT_SUCCESS;
+}
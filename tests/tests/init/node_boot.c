@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <test_utils.h>
+
+typedef struct
+{
+  char host[64];
+  gaspi_rank_t rank, local_rank, local_num;
+} node_entry;
+
+//ranks sharing a host take the topology from the node region of the
+//first one (run with several ranks per host): every rank sends its
+//host, rank and local rank to all, each host must hold local ranks
+//0..n-1 in rank order and the region must be gone after init
+int main(int argc, char *argv[])
+{
+  int i, j;
+  char path[64];
+  gaspi_config_t conf;
+  gaspi_rank_t rank, nprocs, local_rank, local_num, r;
+  gaspi_number_t queue_max, queue_size;
+  gaspi_pointer_t ptr;
+  gaspi_notification_id_t id;
+  gaspi_notification_t val;
+
+  TSUITE_INIT(argc, argv);
+
+  ASSERT (gaspi_proc_init(GASPI_BLOCK));
+
+  ASSERT (gaspi_proc_num(&nprocs));
+  ASSERT (gaspi_proc_rank(&rank));
+  ASSERT (gaspi_proc_local_rank(&local_rank));
+  ASSERT (gaspi_proc_local_num(&local_num));
+  ASSERT (gaspi_queue_size_max(&queue_max));
+
+  if(local_rank >= local_num)
+    return EXIT_FAILURE;
+
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+
+  ASSERT (gaspi_config_get(&conf));
+  snprintf(path, sizeof(path), "/dev/shm/gpi2_boot.%u.%u", (unsigned) getuid(), (unsigned) conf.sn_port);
+  if(access(path, F_OK) == 0)
+    return EXIT_FAILURE;
+
+  ASSERT (gaspi_segment_create(0, (nprocs + 1) * sizeof(node_entry), GASPI_GROUP_ALL, GASPI_BLOCK, GASPI_MEM_INITIALIZED));
+  ASSERT (gaspi_segment_ptr(0, &ptr));
+
+  node_entry *table = (node_entry *) ptr;
+  node_entry *mine = &table[nprocs];
+
+  gethostname(mine->host, sizeof(mine->host) - 1);
+  mine->rank = rank;
+  mine->local_rank = local_rank;
+  mine->local_num = local_num;
+
+  for(r = 0; r < nprocs; r++)
+    {
+      ASSERT (gaspi_queue_size(0, &queue_size));
+      if(queue_size + 2 > queue_max)
+	ASSERT (gaspi_wait(0, GASPI_BLOCK));
+
+      ASSERT (gaspi_write_notify(0, nprocs * sizeof(node_entry), r, 0, rank * sizeof(node_entry),
+				 sizeof(node_entry), rank, 1, 0, GASPI_BLOCK));
+    }
+
+  for(r = 0; r < nprocs; r++)
+    {
+      ASSERT (gaspi_notify_waitsome(0, r, 1, &id, GASPI_BLOCK));
+      ASSERT (gaspi_notify_reset(0, id, &val));
+    }
+
+  int shared = 0;
+  for(i = 0; i < nprocs; i++)
+    {
+      int n = 0;
+
+      if(table[i].rank != i)
+	return EXIT_FAILURE;
+
+      //the ranks of a host are numbered locally in rank order
+      for(j = 0; j < nprocs; j++)
+	{
+	  if(strcmp(table[j].host, table[i].host) != 0)
+	    continue;
+
+	  if(j < i)
+	    n++;
+	  if(table[j].local_num != table[i].local_num)
+	    return EXIT_FAILURE;
+	}
+
+      if(table[i].local_rank != n)
+	return EXIT_FAILURE;
+
+      if(table[i].local_num > 1)
+	shared = 1;
+    }
+
+  if(rank == 0 && !shared)
+    gaspi_printf("Warning: one rank per host, the node region was not used\n");
+
+  ASSERT (gaspi_wait(0, GASPI_BLOCK));
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+
+  ASSERT (gaspi_segment_delete(0));
+
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+  ASSERT (gaspi_proc_term(GASPI_BLOCK));
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <test_utils.h>
+
+#define NOTIFS 16
+#define SEGS 16
+
+//few notifications per segment: many small segments share the
+//notification pool and their notifications stay separate
+int main(int argc, char *argv[])
+{
+  gaspi_config_t conf;
+  gaspi_number_t notif_num;
+  gaspi_rank_t rank, nprocs;
+  gaspi_segment_id_t s;
+  gaspi_notification_id_t n, id;
+  gaspi_notification_t val;
+
+  TSUITE_INIT(argc, argv);
+
+  ASSERT (gaspi_config_get(&conf));
+  conf.notification_num = NOTIFS;
+  ASSERT (gaspi_config_set(conf));
+
+  ASSERT (gaspi_proc_init(GASPI_BLOCK));
+
+  ASSERT(gaspi_proc_num(&nprocs));
+  ASSERT (gaspi_proc_rank(&rank));
+
+  ASSERT( gaspi_notification_num(&notif_num));
+  if(notif_num != NOTIFS)
+    return EXIT_FAILURE;
+
+  const gaspi_rank_t right = (rank + 1) % nprocs;
+
+  for(s = 0; s < SEGS; s++)
+    ASSERT (gaspi_segment_create(s, 64, GASPI_GROUP_ALL, GASPI_BLOCK, GASPI_MEM_INITIALIZED));
+
+  //ids beyond notification_num would land in another segment's area
+  EXPECT_FAIL (gaspi_notify(0, right, NOTIFS, 1, 0, GASPI_BLOCK));
+  EXPECT_FAIL (gaspi_write_notify(0, 0, right, 1, 0, 8, NOTIFS, 1, 0, GASPI_BLOCK));
+  EXPECT_FAIL (gaspi_notify_waitsome(0, NOTIFS - 1, 2, &id, GASPI_TEST));
+  EXPECT_FAIL (gaspi_notify_reset(0, NOTIFS, &val));
+
+  for(s = 0; s < SEGS; s++)
+    for(n = 0; n < NOTIFS; n++)
+      ASSERT (gaspi_notify(s, right, n, 1 + s * NOTIFS + n, 0, GASPI_BLOCK));
+
+  ASSERT (gaspi_wait(0, GASPI_BLOCK));
+
+  for(s = 0; s < SEGS; s++)
+    for(n = 0; n < NOTIFS; n++)
+      {
+	ASSERT (gaspi_notify_waitsome(s, n, 1, &id, GASPI_BLOCK));
+	ASSERT (gaspi_notify_reset(s, id, &val));
+	if(val != (gaspi_notification_t) (1 + s * NOTIFS + n))
+	  return EXIT_FAILURE;
+      }
+
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+
+  for(s = 0; s < SEGS; s++)
+    ASSERT (gaspi_segment_delete(s));
+
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+  ASSERT (gaspi_proc_term(GASPI_BLOCK));
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <test_utils.h>
+
+#define SEG_SIZE (8 << 20)
+
+//create segments with page size and NUMA placement policies,
+//check they are zero-ed and usable for communication
+int main(int argc, char *argv[])
+{
+  int p;
+  unsigned long i;
+  gaspi_rank_t rank, nprocs;
+  gaspi_pointer_t ptr;
+
+  const gaspi_alloc_t policies[] = {
+    GASPI_MEM_INITIALIZED,
+    GASPI_MEM_HUGEPAGE,
+    GASPI_MEM_HUGEPAGE_2M | GASPI_MEM_INITIALIZED,
+    GASPI_MEM_NUMA_LOCAL,
+    GASPI_MEM_NUMA_INTERLEAVE,
+    GASPI_MEM_NUMA_NODE(0),
+    GASPI_MEM_PARALLEL_TOUCH | GASPI_MEM_INITIALIZED,
+    GASPI_MEM_HUGEPAGE | GASPI_MEM_NUMA_LOCAL | GASPI_MEM_PARALLEL_TOUCH
+  };
+
+  TSUITE_INIT(argc, argv);
+
+  ASSERT (gaspi_proc_init(GASPI_BLOCK));
+
+  ASSERT(gaspi_proc_num(&nprocs));
+  ASSERT (gaspi_proc_rank(&rank));
+
+  const gaspi_rank_t right = (rank + 1) % nprocs;
+
+  for(p = 0; p < (int) (sizeof(policies) / sizeof(policies[0])); p++)
+    {
+      ASSERT (gaspi_segment_create(0, SEG_SIZE, GASPI_GROUP_ALL, GASPI_BLOCK, policies[p]));
+      ASSERT (gaspi_segment_ptr(0, &ptr));
+
+      unsigned long *data = (unsigned long *) ptr;
+      const unsigned long n = SEG_SIZE / sizeof(unsigned long) / 2;
+
+      if(policies[p] & GASPI_MEM_INITIALIZED)
+	for(i = 0; i < 2 * n; i++)
+	  if(data[i] != 0)
+	    return EXIT_FAILURE;
+
+      for(i = 0; i < n; i++)
+	data[i] = rank + i;
+
+      ASSERT(gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+
+      ASSERT (gaspi_write(0, 0, right, 0, n * sizeof(unsigned long), n * sizeof(unsigned long), 0, GASPI_BLOCK));
+      ASSERT (gaspi_wait(0, GASPI_BLOCK));
+
+      ASSERT(gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+
+      const gaspi_rank_t left = (rank + nprocs - 1) % nprocs;
+      for(i = 0; i < n; i++)
+	if(data[n + i] != left + i)
+	  {
+	    gaspi_printf("Wrong data with policy %lu\n", policies[p]);
+	    return EXIT_FAILURE;
+	  }
+
+      ASSERT(gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+      ASSERT (gaspi_segment_delete(0));
+    }
+
+  ASSERT(gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+  ASSERT (gaspi_proc_term(GASPI_BLOCK));
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <test_utils.h>
+
+#define ELEMS 1024
+
+//file backed segment: written by the left neighbour, flushed,
+//deleted and mapped again with its content
+int main(int argc, char *argv[])
+{
+  int i;
+  char path[128];
+  gaspi_rank_t rank, nprocs;
+  gaspi_pointer_t ptr;
+
+  TSUITE_INIT(argc, argv);
+
+  ASSERT (gaspi_proc_init(GASPI_BLOCK));
+
+  ASSERT(gaspi_proc_num(&nprocs));
+  ASSERT (gaspi_proc_rank(&rank));
+
+  const gaspi_rank_t right = (rank + 1) % nprocs;
+  const gaspi_rank_t left = (rank + nprocs - 1) % nprocs;
+
+  snprintf(path, sizeof(path), "/dev/shm/gpi2_seg_file.%d.%u", getpid(), rank);
+  unlink(path);
+
+  ASSERT (gaspi_segment_alloc_file(0, path, 2 * ELEMS * sizeof(int)));
+  ASSERT (gaspi_segment_ptr(0, &ptr));
+
+  int *array = (int *) ptr;
+  for(i = 0; i < ELEMS; i++)
+    array[i] = rank;
+
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+
+  ASSERT (gaspi_write(0, 0, right, 0, ELEMS * sizeof(int), ELEMS * sizeof(int), 0, GASPI_BLOCK));
+  ASSERT (gaspi_wait(0, GASPI_BLOCK));
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+
+  ASSERT (gaspi_segment_sync(0, 0, 2 * ELEMS * sizeof(int), GASPI_SYNC_ASYNC));
+  ASSERT (gaspi_segment_sync(0, ELEMS * sizeof(int), ELEMS * sizeof(int), GASPI_SYNC_WAIT));
+  EXPECT_FAIL (gaspi_segment_sync(0, ELEMS * sizeof(int), 2 * ELEMS * sizeof(int), GASPI_SYNC_WAIT));
+
+  ASSERT (gaspi_segment_delete(0));
+
+  //restart
+  ASSERT (gaspi_segment_alloc_file(0, path, 2 * ELEMS * sizeof(int)));
+  ASSERT (gaspi_segment_ptr(0, &ptr));
+
+  array = (int *) ptr;
+  for(i = 0; i < ELEMS; i++)
+    if(array[i] != rank || array[ELEMS + i] != left)
+      return EXIT_FAILURE;
+
+  ASSERT (gaspi_segment_delete(0));
+  unlink(path);
+
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+  ASSERT (gaspi_proc_term(GASPI_BLOCK));
+
+  return EXIT_SUCCESS;
+}
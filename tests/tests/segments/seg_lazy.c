@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <test_utils.h>
+
+#define ELEMS 1024
+
+//create segments without registration (segment_lazy): the right
+//neighbour's info is fetched on the first write, the left one's
+//is prefetched
+int main(int argc, char *argv[])
+{
+  int i;
+  gaspi_config_t conf;
+  gaspi_rank_t rank, nprocs;
+  gaspi_pointer_t ptr;
+  gaspi_notification_id_t id;
+  gaspi_notification_t val;
+  gaspi_size_t size;
+
+  TSUITE_INIT(argc, argv);
+
+  ASSERT (gaspi_config_get(&conf));
+  conf.segment_lazy = 1;
+  ASSERT (gaspi_config_set(conf));
+
+  ASSERT (gaspi_proc_init(GASPI_BLOCK));
+
+  ASSERT(gaspi_proc_num(&nprocs));
+  ASSERT (gaspi_proc_rank(&rank));
+
+  const gaspi_rank_t right = (rank + 1) % nprocs;
+  const gaspi_rank_t left = (rank + nprocs - 1) % nprocs;
+
+  ASSERT (gaspi_segment_create(0, 2 * ELEMS * sizeof(int), GASPI_GROUP_ALL, GASPI_BLOCK, GASPI_MEM_INITIALIZED));
+  ASSERT (gaspi_segment_ptr(0, &ptr));
+
+  int *array = (int *) ptr;
+  for(i = 0; i < ELEMS; i++)
+    array[i] = rank;
+
+  if(left != rank)
+    {
+      ASSERT (gaspi_segment_prefetch(0, &left, 1, GASPI_BLOCK));
+      ASSERT (gaspi_segment_size(0, left, &size));
+      if(size != 2 * ELEMS * sizeof(int))
+	return EXIT_FAILURE;
+
+      //a segment that does not exist cannot be fetched
+      EXPECT_FAIL (gaspi_segment_prefetch(1, &left, 1, GASPI_BLOCK));
+    }
+
+  ASSERT (gaspi_write_notify(0, 0, right, 0, ELEMS * sizeof(int), ELEMS * sizeof(int),
+			     0, 1 + rank, 0, GASPI_BLOCK));
+
+  ASSERT (gaspi_notify_waitsome(0, 0, 1, &id, GASPI_BLOCK));
+  ASSERT (gaspi_notify_reset(0, id, &val));
+  if(val != 1 + left)
+    return EXIT_FAILURE;
+
+  for(i = 0; i < ELEMS; i++)
+    if(array[ELEMS + i] != left)
+      return EXIT_FAILURE;
+
+  ASSERT (gaspi_wait(0, GASPI_BLOCK));
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+
+  ASSERT (gaspi_segment_delete(0));
+
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+  ASSERT (gaspi_proc_term(GASPI_BLOCK));
+
+  return EXIT_SUCCESS;
+}
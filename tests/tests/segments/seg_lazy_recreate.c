@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <test_utils.h>
+
+#define ELEMS 1024
+
+//write to a lazily fetched segment, delete and recreate it with
+//another size and write again: the cached remote info must not be
+//the one of the deleted segment
+static int
+write_and_check(const gaspi_rank_t rank, const gaspi_rank_t right,
+		const gaspi_rank_t left, const int elems, const int tag)
+{
+  int i;
+  gaspi_pointer_t ptr;
+  gaspi_notification_id_t id;
+  gaspi_notification_t val;
+
+  ASSERT (gaspi_segment_ptr(0, &ptr));
+
+  int *array = (int *) ptr;
+  for(i = 0; i < elems; i++)
+    array[i] = tag + rank;
+
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+
+  ASSERT (gaspi_write_notify(0, 0, right, 0, elems * sizeof(int), elems * sizeof(int),
+			     0, 1 + rank, 0, GASPI_BLOCK));
+
+  ASSERT (gaspi_notify_waitsome(0, 0, 1, &id, GASPI_BLOCK));
+  ASSERT (gaspi_notify_reset(0, id, &val));
+  if(val != 1 + left)
+    return -1;
+
+  for(i = 0; i < elems; i++)
+    if(array[elems + i] != tag + left)
+      return -1;
+
+  ASSERT (gaspi_wait(0, GASPI_BLOCK));
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  gaspi_config_t conf;
+  gaspi_rank_t rank, nprocs;
+  gaspi_size_t size;
+
+  TSUITE_INIT(argc, argv);
+
+  ASSERT (gaspi_config_get(&conf));
+  conf.segment_lazy = 1;
+  ASSERT (gaspi_config_set(conf));
+
+  ASSERT (gaspi_proc_init(GASPI_BLOCK));
+
+  ASSERT(gaspi_proc_num(&nprocs));
+  ASSERT (gaspi_proc_rank(&rank));
+
+  const gaspi_rank_t right = (rank + 1) % nprocs;
+  const gaspi_rank_t left = (rank + nprocs - 1) % nprocs;
+
+  ASSERT (gaspi_segment_create(0, 2 * ELEMS * sizeof(int), GASPI_GROUP_ALL, GASPI_BLOCK, GASPI_MEM_INITIALIZED));
+  if(write_and_check(rank, right, left, ELEMS, 0) != 0)
+    return EXIT_FAILURE;
+
+  ASSERT (gaspi_segment_delete(0));
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+
+  //recreated larger, so a stale size or key would show up
+  ASSERT (gaspi_segment_create(0, 8 * ELEMS * sizeof(int), GASPI_GROUP_ALL, GASPI_BLOCK, GASPI_MEM_INITIALIZED));
+  if(write_and_check(rank, right, left, 4 * ELEMS, 1000) != 0)
+    return EXIT_FAILURE;
+
+  if(right != rank)
+    {
+      ASSERT (gaspi_segment_size(0, right, &size));
+      if(size != 8 * ELEMS * sizeof(int))
+	return EXIT_FAILURE;
+    }
+
+  ASSERT (gaspi_segment_delete(0));
+
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+  ASSERT (gaspi_proc_term(GASPI_BLOCK));
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <test_utils.h>
+
+#define SEG_SIZE (1 << 20)
+#define PAGE (1 << 16)
+#define TAIL_SIZE (3 * PAGE + 1000)
+
+//sub-allocate a segment: classes, large blocks, reuse after free
+//and the remote heap, used by the left neighbour
+int main(int argc, char *argv[])
+{
+  int i;
+  gaspi_rank_t rank, nprocs;
+  gaspi_pointer_t ptr;
+  gaspi_offset_t off[48], big, again, roff;
+  gaspi_notification_id_t id;
+  gaspi_notification_t val;
+
+  TSUITE_INIT(argc, argv);
+
+  ASSERT (gaspi_proc_init(GASPI_BLOCK));
+
+  ASSERT(gaspi_proc_num(&nprocs));
+  ASSERT (gaspi_proc_rank(&rank));
+
+  const gaspi_rank_t right = (rank + 1) % nprocs;
+
+  ASSERT (gaspi_segment_create(0, SEG_SIZE, GASPI_GROUP_ALL, GASPI_BLOCK, GASPI_MEM_INITIALIZED));
+  ASSERT (gaspi_segment_ptr(0, &ptr));
+
+  ASSERT (gaspi_segment_remote_heap(0, 64));
+  EXPECT_FAIL (gaspi_segment_remote_heap(0, 64));
+
+  for(i = 0; i < 48; i++)
+    {
+      ASSERT (gaspi_segment_malloc(0, 1 + i * 61, &off[i]));
+      if(off[i] < 64 || off[i] + 1 + i * 61 > SEG_SIZE)
+	return EXIT_FAILURE;
+      memset((char *) ptr + off[i], i, 1 + i * 61);
+    }
+
+  for(i = 0; i < 48; i++)
+    {
+      const unsigned char *b = (unsigned char *) ptr + off[i];
+      if(b[0] != i || b[i * 61] != i)
+	return EXIT_FAILURE;
+    }
+
+  ASSERT (gaspi_segment_malloc(0, SEG_SIZE / 4, &big));
+  if(big % 65536)
+    return EXIT_FAILURE;
+  EXPECT_FAIL (gaspi_segment_malloc(0, SEG_SIZE, &again));
+
+  //freed blocks are reused
+  ASSERT (gaspi_segment_free(0, off[10]));
+  ASSERT (gaspi_segment_malloc(0, 1 + 10 * 61, &again));
+  if(again != off[10])
+    return EXIT_FAILURE;
+
+  ASSERT (gaspi_segment_free(0, big));
+  ASSERT (gaspi_segment_malloc(0, SEG_SIZE / 4, &again));
+  if(again != big)
+    return EXIT_FAILURE;
+  ASSERT (gaspi_segment_free(0, again));
+  EXPECT_FAIL (gaspi_segment_free(0, 8));
+  EXPECT_FAIL (gaspi_segment_free(1, off[0]));
+
+  for(i = 0; i < 48; i++)
+    ASSERT (gaspi_segment_free(0, off[i]));
+
+  //the last, partial page of a segment: the tail block comes from
+  //the break and goes back there whole
+  ASSERT (gaspi_segment_create(1, TAIL_SIZE, GASPI_GROUP_ALL, GASPI_BLOCK, GASPI_MEM_UNINITIALIZED));
+  ASSERT (gaspi_segment_malloc(1, PAGE, &off[0]));
+  ASSERT (gaspi_segment_malloc(1, 2 * PAGE + 500, &off[1]));
+  if(off[1] != off[0] + PAGE)
+    return EXIT_FAILURE;
+  ASSERT (gaspi_segment_free(1, off[1]));
+
+  ASSERT (gaspi_segment_malloc(1, PAGE, &off[1]));
+  ASSERT (gaspi_segment_malloc(1, PAGE + 500, &off[2]));
+  EXPECT_FAIL (gaspi_segment_malloc(1, 64, &again));
+  if(off[1] < off[0] + PAGE || off[2] < off[1] + PAGE
+     || off[2] + PAGE + 500 > TAIL_SIZE)
+    return EXIT_FAILURE;
+
+  for(i = 0; i < 3; i++)
+    ASSERT (gaspi_segment_free(1, off[i]));
+  ASSERT (gaspi_segment_malloc(1, TAIL_SIZE, &again));
+  if(again != 0)
+    return EXIT_FAILURE;
+  ASSERT (gaspi_segment_delete(1));
+
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+
+  //reserve in the right neighbour's remote heap and write there
+  ASSERT (gaspi_segment_malloc(0, sizeof(int), &off[0]));
+  *(int *) ((char *) ptr + off[0]) = rank;
+
+  //a request that does not fit leaves the rest for smaller ones
+  ASSERT (gaspi_segment_remote_malloc(0, right, 40, &roff, GASPI_BLOCK));
+  EXPECT_FAIL (gaspi_segment_remote_malloc(0, right, 32, &again, GASPI_BLOCK));
+  ASSERT (gaspi_segment_remote_malloc(0, right, 24, &again, GASPI_BLOCK));
+  if(again != 0 || roff != 24)
+    return EXIT_FAILURE;
+  EXPECT_FAIL (gaspi_segment_remote_malloc(0, right, 8, &again, GASPI_BLOCK));
+
+  ASSERT (gaspi_write_notify(0, off[0], right, 0, roff, sizeof(int),
+			     0, 1 + roff, 0, GASPI_BLOCK));
+
+  ASSERT (gaspi_notify_waitsome(0, 0, 1, &id, GASPI_BLOCK));
+  ASSERT (gaspi_notify_reset(0, id, &val));
+  if(*(int *) ((char *) ptr + val - 1) != (rank + nprocs - 1) % nprocs)
+    return EXIT_FAILURE;
+
+  ASSERT (gaspi_wait(0, GASPI_BLOCK));
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+
+  ASSERT (gaspi_segment_delete(0));
+
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+  ASSERT (gaspi_proc_term(GASPI_BLOCK));
+
+  return EXIT_SUCCESS;
+}
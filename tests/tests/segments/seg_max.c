@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <test_utils.h>
+
+//raise segment_max to the whole segment id range, create all
+//segments, write to the right neighbour through each of them
+//and delete them
+int main(int argc, char *argv[])
+{
+  int s;
+  gaspi_config_t conf;
+  gaspi_number_t seg_max;
+  gaspi_rank_t rank, nprocs;
+  gaspi_pointer_t ptr;
+
+  TSUITE_INIT(argc, argv);
+
+  ASSERT (gaspi_config_get(&conf));
+  conf.segment_max = 257;
+  EXPECT_FAIL (gaspi_config_set(conf));
+  conf.segment_max = 256;
+  ASSERT (gaspi_config_set(conf));
+
+  ASSERT (gaspi_proc_init(GASPI_BLOCK));
+
+  ASSERT(gaspi_proc_num(&nprocs));
+  ASSERT (gaspi_proc_rank(&rank));
+
+  ASSERT(gaspi_segment_max(&seg_max));
+  assert(seg_max == 256);
+
+  const gaspi_rank_t right = (rank + 1) % nprocs;
+
+  for (s = 0; s < seg_max; s++)
+    {
+      ASSERT (gaspi_segment_create(s, 2 * sizeof(int), GASPI_GROUP_ALL, GASPI_BLOCK, GASPI_MEM_INITIALIZED));
+      ASSERT (gaspi_segment_ptr(s, &ptr));
+      ((int *) ptr)[0] = s;
+    }
+
+  for (s = 0; s < seg_max; s++)
+    ASSERT (gaspi_write(s, 0, right, s, sizeof(int), sizeof(int), 0, GASPI_BLOCK));
+
+  ASSERT (gaspi_wait(0, GASPI_BLOCK));
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+
+  for (s = 0; s < seg_max; s++)
+    {
+      ASSERT (gaspi_segment_ptr(s, &ptr));
+      if (((int *) ptr)[1] != s)
+	return EXIT_FAILURE;
+    }
+
+  for (s = 0; s < seg_max; s++)
+    ASSERT (gaspi_segment_delete(s));
+
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+  ASSERT (gaspi_proc_term(GASPI_BLOCK));
+
+  return EXIT_SUCCESS;
+}
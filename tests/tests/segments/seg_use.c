@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <test_utils.h>
+
+#define ELEMS (1 << 20)
+
+//use application memory as a segment, communicate in place with
+//notifications and check the memory survives the segment deletion
+int main(int argc, char *argv[])
+{
+  int i;
+  gaspi_rank_t rank, nprocs;
+  gaspi_pointer_t ptr;
+  gaspi_notification_id_t id;
+  gaspi_notification_t val;
+
+  TSUITE_INIT(argc, argv);
+
+  ASSERT (gaspi_proc_init(GASPI_BLOCK));
+
+  ASSERT(gaspi_proc_num(&nprocs));
+  ASSERT (gaspi_proc_rank(&rank));
+
+  const gaspi_rank_t right = (rank + 1) % nprocs;
+  const gaspi_rank_t left = (rank + nprocs - 1) % nprocs;
+
+  int *array = malloc(2 * ELEMS * sizeof(int));
+  if(array == NULL)
+    return EXIT_FAILURE;
+
+  for(i = 0; i < ELEMS; i++)
+    {
+      array[i] = rank;
+      array[ELEMS + i] = -1;
+    }
+
+  ASSERT (gaspi_segment_use(0, array, 2 * ELEMS * sizeof(int), GASPI_GROUP_ALL, GASPI_BLOCK, 0));
+
+  ASSERT (gaspi_segment_ptr(0, &ptr));
+  if(ptr != array)
+    return EXIT_FAILURE;
+
+  //binding an existing segment id fails
+  EXPECT_FAIL (gaspi_segment_bind(0, array, sizeof(int), 0));
+
+  ASSERT (gaspi_write_notify(0, 0, right, 0, ELEMS * sizeof(int), ELEMS * sizeof(int),
+			     0, 1 + rank, 0, GASPI_BLOCK));
+
+  ASSERT (gaspi_notify_waitsome(0, 0, 1, &id, GASPI_BLOCK));
+  ASSERT (gaspi_notify_reset(0, id, &val));
+  if(val != 1 + left)
+    return EXIT_FAILURE;
+
+  for(i = 0; i < ELEMS; i++)
+    if(array[ELEMS + i] != left)
+      return EXIT_FAILURE;
+
+  ASSERT (gaspi_wait(0, GASPI_BLOCK));
+  ASSERT(gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+
+  ASSERT (gaspi_segment_delete(0));
+
+  //still owned by the application
+  for(i = 0; i < ELEMS; i++)
+    array[i] = array[ELEMS + i];
+
+  free(array);
+
+  ASSERT(gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+  ASSERT (gaspi_proc_term(GASPI_BLOCK));
+
+  return EXIT_SUCCESS;
+}
@@ -25,7 +25,11 @@ static gaspi_config_t tsuite_default_config =
     GASPI_MAX_TSIZE_P,		//passive_transfer_size_max;
     278592,			//allreduce_buf_size;
     255,				//allreduce_elem_max;
-    1				//build_infrastructure;  
+    1,				//build_infrastructure;  
+    0,				//allreduce_reproducible;
+    0,				//segment_lazy;
+    0,				//connect_lazy;
+    1000			//queue_lazy_tnc;
   };
 
 #define _4GB 4294967296
@@ -0,0 +1,39 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <test_utils.h>
+
+//library memory: an endpoint per peer after the full connect,
+//one more segment table once a segment exists
+int main(int argc, char *argv[])
+{
+  gaspi_rank_t nprocs;
+  gaspi_number_t peers;
+  gaspi_size_t peer_bytes, total_bytes, total_seg;
+
+  TSUITE_INIT(argc, argv);
+
+  EXPECT_FAIL (gaspi_memory_report(&peers, &peer_bytes, &total_bytes));
+
+  ASSERT (gaspi_proc_init(GASPI_BLOCK));
+  ASSERT (gaspi_proc_num(&nprocs));
+
+  ASSERT (gaspi_memory_report(&peers, &peer_bytes, &total_bytes));
+  gaspi_printf("%u peers: %lu bytes per peer state, %lu bytes in total\n",
+	       peers, peer_bytes, total_bytes);
+
+  if(peers != nprocs || peer_bytes == 0 || total_bytes < peer_bytes)
+    return EXIT_FAILURE;
+
+  ASSERT (gaspi_segment_create(0, 4096, GASPI_GROUP_ALL, GASPI_BLOCK, GASPI_MEM_UNINITIALIZED));
+  ASSERT (gaspi_memory_report(&peers, &peer_bytes, &total_seg));
+  if(total_seg <= total_bytes)
+    return EXIT_FAILURE;
+
+  ASSERT (gaspi_segment_delete(0));
+
+  ASSERT (gaspi_barrier(GASPI_GROUP_ALL, GASPI_BLOCK));
+  ASSERT (gaspi_proc_term(GASPI_BLOCK));
+
+  return EXIT_SUCCESS;
+}